@@ -0,0 +1,91 @@
+// Audio deinterleave throughput: converts a second of synthetic 16 channel, 48 kHz capture audio to planar float with
+// convertAudioToFloat(), from 16 and 32-bit samples, in packets of one 59.94 Hz video frame (1602 sample frames) the way
+// DeckLinkInput::readAudioFloat() hands them over. Channels in order and reversed by a routing table, with every SIMD level
+// the machine supports, single threaded. Prints the best time per second of audio, the share of one core that is, and
+// the speedup over the scalar kernel.
+// Standalone, it only needs the conversion sources:
+//
+//   g++ -std=c++14 -O2 -Iinclude benchmark/AudioDeinterleave.cpp src/AudioConversion.cpp src/CpuFeatures.cpp
+//   cl /O2 /EHsc /Iinclude benchmark\AudioDeinterleave.cpp src\AudioConversion.cpp src\CpuFeatures.cpp
+//
+// Usage: AudioDeinterleave [seconds].
+
+#include "AudioConversion.h"
+#include "CpuFeatures.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	const size_t kChannels = 16;
+	const size_t kSampleRate = 48000;
+	const size_t kPacketFrames = 1602;
+
+	// Fastest of the runs, a preemption in the middle of one would otherwise weigh on the mean.
+	double timeRuns( const std::function<void()>& convert, int runs )
+	{
+		convert();
+		double best = 0.0;
+		for( int run = 0; run < runs; ++run ) {
+			const auto begin = std::chrono::steady_clock::now();
+			convert();
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - begin ).count();
+			best = run == 0 || ms < best ? ms : best;
+		}
+		return best;
+	}
+
+	template<typename T>
+	void benchmark( const char * name, const std::vector<SimdLevel>& levels, int runs )
+	{
+		std::vector<T> src( kSampleRate * kChannels );
+		uint32_t seed = 1;
+		for( auto& sample : src ) {
+			seed = seed * 1664525u + 1013904223u;
+			sample = T( seed >> ( 32 - 8 * sizeof( T ) ) );
+		}
+		std::vector<std::vector<float>> planes( kChannels, std::vector<float>( kSampleRate ) );
+
+		int reversed[kChannels];
+		for( size_t c = 0; c < kChannels; ++c )
+			reversed[c] = int( kChannels - 1 - c );
+
+		std::printf( "%s, 16 channels, best ms per second of audio (share of one core)\n", name );
+		const int * routings[] = { nullptr, reversed };
+		for( const int * routing : routings ) {
+			double scalarMs = 0.0;
+			for( SimdLevel level : levels ) {
+				const double ms = timeRuns( [&] {
+					float * dst[kChannels];
+					for( size_t offset = 0; offset < kSampleRate; offset += kPacketFrames ) {
+						const size_t frames = kSampleRate - offset < kPacketFrames ? kSampleRate - offset : kPacketFrames;
+						for( size_t c = 0; c < kChannels; ++c )
+							dst[c] = planes[c].data() + offset;
+						convertAudioToFloat( src.data() + offset * kChannels, kChannels, frames, dst, kChannels, routing, level );
+					}
+				}, runs );
+				scalarMs = level == SimdLevel::SCALAR ? ms : scalarMs;
+				std::printf( "  %-8s %-8s %8.3f (%5.2f%%)  %5.2fx\n", routing ? "reversed" : "in order", getSimdLevelName( level ), ms, ms / 10.0, scalarMs / ms );
+			}
+		}
+	}
+}
+
+int main( int argc, char * argv[] )
+{
+	const int runs = argc > 1 ? std::atoi( argv[1] ) : 20;
+	std::vector<SimdLevel> levels;
+	for( SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON } ) {
+		if( isSimdLevelSupported( level ) )
+			levels.push_back( level );
+	}
+
+	benchmark<int16_t>( "16-bit", levels, runs );
+	benchmark<int32_t>( "32-bit", levels, runs );
+	return 0;
+}
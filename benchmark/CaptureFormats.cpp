@@ -0,0 +1,106 @@
+// Capture format throughput: unpacks synthetic 8-bit UYVY and 10-bit v210 frames at 1080p and UHD with every SIMD level
+// the machine supports, single threaded, and prints the best time per frame and the frame rate one core sustains. v210
+// has no SSE2 kernel (the unpack shuffle needs SSSE3), the SSE2 row runs the very same scalar functions and its v210
+// columns should match the scalar row; a gap between the two is a measure of how noisy the machine is.
+// Standalone, it only needs the conversion sources:
+//
+//   g++ -std=c++14 -O2 -Iinclude benchmark/CaptureFormats.cpp src/VideoConversion.cpp src/VideoConversionV210.cpp src/VideoConversionRGB.cpp src/CpuFeatures.cpp
+//   cl /O2 /EHsc /Iinclude benchmark\CaptureFormats.cpp src\VideoConversion.cpp src\VideoConversionV210.cpp src\VideoConversionRGB.cpp src\CpuFeatures.cpp
+//
+// Usage: CaptureFormats [frames].
+
+#include "CpuFeatures.h"
+#include "VideoConversion.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	const int kRounds = 3;
+
+	struct Resolution {
+		const char *	name;
+		long			width, height;
+	};
+
+	void fillRandom( std::vector<uint8_t>& bytes )
+	{
+		uint32_t seed = 1;
+		for( auto& byte : bytes ) {
+			seed = seed * 1664525u + 1013904223u;
+			byte = uint8_t( seed >> 24 );
+		}
+	}
+
+	// Fastest of the frames rather than the mean: on a shared or busy machine a single preemption or frequency dip
+	// skews the mean of a few frames by more than the differences being measured.
+	double timeFrames( const std::function<void()>& convert, int frames )
+	{
+		convert();
+		double best = 0.0;
+		for( int frame = 0; frame < frames; ++frame ) {
+			const auto begin = std::chrono::steady_clock::now();
+			convert();
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - begin ).count();
+			best = frame == 0 || ms < best ? ms : best;
+		}
+		return best;
+	}
+}
+
+int main( int argc, char * argv[] )
+{
+	const int frames = argc > 1 ? std::atoi( argv[1] ) : 20;
+	std::vector<SimdLevel> levels;
+	for( SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON } ) {
+		if( isSimdLevelSupported( level ) )
+			levels.push_back( level );
+	}
+
+	const Resolution resolutions[] = { { "1080p", 1920, 1080 }, { "UHD", 3840, 2160 } };
+	for( const auto& resolution : resolutions ) {
+		const long width = resolution.width;
+		const long height = resolution.height;
+		const size_t uyvyRowBytes = size_t( width ) * 2;
+		const size_t v210RowBytes = getV210RowBytes( width );
+		std::vector<uint8_t> uyvy( uyvyRowBytes * height ), v210( v210RowBytes * height );
+		fillRandom( uyvy );
+		fillRandom( v210 );
+		std::vector<uint8_t> bgra( size_t( width ) * 4 * height );
+		std::vector<uint16_t> y( size_t( width ) * height ), cb( size_t( ( width + 1 ) / 2 ) * height ), cr( cb.size() );
+		std::vector<uint16_t> rgba( size_t( width ) * 4 * height );
+
+		std::printf( "%s %ldx%ld, best ms/frame (frames/s on one core)\n", resolution.name, width, height );
+		std::printf( "  %-8s %20s %20s %20s %20s\n", "", "UYVY->BGRA8", "v210->YUV422P16", "v210->RGBA16", "v210->RGBAHalf" );
+		// Levels take turns over several rounds, each cell keeping its best: a slow patch of the machine then hits
+		// every level instead of whichever one happened to run during it.
+		std::vector<std::array<double, 4>> best( levels.size() );
+		for( int round = 0; round < kRounds; ++round ) {
+			for( size_t i = 0; i < levels.size(); ++i ) {
+				const SimdLevel level = levels[i];
+				const double ms[4] = {
+					timeFrames( [&] { convertUYVYToBGRA( uyvy.data(), uyvyRowBytes, bgra.data(), size_t( width ) * 4, width, height, YCbCrMatrix::BT709, level ); }, frames ),
+					timeFrames( [&] { convertV210ToYUV422P16( v210.data(), v210RowBytes, y.data(), size_t( width ) * 2, cb.data(), size_t( ( width + 1 ) / 2 ) * 2, cr.data(), size_t( ( width + 1 ) / 2 ) * 2, width, height, level ); }, frames ),
+					timeFrames( [&] { convertV210ToRGBA16( v210.data(), v210RowBytes, rgba.data(), size_t( width ) * 8, width, height, YCbCrMatrix::BT709, level ); }, frames ),
+					timeFrames( [&] { convertV210ToRGBAHalf( v210.data(), v210RowBytes, rgba.data(), size_t( width ) * 8, width, height, YCbCrMatrix::BT709, level ); }, frames )
+				};
+				for( size_t column = 0; column < 4; ++column )
+					best[i][column] = round == 0 || ms[column] < best[i][column] ? ms[column] : best[i][column];
+			}
+		}
+
+		for( size_t i = 0; i < levels.size(); ++i ) {
+			std::printf( "  %-8s", getSimdLevelName( levels[i] ) );
+			for( double ms : best[i] )
+				std::printf( " %10.2f (%6.0f)", ms, 1000.0 / ms );
+			std::printf( "\n" );
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,213 @@
+// Output resampling throughput: scales synthetic 8-bit frames to the BGRA output size the way DeckLinkOutput::sendSurface()
+// does, with ImageResampler at every SIMD level the machine supports, against a naive two-pass resampler: a float vertical
+// pass over the whole source into an intermediate float image, then a float horizontal pass and the channel swizzle. Both
+// use the same filters with the weights computed once, so the gap is the fused single pass and the fixed point SIMD
+// kernels rather than the kernel setup. Single threaded, prints the best time per frame and the largest difference
+// between the two outputs, which should stay within a couple of codes.
+// Standalone, it only needs the resampler sources:
+//
+//   g++ -std=c++14 -O2 -Iinclude benchmark/ImageResample.cpp src/ImageResampler.cpp src/CpuFeatures.cpp
+//   cl /O2 /EHsc /Iinclude benchmark\ImageResample.cpp src\ImageResampler.cpp src\CpuFeatures.cpp
+//
+// Usage: ImageResample [frames].
+
+#include "CpuFeatures.h"
+#include "ImageResampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	struct Scenario {
+		const char *	name;
+		long			srcWidth, srcHeight;
+		PixelLayout		layout;
+		long			dstWidth, dstHeight;
+	};
+
+	const char * getFilterName( ResampleFilter filter )
+	{
+		switch( filter ) {
+		case ResampleFilter::NEAREST:	return "nearest";
+		case ResampleFilter::LANCZOS3:	return "lanczos3";
+		default:						return "bilinear";
+		}
+	}
+
+	size_t getPixelBytes( PixelLayout layout )
+	{
+		return layout == PixelLayout::RGB || layout == PixelLayout::BGR ? 3 : 4;
+	}
+
+	// Fastest of the frames, a preemption in the middle of a run would otherwise weigh on the mean.
+	double timeFrames( const std::function<void()>& resample, int frames )
+	{
+		resample();
+		double best = 0.0;
+		for( int frame = 0; frame < frames; ++frame ) {
+			const auto begin = std::chrono::steady_clock::now();
+			resample();
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - begin ).count();
+			best = frame == 0 || ms < best ? ms : best;
+		}
+		return best;
+	}
+
+	//! The textbook separable resampler: float weights, one full pass per axis through an intermediate image.
+	class NaiveResampler {
+	public:
+		NaiveResampler( long srcWidth, long srcHeight, PixelLayout layout, long dstWidth, long dstHeight, ResampleFilter filter )
+			: mSrcWidth( srcWidth ), mSrcHeight( srcHeight ), mDstWidth( dstWidth ), mDstHeight( dstHeight ), mLayout( layout ),
+			mIntermediate( size_t( srcWidth ) * dstHeight * 4 )
+		{
+			computeWeights( srcWidth, dstWidth, filter, &mHorizontal );
+			computeWeights( srcHeight, dstHeight, filter, &mVertical );
+		}
+
+		void resample( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes )
+		{
+			const size_t pixelBytes = getPixelBytes( mLayout );
+			const bool hasAlpha = mLayout == PixelLayout::RGBA || mLayout == PixelLayout::BGRA;
+			const bool rgbOrder = mLayout == PixelLayout::RGB || mLayout == PixelLayout::RGBA || mLayout == PixelLayout::RGBX;
+
+			// Vertical: every intermediate row, as B, G, R, A floats.
+			for( long y = 0; y < mDstHeight; ++y ) {
+				float * out = &mIntermediate[size_t( y ) * mSrcWidth * 4];
+				for( long x = 0; x < mSrcWidth; ++x ) {
+					float b = 0.0f, g = 0.0f, r = 0.0f, a = 0.0f;
+					for( const Tap& tap : mVertical[y] ) {
+						const uint8_t * pixel = src + size_t( tap.index ) * srcRowBytes + size_t( x ) * pixelBytes;
+						r += tap.weight * pixel[rgbOrder ? 0 : 2];
+						g += tap.weight * pixel[1];
+						b += tap.weight * pixel[rgbOrder ? 2 : 0];
+						a += tap.weight * ( hasAlpha ? pixel[3] : 255.0f );
+					}
+					out[x * 4 + 0] = b;
+					out[x * 4 + 1] = g;
+					out[x * 4 + 2] = r;
+					out[x * 4 + 3] = a;
+				}
+			}
+
+			// Horizontal, straight into the BGRA destination.
+			for( long y = 0; y < mDstHeight; ++y ) {
+				const float * in = &mIntermediate[size_t( y ) * mSrcWidth * 4];
+				uint8_t * out = dst + size_t( y ) * dstRowBytes;
+				for( long x = 0; x < mDstWidth; ++x ) {
+					float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+					for( const Tap& tap : mHorizontal[x] ) {
+						for( int c = 0; c < 4; ++c )
+							sum[c] += tap.weight * in[tap.index * 4 + c];
+					}
+					for( int c = 0; c < 4; ++c ) {
+						const float value = std::floor( sum[c] + 0.5f );
+						out[x * 4 + c] = uint8_t( value < 0.0f ? 0.0f : ( value > 255.0f ? 255.0f : value ) );
+					}
+				}
+			}
+		}
+	private:
+		struct Tap {
+			long	index;
+			float	weight;
+		};
+
+		static double evaluate( ResampleFilter filter, double x )
+		{
+			const double pi = 3.14159265358979323846;
+			x = std::fabs( x );
+			if( filter == ResampleFilter::LANCZOS3 ) {
+				if( x >= 3.0 )
+					return 0.0;
+				return x < 1e-8 ? 1.0 : 3.0 * std::sin( pi * x ) * std::sin( pi * x / 3.0 ) / ( pi * pi * x * x );
+			}
+			return x < 1.0 ? 1.0 - x : 0.0;
+		}
+
+		static void computeWeights( long srcSize, long dstSize, ResampleFilter filter, std::vector<std::vector<Tap>> * taps )
+		{
+			taps->assign( dstSize, std::vector<Tap>() );
+			const double scale = double( srcSize ) / double( dstSize );
+			const double filterScale = scale > 1.0 ? scale : 1.0;
+			const double support = ( filter == ResampleFilter::LANCZOS3 ? 3.0 : 1.0 ) * filterScale;
+			for( long x = 0; x < dstSize; ++x ) {
+				const double center = ( x + 0.5 ) * scale;
+				std::vector<Tap>& out = ( *taps )[x];
+				if( filter == ResampleFilter::NEAREST ) {
+					const long nearest = long( std::floor( center ) );
+					out.push_back( Tap{ nearest < srcSize ? nearest : srcSize - 1, 1.0f } );
+					continue;
+				}
+
+				double total = 0.0;
+				const long first = std::max( long( std::floor( center - support + 0.5 ) ), 0L );
+				const long last = std::min( long( std::floor( center + support + 0.5 ) ), srcSize );
+				for( long i = first; i < last; ++i ) {
+					const double weight = evaluate( filter, ( i - center + 0.5 ) / filterScale );
+					if( weight != 0.0 ) {
+						out.push_back( Tap{ i, float( weight ) } );
+						total += weight;
+					}
+				}
+				for( Tap& tap : out )
+					tap.weight = float( tap.weight / total );
+			}
+		}
+
+		long							mSrcWidth, mSrcHeight, mDstWidth, mDstHeight;
+		PixelLayout						mLayout;
+		std::vector<std::vector<Tap>>	mHorizontal, mVertical;
+		std::vector<float>				mIntermediate;
+	};
+}
+
+int main( int argc, char * argv[] )
+{
+	const int frames = argc > 1 ? std::atoi( argv[1] ) : 5;
+	std::vector<SimdLevel> levels;
+	for( SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON } ) {
+		if( isSimdLevelSupported( level ) )
+			levels.push_back( level );
+	}
+
+	const Scenario scenarios[] = {
+		{ "PAL RGBA to 1080p", 720, 576, PixelLayout::RGBA, 1920, 1080 },
+		{ "1080p RGB to UHD", 1920, 1080, PixelLayout::RGB, 3840, 2160 },
+		{ "UHD BGRA to 1080p", 3840, 2160, PixelLayout::BGRA, 1920, 1080 }
+	};
+	for( const auto& scenario : scenarios ) {
+		const size_t srcRowBytes = size_t( scenario.srcWidth ) * getPixelBytes( scenario.layout );
+		const size_t dstRowBytes = size_t( scenario.dstWidth ) * 4;
+		std::vector<uint8_t> src( srcRowBytes * scenario.srcHeight ), dst( dstRowBytes * scenario.dstHeight ), reference( dst.size() );
+		uint32_t seed = 1;
+		for( auto& byte : src ) {
+			seed = seed * 1664525u + 1013904223u;
+			byte = uint8_t( seed >> 24 );
+		}
+
+		std::printf( "%s, %ldx%ld to %ldx%ld, best ms/frame (largest difference to the naive output)\n", scenario.name, scenario.srcWidth, scenario.srcHeight, scenario.dstWidth, scenario.dstHeight );
+		for( ResampleFilter filter : { ResampleFilter::NEAREST, ResampleFilter::BILINEAR, ResampleFilter::LANCZOS3 } ) {
+			NaiveResampler naive( scenario.srcWidth, scenario.srcHeight, scenario.layout, scenario.dstWidth, scenario.dstHeight, filter );
+			const double naiveMs = timeFrames( [&] { naive.resample( src.data(), srcRowBytes, reference.data(), dstRowBytes ); }, frames );
+			std::printf( "  %-9s naive    %8.2f\n", getFilterName( filter ), naiveMs );
+
+			ImageResampler resampler;
+			resampler.setup( scenario.srcWidth, scenario.srcHeight, scenario.layout, scenario.dstWidth, scenario.dstHeight, filter );
+			for( SimdLevel level : levels ) {
+				const double ms = timeFrames( [&] { resampler.resample( src.data(), srcRowBytes, dst.data(), dstRowBytes, 0, scenario.dstHeight, level ); }, frames );
+				int largest = 0;
+				for( size_t i = 0; i < dst.size(); ++i )
+					largest = std::max( largest, std::abs( int( dst[i] ) - int( reference[i] ) ) );
+				std::printf( "  %-9s %-8s %8.2f  %5.2fx  (%d)\n", getFilterName( filter ), getSimdLevelName( level ), ms, naiveMs / ms, largest );
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+// Capture conversion scaling: converts synthetic UYVY frames to BGRA the way DeckLinkInput::convertFrame() does, on a
+// WorkerPool of 1 to N threads with two stripes per thread, and prints the time per frame, the speedup over the callback
+// thread alone, and the cost of dispatching an empty job to the pool. The speedup only means something with at least as
+// many free cores as threads; past the memory bandwidth of the machine it levels off whatever the core count.
+// Standalone, it only needs the conversion and pool sources:
+//
+//   g++ -std=c++14 -O2 -pthread -Iinclude benchmark/StripeScaling.cpp src/VideoConversion.cpp src/CpuFeatures.cpp src/WorkerPool.cpp
+//   cl /O2 /EHsc /Iinclude benchmark\StripeScaling.cpp src\VideoConversion.cpp src\CpuFeatures.cpp src\WorkerPool.cpp
+//
+// Usage: StripeScaling [maxThreads] [frames]. maxThreads defaults to the hardware concurrency.
+//
+// Recorded results: none yet on more than one core, so the scaling from 1 to N cores has not been demonstrated. The only
+// runs so far were on a single core AVX2 Xeon, where extra threads just time-slice: UHD stays between 6.7 and 10 ms/frame
+// and 8K between 29 and 38 ms/frame whatever the thread count, the spread being run to run noise of that machine. What
+// those runs do show is the pool overhead, at most 21 us per frame to dispatch the stripes.
+
+#include "CpuFeatures.h"
+#include "VideoConversion.h"
+#include "WorkerPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	// Same split as DeckLinkInput.
+	const size_t kStripesPerThread = 2;
+
+	struct Resolution {
+		const char *	name;
+		long			width, height;
+	};
+
+	double convertFrames( const WorkerPoolRef& pool, const std::vector<uint8_t>& src, std::vector<uint8_t>& dst, long width, long height, int frames )
+	{
+		const size_t srcRowBytes = size_t( width ) * 2;
+		const size_t dstRowBytes = size_t( width ) * 4;
+		const auto begin = std::chrono::steady_clock::now();
+		for( int frame = 0; frame < frames; ++frame ) {
+			if( ! pool ) {
+				convertUYVYToBGRA( src.data(), srcRowBytes, dst.data(), dstRowBytes, width, height, YCbCrMatrix::BT709 );
+				continue;
+			}
+			pool->parallelForRanges( size_t( height ), pool->getConcurrency() * kStripesPerThread, [&]( size_t rowBegin, size_t rowEnd ) {
+				convertUYVYToBGRA( src.data() + rowBegin * srcRowBytes, srcRowBytes, dst.data() + rowBegin * dstRowBytes, dstRowBytes, width, long( rowEnd - rowBegin ), YCbCrMatrix::BT709 );
+			} );
+		}
+		return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - begin ).count() / frames;
+	}
+
+	// Time the pool takes to hand out and collect the stripes of a frame, without converting anything.
+	double dispatchEmpty( const WorkerPoolRef& pool, size_t height, int jobs )
+	{
+		std::vector<size_t> rows( pool->getConcurrency() * kStripesPerThread );
+		const auto begin = std::chrono::steady_clock::now();
+		for( int job = 0; job < jobs; ++job )
+			pool->parallelForRanges( height, rows.size(), [&]( size_t rowBegin, size_t rowEnd ) { rows[rowBegin * rows.size() / height] = rowEnd - rowBegin; } );
+		return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - begin ).count() / jobs;
+	}
+}
+
+int main( int argc, char * argv[] )
+{
+	const size_t hardwareThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	const size_t maxThreads = argc > 1 ? size_t( std::atoi( argv[1] ) ) : hardwareThreads;
+	const int frames = argc > 2 ? std::atoi( argv[2] ) : 20;
+	std::printf( "%s, %u hardware threads\n", getSimdLevelName( getSupportedSimdLevel() ), unsigned( hardwareThreads ) );
+
+	const Resolution resolutions[] = { { "UHD", 3840, 2160 }, { "8K", 7680, 4320 } };
+	for( const auto& resolution : resolutions ) {
+		// Every chroma and luma code, so the kernels see the same data as a busy picture.
+		std::vector<uint8_t> src( size_t( resolution.width ) * 2 * resolution.height );
+		uint32_t seed = 1;
+		for( auto& byte : src ) {
+			seed = seed * 1664525u + 1013904223u;
+			byte = uint8_t( seed >> 24 );
+		}
+		std::vector<uint8_t> dst( size_t( resolution.width ) * 4 * resolution.height );
+
+		std::printf( "%s %ldx%ld\n", resolution.name, resolution.width, resolution.height );
+		convertFrames( nullptr, src, dst, resolution.width, resolution.height, 2 );
+		const double baseMs = convertFrames( nullptr, src, dst, resolution.width, resolution.height, frames );
+		const double frameBytes = double( src.size() + dst.size() );
+		std::printf( "  callback thread only    %7.2f ms/frame  %5.1f GB/s\n", baseMs, frameBytes / ( baseMs * 1e6 ) );
+		for( size_t threads = 1; threads <= maxThreads; ++threads ) {
+			WorkerPoolRef pool = WorkerPool::create( threads - 1 );
+			convertFrames( pool, src, dst, resolution.width, resolution.height, 2 );
+			const double ms = convertFrames( pool, src, dst, resolution.width, resolution.height, frames );
+			const double dispatchUs = dispatchEmpty( pool, size_t( resolution.height ), 200 );
+			std::printf( "  %2u threads, %2u stripes  %7.2f ms/frame  %5.1f GB/s  %5.2fx  dispatch %6.1f us\n", unsigned( threads ), unsigned( threads * kStripesPerThread ), ms, frameBytes / ( ms * 1e6 ), baseMs / ms, dispatchUs );
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,87 @@
+// YUV output encoding throughput: encodes a synthetic BGRA frame to 8-bit UYVY and 10-bit v210 with each matrix, at SD,
+// 1080p and UHD, with every SIMD level the machine supports, single threaded, co-sited chroma filter and legal range (the
+// defaults of DeckLinkOutput). Prints the best time per frame and the frame rate one core sustains. The SSE2 level runs
+// the scalar encoder (hadd and alignr need SSSE3) with only the UYVY packing vectorized, so it stays close to scalar.
+// Standalone, it only needs the conversion sources:
+//
+//   g++ -std=c++14 -O2 -Iinclude benchmark/YuvEncode.cpp src/VideoConversion.cpp src/VideoConversionEncode.cpp src/CpuFeatures.cpp
+//   cl /O2 /EHsc /Iinclude benchmark\YuvEncode.cpp src\VideoConversion.cpp src\VideoConversionEncode.cpp src\CpuFeatures.cpp
+//
+// Usage: YuvEncode [frames].
+
+#include "CpuFeatures.h"
+#include "VideoConversion.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	struct Resolution {
+		const char *	name;
+		long			width, height;
+	};
+
+	const char * getMatrixName( YCbCrMatrix matrix )
+	{
+		switch( matrix ) {
+		case YCbCrMatrix::BT601:	return "BT.601";
+		case YCbCrMatrix::BT2020:	return "BT.2020";
+		default:					return "BT.709";
+		}
+	}
+
+	// Fastest of the frames, a preemption in the middle of a run would otherwise weigh on the mean.
+	double timeFrames( const std::function<void()>& convert, int frames )
+	{
+		convert();
+		double best = 0.0;
+		for( int frame = 0; frame < frames; ++frame ) {
+			const auto begin = std::chrono::steady_clock::now();
+			convert();
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - begin ).count();
+			best = frame == 0 || ms < best ? ms : best;
+		}
+		return best;
+	}
+}
+
+int main( int argc, char * argv[] )
+{
+	const int frames = argc > 1 ? std::atoi( argv[1] ) : 10;
+	std::vector<SimdLevel> levels;
+	for( SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON } ) {
+		if( isSimdLevelSupported( level ) )
+			levels.push_back( level );
+	}
+
+	const Resolution resolutions[] = { { "SD", 720, 486 }, { "1080p", 1920, 1080 }, { "UHD", 3840, 2160 } };
+	for( const auto& resolution : resolutions ) {
+		const long width = resolution.width;
+		const long height = resolution.height;
+		const size_t bgraRowBytes = size_t( width ) * 4;
+		const size_t uyvyRowBytes = size_t( width ) * 2;
+		const size_t v210RowBytes = getV210RowBytes( width );
+		std::vector<uint8_t> bgra( bgraRowBytes * height ), uyvy( uyvyRowBytes * height ), v210( v210RowBytes * height );
+		uint32_t seed = 1;
+		for( auto& byte : bgra ) {
+			seed = seed * 1664525u + 1013904223u;
+			byte = uint8_t( seed >> 24 );
+		}
+
+		std::printf( "%s %ldx%ld, best ms/frame (frames/s on one core)\n", resolution.name, width, height );
+		std::printf( "  %-16s %20s %20s\n", "", "BGRA->UYVY", "BGRA->v210" );
+		for( YCbCrMatrix matrix : { YCbCrMatrix::BT601, YCbCrMatrix::BT709, YCbCrMatrix::BT2020 } ) {
+			for( SimdLevel level : levels ) {
+				const double uyvyMs = timeFrames( [&] { convertBGRAToUYVY( bgra.data(), bgraRowBytes, uyvy.data(), uyvyRowBytes, width, height, matrix, YCbCrRange::LEGAL, ChromaFilter::COSITED, level ); }, frames );
+				const double v210Ms = timeFrames( [&] { convertBGRAToV210( bgra.data(), bgraRowBytes, v210.data(), v210RowBytes, width, height, matrix, YCbCrRange::LEGAL, ChromaFilter::COSITED, level ); }, frames );
+				std::printf( "  %-7s %-8s %10.2f (%6.0f) %10.2f (%6.0f)\n", getMatrixName( matrix ), getSimdLevelName( level ), uyvyMs, 1000.0 / uyvyMs, v210Ms, 1000.0 / v210Ms );
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "CpuFeatures.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace media {
+
+	//! Most planar outputs one audio conversion writes.
+	const size_t kMaxAudioChannels = 64;
+
+	//! Multiplier from integer samples to float, full scale mapping to 1.0. A power of two, so the scaling itself is exact.
+	inline float getAudioSampleScale( const int16_t * ) { return 1.0f / 32768.0f; }
+	inline float getAudioSampleScale( const int32_t * ) { return 1.0f / 2147483648.0f; }
+
+	//! Deinterleaves integer audio (the layout of IDeckLinkAudioInputPacket buffers) into planar float, full scale
+	//! mapping to [-1, 1). Output i receives source channel \a routing[i], or silence for -1 or a channel the source does
+	//! not have; a null \a routing takes the first dstChannels source channels in order. Each of the \a dstChannels
+	//! planes, up to kMaxAudioChannels, must hold frameCount floats. Every kernel produces bit-exact output against the
+	//! scalar reference, so the level only changes speed. Stereo and multiples of 4 (AVX2: 8) source channels are
+	//! vectorized, other layouts take the scalar path.
+	void convertAudioToFloat( const int32_t * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing = nullptr );
+	void convertAudioToFloat( const int32_t * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing, SimdLevel level );
+	void convertAudioToFloat( const int16_t * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing = nullptr );
+	void convertAudioToFloat( const int16_t * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing, SimdLevel level );
+
+} //end namespace media
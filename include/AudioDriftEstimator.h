@@ -0,0 +1,147 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace media {
+
+	struct AudioDriftOptions {
+		double		sampleRate = 48000.0;
+		//! Interval between the timestamps kept, and number of them the rates are fitted over.
+		double		sampleIntervalMs = 250.0;
+		size_t		window = 120;
+		//! Time an offset from the target position is absorbed over, and the largest change of ratio used for it. 1000 ppm
+		//! is a pitch change of under 2 cents.
+		double		correctionSeconds = 5.0;
+		double		maxCorrectionPpm = 1000.0;
+		//! Offsets past this are not absorbed but jumped over, see AudioDriftControl::resync.
+		double		resyncThresholdMs = 10.0;
+	};
+
+	struct AudioDriftStats {
+		//! Audio rates of the input and of the output measured on the reference clock, relative to the nominal sample
+		//! rate, and the input relative to the output, in parts per million. Positive when faster. Only meaningful once
+		//! driftValid, they get steadier as the window fills.
+		double		inputPpm = 0.0;
+		double		outputPpm = 0.0;
+		double		driftPpm = 0.0;
+		bool		driftValid = false;
+		size_t		inputSamples = 0;
+		size_t		outputSamples = 0;
+		//! Last offset of the read position from its target in sample frames, positive when behind, and the ratio
+		//! correction it called for.
+		double		offsetFrames = 0.0;
+		double		correctionPpm = 0.0;
+		//! Last resampling ratio, input frames per output frame.
+		double		ratio = 1.0;
+		//! Offsets too large to absorb, jumped over.
+		uint64_t	resyncs = 0;
+	};
+
+	//! Outcome of AudioDriftEstimator::update().
+	struct AudioDriftControl {
+		//! Input frames per output frame to resample the block with.
+		double		ratio = 1.0;
+		//! Input position the block should start at.
+		double		targetPosition = 0.0;
+		//! The offset is past the threshold: restart resampling at targetPosition instead of slewing to it.
+		bool		resync = false;
+	};
+
+	//! Measures the drift between an input and an output audio stream running on different clocks, and steers a resampler
+	//! so that the output stays locked to the input at a given latency. Both streams are timestamped on a common reference
+	//! clock, typically the hardware reference clock the card timestamps video frames with: the input with the sample
+	//! position of each captured frame's audio packet, the output with the sample position of each scheduled frame.
+	//! Positions are fitted against time by least squares, which gives each stream's true sample rate and maps any
+	//! reference time to an input position. The ratio is the rate of the input over the rate of the output, corrected
+	//! by a proportional term for the offset between where the resampler reads and where it should. Holds no DeckLink
+	//! state, so it can be driven by simulated clocks; timestamps and updates may come from different threads.
+	class AudioDriftEstimator {
+	public:
+		explicit AudioDriftEstimator( const AudioDriftOptions& options = AudioDriftOptions() );
+
+		void				reset();
+		//! Adds the input sample \a position captured at reference time \a timeUs. Timestamps closer than
+		//! sampleIntervalMs to the previous one are ignored.
+		void				addInputTimestamp( int64_t position, int64_t timeUs );
+		//! Adds the output sample \a position played at reference time \a timeUs.
+		void				addOutputTimestamp( int64_t position, int64_t timeUs );
+
+		//! Input position at reference time \a timeUs. Extrapolated at the nominal rate from the last timestamp until the
+		//! fit is valid, false before any timestamp.
+		bool				getInputPosition( int64_t timeUs, double * position ) const;
+		//! Reference time output position \a position plays at, same as getInputPosition().
+		bool				getOutputTime( int64_t position, double * timeUs ) const;
+
+		//! Steers the block starting at output position \a outputPosition, the resampler reading input position
+		//! \a readPosition, so that the input plays out \a latencyUs after it was captured. Returns false before both
+		//! streams have a timestamp.
+		bool				update( double readPosition, int64_t outputPosition, double latencyUs, AudioDriftControl * control );
+
+		const AudioDriftOptions&	getOptions() const { return mOptions; }
+		AudioDriftStats		getStats() const;
+	private:
+		struct Sample {
+			int64_t		position, timeUs;
+		};
+
+		//! Sample position as a linear function of reference time, fitted over a window of timestamps.
+		struct Fit {
+			std::vector<Sample>	samples;
+			size_t				next = 0;
+			Sample				last = Sample();
+			//! position = origin.position + offset + slope * ( time - origin.timeUs ), slope in frames per microsecond.
+			Sample				origin = Sample();
+			double				offset = 0.0;
+			double				slope = 0.0;
+			bool				valid = false;
+		};
+
+		void				addSample( Fit& fit, int64_t position, int64_t timeUs );
+		void				updateFit( Fit& fit );
+		double				getPosition( const Fit& fit, double timeUs ) const;
+		double				getPpm( const Fit& fit ) const;
+
+		AudioDriftOptions		mOptions;
+		mutable std::mutex		mMutex;
+		Fit						mInput, mOutput;
+		AudioDriftStats			mStats;
+	};
+
+} //end namespace media
@@ -0,0 +1,142 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "AudioConversion.h"
+#include "TripleBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace media {
+
+	struct AudioMeterOptions {
+		//! Window of the RMS level, rounded to 100 ms blocks, 3 s at most.
+		double				rmsWindowMs = 300.0;
+		//! ITU-R BS.1770 weight of each channel in the programme loudness, 0 leaves a channel out (LFE). Surround channels
+		//! take 1.41, the others 1.0. Empty takes the first two channels, the usual programme pair on SDI.
+		std::vector<float>	programWeights;
+	};
+
+	struct AudioChannelLevels {
+		//! Highest sample magnitude in the last 100 ms block and since reset, in dBFS.
+		float	peakDb = 0.0f;
+		float	maxPeakDb = 0.0f;
+		//! RMS level over the RMS window, in dBFS. A full scale sine reads -3 dB.
+		float	rmsDb = 0.0f;
+		//! EBU R128 loudness of the channel on its own, in LUFS: momentary (400 ms), short-term (3 s) and integrated
+		//! (gated, since reset). Shorter windows are used until enough audio came in.
+		float	momentaryLufs = 0.0f;
+		float	shortTermLufs = 0.0f;
+		float	integratedLufs = 0.0f;
+	};
+
+	//! Levels published by AudioMeter every 100 ms of audio. Silence reads as -infinity.
+	struct AudioLevels {
+		size_t				channels = 0;
+		//! Sample frames metered since reset.
+		uint64_t			position = 0;
+		AudioChannelLevels	channel[kMaxAudioChannels];
+		//! EBU R128 loudness of the programme, see AudioMeterOptions::programWeights.
+		float				momentaryLufs = 0.0f;
+		float				shortTermLufs = 0.0f;
+		float				integratedLufs = 0.0f;
+	};
+
+	typedef std::shared_ptr<class AudioMeter> AudioMeterRef;
+
+	//! Peak, RMS and EBU R128 loudness (ITU-R BS.1770 K-weighting, absolute and relative gating) of every channel of an
+	//! interleaved integer stream, plus the loudness of a programme mixed from weighted channels. The kernels filter the
+	//! channels of a frame in parallel, 4 or 8 to a register, straight from the interleaved samples; SSE2 and AVX2 give the
+	//! same results as the scalar reference bit for bit. Integrated loudness is gated from 0.1 LU histograms, so memory
+	//! does not grow with time. Process never allocates and publishes the levels through a triple buffer, so it never
+	//! waits for readers.
+	class AudioMeter {
+	public:
+		static AudioMeterRef	create( const AudioMeterOptions& options = AudioMeterOptions() ) { return AudioMeterRef( new AudioMeter( options ) ); }
+
+		//! Starts over for \a channels channels, up to kMaxAudioChannels, at \a sampleRate. Not while process() runs.
+		void		reset( size_t channels, double sampleRate = 48000.0 );
+
+		//! Producer side, typically the capture callback. Meters \a frameCount interleaved sample frames.
+		void		process( const int32_t * src, size_t frameCount );
+		void		process( const int32_t * src, size_t frameCount, SimdLevel level );
+		void		process( const int16_t * src, size_t frameCount );
+		void		process( const int16_t * src, size_t frameCount, SimdLevel level );
+
+		//! Any thread but the producer's. Newest published levels.
+		AudioLevels	getLevels() const;
+
+		size_t					getChannels() const { return mChannels; }
+		const AudioMeterOptions&	getOptions() const { return mOptions; }
+	private:
+		explicit AudioMeter( const AudioMeterOptions& options );
+		AudioMeter( const AudioMeter& ) = delete;
+		AudioMeter& operator=( const AudioMeter& ) = delete;
+
+		template<typename T>
+		void		processFrames( const T * src, size_t frameCount, SimdLevel level );
+		void		endBlock();
+		float		getIntegratedLufs( const std::vector<uint32_t>& histogram ) const;
+
+		AudioMeterOptions		mOptions;
+		size_t					mChannels;
+		//! Direct form I coefficients b0 b1 b2 a1 a2 of the shelving and the high-pass stage of the K-weighting.
+		float					mWeighting[10];
+		size_t					mBlockFrames, mBlockPosition, mRmsBlocks;
+		uint64_t				mBlocks, mPosition;
+
+		//! Filter state, 6 values per channel stored as 6 rows of mChannels so kernels load several channels at once.
+		std::vector<float>		mState;
+		//! Chunk results of the kernels, and the running sums of the current 100 ms block.
+		std::vector<float>		mChunkPeak, mChunkSquares, mChunkWeighted;
+		std::vector<float>		mBlockPeak, mMaxPeak;
+		std::vector<double>		mBlockSquares, mBlockWeighted;
+		//! Mean raw and K-weighted power of the last 3 s of blocks, kHistoryBlocks per channel.
+		std::vector<double>		mSquaresHistory, mWeightedHistory;
+		std::vector<float>		mProgramWeights;
+		//! Gating block counts per 0.1 LU, one histogram per channel and one for the programme.
+		std::vector<std::vector<uint32_t>>	mHistograms;
+		std::vector<uint32_t>				mProgramHistogram;
+
+		mutable TripleBuffer<AudioLevels>	mLevels;
+		//! Serializes readers among themselves, the producer never takes it.
+		mutable std::mutex					mReadMutex;
+	};
+
+} //end namespace media
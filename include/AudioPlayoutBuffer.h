@@ -0,0 +1,123 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace media {
+
+	struct AudioPlayoutStats {
+		//! Next sample frame to schedule and next one to write, in the output timeline.
+		int64_t		readPosition = 0;
+		int64_t		writePosition = 0;
+		uint64_t	writtenFrames = 0;
+		//! Sample frames rejected because the buffer was full.
+		uint64_t	overflowFrames = 0;
+		//! Sample frames written for positions already written or already played out, dropped to stay in sync.
+		uint64_t	lateFrames = 0;
+		//! Sample frames of silence: gaps between written positions, and underruns.
+		uint64_t	silenceFrames = 0;
+		//! Refills that ran out of written audio and continued with silence.
+		uint64_t	underruns = 0;
+		//! Times the schedule fell behind playback and skipped ahead.
+		uint64_t	resyncs = 0;
+	};
+
+	typedef std::shared_ptr<class AudioPlayoutBuffer> AudioPlayoutBufferRef;
+
+	//! FIFO of interleaved audio sample frames between the application (producer) and the output's audio callback
+	//! (consumer), indexed by position in the output timeline. Wait-free for one producer thread and one consumer thread,
+	//! it never allocates after creation. The consumer may run past what was written, scheduling silence instead; the
+	//! producer then drops the audio written for positions already played out rather than delaying everything after it,
+	//! so audio written for a position always plays at that position or not at all.
+	class AudioPlayoutBuffer {
+	public:
+		static AudioPlayoutBufferRef	create( size_t channels, size_t bytesPerSample, size_t capacityFrames ) { return AudioPlayoutBufferRef( new AudioPlayoutBuffer( channels, bytesPerSample, capacityFrames ) ); }
+
+		//! Producer side. Writes \a frameCount interleaved sample frames starting at \a position. Positions already written
+		//! or played out are dropped, a gap from the write position is filled with silence. Returns the frames stored.
+		size_t		write( int64_t position, const void * data, size_t frameCount );
+		//! Producer side. Appends at the write position.
+		size_t		write( const void * data, size_t frameCount ) { return write( getWritePosition(), data, frameCount ); }
+		//! Next position write() appends at, the read position when the consumer went past the written frames.
+		int64_t		getWritePosition() const;
+		//! Sample frames that can be written from the write position.
+		size_t		getWritableFrames() const;
+
+		//! Consumer side. Points \a frames to the written sample frames from the read position, up to the end of the ring,
+		//! and returns how many there are.
+		size_t		peek( const uint8_t ** frames ) const;
+		//! Consumer side. Moves the read position \a frameCount frames forward, frames past the written ones counting
+		//! as silence.
+		void		consume( size_t frameCount );
+		//! Consumer side. Moves the read position forward to \a position, skipping whatever was written in between.
+		void		seek( int64_t position );
+		int64_t		getReadPosition() const { return mTail.load( std::memory_order_acquire ); }
+
+		size_t		getChannels() const { return mChannels; }
+		size_t		getBytesPerSample() const { return mBytesPerSample; }
+		//! Bytes of one interleaved sample frame, every channel.
+		size_t		getFrameBytes() const { return mFrameBytes; }
+		size_t		getCapacity() const { return mCapacity; }
+		//! Approximate when called from a third thread.
+		AudioPlayoutStats	getStats() const;
+	private:
+		AudioPlayoutBuffer( size_t channels, size_t bytesPerSample, size_t capacityFrames );
+		AudioPlayoutBuffer( const AudioPlayoutBuffer& ) = delete;
+		AudioPlayoutBuffer& operator=( const AudioPlayoutBuffer& ) = delete;
+
+		//! Producer side, \a data null writes silence. The range must be free.
+		void		store( int64_t position, const uint8_t * data, size_t frameCount );
+
+		size_t					mChannels, mBytesPerSample, mFrameBytes, mCapacity;
+		std::vector<uint8_t>	mData;
+
+		// Written end (producer) and read position (consumer) live on separate cache lines to avoid false sharing. The read
+		// position runs ahead of the written end while the consumer schedules silence.
+		char					mPad0[64];
+		std::atomic<int64_t>	mHead;
+		char					mPad1[64 - sizeof( std::atomic<int64_t> )];
+		std::atomic<int64_t>	mTail;
+		char					mPad2[64 - sizeof( std::atomic<int64_t> )];
+		std::atomic<uint64_t>	mWrittenFrames, mOverflowFrames, mLateFrames, mGapFrames;
+		std::atomic<uint64_t>	mUnderrunFrames, mUnderruns, mResyncs;
+	};
+
+} //end namespace media
@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "AudioConversion.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace media {
+
+	struct AudioResamplerOptions {
+		//! Filter length in input frames. With the default cutoff and window, 48 taps are flat to about 20 kHz at 48 kHz and
+		//! keep aliasing under -80 dB.
+		size_t	taps = 48;
+		//! Filter phases, rounded up to a power of two. Coefficients are interpolated linearly between them.
+		size_t	phases = 256;
+		//! Center of the transition band as a fraction of the input rate, and beta of the Kaiser window.
+		double	cutoff = 0.47;
+		double	kaiserBeta = 8.0;
+	};
+
+	typedef std::shared_ptr<class AudioResampler> AudioResamplerRef;
+
+	//! Polyphase windowed sinc resampler for interleaved integer audio, with a ratio that can change between any two
+	//! blocks without a click. Meant for ratios close to 1 such as clock drift compensation: the filter is not narrowed
+	//! for downsampling. The read position advances in 32.32 fixed point, so it never drifts from the ratios it was given.
+	//! Kernels filter 4 (SSE2, NEON) or 8 (AVX2) channels per register and give the same results as the scalar reference
+	//! bit for bit. Process never allocates. Not thread safe.
+	class AudioResampler {
+	public:
+		static AudioResamplerRef	create( size_t channels, const AudioResamplerOptions& options = AudioResamplerOptions() ) { return AudioResamplerRef( new AudioResampler( channels, options ) ); }
+
+		//! Empties the filter, the next frame fed is the first one.
+		void		reset();
+		//! Input frames consumed per output frame, clamped to [0.5, 2]. 1.0001 plays an input 100 ppm fast at the output rate.
+		void		setRatio( double ratio );
+		double		getRatio() const { return mRatio; }
+
+		//! Resamples interleaved sample frames: produces up to \a dstFrames frames, consuming at most \a *srcFrames, and
+		//! returns the frames produced with the frames consumed in \a *srcFrames.
+		size_t		process( const int32_t * src, size_t * srcFrames, int32_t * dst, size_t dstFrames );
+		size_t		process( const int32_t * src, size_t * srcFrames, int32_t * dst, size_t dstFrames, SimdLevel level );
+		size_t		process( const int16_t * src, size_t * srcFrames, int16_t * dst, size_t dstFrames );
+		size_t		process( const int16_t * src, size_t * srcFrames, int16_t * dst, size_t dstFrames, SimdLevel level );
+
+		//! Input frames process() needs to produce \a dstFrames frames at the current ratio.
+		size_t		getInputFrames( size_t dstFrames ) const;
+		//! Input frames fed but not played out yet: the next output frame is centered this far behind the last frame fed.
+		//! Starts at 1 - taps / 2 after reset(), the filter delay.
+		double		getBufferedFrames() const;
+
+		size_t		getChannels() const { return mChannels; }
+		const AudioResamplerOptions&	getOptions() const { return mOptions; }
+	private:
+		AudioResampler( size_t channels, const AudioResamplerOptions& options );
+		AudioResampler( const AudioResampler& ) = delete;
+		AudioResampler& operator=( const AudioResampler& ) = delete;
+
+		template<typename T>
+		size_t		processFrames( const T * src, size_t * srcFrames, T * dst, size_t dstFrames, SimdLevel level );
+
+		AudioResamplerOptions	mOptions;
+		size_t					mChannels, mTaps, mPhaseBits;
+		//! ( phases + 1 ) rows of taps coefficients, the last row being the first one shifted by a frame.
+		std::vector<float>		mFilter;
+		//! Interpolated coefficients of the current output frame.
+		std::vector<float>		mCoefficients;
+		//! Interleaved input frames, [mIndex, mIndex + taps) is the window of the next output frame.
+		std::vector<float>		mInput;
+		size_t					mCapacity, mBuffered, mIndex;
+		double					mRatio;
+		//! Fraction of a frame past mIndex, and the step per output frame, in 32.32 fixed point.
+		uint64_t				mFraction, mStep;
+		std::vector<float>		mOutput;
+	};
+
+} //end namespace media
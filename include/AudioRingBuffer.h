@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace media {
+
+	struct AudioBufferStats {
+		//! Sample frames held, [startPosition, endPosition).
+		int64_t		startPosition = 0;
+		int64_t		endPosition = 0;
+		uint64_t	writtenFrames = 0;
+		//! Sample frames of silence filled in for packets that never arrived.
+		uint64_t	silenceFrames = 0;
+		//! Times the packet time jumped back, or further ahead than the buffer holds, and the buffer started over.
+		uint64_t	discontinuities = 0;
+		//! Reads that failed because the block was not written yet or already overwritten.
+		uint64_t	failedReads = 0;
+	};
+
+	typedef std::shared_ptr<class AudioRingBuffer> AudioRingBufferRef;
+
+	//! Ring of interleaved audio sample frames indexed by their absolute position in the stream (the packet time in
+	//! samples), for one producer thread and any number of readers. Reads are random access and never consume: any block
+	//! still in the buffer can be read, by several readers, and read again. The producer never waits and never allocates;
+	//! it overwrites the oldest samples, and a reader that was copying them notices and fails instead of returning torn
+	//! data. Gaps in the packet times are filled with silence so that positions stay sample accurate. Samples are stored
+	//! as 32-bit words, so frames must be a multiple of 4 bytes, as the even channel counts of DeckLink are.
+	class AudioRingBuffer {
+	public:
+		//! Null when a sample frame of \a channels samples of \a bytesPerSample is empty or not a multiple of 4 bytes.
+		static AudioRingBufferRef	create( size_t channels, size_t bytesPerSample, size_t capacityFrames )
+		{
+			const size_t frameBytes = channels * bytesPerSample;
+			return frameBytes > 0 && frameBytes % 4 == 0 ? AudioRingBufferRef( new AudioRingBuffer( channels, bytesPerSample, capacityFrames ) ) : nullptr;
+		}
+
+		//! Producer side. Writes \a frameCount interleaved sample frames starting at \a position.
+		void		write( int64_t position, const void * data, size_t frameCount );
+		//! Any thread. Copies the sample frames [position, position + frameCount) to \a dst, which must hold
+		//! frameCount * getFrameBytes() bytes. Returns false if any of them is not in the buffer, dst is then undefined.
+		bool		read( int64_t position, size_t frameCount, void * dst ) const;
+		//! Any thread. Same as read() but hands the sample frames to \a visitor( const uint8_t * frames, size_t offset,
+		//! size_t count ) a few at a time, \a offset being the frame of the block each piece starts at. The pieces are staged
+		//! on the stack, so the visitor can convert them while they are in cache. Whatever the visitor produced is undefined
+		//! when this returns false.
+		template<typename Visitor>
+		bool		visit( int64_t position, size_t frameCount, Visitor visitor ) const
+		{
+			uint64_t epoch;
+			if( ! beginRead( position, frameCount, &epoch ) )
+				return false;
+
+			// Words rather than bytes, the visitor may read the samples as 32-bit integers.
+			uint32_t chunk[1024];
+			const size_t chunkFrames = sizeof( chunk ) / mFrameBytes;
+			for( size_t done = 0; done < frameCount; ) {
+				const size_t count = frameCount - done < chunkFrames ? frameCount - done : chunkFrames;
+				loadFrames( position + int64_t( done ), count, (uint8_t*)chunk );
+				visitor( (const uint8_t*)chunk, done, count );
+				done += count;
+			}
+			return endRead( position, epoch );
+		}
+
+		size_t		getChannels() const { return mChannels; }
+		size_t		getBytesPerSample() const { return mBytesPerSample; }
+		//! Bytes of one interleaved sample frame, every channel.
+		size_t		getFrameBytes() const { return mFrameBytes; }
+		size_t		getCapacity() const { return mCapacity; }
+		//! Approximate when called from a reader while the producer runs.
+		int64_t		getStartPosition() const { return mStart.load( std::memory_order_acquire ); }
+		int64_t		getEndPosition() const { return mEnd.load( std::memory_order_acquire ); }
+		AudioBufferStats	getStats() const;
+	private:
+		AudioRingBuffer( size_t channels, size_t bytesPerSample, size_t capacityFrames );
+		AudioRingBuffer( const AudioRingBuffer& ) = delete;
+		AudioRingBuffer& operator=( const AudioRingBuffer& ) = delete;
+
+		//! Producer side, \a data null writes silence. The range must fit in the buffer and follow the end.
+		void		store( int64_t position, const uint8_t * data, size_t frameCount );
+		//! Copies out of the buffer, the range must fit in it. Only valid if endRead() agrees.
+		void		loadFrames( int64_t position, size_t frameCount, uint8_t * dst ) const;
+		bool		beginRead( int64_t position, size_t frameCount, uint64_t * epoch ) const;
+		bool		endRead( int64_t position, uint64_t epoch ) const;
+		void		restart( int64_t position );
+		size_t		getOffset( int64_t position ) const;
+
+		size_t					mChannels, mBytesPerSample, mFrameBytes, mCapacity;
+		//! Readers copy while the producer may be overwriting the same samples. Relaxed atomic words keep that race defined,
+		//! the epoch and start checks then throw the torn copy away.
+		std::vector<std::atomic<uint32_t>>	mData;
+
+		//! Bumped every time the buffer starts over, readers check it did not change during their copy.
+		std::atomic<uint64_t>	mEpoch;
+		std::atomic<int64_t>	mStart, mEnd;
+		bool					mEmpty;
+		std::atomic<uint64_t>	mWrittenFrames, mSilenceFrames, mDiscontinuities;
+		mutable std::atomic<uint64_t>	mFailedReads;
+	};
+
+} //end namespace media
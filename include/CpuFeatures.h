@@ -0,0 +1,69 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+	#define MEDIA_ARCH_X86 1
+#elif defined( _M_ARM64 ) || defined( __aarch64__ ) || defined( __ARM_NEON )
+	#define MEDIA_ARCH_NEON 1
+#endif
+
+// MSVC compiles every intrinsic regardless of the /arch flag, gcc and clang need the
+// target enabled on the function that uses it.
+#if defined( MEDIA_ARCH_X86 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+	#define MEDIA_TARGET_AVX2 __attribute__(( target( "avx2,f16c" ) ))
+#else
+	#define MEDIA_TARGET_AVX2
+#endif
+
+namespace media {
+
+	//! Instruction set used by the pixel and audio kernels, in increasing order of preference. AVX2 also implies
+	//! SSSE3, SSE4.1 and F16C, which every AVX2 cpu provides.
+	enum class SimdLevel { SCALAR, SSE2, AVX2, NEON };
+
+	//! Best instruction set supported by both the build and the running cpu, detected once.
+	SimdLevel		getSupportedSimdLevel();
+	//! Instruction set currently used by the kernels. Defaults to getSupportedSimdLevel().
+	SimdLevel		getSimdLevel();
+	//! Forces the kernels onto a given instruction set, clamped to what the cpu supports. Mostly useful to compare against the scalar reference.
+	void			setSimdLevel( SimdLevel level );
+	bool			isSimdLevelSupported( SimdLevel level );
+	const char*		getSimdLevelName( SimdLevel level );
+
+} //end namespace media
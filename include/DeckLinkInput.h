@@ -35,26 +35,41 @@
 
 #pragma once
 
+#include "AudioConversion.h"
+#include "AudioMeter.h"
+#include "AudioRingBuffer.h"
 #include "DeckLinkDeviceDiscovery.h"
+#include "DeckLinkMemoryAllocator.h"
+#include "InputWatchdog.h"
+#include "SpscQueue.h"
+#include "VideoFramePool.h"
+#include "WorkerPool.h"
 #include "cinder/Surface.h"
 
 #include <mutex>
 #include <vector>
 #include <atomic>
+#include <condition_variable>
+#include <thread>
 
 namespace media {
 
 	class VideoFrameBGRA : public IDeckLinkVideoFrame {
 	public:
 		VideoFrameBGRA( long width, long height )
-			: mWidth{ width }, mHeight{ height }
+			: mWidth{ width }, mHeight{ height }, mBuffer{ PooledFrameBuffer::create( height * width * 4 ) }
+		{
+		}
+
+		//! Wraps a pooled buffer of at least height * width * 4 bytes.
+		VideoFrameBGRA( long width, long height, PooledFrameBufferRef buffer )
+			: mWidth{ width }, mHeight{ height }, mBuffer{ std::move( buffer ) }
 		{
-			mData.resize( height * width * 4 );
 		}
 
 		void getSurface( ci::SurfaceRef& surface );
 
-		uint8_t * data() const { return (uint8_t*)mData.data(); }
+		uint8_t * data() const { return mBuffer ? mBuffer->data() : nullptr; }
 
 		//override these methods for virtual
 		glm::ivec2				GetSize() { return glm::ivec2{ mWidth,mHeight }; }
@@ -65,7 +80,7 @@ namespace media {
 		virtual BMDFrameFlags	GetFlags( void ) { return 0; }
 		virtual HRESULT			GetBytes( void **buffer )
 		{
-			*buffer = (void*)mData.data();
+			*buffer = (void*)data();
 			return S_OK;
 		}
 
@@ -76,7 +91,55 @@ namespace media {
 		virtual ULONG			Release() { return 1; }
 	private:
 		long mWidth, mHeight;
-		std::vector<uint8_t> mData;
+		PooledFrameBufferRef mBuffer;
+	};
+
+	//! Input frame made up on the host, the pixels are in a pooled buffer. Stands in for a capture frame where the
+	//! application expects one, as the YUV substitutes sent while the signal is lost.
+	class PooledVideoInputFrame : public IDeckLinkVideoInputFrame {
+	public:
+		static RefPtr<IDeckLinkVideoInputFrame> create( PooledFrameBufferRef buffer, long width, long height, long rowBytes, BMDPixelFormat pixelFormat )
+		{
+			return RefPtr<IDeckLinkVideoInputFrame>::adopt( new PooledVideoInputFrame{ std::move( buffer ), width, height, rowBytes, pixelFormat } );
+		}
+
+		virtual long			GetWidth( void ) { return mWidth; }
+		virtual long			GetHeight( void ) { return mHeight; }
+		virtual long			GetRowBytes( void ) { return mRowBytes; }
+		virtual BMDPixelFormat	GetPixelFormat( void ) { return mPixelFormat; }
+		virtual BMDFrameFlags	GetFlags( void ) { return 0; }
+		virtual HRESULT			GetBytes( void **buffer )
+		{
+			*buffer = (void*)mBuffer->data();
+			return S_OK;
+		}
+
+		// Nothing was captured, there is no time, timecode or ancillary data to report.
+		virtual HRESULT			GetTimecode( BMDTimecodeFormat format, IDeckLinkTimecode **timecode ) { return E_NOINTERFACE; }
+		virtual HRESULT			GetAncillaryData( IDeckLinkVideoFrameAncillary **ancillary ) { return E_NOINTERFACE; }
+		virtual HRESULT			GetStreamTime( BMDTimeValue *frameTime, BMDTimeValue *frameDuration, BMDTimeScale timeScale ) { return E_FAIL; }
+		virtual HRESULT			GetHardwareReferenceTimestamp( BMDTimeScale timeScale, BMDTimeValue *frameTime, BMDTimeValue *frameDuration ) { return E_FAIL; }
+
+		virtual HRESULT			QueryInterface( REFIID iid, LPVOID *ppv ) { return E_NOINTERFACE; }
+		virtual ULONG			AddRef() { return InterlockedIncrement( (LONG*)&m_refCount ); }
+		virtual ULONG			Release()
+		{
+			const ULONG newRefValue = InterlockedDecrement( (LONG*)&m_refCount );
+			if( newRefValue == 0 )
+				delete this;
+			return newRefValue;
+		}
+	private:
+		PooledVideoInputFrame( PooledFrameBufferRef buffer, long width, long height, long rowBytes, BMDPixelFormat pixelFormat )
+			: mBuffer{ std::move( buffer ) }, mWidth{ width }, mHeight{ height }, mRowBytes{ rowBytes }, mPixelFormat{ pixelFormat }, m_refCount{ 1 }
+		{
+		}
+		virtual ~PooledVideoInputFrame() { }
+
+		PooledFrameBufferRef	mBuffer;
+		long					mWidth, mHeight, mRowBytes;
+		BMDPixelFormat			mPixelFormat;
+		ULONG					m_refCount;
 	};
 
 	typedef struct {
@@ -97,17 +160,136 @@ namespace media {
 
 	class DeckLinkDevice;
 
+	//! Immutable, reference counted handle on the pixels of a captured frame. Copies share the same memory: either
+	//! the DeckLink frame itself (YUV capture) or the pooled BGRA buffer, released when the last copy goes away.
+	//! Note that the driver only owns a handful of capture frames, so YUV handles should not be held for long.
+	class InputFrame {
+	public:
+		InputFrame() : mWidth{ 0 }, mHeight{ 0 }, mRowBytes{ 0 }, mPixelFormat{ bmdFormat8BitBGRA }, mData{ nullptr } { }
+
+		explicit operator bool() const { return mData != nullptr; }
+
+		long						getWidth() const { return mWidth; }
+		long						getHeight() const { return mHeight; }
+		long						getRowBytes() const { return mRowBytes; }
+		BMDPixelFormat				getPixelFormat() const { return mPixelFormat; }
+		const uint8_t *				getData() const { return mData; }
+		//! Source DeckLink frame for YUV capture, null for converted frames.
+		IDeckLinkVideoInputFrame *	getDeckLinkFrame() const { return mDeckLinkFrame.get(); }
+
+		//! Surface aliasing the frame memory without a copy, it keeps the frame alive and must not be written to.
+		//! BGRA frames map to a BGRA surface, 8-bit YUV frames to a half width RGBA surface (one UYVY macropixel per texel).
+		ci::SurfaceRef				createSurface() const;
+		//! Converts 10 and 12-bit frames (v210, r210, R10b, R10l, R12B, R12L) into a new full range 16-bit RGBA surface.
+		ci::Surface16uRef			createSurface16u() const;
+	private:
+		InputFrame( RefPtr<IDeckLinkVideoInputFrame> frame );
+		InputFrame( PooledFrameBufferRef buffer, long width, long height, long rowBytes, BMDPixelFormat pixelFormat );
+
+		RefPtr<IDeckLinkVideoInputFrame>	mDeckLinkFrame;
+		PooledFrameBufferRef				mBuffer;
+		long								mWidth, mHeight, mRowBytes;
+		BMDPixelFormat						mPixelFormat;
+		const uint8_t *						mData;
+
+		friend struct FrameEvent;
+		friend class DeckLinkInput;
+	};
+
 	struct FrameEvent {
+		//! Empty event, filled by DeckLinkInput::tryPopFrame().
+		FrameEvent() : surfaceData{ 0, 0, nullptr }, dataPointer{ nullptr } { }
+
 		IDeckLinkVideoInputFrame * dataPointer = nullptr;
 		VideoFrameBGRA surfaceData;
+		//! Retainable handle on the pixels of this event. Copy it to keep the frame past the signal emit without copying pixels.
+		InputFrame frame;
+		//! Sent by the watchdog in place of a missing or no-signal frame. Black and slate substitutes of YUV capture come
+		//! as a PooledVideoInputFrame in dataPointer, with no stream time, timecode or ancillary data.
+		bool substituted = false;
+		//! Audio sample frames spanning this video frame, [audioPosition, audioPosition + audioSampleFrames). Empty when
+		//! audio capture is off. See DeckLinkInput::readAudio().
+		int64_t audioPosition = 0;
+		long audioSampleFrames = 0;
 	private:
-		explicit FrameEvent( long width, long height ) : surfaceData{ width, height }, dataPointer{ nullptr } { }
-		explicit FrameEvent( IDeckLinkVideoInputFrame* frame ) : surfaceData{ 0, 0 }, dataPointer{ frame } { }
+		explicit FrameEvent( long width, long height, PooledFrameBufferRef buffer ) : surfaceData{ width, height, buffer }, dataPointer{ nullptr }, frame{ std::move( buffer ), width, height, width * 4, bmdFormat8BitBGRA } { }
+		explicit FrameEvent( IDeckLinkVideoInputFrame* frame ) : surfaceData{ 0, 0, nullptr }, dataPointer{ frame }, frame{ RefPtr<IDeckLinkVideoInputFrame>( frame ) } { }
+		//! Sends an existing frame again.
+		explicit FrameEvent( const InputFrame& source )
+			: surfaceData{ source.mBuffer && source.mPixelFormat == bmdFormat8BitBGRA ? source.mWidth : 0, source.mHeight, source.mPixelFormat == bmdFormat8BitBGRA ? source.mBuffer : nullptr }
+			, dataPointer{ source.getDeckLinkFrame() }
+			, frame( source )
+			, mFrameRef( source.mDeckLinkFrame )
+		{
+		}
+
+		// Keeps dataPointer alive while the event sits in the frame queue.
+		RefPtr<IDeckLinkVideoInputFrame>	mFrameRef;
 
 		friend class DeckLinkInput;
 	};
 
+	//! What DeckLinkInput delivers in place of the frames it misses while the signal is lost.
+	enum class LossSubstitution {
+		//! Nothing, frames simply stop.
+		NONE,
+		//! The last frame with a signal. Black until there is one. With YUV capture that frame is one of the driver's.
+		FREEZE,
+		BLACK,
+		//! The slate image of the options, black when there is none.
+		SLATE
+	};
+
+	struct InputWatchdogOptions {
+		bool				enabled = false;
+		//! Frame periods without a frame with a signal before the loss is reported.
+		double				timeoutFrames = 3.0;
+		LossSubstitution	substitution = LossSubstitution::NONE;
+		//! Scaled to the capture resolution when the capture starts or changes mode.
+		ci::Surface8uRef	slate;
+	};
+
+	struct AudioCaptureOptions {
+		bool				enabled = false;
+		//! The card takes 2, 8 or 16 channels.
+		unsigned			channels = 2;
+		BMDAudioSampleType	sampleType = bmdAudioSampleType16bitInteger;
+		//! How far back audio can still be read.
+		double				bufferSeconds = 2.0;
+		//! Meters every packet on the callback thread, see DeckLinkInput::getAudioLevels().
+		bool				metering = false;
+		AudioMeterOptions	meterOptions;
+	};
+
 	typedef std::function<void( FrameEvent& )> FrameCallback;
+	typedef std::function<void( IDeckLinkVideoInputFrame * frame )> RawFrameCallback;
+	typedef std::function<void( IDeckLinkAudioInputPacket * packet )> RawAudioCallback;
+
+	//! How DeckLinkInput hands frames over to the application.
+	enum class FrameDelivery {
+		//! The frame signal is emitted synchronously on the DeckLink callback thread.
+		SIGNAL,
+		//! The callback only queues a reference on the DeckLink frame into a wait-free queue. The application drains it
+		//! from its own thread with tryPopFrame(), which converts the frame there. Substitutes for a stalled input come from
+		//! the watchdog thread through a second queue, tryPopFrame() merges both in arrival order.
+		QUEUE
+	};
+
+	//! Capture and stall substitute queues together, except for the capacity, which is per queue.
+	struct FrameQueueStats {
+		size_t		depth = 0;
+		size_t		capacity = 0;
+		uint64_t	pushed = 0;
+		uint64_t	popped = 0;
+		//! Frames dropped because the queue was full.
+		uint64_t	overflows = 0;
+		//! Frames discarded by tryPopLatestFrame().
+		uint64_t	skipped = 0;
+		//! Time from the DeckLink callback entry to the frame being queued. Conversion happens later, in tryPopFrame().
+		double		lastEnqueueLatencyUs = 0.0;
+		double		meanEnqueueLatencyUs = 0.0;
+		double		maxEnqueueLatencyUs = 0.0;
+	};
 
 	typedef std::shared_ptr<class DeckLinkInput> DeckLinkInputRef;
 	class DeckLinkInput : public IDeckLinkInputCallback
@@ -116,7 +298,8 @@ namespace media {
 		DeckLinkInput( DeckLinkDevice * device );
 		~DeckLinkInput();
 
-		bool						start( BMDDisplayMode videoMode, bool useYUVTexture );
+		//! \a pixelFormat selects the YUV capture format: bmdFormat8BitYUV (UYVY) or bmdFormat10BitYUV (v210, see convertV210ToRGBA16() and friends).
+		bool						start( BMDDisplayMode videoMode, bool useYUVTexture, BMDPixelFormat pixelFormat = bmdFormat8BitYUV );
 		void						setUseYUVTexture( bool useYUVTexture ) { mUseYUVTexture = useYUVTexture; }
 		ci::signals::Signal<void( FrameEvent& )>& getFrameSignal() { return mSignalFrame; }
 		void						stop();
@@ -124,8 +307,98 @@ namespace media {
 
 		const glm::ivec2&			getResolution() const { return mResolution; }
 		std::vector<std::string>	getDisplayModeNames();
+
+		//! Pool backing the converted BGRA frames, sized for the current display mode. Exposes hit/miss counters.
+		const VideoFramePoolRef&	getFramePool() const { return mFramePool; }
+
+		//! Selects between signal and queue delivery. Must be called before start().
+		void						setFrameDelivery( FrameDelivery delivery, size_t queueCapacity = 4 );
+		FrameDelivery				getFrameDelivery() const { return mFrameDelivery; }
+		//! Queue delivery only, call from a single consumer thread. Returns false when no frame is pending. Without YUV
+		//! texture the frame is converted to BGRA here, on the calling thread and the conversion pool.
+		bool						tryPopFrame( FrameEvent& frameEvent );
+		//! Same as tryPopFrame() but drops every pending frame except the newest, only that one gets converted.
+		bool						tryPopLatestFrame( FrameEvent& frameEvent );
+		FrameQueueStats				getFrameQueueStats() const;
+
+		//! Called on the DeckLink callback thread with every captured frame before it is converted or delivered, for
+		//! forwarding it with the least latency (see SdiPassthrough). Must be called before start().
+		void						setRawFrameCallback( const RawFrameCallback& callback );
+
+		//! Splits BGRA conversion into horizontal stripes processed by \a numThreads cores, the converting thread included:
+		//! the callback thread, or the consumer with queue delivery. Optionally pinned to \a cpuAffinity. 1 converts on
+		//! that thread only, the default.
+		void						setConversionThreads( size_t numThreads, const std::vector<int>& cpuAffinity = std::vector<int>() );
+		size_t						getConversionThreads() const;
+
+		//! Replaces the allocator backing the frames the driver captures into. Must be called before start().
+		void						setFrameMemoryOptions( const MemoryAllocatorOptions& options );
+		//! Allocator installed with SetVideoInputFrameMemoryAllocator(), exposes committed memory and reuse counters.
+		const DeckLinkMemoryAllocatorRef&	getFrameAllocator() const { return mFrameAllocator; }
+
+		//! Watches the capture for lost signal and stalls (see InputWatchdog), and optionally delivers substitute frames
+		//! at the frame rate meanwhile so that consumers keep their cadence. Substitutes for no-signal frames are delivered
+		//! on the callback thread, substitutes for a stall on the watchdog thread. The callback hands frame arrivals over to
+		//! the watchdog thread through a wait-free queue and takes no lock for frames with a signal, except to keep the last
+		//! one with FREEZE. Must be called before start().
+		void						setWatchdogOptions( const InputWatchdogOptions& options );
+		const InputWatchdogOptions&	getWatchdogOptions() const { return mWatchdogOptions; }
+		//! Emitted on every signal state change, on the watchdog thread, within half a frame of the arrival that caused it.
+		ci::signals::Signal<void( const InputSignalEvent& )>&	getWatchdogSignal() { return mSignalWatchdog; }
+		InputSignalState			getSignalState() const;
+		InputWatchdogStats			getWatchdogStats() const;
+
+		//! Captures the embedded audio at 48 kHz into a ring buffer indexed by sample position in the stream, read with
+		//! readAudio(). The callback thread only copies packets into memory allocated at start(). Must be called before start().
+		void						setAudioCaptureOptions( const AudioCaptureOptions& options );
+		const AudioCaptureOptions&	getAudioCaptureOptions() const { return mAudioOptions; }
+		//! Buffer of the current capture, null when audio capture is off. Valid until the next start().
+		AudioRingBufferRef			getAudioBuffer() const { return std::atomic_load( &mAudioBuffer ); }
+		//! Any thread. Copies the interleaved audio of a video frame, frameEvent.audioSampleFrames sample frames of
+		//! getAudioBuffer()->getFrameBytes() bytes each, to \a dst. Returns false when that audio was not captured yet
+		//! (it may come with the next frame callback) or was already overwritten.
+		bool						readAudio( const FrameEvent& frameEvent, void * dst ) const;
+		//! Same for any block of sample frames, positions in the timeline of FrameEvent::audioPosition.
+		bool						readAudio( int64_t position, long sampleFrames, void * dst ) const;
+		//! Same as readAudio() into planar float, converted straight out of the ring buffer with convertAudioToFloat(),
+		//! which also describes \a routing.
+		bool						readAudioFloat( const FrameEvent& frameEvent, float * const * dst, size_t dstChannels, const int * routing = nullptr ) const;
+		bool						readAudioFloat( int64_t position, long sampleFrames, float * const * dst, size_t dstChannels, const int * routing = nullptr ) const;
+		//! Called on the DeckLink callback thread with every audio packet before it is buffered, to process it in place
+		//! (see convertAudioToFloat()). Must be called before start().
+		void						setRawAudioCallback( const RawAudioCallback& callback );
+		AudioBufferStats			getAudioStats() const;
+		//! Any thread. Newest peak, RMS and loudness levels of the capture, updated every 100 ms of audio. Channels is
+		//! 0 when metering is off.
+		AudioLevels					getAudioLevels() const;
+		//! Meter of the current capture, null when metering is off. Valid until the next start().
+		AudioMeterRef				getAudioMeter() const { return std::atomic_load( &mAudioMeter ); }
 	private:
 		glm::ivec2					getDisplayModeResolution( BMDDisplayMode mode );
+		int64_t						getDisplayModeFrameDurationUs( BMDDisplayMode mode );
+		void						resizeFramePool( const glm::ivec2& resolution );
+		PooledFrameBufferRef		acquireFrameBuffer( long width, long height );
+		//! Queue delivery entry: a captured frame, converted when popped, or a substitute from the watchdog.
+		struct QueuedFrame {
+			RefPtr<IDeckLinkVideoInputFrame>	frame;
+			InputFrame							substitute;
+			//! Host time of the push, orders the two queues.
+			int64_t								timeUs = 0;
+		};
+
+		FrameEvent					createFrameEvent( IDeckLinkVideoInputFrame* frame );
+		FrameEvent					createQueuedFrameEvent( const QueuedFrame& queued );
+		bool						popQueuedFrame( QueuedFrame& queued );
+		void						convertFrame( IDeckLinkVideoInputFrame* frame, VideoFrameBGRA& dest );
+
+		void						startWatchdog( int64_t frameDurationUs );
+		void						stopWatchdog();
+		void						watchdogLoop();
+		void						emitWatchdogEvents( const std::vector<InputSignalEvent>& events );
+		void						prepareSubstituteFrames( const glm::ivec2& resolution, BMDPixelFormat pixelFormat );
+		//! \a watchdogThread picks the queue, each one has a single producer.
+		void						deliverSubstituteFrame( bool watchdogThread );
+		void						setAudioSpan( IDeckLinkVideoInputFrame* frame, FrameEvent& frameEvent );
 		IDeckLinkInput *					mDecklinkInput;
 		std::vector<IDeckLinkDisplayMode*>	mModesList;
 
@@ -145,10 +418,52 @@ namespace media {
 
 		DeckLinkDevice *					mDevice;
 		glm::ivec2							mResolution;
+		BMDPixelFormat						mPixelFormat;
 
 		ULONG								m_refCount;
 
 		std::mutex							mFrameMutex;
+
+		VideoFramePoolRef					mFramePool;
+
+		RawFrameCallback								mRawFrameCallback;
+		FrameDelivery									mFrameDelivery;
+		//! Filled by the callback thread, captures and no-signal substitutes.
+		std::unique_ptr<SpscQueue<QueuedFrame>>			mFrameQueue;
+		//! Filled by the watchdog thread, substitutes while the callbacks have stopped.
+		std::unique_ptr<SpscQueue<QueuedFrame>>			mStallQueue;
+		std::atomic<uint64_t>							mFramesSkipped;
+		std::atomic<uint64_t>							mEnqueueLatencyLastNs, mEnqueueLatencyMaxNs, mEnqueueLatencySumNs, mEnqueueCount;
+
+		WorkerPoolRef						mConversionPool;
+		DeckLinkMemoryAllocatorRef			mFrameAllocator;
+
+		InputWatchdogOptions				mWatchdogOptions;
+		//! Frame arrival as the callback thread hands it to the watchdog thread.
+		struct WatchdogArrival {
+			bool		hasSignal = false;
+			int64_t		timeUs = 0;
+		};
+
+		//! Guards the watchdog state, fed and polled by the watchdog thread.
+		mutable std::mutex					mWatchdogMutex;
+		std::condition_variable				mWatchdogCondition;
+		std::thread							mWatchdogThread;
+		bool								mWatchdogActive;
+		InputWatchdog						mWatchdog;
+		//! Filled by the callback thread, drained by the watchdog thread. Replaced by start() before the callbacks run.
+		std::unique_ptr<SpscQueue<WatchdogArrival>>		mWatchdogArrivals;
+		ci::signals::Signal<void( const InputSignalEvent& )>	mSignalWatchdog;
+		//! Guards the substitute frames, shared between the callback, the watchdog and the consumer thread.
+		std::mutex							mSubstituteMutex;
+		//! Last frame with a signal (FREEZE), and black or slate frames in BGRA and in the capture format.
+		InputFrame							mLastGoodFrame, mSubstituteBGRA, mSubstituteYUV;
+
+		AudioCaptureOptions					mAudioOptions;
+		RawAudioCallback					mRawAudioCallback;
+		//! Written by the callback thread only, replaced by start() before the callbacks run.
+		AudioRingBufferRef					mAudioBuffer;
+		AudioMeterRef						mAudioMeter;
 	};
 }
 
@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "DeckLinkAPI_h.h"
+#include "FrameMemoryCache.h"
+#include "RefPtr.h"
+
+namespace media {
+
+	typedef RefPtr<class DeckLinkMemoryAllocator> DeckLinkMemoryAllocatorRef;
+
+	//! Frame memory handed to the DeckLink driver, the IDeckLinkMemoryAllocator face of a FrameMemoryCache: Commit() and
+	//! Decommit() map to commit() and decommit(), and a refused allocation is E_OUTOFMEMORY.
+	class DeckLinkMemoryAllocator : public IDeckLinkMemoryAllocator {
+	public:
+		static DeckLinkMemoryAllocatorRef	create( const MemoryAllocatorOptions& options = MemoryAllocatorOptions() );
+
+		const MemoryAllocatorOptions&		getOptions() const { return mCache.getOptions(); }
+		MemoryAllocatorStats				getStats() const { return mCache.getStats(); }
+
+		// IDeckLinkMemoryAllocator interface
+		virtual HRESULT	STDMETHODCALLTYPE	AllocateBuffer( unsigned int bufferSize, void **allocatedBuffer ) override;
+		virtual HRESULT	STDMETHODCALLTYPE	ReleaseBuffer( void *buffer ) override;
+		virtual HRESULT	STDMETHODCALLTYPE	Commit() override;
+		virtual HRESULT	STDMETHODCALLTYPE	Decommit() override;
+
+		virtual HRESULT	STDMETHODCALLTYPE	QueryInterface( REFIID iid, LPVOID *ppv ) override;
+		virtual ULONG	STDMETHODCALLTYPE	AddRef() override;
+		virtual ULONG	STDMETHODCALLTYPE	Release() override;
+	private:
+		explicit DeckLinkMemoryAllocator( const MemoryAllocatorOptions& options );
+		virtual ~DeckLinkMemoryAllocator();
+		DeckLinkMemoryAllocator( const DeckLinkMemoryAllocator& ) = delete;
+		DeckLinkMemoryAllocator& operator=( const DeckLinkMemoryAllocator& ) = delete;
+
+		FrameMemoryCache						mCache;
+		ULONG									m_refCount;
+	};
+
+} //end namespace media
@@ -35,36 +35,233 @@
 
 #pragma once
 
+#include "AudioPlayoutBuffer.h"
 #include "DeckLinkDeviceDiscovery.h"
+#include "DeckLinkMemoryAllocator.h"
+#include "ImageResampler.h"
+#include "OutputClock.h"
+#include "OutputReadback.h"
+#include "OutputTelemetry.h"
+#include "PrerollController.h"
+#include "TripleBuffer.h"
+#include "VideoConversion.h"
+#include "WorkerPool.h"
 #include "cinder/Surface.h"
 
 #include <vector>
 #include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 namespace media {
 
 	class DeckLinkDevice;
 
+	//! Output frame buffer handed out by DeckLinkOutput::acquireFrame(), written by the application and then given back
+	//! with DeckLinkOutput::commitFrame(). BGRA rows are bottom-up (OpenGL order), frames being flipped vertically on output;
+	//! YUV frames are top-down.
+	class OutputFrame {
+	public:
+		OutputFrame() : mWidth{ 0 }, mHeight{ 0 }, mRowBytes{ 0 }, mPixelFormat{ bmdFormat8BitBGRA }, mData{ nullptr } { }
+
+		explicit operator bool() const { return mData != nullptr; }
+
+		long						getWidth() const { return mWidth; }
+		long						getHeight() const { return mHeight; }
+		long						getRowBytes() const { return mRowBytes; }
+		BMDPixelFormat				getPixelFormat() const { return mPixelFormat; }
+		uint8_t *					getData() const { return mData; }
+	private:
+		explicit OutputFrame( RefPtr<IDeckLinkVideoFrame> frame );
+
+		RefPtr<IDeckLinkVideoFrame>	mFrame;
+		long						mWidth, mHeight, mRowBytes;
+		BMDPixelFormat				mPixelFormat;
+		uint8_t *					mData;
+
+		friend class DeckLinkOutput;
+	};
+
+	struct OutputFrameStats {
+		uint64_t	committed = 0;
+		//! Output slots that had no new frame, the last one being shown again.
+		uint64_t	repeated = 0;
+		//! Committed frames replaced by a newer one before reaching the output.
+		uint64_t	skipped = 0;
+	};
+
+	//! Target display of a frame requested in pull mode.
+	struct OutputFrameTime {
+		//! Output slot the frame is expected to be scheduled at, counted from the start of playback.
+		uint64_t	frameIndex = 0;
+		//! Display time in the time scale of the mode, frameIndex * frameDuration.
+		int64_t		streamTime = 0;
+		int64_t		frameDuration = 0;
+		int64_t		timeScale = 0;
+		//! Hardware reference clock time the frame is expected on air at, in microseconds. -1 when the card did not tell.
+		int64_t		hardwareTimeUs = -1;
+		//! Audio sample frames going out with the frame, [audioPosition, audioPosition + audioSampleFrames). Empty when
+		//! audio output is off. See DeckLinkOutput::writeAudio().
+		int64_t		audioPosition = 0;
+		long		audioSampleFrames = 0;
+
+		double		getSeconds() const { return timeScale > 0 ? double( streamTime ) / double( timeScale ) : 0.0; }
+	};
+
+	struct PullModeStats {
+		uint64_t	requests = 0;
+		uint64_t	fills = 0;
+		//! Requests replaced by a newer one before the fill thread got to them, the fill callback being slower than the output.
+		uint64_t	overruns = 0;
+		double		lastFillMs = 0.0;
+		double		maxFillMs = 0.0;
+	};
+
+	struct AudioOutputOptions {
+		bool				enabled = false;
+		//! The card takes 2, 8 or 16 channels.
+		unsigned			channels = 2;
+		BMDAudioSampleType	sampleType = bmdAudioSampleType16bitInteger;
+		//! Audio the application can write ahead of the output.
+		double				bufferSeconds = 1.0;
+		//! Audio queued in the driver. Nothing is scheduled until it drops under the low watermark, then it is topped up
+		//! to the high one in one batch. Keep the high watermark under the video latency (see PrerollOptions) so that the
+		//! audio of a frame, written when the frame is rendered, is there before it is needed.
+		double				lowWatermarkMs = 20.0;
+		double				highWatermarkMs = 40.0;
+	};
+
+	typedef std::function<void( OutputFrame& frame, const OutputFrameTime& time )> FillCallback;
+
 	typedef std::shared_ptr<class DeckLinkOutput> DeckLinkOutputRef;
-	class DeckLinkOutput : public IDeckLinkVideoOutputCallback
+	class DeckLinkOutput : public IDeckLinkVideoOutputCallback, public IDeckLinkAudioOutputCallback
 	{
 	public:
 		DeckLinkOutput( DeckLinkDevice * device );
 		~DeckLinkOutput();
 
+		//! Surfaces of another size than the mode are scaled with the resample filter, RGB, BGR, RGBA, BGRA, RGBX and BGRX
+		//! channel orders are swizzled in the same pass.
 		void sendSurface( const ci::Surface& surface );
 		void sendTexture( const ci::gl::Texture2dRef& texture );
 		void sendWindowSurface();
-		bool start( BMDDisplayMode videoMode );
+		//! Starts playback in \a pixelFormat: bmdFormat8BitBGRA, or bmdFormat8BitYUV and bmdFormat10BitYUV for which the
+		//! send methods encode their BGRA input, see setYCbCrEncoding().
+		bool start( BMDDisplayMode videoMode, BMDPixelFormat pixelFormat = bmdFormat8BitBGRA );
 		void stop();
 
+		//! Starts playback for frames forwarded as they arrive, see SdiPassthrough. \a leadFrames of black preroll are
+		//! scheduled and the output callback stops scheduling on its own: every frame comes from schedulePassthroughFrame().
+		//! The send methods, acquireFrame() and pull mode must not be used meanwhile.
+		bool startPassthrough( BMDDisplayMode videoMode, BMDPixelFormat pixelFormat, unsigned leadFrames = 1 );
+		bool isPassthrough() const { return mPassthroughLead > 0; }
+		//! Frame duration of the running mode in microseconds, 0 before start().
+		int64_t getFrameDurationUs() const { return frameTimescale > 0 ? int64_t( frameDuration ) * 1000000 / frameTimescale : 0; }
+		//! Passthrough only, from a single thread. Schedules \a frame, typically a captured frame in the output mode and
+		//! pixel format, in the first slot at least leadFrames ahead of the playback position, and returns in
+		//! \a displayDelayUs how long until it goes on air. Returns false when the frame does not match the mode, when the
+		//! schedule already runs more than a frame past that slot (input faster than output, the frame is dropped so the
+		//! latency stays bounded), or when the driver refuses it. The driver holds a reference until the frame completes.
+		bool schedulePassthroughFrame( IDeckLinkVideoFrame * frame, int64_t * displayDelayUs = nullptr );
+
+		//! Returns the next writable output frame so applications render or convert straight into the memory that gets
+		//! scheduled. Empty when playback is not started. The send methods are built on top of it.
+		OutputFrame	acquireFrame();
+		//! Queues \a frame for the next free output slot and empties the handle. A frame committed before the previous one
+		//! went out replaces it; when nothing new is committed in time the last frame is repeated.
+		//! acquireFrame() and commitFrame() must be called from a single thread, they never block on the output callback.
+		void		commitFrame( OutputFrame& frame );
+		OutputFrameStats	getFrameStats() const;
+
+		//! Switches to pull mode from the next start() on: \a fill is called on a dedicated output thread, exactly once per
+		//! frame the output needs, with the frame to write and its target display time, and the frame is committed when it
+		//! returns. Rendering is then clocked by the card instead of by vsync; rendering with OpenGL from the callback takes
+		//! a context current on that thread. The send methods, acquireFrame() and commitFrame() must not be used in pull mode.
+		//! An empty callback goes back to push mode.
+		void		setFillCallback( const FillCallback& fill ) { mFillCallback = fill; }
+		bool		isPullMode() const { return static_cast<bool>( mFillCallback ); }
+		PullModeStats	getPullModeStats() const;
+
+		//! Schedules audio along with the video from the next start() on, passthrough excepted. Audio shares the timeline of
+		//! the video: sample position p plays with the frame at p / 48000 seconds, see getAudioPosition().
+		void		setAudioOutputOptions( const AudioOutputOptions& options ) { mAudioOptions = options; }
+		const AudioOutputOptions&	getAudioOutputOptions() const { return mAudioOptions; }
+		//! Producer side, from a single thread. Writes interleaved sample frames at  position, typically
+		//! OutputFrameTime::audioPosition in pull mode. Audio for positions already played out is dropped so the rest stays
+		//! in sync, see AudioPlayoutBuffer. Returns the sample frames accepted.
+		size_t		writeAudio( int64_t position, const void * samples, size_t sampleFrames );
+		//! Same, appending to the audio written so far.
+		size_t		writeAudio( const void * samples, size_t sampleFrames );
+		//! First audio sample frame of the video frame in slot  frameIndex.
+		int64_t		getAudioPosition( uint64_t frameIndex ) const;
+		//! Buffer of the current playback, null when audio output is off. Valid until the next start().
+		AudioPlayoutBufferRef	getAudioBuffer() const { return std::atomic_load( &mAudioBuffer ); }
+		AudioPlayoutStats	getAudioStats() const;
+
+		//! Number of asynchronous readbacks sendTexture() and sendWindowSurface() keep in flight. 1 reads back synchronously,
+		//! the default of 2 overlaps the transfer of a frame with the rendering of the next one at the cost of up to a
+		//! frame of latency. Render thread only.
+		void		setReadbackDepth( size_t depth ) { mReadbackDepth = depth > 0 ? depth : 1; }
+		size_t		getReadbackDepth() const { return mReadbackDepth; }
+		//! Render thread only.
+		ReadbackStats	getReadbackStats() const;
+
+		//! Filter sendSurface() scales with, bilinear by default. Render thread only.
+		void		setResampleFilter( ResampleFilter filter ) { mResampleFilter = filter; }
+		ResampleFilter	getResampleFilter() const { return mResampleFilter; }
+		//! Splits scaling into horizontal stripes processed by \a numThreads cores (the render thread included), optionally
+		//! pinned to \a cpuAffinity. 1 scales on the render thread only, the default; UHD Lanczos output typically needs 4.
+		void		setConversionThreads( size_t numThreads, const std::vector<int>& cpuAffinity = std::vector<int>() );
+		size_t		getConversionThreads() const { return mConversionPool ? mConversionPool->getConcurrency() : 1; }
+
+		//! Encoding the send methods use in YUV output formats. Until this is called the matrix follows the mode,
+		//! BT.601 for SD and BT.709 above. Render thread only.
+		void		setYCbCrEncoding( YCbCrMatrix matrix, YCbCrRange range = YCbCrRange::LEGAL, ChromaFilter filter = ChromaFilter::COSITED );
+		YCbCrMatrix		getYCbCrMatrix() const { return mMatrix; }
+		YCbCrRange		getYCbCrRange() const { return mRange; }
+		ChromaFilter	getChromaFilter() const { return mChromaFilter; }
+
+		//! Latency target and adaptation of the output queue, taking effect at the next start().
+		void		setPrerollOptions( const PrerollOptions& options ) { mPrerollOptions = options; }
+		const PrerollOptions&	getPrerollOptions() const { return mPrerollOptions; }
+		PrerollStats	getPrerollStats() const;
+		//! Pacing of the current playback: completion counters, frame timeline and jitter / late-rate histograms.
+		const OutputTelemetry&	getTelemetry() const { return mTelemetry; }
+		//! Schedule resyncs against the card clock and the measured drift between host and card clocks.
+		OutputClockStats	getClockStats() const { return mClock.getStats(); }
+
+		//! Replaces the allocator backing the output frames, taking effect at the next start().
+		void		setFrameMemoryOptions( const MemoryAllocatorOptions& options );
+		//! Allocator installed with SetVideoOutputFrameMemoryAllocator(), exposes committed memory and reuse counters.
+		const DeckLinkMemoryAllocatorRef&	getFrameAllocator() const { return mFrameAllocator; }
 	private:
+		bool startPlayback( BMDDisplayMode videoMode, BMDPixelFormat pixelFormat );
 		void setPreroll();
+		RefPtr<IDeckLinkVideoFrame>	createFrame();
+		void clearFrame( IDeckLinkVideoFrame * frame );
+		bool scheduleFrame( IDeckLinkVideoFrame * frame );
+		bool prepareReadback();
+		void writeFrame( const uint8_t * pixels, size_t rowBytes );
+		void resampleSurface( const ci::Surface& surface, uint8_t * dst, size_t dstRowBytes );
+		void startFillThread();
+		void stopFillThread();
+		void requestFill( uint64_t frameIndex );
+		int64_t getSlotHardwareTimeUs( uint64_t slot );
+		void fillLoop();
+		bool startAudio();
+		void stopAudio();
+		void refillAudio( bool preroll );
+		bool scheduleAudio( AudioPlayoutBuffer& buffer, const uint8_t * frames, size_t frameCount );
 
 		// IDeckLinkVideoOutputCallback
 		virtual HRESULT	STDMETHODCALLTYPE	ScheduledFrameCompleted( IDeckLinkVideoFrame* completedFrame, BMDOutputFrameCompletionResult result ) override;
 		virtual HRESULT	STDMETHODCALLTYPE	ScheduledPlaybackHasStopped() override;
 
+		// IDeckLinkAudioOutputCallback
+		virtual HRESULT	STDMETHODCALLTYPE	RenderAudioSamples( BOOL preroll ) override;
+
 		virtual HRESULT				QueryInterface( REFIID iid, LPVOID *ppv ) override;// { return E_NOINTERFACE; }
 		virtual ULONG				AddRef() override;
 		virtual ULONG				Release() override;
@@ -73,14 +270,59 @@ namespace media {
 
 		IDeckLinkOutput*			mDeckLinkOutput;
 		glm::ivec2					mResolution;
+		BMDPixelFormat				mPixelFormat;
+		YCbCrMatrix					mMatrix;
+		YCbCrRange					mRange;
+		ChromaFilter				mChromaFilter;
+		bool						mMatrixFromMode;
 		BMDTimeValue				frameDuration;
 		BMDTimeScale				frameTimescale;
 		unsigned __int32			uiFPS;
 		unsigned __int32			uiTotalFrames;
+		//! Lead of passthrough playback in frames, 0 for regular playback. Only changes while stopped.
+		unsigned					mPassthroughLead;
+
+		DeckLinkMemoryAllocatorRef				mFrameAllocator;
+		//! Frames between the application (write slot) and ScheduledFrameCompleted (read slot), none of them scheduled.
+		TripleBuffer<RefPtr<IDeckLinkVideoFrame>>	mFrames;
+		//! Most recently scheduled frame, copied into the completed slot when nothing new was committed. Callback thread only.
+		RefPtr<IDeckLinkVideoFrame>				mLastFrame;
+
+		PrerollOptions						mPrerollOptions;
+		//! Shared between the callback thread and getPrerollStats().
+		PrerollController					mPreroll;
+		mutable std::mutex					mPrerollMutex;
+
+		OutputTelemetry						mTelemetry;
+		OutputClock							mClock;
+
+		FillCallback						mFillCallback;
+		std::thread							mFillThread;
+		mutable std::mutex					mFillMutex;
+		std::condition_variable				mFillCondition;
+		//! Set while the fill thread runs, requests from the callback thread are ignored otherwise.
+		bool								mFillActive;
+		bool								mFillPending;
+		OutputFrameTime						mFillTime;
+		PullModeStats						mPullStats;
+
+		ImageResampler						mResampler;
+		ResampleFilter						mResampleFilter;
+		WorkerPoolRef						mConversionPool;
+		//! Scaled BGRA staging for YUV formats, which encode from BGRA.
+		std::vector<uint8_t>				mScaledPixels;
 
-		ci::SurfaceRef				mWindowSurface;
+		AudioOutputOptions					mAudioOptions;
+		//! Read by the audio callback, replaced by start() before the callbacks run.
+		AudioPlayoutBufferRef				mAudioBuffer;
+		//! Watermarks in sample frames, and a high watermark of silence.
+		size_t								mAudioLowWatermark, mAudioHighWatermark;
+		std::vector<uint8_t>				mAudioSilence;
+		//! Set from start() until the first audio preroll callback starts playback.
+		std::atomic<bool>					mAudioPreroll;
 
-		mutable std::mutex					mMutex;
+		OutputReadbackRef					mReadback;
+		size_t								mReadbackDepth;
 
 		ULONG				m_refCount;
 	};
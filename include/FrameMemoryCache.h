@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace media {
+
+	struct MemoryAllocatorOptions {
+		//! Backs buffers with huge pages (MAP_HUGETLB, or MEM_LARGE_PAGES which needs the SeLockMemoryPrivilege),
+		//! falling back to regular pages when the system has none to give.
+		bool		largePages = false;
+		//! Touches every page on allocation so the driver and the conversion passes never take the page faults.
+		bool		prefault = true;
+		//! Upper bound on the memory held by the allocator, outstanding and cached buffers together. 0 is unbounded.
+		size_t		maxCommittedBytes = 0;
+	};
+
+	struct MemoryAllocatorStats {
+		//! allocate() calls that returned a buffer.
+		uint64_t	allocations = 0;
+		//! Allocations served with a previously released buffer instead of fresh memory.
+		uint64_t	reuses = 0;
+		//! Allocations refused because they would have exceeded maxCommittedBytes.
+		uint64_t	rejections = 0;
+		size_t		outstandingBuffers = 0;
+		size_t		cachedBuffers = 0;
+		size_t		largePageBuffers = 0;
+		size_t		committedBytes = 0;
+		size_t		peakCommittedBytes = 0;
+	};
+
+	//! Page aligned (so 64-byte aligned) frame memory, optionally huge page backed and pre-faulted, with a cache of
+	//! released blocks and a cap on the memory held. Released blocks are cached for reuse while committed; decommit()
+	//! frees the cache and makes blocks released afterwards go straight back to the system. Starts committed.
+	//! Thread-safe. DeckLinkMemoryAllocator exposes it to the driver as an IDeckLinkMemoryAllocator.
+	class FrameMemoryCache {
+	public:
+		explicit FrameMemoryCache( const MemoryAllocatorOptions& options = MemoryAllocatorOptions() );
+		~FrameMemoryCache();
+
+		//! At least \a bufferSize bytes, null if the cap or the system refuses.
+		void *							allocate( size_t bufferSize );
+		//! Returns false if \a buffer was not allocated here or was already released.
+		bool							release( void * buffer );
+		void							commit();
+		void							decommit();
+
+		const MemoryAllocatorOptions&	getOptions() const { return mOptions; }
+		MemoryAllocatorStats			getStats() const;
+	private:
+		struct Block {
+			//! Requested size rounded to the page size, used to match cached blocks.
+			size_t	size;
+			//! Size of the mapping, larger than size for huge pages.
+			size_t	mappedSize;
+			bool	largePages;
+		};
+
+		FrameMemoryCache( const FrameMemoryCache& ) = delete;
+		FrameMemoryCache& operator=( const FrameMemoryCache& ) = delete;
+
+		void *						mapBlock( size_t size, Block * block ) const;
+		void						unmapBlock( void * data, const Block& block );
+		void						releaseCachedBlocks();
+
+		const MemoryAllocatorOptions			mOptions;
+		mutable std::mutex						mMutex;
+		std::unordered_map<void*, Block>		mOutstandingBlocks;
+		std::vector<std::pair<void*, Block>>	mCachedBlocks;
+		bool									mCommitted;
+		MemoryAllocatorStats					mStats;
+	};
+
+} //end namespace media
@@ -0,0 +1,292 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace media {
+
+	enum class FrameSyncEventType {
+		//! The output showed the same input frame again, the input runs slow.
+		REPEAT,
+		//! Input frames were never shown, the input runs fast.
+		DROP
+	};
+
+	struct FrameSyncEvent {
+		FrameSyncEventType	type = FrameSyncEventType::REPEAT;
+		//! Output frame the event happened in, counted from reset().
+		uint64_t			outputIndex = 0;
+		//! Frames repeated or dropped at once.
+		uint32_t			count = 1;
+		//! Display time of the output frame.
+		int64_t				timeUs = 0;
+	};
+
+	struct FrameSyncOptions {
+		//! Input frames buffered ahead of the output, the oldest is dropped when a new one does not fit.
+		size_t		capacity = 3;
+		//! How far behind the input the output runs, in frames. The picks sit half a frame away from the arrival times, the
+		//! most room timestamp jitter can get.
+		double		delayFrames = 1.5;
+		//! How far past the pick threshold the next frame must be before a repeat or a drop, in frames. Keeps arrival jitter
+		//! from turning a single slip into a repeat followed by a drop.
+		double		hysteresisFrames = 0.25;
+		//! Events kept until popEvents(), older ones are counted as lost.
+		size_t		eventHistory = 256;
+	};
+
+	struct FrameSyncStats {
+		uint64_t	pushed = 0;
+		//! Output frames asked for, and those of them that got an input frame.
+		uint64_t	outputs = 0;
+		uint64_t	selected = 0;
+		//! Frames repeated and dropped so far.
+		uint64_t	repeats = 0;
+		uint64_t	drops = 0;
+		//! Frames dropped because the buffer was full, also counted in drops once the output skips them.
+		uint64_t	overflows = 0;
+		uint64_t	lostEvents = 0;
+		size_t		buffered = 0;
+		//! Frame periods measured from the timestamps since reset(), and the input rate relative to the output in parts
+		//! per million, positive when the input runs fast.
+		double		inputPeriodUs = 0.0;
+		double		outputPeriodUs = 0.0;
+		double		driftPpm = 0.0;
+		//! Time between the arrival of the last selected input frame and its display.
+		double		latencyUs = 0.0;
+	};
+
+	//! Frame synchronizer between an input and an output running on different clocks. Input frames go into a small bounded
+	//! buffer with the time they arrived, and each output frame takes the newest input frame that arrived at least
+	//! delayFrames before it goes on air. When the clocks drift apart this naturally repeats a frame now and then (slow
+	//! input) or skips one (fast input). Interlaced frames are repeated and dropped as whole field pairs: a single field
+	//! would land on the lines of the other parity or show out of temporal order. Arrival times are smoothed by a tracking
+	//! loop so that timestamp jitter does not toggle between repeats and drops. Input and output times must come from the
+	//! same clock, ideally the hardware reference clock of the card. Push and select may run on different threads.
+	template<typename T>
+	class FrameSynchronizer {
+	public:
+		explicit FrameSynchronizer( const FrameSyncOptions& options = FrameSyncOptions() )
+			: mOptions( options ), mFrameDurationUs{ 0 }
+		{
+			if( mOptions.capacity == 0 )
+				mOptions.capacity = 1;
+			reset( 0 );
+		}
+
+		//! Starts over for frames of \a frameDurationUs.
+		void reset( int64_t frameDurationUs )
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mFrameDurationUs = frameDurationUs;
+			mQueue.clear();
+			mCurrent = Entry();
+			mEvents.clear();
+			mStats = FrameSyncStats();
+			mNextSequence = 1;
+			mInputPhaseUs = 0.0;
+			mInputPeriodUs = double( frameDurationUs );
+			mFirstInputUs = mLastInputUs = mFirstOutputUs = mLastOutputUs = 0;
+		}
+
+		//! Input side. \a timeUs is when the frame was fully received.
+		void push( T frame, int64_t timeUs )
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			trackInput( timeUs );
+
+			Entry entry;
+			entry.frame = std::move( frame );
+			entry.sequence = mNextSequence++;
+			entry.timeUs = mInputPhaseUs;
+			if( mQueue.size() >= mOptions.capacity ) {
+				mQueue.pop_front();
+				++mStats.overflows;
+			}
+			mQueue.push_back( std::move( entry ) );
+			++mStats.pushed;
+		}
+
+		//! Output side. Picks the input frame for the output frame going on air at \a timeUs, returns false until an input
+		//! frame is old enough to be shown.
+		bool select( int64_t timeUs, T * frame )
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			if( mStats.outputs == 0 )
+				mFirstOutputUs = timeUs;
+			mLastOutputUs = timeUs;
+			const uint64_t outputIndex = mStats.outputs++;
+
+			const double targetUs = double( timeUs ) - mOptions.delayFrames * double( mFrameDurationUs );
+			const double hysteresisUs = mOptions.hysteresisFrames * double( mFrameDurationUs );
+			if( ! mCurrent.sequence ) {
+				const Entry * first = findNewest( targetUs );
+				if( ! first )
+					return false;
+				mCurrent = *first;
+			}
+			else {
+				// The queue only holds frames newer than the current one, the front is the regular next frame.
+				const Entry * next = mQueue.empty() ? nullptr : &mQueue.front();
+				const Entry * newest = findNewest( targetUs - hysteresisUs );
+				if( ! next || next->timeUs > targetUs + hysteresisUs )
+					addEvent( FrameSyncEventType::REPEAT, outputIndex, 1, timeUs );
+				else {
+					const Entry * pick = newest && newest->sequence > next->sequence ? newest : next;
+					if( pick->sequence > mCurrent.sequence + 1 )
+						addEvent( FrameSyncEventType::DROP, outputIndex, uint32_t( pick->sequence - mCurrent.sequence - 1 ), timeUs );
+					mCurrent = *pick;
+				}
+			}
+
+			// Frames up to the current one can never be picked again.
+			while( ! mQueue.empty() && mQueue.front().sequence <= mCurrent.sequence )
+				mQueue.pop_front();
+
+			*frame = mCurrent.frame;
+			mStats.latencyUs = double( timeUs ) - mCurrent.timeUs;
+			++mStats.selected;
+			return true;
+		}
+
+		//! Repeat and drop events since the last call, oldest first.
+		std::vector<FrameSyncEvent> popEvents()
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			std::vector<FrameSyncEvent> events( mEvents.begin(), mEvents.end() );
+			mEvents.clear();
+			return events;
+		}
+
+		const FrameSyncOptions&	getOptions() const { return mOptions; }
+
+		FrameSyncStats getStats() const
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			FrameSyncStats stats = mStats;
+			stats.buffered = mQueue.size();
+			if( stats.pushed > 1 )
+				stats.inputPeriodUs = double( mLastInputUs - mFirstInputUs ) / double( stats.pushed - 1 );
+			if( stats.outputs > 1 )
+				stats.outputPeriodUs = double( mLastOutputUs - mFirstOutputUs ) / double( stats.outputs - 1 );
+			if( stats.inputPeriodUs > 0.0 && stats.outputPeriodUs > 0.0 )
+				stats.driftPpm = ( stats.outputPeriodUs / stats.inputPeriodUs - 1.0 ) * 1e6;
+			return stats;
+		}
+	private:
+		struct Entry {
+			T			frame;
+			//! 0 for none.
+			uint64_t	sequence = 0;
+			double		timeUs = 0.0;
+		};
+
+		// Gains of the arrival tracking loop, low enough to average out jitter over tens of frames.
+		static double getPhaseGain() { return 0.1; }
+		static double getPeriodGain() { return 0.005; }
+
+		const Entry * findNewest( double maxTimeUs ) const
+		{
+			const Entry * newest = nullptr;
+			for( const auto& entry : mQueue ) {
+				if( entry.timeUs > maxTimeUs )
+					break;
+				newest = &entry;
+			}
+			return newest;
+		}
+
+		void trackInput( int64_t timeUs )
+		{
+			if( mStats.pushed == 0 )
+				mFirstInputUs = timeUs;
+			mLastInputUs = timeUs;
+
+			const double predictedUs = mInputPhaseUs + mInputPeriodUs;
+			const double errorUs = double( timeUs ) - predictedUs;
+			// The first frame, a missing frame or a jump: start tracking again from this arrival.
+			if( mStats.pushed == 0 || mInputPeriodUs <= 0.0 || errorUs > mInputPeriodUs / 2 || errorUs < -mInputPeriodUs / 2 ) {
+				mInputPhaseUs = double( timeUs );
+				return;
+			}
+			mInputPhaseUs = predictedUs + errorUs * getPhaseGain();
+			mInputPeriodUs += errorUs * getPeriodGain();
+		}
+
+		void addEvent( FrameSyncEventType type, uint64_t outputIndex, uint32_t count, int64_t timeUs )
+		{
+			if( type == FrameSyncEventType::REPEAT )
+				mStats.repeats += count;
+			else
+				mStats.drops += count;
+
+			FrameSyncEvent event;
+			event.type = type;
+			event.outputIndex = outputIndex;
+			event.count = count;
+			event.timeUs = timeUs;
+			if( mOptions.eventHistory == 0 ) {
+				++mStats.lostEvents;
+				return;
+			}
+			if( mEvents.size() >= mOptions.eventHistory ) {
+				mEvents.pop_front();
+				++mStats.lostEvents;
+			}
+			mEvents.push_back( event );
+		}
+
+		FrameSyncOptions		mOptions;
+		mutable std::mutex		mMutex;
+		int64_t					mFrameDurationUs;
+
+		std::deque<Entry>		mQueue;
+		//! Input frame of the last output frame, kept for repeats.
+		Entry					mCurrent;
+		uint64_t				mNextSequence;
+		double					mInputPhaseUs, mInputPeriodUs;
+		int64_t					mFirstInputUs, mLastInputUs, mFirstOutputUs, mLastOutputUs;
+
+		std::deque<FrameSyncEvent>	mEvents;
+		FrameSyncStats			mStats;
+	};
+
+} //end namespace media
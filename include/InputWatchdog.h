@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace media {
+
+	enum class InputSignalState {
+		//! No frame with a signal since the watchdog started.
+		WAITING,
+		//! Frames with a signal arrive.
+		LOCKED,
+		//! Frames keep arriving but the card flags them as having no input source.
+		NO_SIGNAL,
+		//! No frame at all arrived for the timeout, the driver or the capture stopped calling back.
+		STALLED
+	};
+
+	struct InputSignalEvent {
+		InputSignalState	state = InputSignalState::WAITING;
+		InputSignalState	previous = InputSignalState::WAITING;
+		//! Time of the transition.
+		int64_t				timeUs = 0;
+		//! Time since the last frame with a signal. On the way back to LOCKED, the length of the outage.
+		int64_t				outageUs = 0;
+	};
+
+	struct InputWatchdogStats {
+		InputSignalState	state = InputSignalState::WAITING;
+		uint64_t			goodFrames = 0;
+		uint64_t			noSignalFrames = 0;
+		//! Transitions out of LOCKED, and into STALLED.
+		uint64_t			losses = 0;
+		uint64_t			stalls = 0;
+		//! Frames delivered in place of missing or no-signal ones.
+		uint64_t			substitutedFrames = 0;
+		double				lastOutageUs = 0.0;
+		double				longestOutageUs = 0.0;
+	};
+
+	//! Tracks the state of a capture signal from frame arrivals. A loss is reported once no frame with a signal arrived
+	//! for timeoutFrames frame periods, as NO_SIGNAL when the card keeps delivering frames flagged as having no input and
+	//! as STALLED when it stops delivering frames altogether; the first frame with a signal reports LOCKED again. Stalls
+	//! can only be seen by polling, so onTick() must be called at least once per frame period from a timer. While stalled
+	//! it also paces substitute frames at the frame rate. Holds no DeckLink state and takes times from the caller, so it
+	//! can be driven by a simulated clock. Not thread safe.
+	class InputWatchdog {
+	public:
+		explicit InputWatchdog( double timeoutFrames = 3.0 );
+
+		//! Starts over in the WAITING state at \a timeUs, for frames \a frameDurationUs apart.
+		void		reset( int64_t frameDurationUs, int64_t timeUs );
+		//! Follows a mode change without leaving the current state.
+		void		setFrameDuration( int64_t frameDurationUs );
+		//! Feeds a frame arrival. Returns true when the frame carries no signal and a substitute should take its place.
+		bool		onFrame( bool hasSignal, int64_t timeUs );
+		//! Checks for a stall. Returns true when a substitute frame is due to keep the frame rate while stalled.
+		bool		onTick( int64_t timeUs );
+		//! Counts a substitute delivered by the caller.
+		void		onSubstituted() { ++mStats.substitutedFrames; }
+
+		InputSignalState	getState() const { return mState; }
+		int64_t				getFrameDurationUs() const { return mFrameDurationUs; }
+		double				getTimeoutFrames() const { return mTimeoutFrames; }
+		//! Every transition since the last call, oldest first.
+		std::vector<InputSignalEvent>	popEvents();
+		InputWatchdogStats				getStats() const { return mStats; }
+	private:
+		void		transition( InputSignalState state, int64_t timeUs );
+		int64_t		getTimeoutUs() const;
+
+		double				mTimeoutFrames;
+		int64_t				mFrameDurationUs;
+		InputSignalState	mState;
+		int64_t				mLastArrivalUs, mLastGoodUs, mNextSubstituteUs;
+		std::vector<InputSignalEvent>	mEvents;
+		InputWatchdogStats	mStats;
+	};
+
+} //end namespace media
@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace media {
+
+	struct OutputClockOptions {
+		//! Frames the next schedule slot must stay ahead of the playback position before the schedule skips ahead.
+		unsigned	minLeadFrames = 1;
+		//! Interval between clock samples and number of samples the drift is fitted over.
+		double		driftSampleIntervalMs = 1000.0;
+		size_t		driftWindow = 64;
+	};
+
+	struct OutputClockStats {
+		//! Times the schedule fell behind playback and was moved ahead, and output slots skipped doing so.
+		uint64_t	resyncs = 0;
+		uint64_t	skippedSlots = 0;
+		//! How far ahead of the playback position the last frame was scheduled.
+		double		leadMs = 0.0;
+		//! Rate of the card clock relative to the host clock in parts per million, positive when the card runs fast.
+		//! Only meaningful once driftValid, it gets steadier as the window fills.
+		double		driftPpm = 0.0;
+		bool		driftValid = false;
+		size_t		driftSamples = 0;
+		//! Time span covered by the drift samples.
+		double		driftSpanMs = 0.0;
+	};
+
+	//! Keeps the output schedule locked to the card clock. Each slot is checked against the playback position
+	//! (GetScheduledStreamTime()) before a frame is scheduled, and when a stalled renderer or callback left the schedule
+	//! in the past it jumps ahead instead of queuing frames that can only be late. It also pairs hardware reference
+	//! clock readings with the host clock and fits their relative rate by least squares, the drift the application sees
+	//! as skipped or repeated frames. Holds no DeckLink state; scheduling and sampling come from one thread, the stats
+	//! may be read from any thread.
+	class OutputClock {
+	public:
+		explicit OutputClock( const OutputClockOptions& options = OutputClockOptions() );
+
+		//! Starts over for a frame rate of \a timeScale / \a frameDuration.
+		void				reset( int64_t frameDuration, int64_t timeScale );
+		//! Returns the slot to schedule the next frame at: \a nextSlot when it is far enough ahead of \a streamTime,
+		//! the first slot that is otherwise.
+		uint64_t			getScheduleSlot( uint64_t nextSlot, int64_t streamTime );
+		//! Adds a hardware reference clock reading and the host time it was taken at, both in microseconds. Readings
+		//! closer than driftSampleIntervalMs to the previous sample are ignored.
+		void				addClockSample( int64_t hardwareUs, int64_t hostUs );
+
+		const OutputClockOptions&	getOptions() const { return mOptions; }
+		OutputClockStats	getStats() const;
+	private:
+		struct Sample {
+			int64_t		hardwareUs, hostUs;
+		};
+
+		void				updateDrift();
+
+		OutputClockOptions		mOptions;
+		mutable std::mutex		mMutex;
+		int64_t					mFrameDuration, mTimeScale;
+		std::vector<Sample>		mSamples;
+		size_t					mNextSample;
+		int64_t					mLastSampleUs;
+		OutputClockStats		mStats;
+	};
+
+} //end namespace media
@@ -0,0 +1,106 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Pbo.h"
+#include "cinder/gl/Sync.h"
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace media {
+
+	struct ReadbackStats {
+		size_t		depth = 0;
+		uint64_t	reads = 0;
+		//! Transfers handed over to the consumer.
+		uint64_t	completed = 0;
+		//! Finished transfers dropped because a newer one finished in the same call.
+		uint64_t	discarded = 0;
+		//! Frames between issuing the readback of the last completed frame and handing it over, the latency added by the ring.
+		uint64_t	lastLatencyFrames = 0;
+		double		lastLatencyMs = 0.0;
+		double		meanLatencyMs = 0.0;
+	};
+
+	typedef std::shared_ptr<class OutputReadback> OutputReadbackRef;
+
+	//! Ring of pixel pack buffers reading BGRA frames back from the GPU asynchronously. Each read is fenced and only
+	//! mapped once the fence signals, so the transfer of frame N overlaps the rendering of frame N + 1. At most
+	//! depth - 1 transfers stay in flight after a read: depth 1 is a synchronous readback, depth 2 adds up to one frame
+	//! of latency and so on. Render thread only, with the GL context that created it current.
+	class OutputReadback {
+	public:
+		typedef std::function<void( const uint8_t * pixels, size_t rowBytes )> ConsumeFn;
+
+		static OutputReadbackRef	create( const glm::ivec2& size, size_t depth );
+
+		//! Reads the bound read framebuffer, then hands the newest finished frame, if any, to \a consume.
+		void						readFramebuffer( const ConsumeFn& consume );
+		//! Reads \a texture, then hands the newest finished frame, if any, to \a consume.
+		void						readTexture( const ci::gl::Texture2dRef& texture, const ConsumeFn& consume );
+
+		const glm::ivec2&			getSize() const { return mSize; }
+		size_t						getDepth() const { return mTransfers.size(); }
+		ReadbackStats				getStats() const;
+	private:
+		struct Transfer {
+			ci::gl::PboRef							pbo;
+			ci::gl::SyncRef							fence;
+			uint64_t								index;
+			std::chrono::steady_clock::time_point	issued;
+		};
+
+		OutputReadback( const glm::ivec2& size, size_t depth );
+		OutputReadback( const OutputReadback& ) = delete;
+		OutputReadback& operator=( const OutputReadback& ) = delete;
+
+		Transfer&					beginTransfer();
+		void						endTransfer( Transfer& transfer );
+		void						collect( const ConsumeFn& consume );
+
+		glm::ivec2					mSize;
+		size_t						mRowBytes;
+		std::vector<Transfer>		mTransfers;
+		//! Ring position of the oldest transfer in flight and number of transfers in flight.
+		size_t						mOldest, mPending;
+		ReadbackStats				mStats;
+		double						mLatencySumMs;
+	};
+
+} //end namespace media
@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "PrerollController.h"
+#include "cinder/Filesystem.h"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace media {
+
+	//! Timeline entry of one output frame.
+	struct FrameTiming {
+		//! Position of the frame in the output sequence.
+		uint64_t		index = 0;
+		//! Display time the frame was scheduled for, in the time scale of the mode. -1 when unknown.
+		int64_t			scheduledTime = -1;
+		FrameCompletion	result = FrameCompletion::COMPLETED;
+		//! Hardware reference clock at completion in microseconds, from GetFrameCompletionReferenceTimestamp(). -1 when unavailable.
+		int64_t			completionTimeUs = -1;
+		//! Time since the previous completion minus the frame duration. 0 when either timestamp is missing.
+		double			jitterMs = 0.0;
+	};
+
+	struct TelemetryHistogram {
+		//! Lower edge of each bin, the first bin also collects everything below its edge and the last one everything above.
+		std::vector<double>		lowerEdges;
+		std::vector<uint64_t>	counts;
+	};
+
+	struct OutputTelemetryOptions {
+		//! Frames kept in the timeline ring.
+		size_t		timelineFrames = 1024;
+		//! Width and number of the jitter histogram bins, centered on zero.
+		double		jitterBinMs = 0.25;
+		size_t		jitterBins = 33;
+		//! Frames per late-rate window, 0 for one second of frames.
+		size_t		lateWindowFrames = 0;
+	};
+
+	struct OutputTelemetryStats {
+		uint64_t	scheduled = 0;
+		uint64_t	completed = 0;
+		uint64_t	late = 0;
+		uint64_t	dropped = 0;
+		uint64_t	flushed = 0;
+		//! Late and dropped frames over every frame that reached the output.
+		double		lateRate = 0.0;
+		double		meanJitterMs = 0.0;
+		double		rmsJitterMs = 0.0;
+		double		maxJitterMs = 0.0;
+	};
+
+	//! Records how output frames were paced: counters, a ring of the most recent frames with their scheduled time,
+	//! completion result and completion timestamp, and histograms of completion jitter and of the late frame share per
+	//! window. Frames complete in the order they were scheduled, which is how completions are matched to schedule times.
+	//! Recording and queries may come from different threads.
+	class OutputTelemetry {
+	public:
+		explicit OutputTelemetry( const OutputTelemetryOptions& options = OutputTelemetryOptions() );
+
+		//! Clears everything for a new playback at \a timeScale / \a frameDuration frames per second.
+		void						reset( int64_t frameDuration, int64_t timeScale );
+		void						onFrameScheduled( int64_t scheduledTime );
+		//! \a completionTimeUs is negative when the driver gave no timestamp.
+		void						onFrameCompleted( FrameCompletion result, int64_t completionTimeUs );
+
+		const OutputTelemetryOptions&	getOptions() const { return mOptions; }
+		OutputTelemetryStats		getStats() const;
+		//! Most recent frames, oldest first.
+		std::vector<FrameTiming>	getTimeline() const;
+		TelemetryHistogram			getJitterHistogram() const;
+		//! Bin 0 counts windows without a late or dropped frame, bin k windows whose late share is in ( ( k - 1 ) / 10, k / 10 ].
+		TelemetryHistogram			getLateRateHistogram() const;
+		//! Writes the timeline as CSV for post-mortem analysis. Returns false if the file cannot be written.
+		bool						writeTimeline( const ci::fs::path& path ) const;
+	private:
+		struct Scheduled {
+			uint64_t	index;
+			int64_t		time;
+		};
+
+		OutputTelemetryOptions		mOptions;
+		mutable std::mutex			mMutex;
+		double						mFrameMs;
+		int64_t						mTimeScale;
+		size_t						mLateWindowFrames;
+
+		//! Frames scheduled and not completed yet, in display order.
+		std::deque<Scheduled>		mPending;
+		uint64_t					mNextIndex;
+		std::vector<FrameTiming>	mTimeline;
+		size_t						mTimelineNext;
+		int64_t						mLastCompletionUs;
+
+		OutputTelemetryStats		mStats;
+		double						mJitterSumMs, mJitterSquareSumMs;
+		uint64_t					mJitterCount;
+		std::vector<uint64_t>		mJitterCounts, mLateRateCounts;
+		size_t						mWindowFrames, mWindowLate;
+	};
+
+} //end namespace media
@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace media {
+
+	//! Outcome of a scheduled output frame, mirrors BMDOutputFrameCompletionResult.
+	enum class FrameCompletion { COMPLETED, LATE, DROPPED, FLUSHED };
+
+	struct PrerollOptions {
+		//! Output latency aimed for, rounded up to whole frames. It is also the floor the queue shrinks back to.
+		double		targetLatencyMs = 50.0;
+		unsigned	minFrames = 2;
+		unsigned	maxFrames = 10;
+		//! Time without a late or dropped frame after which the queue gives back one frame of latency.
+		double		shrinkAfterMs = 10000.0;
+	};
+
+	struct PrerollStats {
+		unsigned	targetFrames = 0;
+		//! GetBufferedVideoFrameCount() at the last completion.
+		unsigned	bufferedFrames = 0;
+		double		latencyMs = 0.0;
+		uint64_t	completed = 0;
+		uint64_t	late = 0;
+		uint64_t	dropped = 0;
+		uint64_t	flushed = 0;
+		uint64_t	grows = 0;
+		uint64_t	shrinks = 0;
+	};
+
+	//! Sizes the output queue from a latency target and adapts it to completion results. Every late or dropped frame grows
+	//! the queue by one frame, up to maxFrames; after shrinkAfterMs of clean output it shrinks by one, down to the target.
+	//! Underruns caused by frames that were queued before the last growth are not counted twice. Holds no DeckLink state,
+	//! so it can be driven by a simulated output clock. Not thread safe.
+	class PrerollController {
+	public:
+		explicit PrerollController( const PrerollOptions& options = PrerollOptions() );
+
+		//! Starts over for a frame rate of \a timeScale / \a frameDuration and returns the number of frames to preroll.
+		unsigned				reset( int64_t frameDuration, int64_t timeScale );
+		//! Feeds the result of a completed frame with the number of frames still queued, and returns how many frames to
+		//! schedule in its place: 1 in steady state, 2 to grow the queue and 0 to shrink it.
+		unsigned				onFrameCompleted( FrameCompletion completion, unsigned bufferedFrames );
+		//! Same when the queue depth is unavailable: the result is counted but the target is left alone, as an unknown depth
+		//! is no evidence of an underrun. Returns 1 to replace the completed frame, 0 for a flushed one.
+		unsigned				onFrameCompleted( FrameCompletion completion );
+
+		unsigned				getTargetFrames() const { return mTargetFrames; }
+		const PrerollOptions&	getOptions() const { return mOptions; }
+		PrerollStats			getStats() const;
+	private:
+		PrerollOptions	mOptions;
+		double			mFrameMs;
+		unsigned		mFloorFrames, mTargetFrames;
+		//! Clean completions since the last underrun or shrink, and the count after which the queue shrinks.
+		uint64_t		mCleanFrames, mShrinkFrames;
+		//! Completions left before another underrun may grow the queue again.
+		unsigned		mHoldoffFrames;
+		PrerollStats	mStats;
+	};
+
+} //end namespace media
@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+namespace media {
+
+	//! Intrusive smart pointer for anything exposing COM style AddRef() / Release(), including the DeckLink interfaces.
+	template<typename T>
+	class RefPtr {
+	public:
+		RefPtr() : mPtr{ nullptr } { }
+		RefPtr( std::nullptr_t ) : mPtr{ nullptr } { }
+		//! Takes a new reference on \a ptr.
+		explicit RefPtr( T * ptr ) : mPtr{ ptr } { if( mPtr ) mPtr->AddRef(); }
+		RefPtr( const RefPtr& other ) : mPtr{ other.mPtr } { if( mPtr ) mPtr->AddRef(); }
+		RefPtr( RefPtr&& other ) : mPtr{ other.mPtr } { other.mPtr = nullptr; }
+		~RefPtr() { if( mPtr ) mPtr->Release(); }
+
+		//! Wraps \a ptr without adding a reference, for objects returned with a reference already held.
+		static RefPtr	adopt( T * ptr ) { RefPtr result; result.mPtr = ptr; return result; }
+
+		RefPtr& operator=( RefPtr other ) { std::swap( mPtr, other.mPtr ); return *this; }
+
+		void			reset() { RefPtr().swap( *this ); }
+		void			swap( RefPtr& other ) { std::swap( mPtr, other.mPtr ); }
+
+		T *				get() const { return mPtr; }
+		T *				operator->() const { return mPtr; }
+		T&				operator*() const { return *mPtr; }
+		explicit		operator bool() const { return mPtr != nullptr; }
+
+		bool			operator==( const RefPtr& other ) const { return mPtr == other.mPtr; }
+		bool			operator!=( const RefPtr& other ) const { return mPtr != other.mPtr; }
+	private:
+		T * mPtr;
+	};
+
+} //end namespace media
@@ -0,0 +1,171 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "AudioDriftEstimator.h"
+#include "AudioResampler.h"
+#include "DeckLinkInput.h"
+#include "DeckLinkOutput.h"
+#include "FrameSynchronizer.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace media {
+
+	//! Captured frame on its way to the output. Hooks may write the pixels in place, in the capture pixel format.
+	struct PassthroughFrame {
+		uint8_t *					data = nullptr;
+		long						width = 0;
+		long						height = 0;
+		long						rowBytes = 0;
+		BMDPixelFormat				pixelFormat = bmdFormat8BitYUV;
+		//! Frames received since start(), and the capture stream time and duration of this one in microseconds.
+		uint64_t					frameIndex = 0;
+		int64_t						streamTimeUs = 0;
+		int64_t						frameDurationUs = 0;
+		//! Source frame, for timecodes and ancillary data.
+		IDeckLinkVideoInputFrame *	deckLinkFrame = nullptr;
+	};
+
+	typedef std::function<void( PassthroughFrame& frame )> PassthroughHook;
+
+	struct PassthroughOptions {
+		//! Output slots between the playback position and the slot a frame is scheduled in. 1 is the lowest the driver
+		//! reliably makes, raise it when hooks are slow or the system is loaded.
+		unsigned	leadFrames = 1;
+		//! Runs the output on its own clock instead of scheduling frames as they arrive, with a FrameSynchronizer in
+		//! between that repeats or drops whole frames as the input and output clocks drift apart. Needed when the input
+		//! is not locked to the output reference, at the cost of the output preroll and the sync delay in latency, and a
+		//! copy per frame. leadFrames does not apply, see setPrerollOptions() on the output instead.
+		bool				frameSync = false;
+		FrameSyncOptions	frameSyncOptions;
+		//! Frame sync only. Forwards the embedded audio, resampled to the output clock so that it stays locked to the video
+		//! instead of slipping with the clock drift. Turns on audio capture on the input and audio output on the output with
+		//! the channels and sample type below, 16 or 32-bit.
+		bool					audio = false;
+		unsigned				audioChannels = 2;
+		BMDAudioSampleType		audioSampleType = bmdAudioSampleType16bitInteger;
+		//! Audio plays this much later than the video it came with. A couple of milliseconds leave room for the resampler
+		//! filter and for timestamp jitter, so the audio an output frame needs has always been captured.
+		double					audioDelayMs = 2.0;
+		AudioDriftOptions		audioDriftOptions;
+		AudioResamplerOptions	audioResamplerOptions;
+	};
+
+	struct PassthroughStats {
+		uint64_t	received = 0;
+		uint64_t	forwarded = 0;
+		//! Frames the output did not take: input running ahead of the output clock, or a mode or format mismatch. With
+		//! frame sync the drops are in FrameSyncStats instead, this only counts frames that could not be used.
+		uint64_t	dropped = 0;
+		//! Glass-to-glass latency from the first line entering the input to the first line leaving the output: capture
+		//! of the whole frame, hooks and scheduling, and the wait for the output slot.
+		double		latencyUs = 0.0;
+		double		latencyFrames = 0.0;
+		double		meanLatencyUs = 0.0;
+		double		maxLatencyUs = 0.0;
+		//! Time spent in the hooks.
+		double		hookUs = 0.0;
+		double		maxHookUs = 0.0;
+		//! Audio passthrough. Latency the audio is held at, following the frame sync latency slowly, and output frames
+		//! that went out silent because their audio was not in the capture buffer.
+		double		audioLatencyUs = 0.0;
+		uint64_t	audioGaps = 0;
+	};
+
+	typedef std::shared_ptr<class SdiPassthrough> SdiPassthroughRef;
+
+	//! Forwards captured frames to an output in the same pixel format, without conversion or copy: the capture frame
+	//! itself is scheduled from the capture callback thread as soon as it arrives, so glass-to-glass latency is the
+	//! capture frame plus the output lead. The input frame signal keeps working for a preview, conversion is skipped
+	//! when nothing is connected to it.
+	class SdiPassthrough {
+	public:
+		static SdiPassthroughRef	create( DeckLinkInput * input, DeckLinkOutput * output, const PassthroughOptions& options = PassthroughOptions() );
+		~SdiPassthrough();
+
+		//! Hooks run in order on the capture callback thread and add straight to the latency. Must be called before start().
+		void				addHook( const PassthroughHook& hook );
+		void				clearHooks();
+
+		//! Starts the output then the input in \a videoMode, \a pixelFormat being bmdFormat8BitYUV or bmdFormat10BitYUV.
+		bool				start( BMDDisplayMode videoMode, BMDPixelFormat pixelFormat = bmdFormat8BitYUV );
+		void				stop();
+		bool				isRunning() const { return mRunning; }
+
+		const PassthroughOptions&	getOptions() const { return mOptions; }
+		PassthroughStats	getStats() const;
+		//! Frame sync only.
+		FrameSyncStats		getFrameSyncStats() const { return mSync.getStats(); }
+		//! Frame sync only. Every repeat and drop since the last call.
+		std::vector<FrameSyncEvent>	popFrameSyncEvents() { return mSync.popEvents(); }
+		//! Audio passthrough only. Clock drift between the input and output audio and the resampling ratio compensating it.
+		AudioDriftStats		getAudioDriftStats() const { return mDrift.getStats(); }
+	private:
+		SdiPassthrough( DeckLinkInput * input, DeckLinkOutput * output, const PassthroughOptions& options );
+		SdiPassthrough( const SdiPassthrough& ) = delete;
+		SdiPassthrough& operator=( const SdiPassthrough& ) = delete;
+
+		void				forwardFrame( IDeckLinkVideoInputFrame * frame );
+		void				fillFrame( OutputFrame& frame, const OutputFrameTime& time );
+		void				fillAudio( const OutputFrameTime& time );
+
+		DeckLinkInput *				mInput;
+		DeckLinkOutput *			mOutput;
+		PassthroughOptions			mOptions;
+		std::vector<PassthroughHook>	mHooks;
+		FrameSynchronizer<RefPtr<IDeckLinkVideoInputFrame>>	mSync;
+		bool						mRunning;
+
+		mutable std::mutex			mMutex;
+		PassthroughStats			mStats;
+		double						mLatencySumUs;
+
+		//! Audio passthrough, the input side timestamps mDrift on the capture thread, the rest runs on the fill thread.
+		AudioDriftEstimator			mDrift;
+		AudioResamplerRef			mResampler;
+		std::vector<uint8_t>		mAudioInput, mAudioOutput;
+		//! Next input sample frame the resampler reads, and whether it follows on from the previous block.
+		int64_t						mAudioReadPosition;
+		bool						mAudioLocked;
+		double						mAudioLatencyUs;
+		int64_t						mAudioLatencyTimeUs;
+	};
+
+} //end namespace media
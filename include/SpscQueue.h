@@ -0,0 +1,148 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace media {
+
+	//! Bounded wait-free queue for exactly one producer thread and one consumer thread. When the consumer falls
+	//! behind, pushes fail and the rejected items are counted as overflows; tryPopLatest() lets the consumer catch up.
+	template<typename T>
+	class SpscQueue {
+	public:
+		explicit SpscQueue( size_t capacity )
+			: mSlots( capacity > 0 ? capacity : 1 ), mHead{ 0 }, mTail{ 0 }, mOverflows{ 0 }, mSkipped{ 0 }
+		{
+		}
+
+		//! Producer side. Returns false, leaving \a value untouched, if the queue is full.
+		bool tryPush( T&& value )
+		{
+			const uint64_t head = mHead.load( std::memory_order_relaxed );
+			if( head - mTail.load( std::memory_order_acquire ) >= mSlots.size() ) {
+				mOverflows.fetch_add( 1, std::memory_order_relaxed );
+				return false;
+			}
+
+			mSlots[head % mSlots.size()] = std::move( value );
+			mHead.store( head + 1, std::memory_order_release );
+			return true;
+		}
+
+		bool tryPush( const T& value )
+		{
+			T copy = value;
+			return tryPush( std::move( copy ) );
+		}
+
+		//! Consumer side. Returns false if the queue is empty.
+		bool tryPop( T& value )
+		{
+			const uint64_t tail = mTail.load( std::memory_order_relaxed );
+			if( tail == mHead.load( std::memory_order_acquire ) )
+				return false;
+
+			// Moving out releases whatever the slot holds as soon as the consumer is done with it.
+			value = std::move( mSlots[tail % mSlots.size()] );
+			mTail.store( tail + 1, std::memory_order_release );
+			return true;
+		}
+
+		//! Consumer side. Oldest item, left in the queue, or null if the queue is empty. Valid until the next pop.
+		const T *	front() const
+		{
+			const uint64_t tail = mTail.load( std::memory_order_relaxed );
+			if( tail == mHead.load( std::memory_order_acquire ) )
+				return nullptr;
+
+			return &mSlots[tail % mSlots.size()];
+		}
+
+		//! Consumer side. Pops everything queued and keeps only the newest item, the others are counted as skipped.
+		bool tryPopLatest( T& value )
+		{
+			if( ! tryPop( value ) )
+				return false;
+
+			while( tryPop( value ) ) {
+				mSkipped.fetch_add( 1, std::memory_order_relaxed );
+			}
+			return true;
+		}
+
+		//! Approximate when called from a third thread, exact from either end.
+		size_t		size() const { return size_t( mHead.load( std::memory_order_acquire ) - mTail.load( std::memory_order_acquire ) ); }
+		size_t		capacity() const { return mSlots.size(); }
+		bool		empty() const { return size() == 0; }
+
+		uint64_t	getPushCount() const { return mHead.load( std::memory_order_relaxed ); }
+		uint64_t	getPopCount() const { return mTail.load( std::memory_order_relaxed ); }
+		uint64_t	getOverflowCount() const { return mOverflows.load( std::memory_order_relaxed ); }
+		uint64_t	getSkippedCount() const { return mSkipped.load( std::memory_order_relaxed ); }
+	private:
+		SpscQueue( const SpscQueue& ) = delete;
+		SpscQueue& operator=( const SpscQueue& ) = delete;
+
+		std::vector<T>				mSlots;
+
+		// Producer and consumer indices live on separate cache lines to avoid false sharing.
+		char						mPad0[64];
+		std::atomic<uint64_t>		mHead;
+		char						mPad1[64 - sizeof( std::atomic<uint64_t> )];
+		std::atomic<uint64_t>		mTail;
+		char						mPad2[64 - sizeof( std::atomic<uint64_t> )];
+		std::atomic<uint64_t>		mOverflows, mSkipped;
+	};
+
+	//! Consumer side of two queues with one producer each: pops the older of their fronts, \a older( a, b ) telling whether
+	//! a came before b, so that the merged stream keeps the order of both. Ties go to \a first.
+	template<typename T, typename Older>
+	bool tryPopOlder( SpscQueue<T>& first, SpscQueue<T>& second, T& value, Older older )
+	{
+		// Fronts only change when popped, and that only happens here.
+		const T * firstFront = first.front();
+		const T * secondFront = second.front();
+		if( secondFront && ( ! firstFront || older( *secondFront, *firstFront ) ) )
+			return second.tryPop( value );
+		return first.tryPop( value );
+	}
+
+} //end namespace media
@@ -0,0 +1,120 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace media {
+
+	//! Lock-free triple buffer for exactly one producer thread and one consumer thread. The producer owns the write slot,
+	//! the consumer the read slot, and publishing or fetching swaps the owned slot with the shared ready slot in a single
+	//! atomic exchange, so neither side ever waits for the other. The consumer always gets the newest published value:
+	//! values published twice before a fetch count as skipped, fetches with nothing new as repeated.
+	template<typename T>
+	class TripleBuffer {
+	public:
+		TripleBuffer() : mState{ 1 }, mWrite{ 0 }, mRead{ 2 }, mPublished{ 0 }, mSkipped{ 0 }, mRepeated{ 0 } { }
+
+		//! Producer side.
+		T&			getWriteSlot() { return mSlots[mWrite]; }
+		//! Producer side. Makes the write slot the newest value and takes the previous ready slot as the new write slot.
+		//! Returns false if the previous value was never fetched.
+		bool publish()
+		{
+			const uint8_t previous = mState.exchange( uint8_t( mWrite | kFresh ), std::memory_order_acq_rel );
+			mWrite = previous & kIndexMask;
+			mPublished.fetch_add( 1, std::memory_order_relaxed );
+			if( previous & kFresh ) {
+				mSkipped.fetch_add( 1, std::memory_order_relaxed );
+				return false;
+			}
+			return true;
+		}
+
+		//! Consumer side.
+		T&			getReadSlot() { return mSlots[mRead]; }
+		//! Consumer side. Swaps the newest published value into the read slot, returns false when nothing was published
+		//! since the last fetch, leaving the read slot as is.
+		bool fetch()
+		{
+			if( ( mState.load( std::memory_order_relaxed ) & kFresh ) == 0 ) {
+				mRepeated.fetch_add( 1, std::memory_order_relaxed );
+				return false;
+			}
+			mRead = mState.exchange( mRead, std::memory_order_acq_rel ) & kIndexMask;
+			return true;
+		}
+
+		//! Fills every slot and clears the counters, only valid while neither side is running.
+		void reset( T write, T ready, T read )
+		{
+			mWrite = 0;
+			mRead = 2;
+			mSlots[0] = std::move( write );
+			mSlots[1] = std::move( ready );
+			mSlots[2] = std::move( read );
+			mPublished = 0;
+			mSkipped = 0;
+			mRepeated = 0;
+			mState.store( 1, std::memory_order_release );
+		}
+
+		uint64_t	getPublishCount() const { return mPublished.load( std::memory_order_relaxed ); }
+		uint64_t	getSkippedCount() const { return mSkipped.load( std::memory_order_relaxed ); }
+		uint64_t	getRepeatedCount() const { return mRepeated.load( std::memory_order_relaxed ); }
+	private:
+		TripleBuffer( const TripleBuffer& ) = delete;
+		TripleBuffer& operator=( const TripleBuffer& ) = delete;
+
+		// The shared state holds the ready slot index and whether it was published since the last fetch.
+		static const uint8_t kIndexMask = 3;
+		static const uint8_t kFresh = 4;
+
+		T							mSlots[3];
+
+		char						mPad0[64];
+		std::atomic<uint8_t>		mState;
+		char						mPad1[64 - sizeof( std::atomic<uint8_t> )];
+		uint8_t						mWrite;
+		char						mPad2[64 - sizeof( uint8_t )];
+		uint8_t						mRead;
+		char						mPad3[64 - sizeof( uint8_t )];
+		std::atomic<uint64_t>		mPublished, mSkipped, mRepeated;
+	};
+
+} //end namespace media
@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "CpuFeatures.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace media {
+
+	//! YCbCr matrix of a video signal. SD modes are BT.601, HD modes BT.709 and UHD wide gamut BT.2020.
+	enum class YCbCrMatrix { BT601, BT709, BT2020 };
+
+	//! Matrix the DeckLink SDK assumes for a given frame height.
+	inline YCbCrMatrix getDefaultYCbCrMatrix( long height ) { return height < 720 ? YCbCrMatrix::BT601 : YCbCrMatrix::BT709; }
+
+	//! Red and blue luma weights of a matrix, green is 1 - kr - kb.
+	inline void getYCbCrWeights( YCbCrMatrix matrix, double * kr, double * kb )
+	{
+		switch( matrix ) {
+		case YCbCrMatrix::BT601:	*kr = 0.299; *kb = 0.114; break;
+		case YCbCrMatrix::BT2020:	*kr = 0.2627; *kb = 0.0593; break;
+		default:					*kr = 0.2126; *kb = 0.0722; break;
+		}
+	}
+
+	//! IEEE 754 binary16 conversion with round to nearest even, matching the F16C and NEON conversions bit for bit.
+	uint16_t floatToHalf( float value );
+
+	//! Converts video range 8-bit 4:2:2 UYVY ('2vuy', bmdFormat8BitYUV) to 8-bit BGRA with opaque alpha.
+	//! Every kernel produces bit-exact output against the scalar reference, so the level only changes speed.
+	void convertUYVYToBGRA( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix = YCbCrMatrix::BT709 );
+	void convertUYVYToBGRA( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level );
+
+	//! Row bytes of a v210 (bmdFormat10BitYUV) frame: 48 pixel groups packed in 128 bytes.
+	inline size_t getV210RowBytes( long width ) { return size_t( ( width + 47 ) / 48 ) * 128; }
+
+	//! Unpacks v210 to 16-bit planar 4:2:2. Samples keep their 10-bit video range value, the chroma planes are ( width + 1 ) / 2 wide.
+	void convertV210ToYUV422P16( const uint8_t * src, size_t srcRowBytes, uint16_t * y, size_t yRowBytes, uint16_t * cb, size_t cbRowBytes, uint16_t * cr, size_t crRowBytes, long width, long height );
+	void convertV210ToYUV422P16( const uint8_t * src, size_t srcRowBytes, uint16_t * y, size_t yRowBytes, uint16_t * cb, size_t cbRowBytes, uint16_t * cr, size_t crRowBytes, long width, long height, SimdLevel level );
+	//! Converts v210 to full range 16-bit RGBA with opaque alpha.
+	void convertV210ToRGBA16( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix = YCbCrMatrix::BT709 );
+	void convertV210ToRGBA16( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level );
+	//! Converts v210 to 8-bit BGRA with opaque alpha, the levels of convertV210ToRGBA16() rounded to 8 bits.
+	void convertV210ToBGRA( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix = YCbCrMatrix::BT709 );
+	void convertV210ToBGRA( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level );
+	//! Converts v210 to half float RGBA, 1.0 being reference white. Super-whites and sub-blacks are kept out of [0, 1].
+	void convertV210ToRGBAHalf( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix = YCbCrMatrix::BT709 );
+	void convertV210ToRGBAHalf( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level );
+
+	//! Packed RGB 4:4:4 capture formats.
+	enum class PackedRGBFormat {
+		//! 'r210', bmdFormat10BitRGB: big endian 2:10:10:10 words, padding in the top bits. SMPTE video levels (64-940).
+		R210,
+		//! 'R10b', bmdFormat10BitRGBX: big endian 10:10:10:2 words, padding in the bottom bits. SMPTE video levels (64-940).
+		R10B,
+		//! 'R10l', bmdFormat10BitRGBXLE: little endian R10b.
+		R10L,
+		//! 'R12B', bmdFormat12BitRGB: 12-bit full range components in a continuous bit stream, 8 pixels per 36 bytes, big endian words.
+		R12B,
+		//! 'R12L', bmdFormat12BitRGBLE: little endian R12B.
+		R12L
+	};
+
+	//! Row bytes the DeckLink SDK uses for a packed RGB format: 64 pixel / 256 byte groups for 10-bit, 8 pixel / 36 byte groups for 12-bit.
+	inline size_t getPackedRGBRowBytes( PackedRGBFormat format, long width )
+	{
+		if( format == PackedRGBFormat::R12B || format == PackedRGBFormat::R12L )
+			return size_t( ( width + 7 ) / 8 ) * 36;
+		return size_t( ( width + 63 ) / 64 ) * 256;
+	}
+
+	//! Unpacks packed RGB to full range 16-bit RGBA with opaque alpha. 10-bit video levels are expanded so 64 maps to 0 and 940
+	//! to 65535, clamping sub-blacks and super-whites; 12-bit full range is bit replicated.
+	void convertPackedRGBToRGBA16( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height );
+	void convertPackedRGBToRGBA16( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, SimdLevel level );
+	//! Unpacks packed RGB to 32-bit float RGBA, 1.0 being reference white. 10-bit sub-blacks and super-whites are kept out of [0, 1].
+	void convertPackedRGBToRGBAFloat( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, float * dst, size_t dstRowBytes, long width, long height );
+	void convertPackedRGBToRGBAFloat( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, float * dst, size_t dstRowBytes, long width, long height, SimdLevel level );
+	//! Converts packed RGB to 8-bit BGRA with opaque alpha, the levels of convertPackedRGBToRGBA16() rounded to 8 bits.
+	void convertPackedRGBToBGRA( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height );
+	void convertPackedRGBToBGRA( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, SimdLevel level );
+	//! Rounds 16-bit RGBA to 8-bit BGRA, value * 255 / 65535 to nearest.
+	void convertRGBA16ToBGRA( const uint16_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height );
+	void convertRGBA16ToBGRA( const uint16_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, SimdLevel level );
+	//! Packs 16-bit RGBA back to a packed RGB format, alpha is dropped and padding bits are zero. Inverse of
+	//! convertPackedRGBToRGBA16() for every legal code value, so unpacking and repacking a frame gives the same bytes.
+	void convertRGBA16ToPackedRGB( PackedRGBFormat format, const uint16_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height );
+
+	//! Quantization range of encoded YCbCr. LEGAL is the SDI video range (16-235 / 64-940 luma), FULL uses every code
+	//! except the values SDI reserves for timing references (0 and 255 / 0-3 and 1020-1023).
+	enum class YCbCrRange { LEGAL, FULL };
+
+	//! Horizontal filter used to subsample chroma to 4:2:2.
+	enum class ChromaFilter {
+		//! [1 2 1] / 4 centered on the even pixel, matching the co-sited chroma of BT.601, BT.709 and BT.2020 4:2:2.
+		COSITED,
+		//! Mean of each pixel pair, chroma sited between the two luma samples.
+		AVERAGE,
+		//! Chroma of the even pixel only. Fastest, aliases on fine detail.
+		DROP
+	};
+
+	//! Encodes 8-bit BGRA (alpha ignored) to 8-bit 4:2:2 UYVY ('2vuy', bmdFormat8BitYUV).
+	void convertBGRAToUYVY( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix = YCbCrMatrix::BT709, YCbCrRange range = YCbCrRange::LEGAL, ChromaFilter filter = ChromaFilter::COSITED );
+	void convertBGRAToUYVY( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, YCbCrRange range, ChromaFilter filter, SimdLevel level );
+	//! Encodes 8-bit BGRA (alpha ignored) to 10-bit 4:2:2 v210 (bmdFormat10BitYUV). Samples past \a width in the last
+	//! 6 pixel block repeat the last pixel, the row padding past that block is left untouched.
+	void convertBGRAToV210( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix = YCbCrMatrix::BT709, YCbCrRange range = YCbCrRange::LEGAL, ChromaFilter filter = ChromaFilter::COSITED );
+	void convertBGRAToV210( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, YCbCrRange range, ChromaFilter filter, SimdLevel level );
+
+} //end namespace media
@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include "RefPtr.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace media {
+
+	typedef std::shared_ptr<class VideoFramePool> VideoFramePoolRef;
+
+	//! 64-byte aligned frame storage. Buffers acquired from a VideoFramePool go back to it when the last reference is released.
+	class PooledFrameBuffer {
+	public:
+		//! Allocates a standalone buffer, freed on last release.
+		static RefPtr<PooledFrameBuffer>	create( size_t size );
+
+		uint8_t *		data() const { return mData; }
+		size_t			size() const { return mSize; }
+
+		unsigned long	AddRef();
+		unsigned long	Release();
+	private:
+		explicit PooledFrameBuffer( size_t size );
+		~PooledFrameBuffer();
+
+		uint8_t *					mData;
+		size_t						mSize;
+		std::atomic<unsigned long>	mRefCount;
+		VideoFramePoolRef			mPool;
+
+		friend class VideoFramePool;
+	};
+
+	typedef RefPtr<PooledFrameBuffer> PooledFrameBufferRef;
+
+	//! Bounded set of pre-allocated, pre-faulted buffers of a single size. An empty pool falls back to a heap
+	//! allocation (counted as a miss) and buffers returned to a full pool are freed, so it never grows past its capacity.
+	class VideoFramePool : public std::enable_shared_from_this<VideoFramePool> {
+	public:
+		static VideoFramePoolRef	create( size_t bufferSize, size_t capacity );
+		~VideoFramePool();
+
+		PooledFrameBufferRef		acquire();
+		//! Re-allocates the free buffers for a new size, outstanding buffers of the previous size are freed when released.
+		void						resize( size_t bufferSize );
+
+		size_t						getBufferSize() const;
+		size_t						getCapacity() const { return mCapacity; }
+		size_t						getFreeCount() const;
+		uint64_t					getHitCount() const { return mHits; }
+		uint64_t					getMissCount() const { return mMisses; }
+	private:
+		VideoFramePool( size_t bufferSize, size_t capacity );
+		VideoFramePool( const VideoFramePool& ) = delete;
+		VideoFramePool& operator=( const VideoFramePool& ) = delete;
+
+		void						recycle( PooledFrameBuffer * buffer );
+
+		mutable std::mutex					mMutex;
+		std::vector<PooledFrameBuffer*>		mFreeBuffers;
+		size_t								mBufferSize;
+		const size_t						mCapacity;
+		std::atomic<uint64_t>				mHits, mMisses;
+
+		friend class PooledFrameBuffer;
+	};
+
+} //end namespace media
@@ -0,0 +1,111 @@
+/*
+* Copyright (c) 2016, The Mill
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in
+* the documentation and/or other materials provided with the
+* distribution.
+*
+* Neither the name of the Eric Renaud-Houde nor the names of its
+* contributors may be used to endorse or promote products
+* derived from this software without specific prior written
+* permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+* FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+* COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+* INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace media {
+
+	typedef std::shared_ptr<class WorkerPool> WorkerPoolRef;
+
+	//! Persistent threads for data parallel work such as per-stripe pixel conversion. No thread is created per job,
+	//! and the calling thread takes part in the work, so a pool of N workers runs jobs on N + 1 cores.
+	class WorkerPool {
+	public:
+		//! \a cpuAffinity optionally pins worker i to core cpuAffinity[i % size], the calling thread is left alone.
+		static WorkerPoolRef	create( size_t numWorkers, const std::vector<int>& cpuAffinity = std::vector<int>() );
+		~WorkerPool();
+
+		size_t					getNumWorkers() const { return mThreads.size(); }
+		//! Worker threads plus the calling thread.
+		size_t					getConcurrency() const { return mThreads.size() + 1; }
+
+		//! Calls fn( i ) for every i in [0, count) across the pool and blocks until all calls returned. Not reentrant,
+		//! one job runs at a time.
+		template<typename F>
+		void					parallelFor( size_t count, F&& fn )
+		{
+			typedef typename std::remove_reference<F>::type Fn;
+			run( count, []( void * context, size_t index ) { ( *static_cast<Fn*>( context ) )( index ); }, (void*)&fn );
+		}
+
+		//! Splits [0, total) into \a numRanges contiguous ranges and calls fn( begin, end ) for each non-empty one.
+		template<typename F>
+		void					parallelForRanges( size_t total, size_t numRanges, F&& fn )
+		{
+			if( numRanges == 0 )
+				numRanges = 1;
+			parallelFor( numRanges, [&]( size_t index ) {
+				const size_t begin = total * index / numRanges;
+				const size_t end = total * ( index + 1 ) / numRanges;
+				if( begin < end )
+					fn( begin, end );
+			} );
+		}
+	private:
+		typedef void( *Task )( void * context, size_t index );
+
+		WorkerPool( size_t numWorkers, const std::vector<int>& cpuAffinity );
+		WorkerPool( const WorkerPool& ) = delete;
+		WorkerPool& operator=( const WorkerPool& ) = delete;
+
+		void					run( size_t count, Task task, void * context );
+		void					workerLoop();
+		void					execute();
+
+		std::vector<std::thread>	mThreads;
+
+		std::mutex					mRunMutex;
+		std::mutex					mMutex;
+		std::condition_variable		mWorkCondition, mDoneCondition;
+		uint64_t					mGeneration;
+		size_t						mBusyWorkers;
+		bool						mQuit;
+
+		Task						mTask;
+		void *						mContext;
+		size_t						mCount;
+		std::atomic<size_t>			mNextIndex;
+	};
+
+} //end namespace media
@@ -60,7 +60,8 @@ void BasicCaptureApp::frameArrived( media::FrameEvent& frameEvent )
 {
 	/* Note that both device and frame callbacks are triggered from DeckLink worker threads, hence the mutex here. */
 	std::lock_guard<std::mutex> lock{ mFrameLock };
-	frameEvent.surfaceData.getSurface( mSurface );
+	// Aliases the pooled frame buffer instead of copying it, the previous frame goes back to the pool here.
+	mSurface = frameEvent.frame.createSurface();
 }
 
 void BasicCaptureApp::update()
@@ -0,0 +1,315 @@
+#include "AudioConversion.h"
+
+#include <cstring>
+
+#if defined( MEDIA_ARCH_X86 )
+	#include <emmintrin.h>
+	#include <immintrin.h>
+#elif defined( MEDIA_ARCH_NEON )
+	#include <arm_neon.h>
+#endif
+
+// Full scale is a power of two for both sample types, so int to float conversion followed by the scaling is exact up to
+// the rounding of the conversion itself, which every instruction set does to nearest even like the scalar cast.
+
+namespace media {
+
+namespace {
+
+	// Widest layout the vector kernels route, wider ones take the scalar path.
+	const size_t kMaxBlockChannels = 256;
+
+	//! \a channels holds the source channel of each plane, all valid.
+	template<typename T>
+	using AudioKernel = void( *)( const T * src, size_t srcChannels, size_t frameCount, float * const * dst, const int * channels, size_t planes );
+
+	//! Converts frames [frameBegin, frameEnd).
+	template<typename T>
+	void convertFramesScalar( const T * src, size_t srcChannels, size_t frameBegin, size_t frameEnd, float * const * dst, const int * channels, size_t planes )
+	{
+		const float scale = getAudioSampleScale( src );
+		for( size_t i = 0; i < planes; ++i ) {
+			const T * samples = src + channels[i];
+			float * plane = dst[i];
+			for( size_t frame = frameBegin; frame < frameEnd; ++frame )
+				plane[frame] = float( samples[frame * srcChannels] ) * scale;
+		}
+	}
+
+	template<typename T>
+	void convertScalar( const T * src, size_t srcChannels, size_t frameCount, float * const * dst, const int * channels, size_t planes )
+	{
+		convertFramesScalar( src, srcChannels, 0, frameCount, dst, channels, planes );
+	}
+
+	//! Planes grouped by the block of source channels they read, so that each transposed block is only stored where needed.
+	struct BlockRoutes {
+		//! Planes of block b are order[begin[b]] to order[begin[b + 1] - 1].
+		uint8_t		order[kMaxAudioChannels];
+		size_t		begin[kMaxBlockChannels / 4 + 1];
+	};
+
+	inline void routeBlocks( const int * channels, size_t planes, size_t blockSize, size_t blocks, BlockRoutes * routes )
+	{
+		std::memset( routes->begin, 0, ( blocks + 1 ) * sizeof( size_t ) );
+		for( size_t i = 0; i < planes; ++i )
+			++routes->begin[channels[i] / blockSize + 1];
+		for( size_t b = 0; b < blocks; ++b )
+			routes->begin[b + 1] += routes->begin[b];
+
+		size_t next[kMaxBlockChannels / 4];
+		std::memcpy( next, routes->begin, blocks * sizeof( size_t ) );
+		for( size_t i = 0; i < planes; ++i )
+			routes->order[next[channels[i] / blockSize]++] = uint8_t( i );
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	inline __m128 loadSse2( const int32_t * src, __m128 scale )
+	{
+		return _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( (const __m128i*)src ) ), scale );
+	}
+
+	inline __m128 loadSse2( const int16_t * src, __m128 scale )
+	{
+		// Sign extends by moving each sample to the top half of its 32-bit lane.
+		const __m128i samples = _mm_loadl_epi64( (const __m128i*)src );
+		return _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( samples, samples ), 16 ) ), scale );
+	}
+
+	// Stereo splits with one shuffle per 4 frames, multiples of 4 channels transpose 4 frames x 4 channels blocks.
+	template<typename T>
+	void convertSse2( const T * src, size_t srcChannels, size_t frameCount, float * const * dst, const int * channels, size_t planes )
+	{
+		const __m128 scale = _mm_set1_ps( getAudioSampleScale( src ) );
+		size_t frame = 0;
+		if( srcChannels == 2 ) {
+			for( ; frame + 4 <= frameCount; frame += 4 ) {
+				const __m128 a = loadSse2( src + frame * 2, scale );
+				const __m128 b = loadSse2( src + frame * 2 + 4, scale );
+				const __m128 left = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+				const __m128 right = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+				for( size_t i = 0; i < planes; ++i )
+					_mm_storeu_ps( dst[i] + frame, channels[i] == 0 ? left : right );
+			}
+		}
+		else if( srcChannels % 4 == 0 ) {
+			const size_t blocks = srcChannels / 4;
+			BlockRoutes routes;
+			routeBlocks( channels, planes, 4, blocks, &routes );
+			for( ; frame + 4 <= frameCount; frame += 4 ) {
+				const T * frames = src + frame * srcChannels;
+				for( size_t block = 0; block < blocks; ++block ) {
+					if( routes.begin[block] == routes.begin[block + 1] )
+						continue;
+					__m128 rows[4];
+					for( size_t f = 0; f < 4; ++f )
+						rows[f] = loadSse2( frames + f * srcChannels + block * 4, scale );
+					_MM_TRANSPOSE4_PS( rows[0], rows[1], rows[2], rows[3] );
+					for( size_t k = routes.begin[block]; k < routes.begin[block + 1]; ++k ) {
+						const size_t i = routes.order[k];
+						_mm_storeu_ps( dst[i] + frame, rows[channels[i] & 3] );
+					}
+				}
+			}
+		}
+		convertFramesScalar( src, srcChannels, frame, frameCount, dst, channels, planes );
+	}
+
+	MEDIA_TARGET_AVX2 inline __m256 loadAvx2( const int32_t * src, __m256 scale )
+	{
+		return _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_loadu_si256( (const __m256i*)src ) ), scale );
+	}
+
+	MEDIA_TARGET_AVX2 inline __m256 loadAvx2( const int16_t * src, __m256 scale )
+	{
+		return _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i*)src ) ) ), scale );
+	}
+
+	//! 8 frames x 8 channels to 8 channels x 8 frames.
+	MEDIA_TARGET_AVX2 inline void transpose8Avx2( __m256 * rows )
+	{
+		const __m256 t0 = _mm256_unpacklo_ps( rows[0], rows[1] );
+		const __m256 t1 = _mm256_unpackhi_ps( rows[0], rows[1] );
+		const __m256 t2 = _mm256_unpacklo_ps( rows[2], rows[3] );
+		const __m256 t3 = _mm256_unpackhi_ps( rows[2], rows[3] );
+		const __m256 t4 = _mm256_unpacklo_ps( rows[4], rows[5] );
+		const __m256 t5 = _mm256_unpackhi_ps( rows[4], rows[5] );
+		const __m256 t6 = _mm256_unpacklo_ps( rows[6], rows[7] );
+		const __m256 t7 = _mm256_unpackhi_ps( rows[6], rows[7] );
+		const __m256 u0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+		const __m256 u1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+		const __m256 u2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+		const __m256 u3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+		const __m256 u4 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+		const __m256 u5 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+		const __m256 u6 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+		const __m256 u7 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+		rows[0] = _mm256_permute2f128_ps( u0, u4, 0x20 );
+		rows[1] = _mm256_permute2f128_ps( u1, u5, 0x20 );
+		rows[2] = _mm256_permute2f128_ps( u2, u6, 0x20 );
+		rows[3] = _mm256_permute2f128_ps( u3, u7, 0x20 );
+		rows[4] = _mm256_permute2f128_ps( u0, u4, 0x31 );
+		rows[5] = _mm256_permute2f128_ps( u1, u5, 0x31 );
+		rows[6] = _mm256_permute2f128_ps( u2, u6, 0x31 );
+		rows[7] = _mm256_permute2f128_ps( u3, u7, 0x31 );
+	}
+
+	// Same scheme as SSE2 on 8 frames: stereo shuffles and puts the 128-bit lanes back in order, multiples of 8
+	// channels transpose 8 x 8 blocks. Other multiples of 4 use the SSE2 kernel.
+	template<typename T>
+	MEDIA_TARGET_AVX2 void convertAvx2( const T * src, size_t srcChannels, size_t frameCount, float * const * dst, const int * channels, size_t planes )
+	{
+		const __m256 scale = _mm256_set1_ps( getAudioSampleScale( src ) );
+		size_t frame = 0;
+		if( srcChannels == 2 ) {
+			for( ; frame + 8 <= frameCount; frame += 8 ) {
+				const __m256 a = loadAvx2( src + frame * 2, scale );
+				const __m256 b = loadAvx2( src + frame * 2 + 8, scale );
+				// [L0 L1 L4 L5 | L2 L3 L6 L7] to [L0 L1 L2 L3 | L4 L5 L6 L7].
+				const __m256 left = _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( _mm256_shuffle_ps( a, b, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+				const __m256 right = _mm256_castpd_ps( _mm256_permute4x64_pd( _mm256_castps_pd( _mm256_shuffle_ps( a, b, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+				for( size_t i = 0; i < planes; ++i )
+					_mm256_storeu_ps( dst[i] + frame, channels[i] == 0 ? left : right );
+			}
+		}
+		else {
+			const size_t blocks = srcChannels / 8;
+			BlockRoutes routes;
+			routeBlocks( channels, planes, 8, blocks, &routes );
+			for( ; frame + 8 <= frameCount; frame += 8 ) {
+				const T * frames = src + frame * srcChannels;
+				for( size_t block = 0; block < blocks; ++block ) {
+					if( routes.begin[block] == routes.begin[block + 1] )
+						continue;
+					__m256 rows[8];
+					for( size_t f = 0; f < 8; ++f )
+						rows[f] = loadAvx2( frames + f * srcChannels + block * 8, scale );
+					transpose8Avx2( rows );
+					for( size_t k = routes.begin[block]; k < routes.begin[block + 1]; ++k ) {
+						const size_t i = routes.order[k];
+						_mm256_storeu_ps( dst[i] + frame, rows[channels[i] & 7] );
+					}
+				}
+			}
+		}
+		convertFramesScalar( src, srcChannels, frame, frameCount, dst, channels, planes );
+	}
+#endif
+
+#if defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+	inline float32x4_t loadNeon( const int32_t * src, float scale )
+	{
+		return vmulq_n_f32( vcvtq_f32_s32( vld1q_s32( src ) ), scale );
+	}
+
+	inline float32x4_t loadNeon( const int16_t * src, float scale )
+	{
+		return vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vld1_s16( src ) ) ), scale );
+	}
+
+	// Stereo splits with one unzip per 4 frames, multiples of 4 channels transpose 4 x 4 blocks.
+	template<typename T>
+	void convertNeon( const T * src, size_t srcChannels, size_t frameCount, float * const * dst, const int * channels, size_t planes )
+	{
+		const float scale = getAudioSampleScale( src );
+		size_t frame = 0;
+		if( srcChannels == 2 ) {
+			for( ; frame + 4 <= frameCount; frame += 4 ) {
+				const float32x4x2_t split = vuzpq_f32( loadNeon( src + frame * 2, scale ), loadNeon( src + frame * 2 + 4, scale ) );
+				for( size_t i = 0; i < planes; ++i )
+					vst1q_f32( dst[i] + frame, split.val[channels[i]] );
+			}
+		}
+		else if( srcChannels % 4 == 0 ) {
+			const size_t blocks = srcChannels / 4;
+			BlockRoutes routes;
+			routeBlocks( channels, planes, 4, blocks, &routes );
+			for( ; frame + 4 <= frameCount; frame += 4 ) {
+				const T * frames = src + frame * srcChannels;
+				for( size_t block = 0; block < blocks; ++block ) {
+					if( routes.begin[block] == routes.begin[block + 1] )
+						continue;
+					const float32x4x2_t p0 = vtrnq_f32( loadNeon( frames + block * 4, scale ), loadNeon( frames + srcChannels + block * 4, scale ) );
+					const float32x4x2_t p1 = vtrnq_f32( loadNeon( frames + 2 * srcChannels + block * 4, scale ), loadNeon( frames + 3 * srcChannels + block * 4, scale ) );
+					float32x4_t rows[4];
+					rows[0] = vcombine_f32( vget_low_f32( p0.val[0] ), vget_low_f32( p1.val[0] ) );
+					rows[1] = vcombine_f32( vget_low_f32( p0.val[1] ), vget_low_f32( p1.val[1] ) );
+					rows[2] = vcombine_f32( vget_high_f32( p0.val[0] ), vget_high_f32( p1.val[0] ) );
+					rows[3] = vcombine_f32( vget_high_f32( p0.val[1] ), vget_high_f32( p1.val[1] ) );
+					for( size_t k = routes.begin[block]; k < routes.begin[block + 1]; ++k ) {
+						const size_t i = routes.order[k];
+						vst1q_f32( dst[i] + frame, rows[channels[i] & 3] );
+					}
+				}
+			}
+		}
+		convertFramesScalar( src, srcChannels, frame, frameCount, dst, channels, planes );
+	}
+#endif
+
+	template<typename T>
+	AudioKernel<T> getKernel( size_t srcChannels, SimdLevel level )
+	{
+		if( srcChannels > kMaxBlockChannels )
+			return convertScalar<T>;
+#if defined( MEDIA_ARCH_X86 )
+		if( level == SimdLevel::AVX2 && ( srcChannels == 2 || srcChannels % 8 == 0 ) )
+			return convertAvx2<T>;
+		if( ( level == SimdLevel::AVX2 || level == SimdLevel::SSE2 ) && ( srcChannels == 2 || srcChannels % 4 == 0 ) )
+			return convertSse2<T>;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		if( level == SimdLevel::NEON && ( srcChannels == 2 || srcChannels % 4 == 0 ) )
+			return convertNeon<T>;
+#endif
+		return convertScalar<T>;
+	}
+
+	template<typename T>
+	void convertAudio( const T * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing, SimdLevel level )
+	{
+		if( ! isSimdLevelSupported( level ) )
+			level = SimdLevel::SCALAR;
+		if( dstChannels > kMaxAudioChannels )
+			dstChannels = kMaxAudioChannels;
+
+		// Silent planes are cleared here, the kernels only see planes with a source channel.
+		float * planes[kMaxAudioChannels];
+		int channels[kMaxAudioChannels];
+		size_t count = 0;
+		for( size_t i = 0; i < dstChannels; ++i ) {
+			const int channel = routing ? routing[i] : int( i );
+			if( channel >= 0 && size_t( channel ) < srcChannels ) {
+				planes[count] = dst[i];
+				channels[count] = channel;
+				++count;
+			}
+			else
+				std::memset( dst[i], 0, frameCount * sizeof( float ) );
+		}
+
+		if( count > 0 )
+			getKernel<T>( srcChannels, level )( src, srcChannels, frameCount, planes, channels, count );
+	}
+}
+
+void convertAudioToFloat( const int32_t * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing )
+{
+	convertAudio( src, srcChannels, frameCount, dst, dstChannels, routing, getSimdLevel() );
+}
+
+void convertAudioToFloat( const int32_t * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing, SimdLevel level )
+{
+	convertAudio( src, srcChannels, frameCount, dst, dstChannels, routing, level );
+}
+
+void convertAudioToFloat( const int16_t * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing )
+{
+	convertAudio( src, srcChannels, frameCount, dst, dstChannels, routing, getSimdLevel() );
+}
+
+void convertAudioToFloat( const int16_t * src, size_t srcChannels, size_t frameCount, float * const * dst, size_t dstChannels, const int * routing, SimdLevel level )
+{
+	convertAudio( src, srcChannels, frameCount, dst, dstChannels, routing, level );
+}
+
+} //end namespace media
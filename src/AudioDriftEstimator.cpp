@@ -0,0 +1,163 @@
+#include "AudioDriftEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace media;
+
+AudioDriftEstimator::AudioDriftEstimator( const AudioDriftOptions& options )
+	: mOptions( options )
+{
+	mOptions.window = std::max<size_t>( mOptions.window, 2 );
+	reset();
+}
+
+void AudioDriftEstimator::reset()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	for( Fit * fit : { &mInput, &mOutput } ) {
+		*fit = Fit();
+		fit->samples.reserve( mOptions.window );
+	}
+	mStats = AudioDriftStats();
+}
+
+void AudioDriftEstimator::addInputTimestamp( int64_t position, int64_t timeUs )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	addSample( mInput, position, timeUs );
+	mStats.inputSamples = mInput.samples.size();
+}
+
+void AudioDriftEstimator::addOutputTimestamp( int64_t position, int64_t timeUs )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	addSample( mOutput, position, timeUs );
+	mStats.outputSamples = mOutput.samples.size();
+}
+
+void AudioDriftEstimator::addSample( Fit& fit, int64_t position, int64_t timeUs )
+{
+	// The stream restarted, whatever was fitted before no longer applies.
+	if( ! fit.samples.empty() && ( position < fit.last.position || timeUs < fit.last.timeUs ) ) {
+		fit.samples.clear();
+		fit.next = 0;
+		fit.valid = false;
+		mStats.driftValid = false;
+	}
+
+	const Sample sample = { position, timeUs };
+	fit.last = sample;
+	// Too close to the previous sample to add to the fit, but still the freshest reading for extrapolation.
+	if( ! fit.samples.empty() && double( timeUs - fit.samples[( fit.next + fit.samples.size() - 1 ) % fit.samples.size()].timeUs ) < mOptions.sampleIntervalMs * 1000.0 )
+		return;
+
+	if( fit.samples.size() < mOptions.window )
+		fit.samples.push_back( sample );
+	else
+		fit.samples[fit.next] = sample;
+	fit.next = ( fit.next + 1 ) % mOptions.window;
+	updateFit( fit );
+
+	if( mInput.valid && mOutput.valid ) {
+		mStats.inputPpm = getPpm( mInput );
+		mStats.outputPpm = getPpm( mOutput );
+		mStats.driftPpm = ( mInput.slope / mOutput.slope - 1.0 ) * 1e6;
+		mStats.driftValid = true;
+	}
+}
+
+void AudioDriftEstimator::updateFit( Fit& fit )
+{
+	// Relative to the oldest sample so that the sums keep their precision over long runs.
+	fit.origin = fit.samples[fit.next < fit.samples.size() ? fit.next : 0];
+	double meanTime = 0.0, meanPosition = 0.0;
+	for( const auto& sample : fit.samples ) {
+		meanTime += double( sample.timeUs - fit.origin.timeUs );
+		meanPosition += double( sample.position - fit.origin.position );
+	}
+	meanTime /= double( fit.samples.size() );
+	meanPosition /= double( fit.samples.size() );
+
+	double covariance = 0.0, variance = 0.0;
+	for( const auto& sample : fit.samples ) {
+		const double time = double( sample.timeUs - fit.origin.timeUs ) - meanTime;
+		covariance += time * ( double( sample.position - fit.origin.position ) - meanPosition );
+		variance += time * time;
+	}
+
+	fit.valid = fit.samples.size() >= 2 && variance > 0.0 && covariance > 0.0;
+	if( fit.valid ) {
+		fit.slope = covariance / variance;
+		fit.offset = meanPosition - fit.slope * meanTime;
+	}
+}
+
+double AudioDriftEstimator::getPosition( const Fit& fit, double timeUs ) const
+{
+	if( fit.valid )
+		return double( fit.origin.position ) + fit.offset + fit.slope * ( timeUs - double( fit.origin.timeUs ) );
+	return double( fit.last.position ) + mOptions.sampleRate * 1e-6 * ( timeUs - double( fit.last.timeUs ) );
+}
+
+double AudioDriftEstimator::getPpm( const Fit& fit ) const
+{
+	return ( fit.slope * 1e6 / mOptions.sampleRate - 1.0 ) * 1e6;
+}
+
+bool AudioDriftEstimator::getInputPosition( int64_t timeUs, double * position ) const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( mInput.samples.empty() )
+		return false;
+
+	*position = getPosition( mInput, double( timeUs ) );
+	return true;
+}
+
+bool AudioDriftEstimator::getOutputTime( int64_t position, double * timeUs ) const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( mOutput.samples.empty() )
+		return false;
+
+	const double slope = mOutput.valid ? mOutput.slope : mOptions.sampleRate * 1e-6;
+	const Sample& origin = mOutput.valid ? mOutput.origin : mOutput.last;
+	const double offset = mOutput.valid ? mOutput.offset : 0.0;
+	*timeUs = double( origin.timeUs ) + ( double( position - origin.position ) - offset ) / slope;
+	return true;
+}
+
+bool AudioDriftEstimator::update( double readPosition, int64_t outputPosition, double latencyUs, AudioDriftControl * control )
+{
+	double outputTimeUs, targetPosition;
+	if( ! getOutputTime( outputPosition, &outputTimeUs ) || ! getInputPosition( int64_t( outputTimeUs - latencyUs ), &targetPosition ) )
+		return false;
+
+	std::lock_guard<std::mutex> lock( mMutex );
+	// Input frames per output frame as measured, nominal until both rates are known.
+	const double ratio = mInput.valid && mOutput.valid ? mInput.slope / mOutput.slope : 1.0;
+	const double offset = targetPosition - readPosition;
+	control->targetPosition = targetPosition;
+	control->resync = std::fabs( offset ) > mOptions.resyncThresholdMs * mOptions.sampleRate / 1000.0;
+
+	double correction = 0.0;
+	if( control->resync )
+		++mStats.resyncs;
+	else {
+		const double limit = mOptions.maxCorrectionPpm * 1e-6;
+		correction = std::min( std::max( offset / ( mOptions.correctionSeconds * mOptions.sampleRate ), -limit ), limit );
+	}
+	control->ratio = ratio * ( 1.0 + correction );
+
+	mStats.offsetFrames = offset;
+	mStats.correctionPpm = correction * 1e6;
+	mStats.ratio = control->ratio;
+	return true;
+}
+
+AudioDriftStats AudioDriftEstimator::getStats() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mStats;
+}
@@ -0,0 +1,480 @@
+#include "AudioMeter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined( MEDIA_ARCH_X86 )
+	#include <emmintrin.h>
+	#include <immintrin.h>
+#elif defined( MEDIA_ARCH_NEON )
+	#include <arm_neon.h>
+#endif
+
+using namespace media;
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+	// BS.1770 blocks: 100 ms steps, momentary over 4 of them, short-term over 30.
+	const double kBlockSeconds = 0.1;
+	const size_t kMomentaryBlocks = 4;
+	const size_t kHistoryBlocks = 30;
+	// Kernels return float partial sums over at most this many frames, accumulated in double by the caller.
+	const size_t kChunkFrames = 64;
+	// Filter state below this is flushed to zero between chunks, decaying filters would otherwise crawl through denormals.
+	const float kDenormalThreshold = 1e-20f;
+	const double kLoudnessOffset = -0.691;
+	const double kAbsoluteGateLufs = -70.0;
+	const double kRelativeGateLu = -10.0;
+	// Integrated loudness histograms, 0.1 LU bins from the absolute gate up to +10 LUFS.
+	const double kHistogramBinLu = 0.1;
+	const size_t kHistogramBins = 800;
+
+	const size_t kStateRows = 6;
+
+	// Every kernel evaluates the filters and the sums in the same order without fused multiply-adds, which is what
+	// keeps them bit-exact against the scalar reference:
+	//   y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2 for the shelf, then the same for the high-pass on y.
+	template<typename T>
+	using MeterKernel = void( *)( const T * src, size_t channels, size_t frameCount, const float * weighting, float * state, float * peak, float * squares, float * weighted );
+
+	template<typename T>
+	void meterChannelsScalar( const T * src, size_t channels, size_t channelBegin, size_t frameCount, const float * k, float * state, float * peak, float * squares, float * weighted )
+	{
+		const float scale = getAudioSampleScale( src );
+		for( size_t c = channelBegin; c < channels; ++c ) {
+			float x1 = state[c], x2 = state[channels + c];
+			float y1 = state[2 * channels + c], y2 = state[3 * channels + c];
+			float z1 = state[4 * channels + c], z2 = state[5 * channels + c];
+			float p = 0.0f, s = 0.0f, w = 0.0f;
+			for( size_t frame = 0; frame < frameCount; ++frame ) {
+				const float x = float( src[frame * channels + c] ) * scale;
+				p = std::max( p, std::fabs( x ) );
+				s = s + x * x;
+				const float y = k[0] * x + k[1] * x1 + k[2] * x2 - k[3] * y1 - k[4] * y2;
+				const float z = k[5] * y + k[6] * y1 + k[7] * y2 - k[8] * z1 - k[9] * z2;
+				w = w + z * z;
+				x2 = x1; x1 = x;
+				y2 = y1; y1 = y;
+				z2 = z1; z1 = z;
+			}
+			state[c] = x1; state[channels + c] = x2;
+			state[2 * channels + c] = y1; state[3 * channels + c] = y2;
+			state[4 * channels + c] = z1; state[5 * channels + c] = z2;
+			peak[c] = p;
+			squares[c] = s;
+			weighted[c] = w;
+		}
+	}
+
+	template<typename T>
+	void meterScalar( const T * src, size_t channels, size_t frameCount, const float * k, float * state, float * peak, float * squares, float * weighted )
+	{
+		meterChannelsScalar( src, channels, 0, frameCount, k, state, peak, squares, weighted );
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	inline __m128 loadSse2( const int32_t * src, __m128 scale )
+	{
+		return _mm_mul_ps( _mm_cvtepi32_ps( _mm_loadu_si128( (const __m128i*)src ) ), scale );
+	}
+
+	inline __m128 loadSse2( const int16_t * src, __m128 scale )
+	{
+		const __m128i samples = _mm_loadl_epi64( (const __m128i*)src );
+		return _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( samples, samples ), 16 ) ), scale );
+	}
+
+	// One register per 4 channels, the filter state stays in registers for the whole chunk.
+	template<typename T>
+	void meterSse2( const T * src, size_t channels, size_t frameCount, const float * k, float * state, float * peak, float * squares, float * weighted )
+	{
+		const __m128 scale = _mm_set1_ps( getAudioSampleScale( src ) );
+		const __m128 sign = _mm_set1_ps( -0.0f );
+		__m128 c[10];
+		for( int i = 0; i < 10; ++i )
+			c[i] = _mm_set1_ps( k[i] );
+
+		for( size_t block = 0; block + 4 <= channels; block += 4 ) {
+			__m128 x1 = _mm_loadu_ps( state + block ), x2 = _mm_loadu_ps( state + channels + block );
+			__m128 y1 = _mm_loadu_ps( state + 2 * channels + block ), y2 = _mm_loadu_ps( state + 3 * channels + block );
+			__m128 z1 = _mm_loadu_ps( state + 4 * channels + block ), z2 = _mm_loadu_ps( state + 5 * channels + block );
+			__m128 p = _mm_setzero_ps(), s = _mm_setzero_ps(), w = _mm_setzero_ps();
+			for( size_t frame = 0; frame < frameCount; ++frame ) {
+				const __m128 x = loadSse2( src + frame * channels + block, scale );
+				p = _mm_max_ps( p, _mm_andnot_ps( sign, x ) );
+				s = _mm_add_ps( s, _mm_mul_ps( x, x ) );
+				const __m128 y = _mm_sub_ps( _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( c[0], x ), _mm_mul_ps( c[1], x1 ) ), _mm_mul_ps( c[2], x2 ) ), _mm_mul_ps( c[3], y1 ) ), _mm_mul_ps( c[4], y2 ) );
+				const __m128 z = _mm_sub_ps( _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( c[5], y ), _mm_mul_ps( c[6], y1 ) ), _mm_mul_ps( c[7], y2 ) ), _mm_mul_ps( c[8], z1 ) ), _mm_mul_ps( c[9], z2 ) );
+				w = _mm_add_ps( w, _mm_mul_ps( z, z ) );
+				x2 = x1; x1 = x;
+				y2 = y1; y1 = y;
+				z2 = z1; z1 = z;
+			}
+			_mm_storeu_ps( state + block, x1 ); _mm_storeu_ps( state + channels + block, x2 );
+			_mm_storeu_ps( state + 2 * channels + block, y1 ); _mm_storeu_ps( state + 3 * channels + block, y2 );
+			_mm_storeu_ps( state + 4 * channels + block, z1 ); _mm_storeu_ps( state + 5 * channels + block, z2 );
+			_mm_storeu_ps( peak + block, p );
+			_mm_storeu_ps( squares + block, s );
+			_mm_storeu_ps( weighted + block, w );
+		}
+		meterChannelsScalar( src, channels, channels & ~size_t( 3 ), frameCount, k, state, peak, squares, weighted );
+	}
+
+	MEDIA_TARGET_AVX2 inline __m256 loadAvx2( const int32_t * src, __m256 scale )
+	{
+		return _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_loadu_si256( (const __m256i*)src ) ), scale );
+	}
+
+	MEDIA_TARGET_AVX2 inline __m256 loadAvx2( const int16_t * src, __m256 scale )
+	{
+		return _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( _mm_loadu_si128( (const __m128i*)src ) ) ), scale );
+	}
+
+	template<typename T>
+	MEDIA_TARGET_AVX2 void meterAvx2( const T * src, size_t channels, size_t frameCount, const float * k, float * state, float * peak, float * squares, float * weighted )
+	{
+		const __m256 scale = _mm256_set1_ps( getAudioSampleScale( src ) );
+		const __m256 sign = _mm256_set1_ps( -0.0f );
+		__m256 c[10];
+		for( int i = 0; i < 10; ++i )
+			c[i] = _mm256_set1_ps( k[i] );
+
+		for( size_t block = 0; block + 8 <= channels; block += 8 ) {
+			__m256 x1 = _mm256_loadu_ps( state + block ), x2 = _mm256_loadu_ps( state + channels + block );
+			__m256 y1 = _mm256_loadu_ps( state + 2 * channels + block ), y2 = _mm256_loadu_ps( state + 3 * channels + block );
+			__m256 z1 = _mm256_loadu_ps( state + 4 * channels + block ), z2 = _mm256_loadu_ps( state + 5 * channels + block );
+			__m256 p = _mm256_setzero_ps(), s = _mm256_setzero_ps(), w = _mm256_setzero_ps();
+			for( size_t frame = 0; frame < frameCount; ++frame ) {
+				const __m256 x = loadAvx2( src + frame * channels + block, scale );
+				p = _mm256_max_ps( p, _mm256_andnot_ps( sign, x ) );
+				s = _mm256_add_ps( s, _mm256_mul_ps( x, x ) );
+				const __m256 y = _mm256_sub_ps( _mm256_sub_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( c[0], x ), _mm256_mul_ps( c[1], x1 ) ), _mm256_mul_ps( c[2], x2 ) ), _mm256_mul_ps( c[3], y1 ) ), _mm256_mul_ps( c[4], y2 ) );
+				const __m256 z = _mm256_sub_ps( _mm256_sub_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( c[5], y ), _mm256_mul_ps( c[6], y1 ) ), _mm256_mul_ps( c[7], y2 ) ), _mm256_mul_ps( c[8], z1 ) ), _mm256_mul_ps( c[9], z2 ) );
+				w = _mm256_add_ps( w, _mm256_mul_ps( z, z ) );
+				x2 = x1; x1 = x;
+				y2 = y1; y1 = y;
+				z2 = z1; z1 = z;
+			}
+			_mm256_storeu_ps( state + block, x1 ); _mm256_storeu_ps( state + channels + block, x2 );
+			_mm256_storeu_ps( state + 2 * channels + block, y1 ); _mm256_storeu_ps( state + 3 * channels + block, y2 );
+			_mm256_storeu_ps( state + 4 * channels + block, z1 ); _mm256_storeu_ps( state + 5 * channels + block, z2 );
+			_mm256_storeu_ps( peak + block, p );
+			_mm256_storeu_ps( squares + block, s );
+			_mm256_storeu_ps( weighted + block, w );
+		}
+		meterChannelsScalar( src, channels, channels & ~size_t( 7 ), frameCount, k, state, peak, squares, weighted );
+	}
+#endif
+
+#if defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+	inline float32x4_t loadNeon( const int32_t * src, float scale )
+	{
+		return vmulq_n_f32( vcvtq_f32_s32( vld1q_s32( src ) ), scale );
+	}
+
+	inline float32x4_t loadNeon( const int16_t * src, float scale )
+	{
+		return vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vld1_s16( src ) ) ), scale );
+	}
+
+	// Separate multiplies and adds, vmla may be fused on some targets.
+	template<typename T>
+	void meterNeon( const T * src, size_t channels, size_t frameCount, const float * k, float * state, float * peak, float * squares, float * weighted )
+	{
+		const float scale = getAudioSampleScale( src );
+		for( size_t block = 0; block + 4 <= channels; block += 4 ) {
+			float32x4_t x1 = vld1q_f32( state + block ), x2 = vld1q_f32( state + channels + block );
+			float32x4_t y1 = vld1q_f32( state + 2 * channels + block ), y2 = vld1q_f32( state + 3 * channels + block );
+			float32x4_t z1 = vld1q_f32( state + 4 * channels + block ), z2 = vld1q_f32( state + 5 * channels + block );
+			float32x4_t p = vdupq_n_f32( 0.0f ), s = vdupq_n_f32( 0.0f ), w = vdupq_n_f32( 0.0f );
+			for( size_t frame = 0; frame < frameCount; ++frame ) {
+				const float32x4_t x = loadNeon( src + frame * channels + block, scale );
+				p = vmaxq_f32( p, vabsq_f32( x ) );
+				s = vaddq_f32( s, vmulq_f32( x, x ) );
+				const float32x4_t y = vsubq_f32( vsubq_f32( vaddq_f32( vaddq_f32( vmulq_n_f32( x, k[0] ), vmulq_n_f32( x1, k[1] ) ), vmulq_n_f32( x2, k[2] ) ), vmulq_n_f32( y1, k[3] ) ), vmulq_n_f32( y2, k[4] ) );
+				const float32x4_t z = vsubq_f32( vsubq_f32( vaddq_f32( vaddq_f32( vmulq_n_f32( y, k[5] ), vmulq_n_f32( y1, k[6] ) ), vmulq_n_f32( y2, k[7] ) ), vmulq_n_f32( z1, k[8] ) ), vmulq_n_f32( z2, k[9] ) );
+				w = vaddq_f32( w, vmulq_f32( z, z ) );
+				x2 = x1; x1 = x;
+				y2 = y1; y1 = y;
+				z2 = z1; z1 = z;
+			}
+			vst1q_f32( state + block, x1 ); vst1q_f32( state + channels + block, x2 );
+			vst1q_f32( state + 2 * channels + block, y1 ); vst1q_f32( state + 3 * channels + block, y2 );
+			vst1q_f32( state + 4 * channels + block, z1 ); vst1q_f32( state + 5 * channels + block, z2 );
+			vst1q_f32( peak + block, p );
+			vst1q_f32( squares + block, s );
+			vst1q_f32( weighted + block, w );
+		}
+		meterChannelsScalar( src, channels, channels & ~size_t( 3 ), frameCount, k, state, peak, squares, weighted );
+	}
+#endif
+
+	template<typename T>
+	MeterKernel<T> getKernel( size_t channels, SimdLevel level )
+	{
+#if defined( MEDIA_ARCH_X86 )
+		if( level == SimdLevel::AVX2 && channels >= 8 )
+			return meterAvx2<T>;
+		if( ( level == SimdLevel::AVX2 || level == SimdLevel::SSE2 ) && channels >= 4 )
+			return meterSse2<T>;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		if( level == SimdLevel::NEON && channels >= 4 )
+			return meterNeon<T>;
+#endif
+		return meterScalar<T>;
+	}
+
+	//! Shelving and high-pass stages of the BS.1770 K-weighting at any sample rate, from the analog prototypes.
+	void computeKWeighting( double sampleRate, float * k )
+	{
+		double f0 = 1681.974450955533;
+		const double gainDb = 3.999843853973347;
+		double q = 0.7071752369554196;
+		double kk = std::tan( kPi * f0 / sampleRate );
+		const double vh = std::pow( 10.0, gainDb / 20.0 );
+		const double vb = std::pow( vh, 0.4996667741545416 );
+		double a0 = 1.0 + kk / q + kk * kk;
+		k[0] = float( ( vh + vb * kk / q + kk * kk ) / a0 );
+		k[1] = float( 2.0 * ( kk * kk - vh ) / a0 );
+		k[2] = float( ( vh - vb * kk / q + kk * kk ) / a0 );
+		k[3] = float( 2.0 * ( kk * kk - 1.0 ) / a0 );
+		k[4] = float( ( 1.0 - kk / q + kk * kk ) / a0 );
+
+		f0 = 38.13547087602444;
+		q = 0.5003270373238773;
+		kk = std::tan( kPi * f0 / sampleRate );
+		a0 = 1.0 + kk / q + kk * kk;
+		k[5] = 1.0f;
+		k[6] = -2.0f;
+		k[7] = 1.0f;
+		k[8] = float( 2.0 * ( kk * kk - 1.0 ) / a0 );
+		k[9] = float( ( 1.0 - kk / q + kk * kk ) / a0 );
+	}
+
+	inline float toDb( double amplitude )
+	{
+		return amplitude > 0.0 ? float( 20.0 * std::log10( amplitude ) ) : -std::numeric_limits<float>::infinity();
+	}
+
+	inline double toLufs( double power )
+	{
+		return power > 0.0 ? kLoudnessOffset + 10.0 * std::log10( power ) : -std::numeric_limits<double>::infinity();
+	}
+
+	inline double toPower( double lufs )
+	{
+		return std::pow( 10.0, ( lufs - kLoudnessOffset ) / 10.0 );
+	}
+
+	//! Counts a gating block, blocks under the absolute gate are not part of the integrated loudness at all.
+	void addGatingBlock( std::vector<uint32_t>& histogram, double power )
+	{
+		const double lufs = toLufs( power );
+		if( lufs < kAbsoluteGateLufs )
+			return;
+		const size_t bin = std::min( size_t( ( lufs - kAbsoluteGateLufs ) / kHistogramBinLu ), kHistogramBins - 1 );
+		++histogram[bin];
+	}
+
+	//! Mean power of the last \a count blocks of one channel's history.
+	double getMeanPower( const double * history, uint64_t blocks, size_t count )
+	{
+		count = size_t( std::min<uint64_t>( count, blocks ) );
+		double sum = 0.0;
+		for( size_t i = 0; i < count; ++i )
+			sum += history[( blocks - 1 - i ) % kHistoryBlocks];
+		return count > 0 ? sum / double( count ) : 0.0;
+	}
+}
+
+AudioMeter::AudioMeter( const AudioMeterOptions& options )
+	: mOptions( options )
+	, mChannels{ 0 }
+	, mBlockFrames{ 0 }
+	, mBlockPosition{ 0 }
+	, mRmsBlocks{ 1 }
+	, mBlocks{ 0 }
+	, mPosition{ 0 }
+{
+	std::memset( mWeighting, 0, sizeof( mWeighting ) );
+}
+
+void AudioMeter::reset( size_t channels, double sampleRate )
+{
+	mChannels = std::min( channels, kMaxAudioChannels );
+	computeKWeighting( sampleRate, mWeighting );
+	mBlockFrames = std::max<size_t>( size_t( sampleRate * kBlockSeconds + 0.5 ), 1 );
+	mBlockPosition = 0;
+	mRmsBlocks = std::min( std::max<size_t>( size_t( mOptions.rmsWindowMs / ( kBlockSeconds * 1000.0 ) + 0.5 ), 1 ), kHistoryBlocks );
+	mBlocks = 0;
+	mPosition = 0;
+
+	mState.assign( kStateRows * mChannels, 0.0f );
+	mChunkPeak.assign( mChannels, 0.0f );
+	mChunkSquares.assign( mChannels, 0.0f );
+	mChunkWeighted.assign( mChannels, 0.0f );
+	mBlockPeak.assign( mChannels, 0.0f );
+	mMaxPeak.assign( mChannels, 0.0f );
+	mBlockSquares.assign( mChannels, 0.0 );
+	mBlockWeighted.assign( mChannels, 0.0 );
+	mSquaresHistory.assign( kHistoryBlocks * mChannels, 0.0 );
+	mWeightedHistory.assign( kHistoryBlocks * mChannels, 0.0 );
+
+	mProgramWeights.assign( mChannels, 0.0f );
+	if( mOptions.programWeights.empty() ) {
+		for( size_t c = 0; c < std::min<size_t>( mChannels, 2 ); ++c )
+			mProgramWeights[c] = 1.0f;
+	}
+	else {
+		for( size_t c = 0; c < std::min( mChannels, mOptions.programWeights.size() ); ++c )
+			mProgramWeights[c] = mOptions.programWeights[c];
+	}
+
+	mHistograms.assign( mChannels, std::vector<uint32_t>( kHistogramBins, 0 ) );
+	mProgramHistogram.assign( kHistogramBins, 0 );
+
+	AudioLevels silence;
+	silence.channels = mChannels;
+	const float floor = -std::numeric_limits<float>::infinity();
+	for( size_t c = 0; c < kMaxAudioChannels; ++c ) {
+		AudioChannelLevels& levels = silence.channel[c];
+		levels.peakDb = levels.maxPeakDb = levels.rmsDb = floor;
+		levels.momentaryLufs = levels.shortTermLufs = levels.integratedLufs = floor;
+	}
+	silence.momentaryLufs = silence.shortTermLufs = silence.integratedLufs = floor;
+	mLevels.reset( silence, silence, silence );
+}
+
+void AudioMeter::process( const int32_t * src, size_t frameCount )
+{
+	processFrames( src, frameCount, getSimdLevel() );
+}
+
+void AudioMeter::process( const int32_t * src, size_t frameCount, SimdLevel level )
+{
+	processFrames( src, frameCount, level );
+}
+
+void AudioMeter::process( const int16_t * src, size_t frameCount )
+{
+	processFrames( src, frameCount, getSimdLevel() );
+}
+
+void AudioMeter::process( const int16_t * src, size_t frameCount, SimdLevel level )
+{
+	processFrames( src, frameCount, level );
+}
+
+template<typename T>
+void AudioMeter::processFrames( const T * src, size_t frameCount, SimdLevel level )
+{
+	if( mChannels == 0 )
+		return;
+	if( ! isSimdLevelSupported( level ) )
+		level = SimdLevel::SCALAR;
+
+	const MeterKernel<T> meter = getKernel<T>( mChannels, level );
+	while( frameCount > 0 ) {
+		// Chunks never straddle a block, so the sums of each block are exact whatever the packet sizes.
+		const size_t count = std::min( std::min( frameCount, kChunkFrames ), mBlockFrames - mBlockPosition );
+		meter( src, mChannels, count, mWeighting, mState.data(), mChunkPeak.data(), mChunkSquares.data(), mChunkWeighted.data() );
+
+		for( size_t c = 0; c < mChannels; ++c ) {
+			mBlockPeak[c] = std::max( mBlockPeak[c], mChunkPeak[c] );
+			mBlockSquares[c] += mChunkSquares[c];
+			mBlockWeighted[c] += mChunkWeighted[c];
+		}
+		for( float& value : mState ) {
+			if( std::fabs( value ) < kDenormalThreshold )
+				value = 0.0f;
+		}
+
+		src += count * mChannels;
+		frameCount -= count;
+		mPosition += count;
+		mBlockPosition += count;
+		if( mBlockPosition == mBlockFrames )
+			endBlock();
+	}
+}
+
+void AudioMeter::endBlock()
+{
+	const size_t slot = size_t( mBlocks % kHistoryBlocks );
+	for( size_t c = 0; c < mChannels; ++c ) {
+		mSquaresHistory[c * kHistoryBlocks + slot] = mBlockSquares[c] / double( mBlockFrames );
+		mWeightedHistory[c * kHistoryBlocks + slot] = mBlockWeighted[c] / double( mBlockFrames );
+	}
+	++mBlocks;
+
+	AudioLevels& levels = mLevels.getWriteSlot();
+	levels.channels = mChannels;
+	levels.position = mPosition;
+	double programMomentary = 0.0, programShortTerm = 0.0;
+	for( size_t c = 0; c < mChannels; ++c ) {
+		const double momentary = getMeanPower( &mWeightedHistory[c * kHistoryBlocks], mBlocks, kMomentaryBlocks );
+		const double shortTerm = getMeanPower( &mWeightedHistory[c * kHistoryBlocks], mBlocks, kHistoryBlocks );
+		// Gating blocks are 400 ms long and overlap by 75 %, one per 100 ms step once there is a whole one.
+		if( mBlocks >= kMomentaryBlocks )
+			addGatingBlock( mHistograms[c], momentary );
+		programMomentary += mProgramWeights[c] * momentary;
+		programShortTerm += mProgramWeights[c] * shortTerm;
+
+		mMaxPeak[c] = std::max( mMaxPeak[c], mBlockPeak[c] );
+		AudioChannelLevels& channel = levels.channel[c];
+		channel.peakDb = toDb( mBlockPeak[c] );
+		channel.maxPeakDb = toDb( mMaxPeak[c] );
+		channel.rmsDb = toDb( std::sqrt( getMeanPower( &mSquaresHistory[c * kHistoryBlocks], mBlocks, mRmsBlocks ) ) );
+		channel.momentaryLufs = float( toLufs( momentary ) );
+		channel.shortTermLufs = float( toLufs( shortTerm ) );
+		channel.integratedLufs = getIntegratedLufs( mHistograms[c] );
+
+		mBlockPeak[c] = 0.0f;
+		mBlockSquares[c] = 0.0;
+		mBlockWeighted[c] = 0.0;
+	}
+	if( mBlocks >= kMomentaryBlocks )
+		addGatingBlock( mProgramHistogram, programMomentary );
+	levels.momentaryLufs = float( toLufs( programMomentary ) );
+	levels.shortTermLufs = float( toLufs( programShortTerm ) );
+	levels.integratedLufs = getIntegratedLufs( mProgramHistogram );
+
+	mLevels.publish();
+	mBlockPosition = 0;
+}
+
+float AudioMeter::getIntegratedLufs( const std::vector<uint32_t>& histogram ) const
+{
+	// Bins stand for the power at their center, which keeps the error under 0.05 LU.
+	double sum = 0.0;
+	uint64_t count = 0;
+	for( size_t bin = 0; bin < kHistogramBins; ++bin ) {
+		if( histogram[bin] == 0 )
+			continue;
+		sum += double( histogram[bin] ) * toPower( kAbsoluteGateLufs + ( double( bin ) + 0.5 ) * kHistogramBinLu );
+		count += histogram[bin];
+	}
+	if( count == 0 )
+		return -std::numeric_limits<float>::infinity();
+
+	const double relativeGate = toLufs( sum / double( count ) ) + kRelativeGateLu;
+	const size_t firstBin = relativeGate > kAbsoluteGateLufs ? size_t( ( relativeGate - kAbsoluteGateLufs ) / kHistogramBinLu ) : 0;
+	sum = 0.0;
+	count = 0;
+	for( size_t bin = std::min( firstBin, kHistogramBins - 1 ); bin < kHistogramBins; ++bin ) {
+		if( histogram[bin] == 0 )
+			continue;
+		sum += double( histogram[bin] ) * toPower( kAbsoluteGateLufs + ( double( bin ) + 0.5 ) * kHistogramBinLu );
+		count += histogram[bin];
+	}
+	return count > 0 ? float( toLufs( sum / double( count ) ) ) : -std::numeric_limits<float>::infinity();
+}
+
+AudioLevels AudioMeter::getLevels() const
+{
+	std::lock_guard<std::mutex> lock( mReadMutex );
+	mLevels.fetch();
+	return mLevels.getReadSlot();
+}
@@ -0,0 +1,147 @@
+#include "AudioPlayoutBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace media;
+
+AudioPlayoutBuffer::AudioPlayoutBuffer( size_t channels, size_t bytesPerSample, size_t capacityFrames )
+	: mChannels{ channels }
+	, mBytesPerSample{ bytesPerSample }
+	, mFrameBytes{ channels * bytesPerSample }
+	, mCapacity{ std::max<size_t>( capacityFrames, 1 ) }
+	, mData( mCapacity * mFrameBytes )
+	, mHead{ 0 }
+	, mTail{ 0 }
+	, mWrittenFrames{ 0 }
+	, mOverflowFrames{ 0 }
+	, mLateFrames{ 0 }
+	, mGapFrames{ 0 }
+	, mUnderrunFrames{ 0 }
+	, mUnderruns{ 0 }
+	, mResyncs{ 0 }
+{
+}
+
+size_t AudioPlayoutBuffer::write( int64_t position, const void * data, size_t frameCount )
+{
+	const uint8_t * bytes = (const uint8_t*)data;
+	const int64_t tail = mTail.load( std::memory_order_acquire );
+	// After an underrun the consumer is past the written frames, writing continues from where it is.
+	int64_t head = std::max( mHead.load( std::memory_order_relaxed ), tail );
+
+	if( position < head ) {
+		const size_t late = size_t( std::min<int64_t>( head - position, int64_t( frameCount ) ) );
+		bytes += late * mFrameBytes;
+		position += int64_t( late );
+		frameCount -= late;
+		mLateFrames.fetch_add( late, std::memory_order_relaxed );
+	}
+	if( frameCount == 0 ) {
+		mHead.store( head, std::memory_order_release );
+		return 0;
+	}
+
+	size_t free = mCapacity - size_t( head - tail );
+	if( position > head ) {
+		const size_t gap = size_t( std::min<int64_t>( position - head, int64_t( free ) ) );
+		store( head, nullptr, gap );
+		head += int64_t( gap );
+		free -= gap;
+		mGapFrames.fetch_add( gap, std::memory_order_relaxed );
+	}
+
+	// A gap the buffer cannot hold leaves no room for the frames after it either.
+	const size_t count = position == head ? std::min( frameCount, free ) : 0;
+	store( head, bytes, count );
+	head += int64_t( count );
+	mHead.store( head, std::memory_order_release );
+
+	mWrittenFrames.fetch_add( count, std::memory_order_relaxed );
+	if( count < frameCount )
+		mOverflowFrames.fetch_add( frameCount - count, std::memory_order_relaxed );
+	return count;
+}
+
+int64_t AudioPlayoutBuffer::getWritePosition() const
+{
+	return std::max( mHead.load( std::memory_order_relaxed ), mTail.load( std::memory_order_acquire ) );
+}
+
+size_t AudioPlayoutBuffer::getWritableFrames() const
+{
+	const int64_t tail = mTail.load( std::memory_order_acquire );
+	const int64_t head = std::max( mHead.load( std::memory_order_relaxed ), tail );
+	return mCapacity - size_t( head - tail );
+}
+
+size_t AudioPlayoutBuffer::peek( const uint8_t ** frames ) const
+{
+	const int64_t tail = mTail.load( std::memory_order_relaxed );
+	const int64_t head = mHead.load( std::memory_order_acquire );
+	if( head <= tail )
+		return 0;
+
+	const size_t offset = size_t( tail % int64_t( mCapacity ) );
+	*frames = mData.data() + offset * mFrameBytes;
+	return std::min( size_t( head - tail ), mCapacity - offset );
+}
+
+void AudioPlayoutBuffer::consume( size_t frameCount )
+{
+	if( frameCount == 0 )
+		return;
+
+	const int64_t tail = mTail.load( std::memory_order_relaxed );
+	const int64_t head = mHead.load( std::memory_order_acquire );
+	const size_t available = head > tail ? size_t( head - tail ) : 0;
+	if( frameCount > available ) {
+		mUnderrunFrames.fetch_add( frameCount - available, std::memory_order_relaxed );
+		mUnderruns.fetch_add( 1, std::memory_order_relaxed );
+	}
+	// Release: the frames read from the ring are done with before the producer may overwrite them.
+	mTail.store( tail + int64_t( frameCount ), std::memory_order_release );
+}
+
+void AudioPlayoutBuffer::seek( int64_t position )
+{
+	if( position <= mTail.load( std::memory_order_relaxed ) )
+		return;
+
+	mTail.store( position, std::memory_order_release );
+	mResyncs.fetch_add( 1, std::memory_order_relaxed );
+}
+
+AudioPlayoutStats AudioPlayoutBuffer::getStats() const
+{
+	AudioPlayoutStats stats;
+	stats.readPosition = mTail.load( std::memory_order_acquire );
+	stats.writePosition = std::max( mHead.load( std::memory_order_acquire ), stats.readPosition );
+	stats.writtenFrames = mWrittenFrames.load( std::memory_order_relaxed );
+	stats.overflowFrames = mOverflowFrames.load( std::memory_order_relaxed );
+	stats.lateFrames = mLateFrames.load( std::memory_order_relaxed );
+	stats.silenceFrames = mGapFrames.load( std::memory_order_relaxed ) + mUnderrunFrames.load( std::memory_order_relaxed );
+	stats.underruns = mUnderruns.load( std::memory_order_relaxed );
+	stats.resyncs = mResyncs.load( std::memory_order_relaxed );
+	return stats;
+}
+
+void AudioPlayoutBuffer::store( int64_t position, const uint8_t * data, size_t frameCount )
+{
+	if( frameCount == 0 )
+		return;
+
+	// Positions start at 0 and only move forward.
+	const size_t offset = size_t( position % int64_t( mCapacity ) );
+	const size_t first = std::min( frameCount, mCapacity - offset );
+	uint8_t * dst = mData.data() + offset * mFrameBytes;
+	if( data ) {
+		std::memcpy( dst, data, first * mFrameBytes );
+		std::memcpy( mData.data(), data + first * mFrameBytes, ( frameCount - first ) * mFrameBytes );
+	}
+	else {
+		// Zero is silence for signed integer samples.
+		std::memset( dst, 0, first * mFrameBytes );
+		std::memset( mData.data(), 0, ( frameCount - first ) * mFrameBytes );
+	}
+}
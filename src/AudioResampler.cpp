@@ -0,0 +1,286 @@
+#include "AudioResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined( MEDIA_ARCH_X86 )
+	#include <emmintrin.h>
+	#include <immintrin.h>
+#elif defined( MEDIA_ARCH_NEON )
+	#include <arm_neon.h>
+#endif
+
+using namespace media;
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+	// Input frames converted at once past the filter window.
+	const size_t kBlockFrames = 256;
+	const double kFractionScale = 4294967296.0;
+	const uint64_t kFractionMask = 0xFFFFFFFFull;
+
+	// Each channel sums its taps in order with separate multiplies and adds, the same in every kernel, which keeps them
+	// bit-exact against the scalar reference.
+	typedef void( *FilterKernel )( const float * frames, const float * coefficients, size_t taps, size_t channels, float * dst );
+
+	void filterChannelsScalar( const float * frames, const float * coefficients, size_t taps, size_t channels, size_t channelBegin, float * dst )
+	{
+		for( size_t c = channelBegin; c < channels; ++c ) {
+			float sum = 0.0f;
+			for( size_t k = 0; k < taps; ++k )
+				sum = sum + coefficients[k] * frames[k * channels + c];
+			dst[c] = sum;
+		}
+	}
+
+	void filterScalar( const float * frames, const float * coefficients, size_t taps, size_t channels, float * dst )
+	{
+		filterChannelsScalar( frames, coefficients, taps, channels, 0, dst );
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	//! Filters blocks of 4 channels from \a block on, returns the first channel left.
+	size_t filterBlocksSse2( const float * frames, const float * coefficients, size_t taps, size_t channels, size_t block, float * dst )
+	{
+		for( ; block + 4 <= channels; block += 4 ) {
+			__m128 sum = _mm_setzero_ps();
+			for( size_t k = 0; k < taps; ++k )
+				sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( coefficients[k] ), _mm_loadu_ps( frames + k * channels + block ) ) );
+			_mm_storeu_ps( dst + block, sum );
+		}
+		return block;
+	}
+
+	void filterSse2( const float * frames, const float * coefficients, size_t taps, size_t channels, float * dst )
+	{
+		filterChannelsScalar( frames, coefficients, taps, channels, filterBlocksSse2( frames, coefficients, taps, channels, 0, dst ), dst );
+	}
+
+	MEDIA_TARGET_AVX2 void filterAvx2( const float * frames, const float * coefficients, size_t taps, size_t channels, float * dst )
+	{
+		size_t block = 0;
+		for( ; block + 8 <= channels; block += 8 ) {
+			__m256 sum = _mm256_setzero_ps();
+			for( size_t k = 0; k < taps; ++k )
+				sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_set1_ps( coefficients[k] ), _mm256_loadu_ps( frames + k * channels + block ) ) );
+			_mm256_storeu_ps( dst + block, sum );
+		}
+		// 4 to 7 channels left still fill an SSE register.
+		filterChannelsScalar( frames, coefficients, taps, channels, filterBlocksSse2( frames, coefficients, taps, channels, block, dst ), dst );
+	}
+#endif
+
+#if defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+	// Separate multiplies and adds, vmla may be fused on some targets.
+	void filterNeon( const float * frames, const float * coefficients, size_t taps, size_t channels, float * dst )
+	{
+		for( size_t block = 0; block + 4 <= channels; block += 4 ) {
+			float32x4_t sum = vdupq_n_f32( 0.0f );
+			for( size_t k = 0; k < taps; ++k )
+				sum = vaddq_f32( sum, vmulq_n_f32( vld1q_f32( frames + k * channels + block ), coefficients[k] ) );
+			vst1q_f32( dst + block, sum );
+		}
+		filterChannelsScalar( frames, coefficients, taps, channels, channels & ~size_t( 3 ), dst );
+	}
+#endif
+
+	FilterKernel getKernel( size_t channels, SimdLevel level )
+	{
+#if defined( MEDIA_ARCH_X86 )
+		if( level == SimdLevel::AVX2 && channels >= 8 )
+			return filterAvx2;
+		if( ( level == SimdLevel::AVX2 || level == SimdLevel::SSE2 ) && channels >= 4 )
+			return filterSse2;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		if( level == SimdLevel::NEON && channels >= 4 )
+			return filterNeon;
+#endif
+		return filterScalar;
+	}
+
+	//! Zeroth order modified Bessel function of the first kind, for the Kaiser window.
+	double besselI0( double x )
+	{
+		double sum = 1.0, term = 1.0;
+		for( int k = 1; k < 50 && term > sum * 1e-12; ++k ) {
+			term *= ( x / ( 2.0 * k ) ) * ( x / ( 2.0 * k ) );
+			sum += term;
+		}
+		return sum;
+	}
+
+	//! Rounds half away from zero like lround(), with a truncating conversion instead of a library call. Exact in double.
+	inline int64_t roundSample( double value )
+	{
+		return int64_t( value >= 0.0 ? value + 0.5 : value - 0.5 );
+	}
+
+	inline void storeSample( float value, int16_t * dst )
+	{
+		const double scaled = std::min( std::max( double( value ) * 32768.0, -32768.0 ), 32767.0 );
+		*dst = int16_t( roundSample( scaled ) );
+	}
+
+	inline void storeSample( float value, int32_t * dst )
+	{
+		// Float does not hold 2^31 - 1, the clamp is done in double.
+		const double scaled = std::min( std::max( double( value ) * 2147483648.0, -2147483648.0 ), 2147483647.0 );
+		*dst = int32_t( roundSample( scaled ) );
+	}
+}
+
+AudioResampler::AudioResampler( size_t channels, const AudioResamplerOptions& options )
+	: mOptions( options )
+	, mChannels{ std::max<size_t>( channels, 1 ) }
+	, mTaps{ std::max<size_t>( options.taps, 2 ) & ~size_t( 1 ) }
+	, mPhaseBits{ 0 }
+	, mCapacity{ 0 }
+	, mBuffered{ 0 }
+	, mIndex{ 0 }
+	, mRatio{ 1.0 }
+	, mFraction{ 0 }
+	, mStep{ uint64_t( 1 ) << 32 }
+{
+	while( mPhaseBits < 16 && ( size_t( 1 ) << mPhaseBits ) < options.phases )
+		++mPhaseBits;
+	const size_t phases = size_t( 1 ) << mPhaseBits;
+
+	// Windowed sinc centered between taps / 2 - 1 and taps / 2, shifted by the phase: row p, tap k weighs the input frame
+	// at distance p / phases + taps / 2 - 1 - k from the output. Rows are normalized for unity gain at DC.
+	const double half = double( mTaps / 2 );
+	const double window = besselI0( mOptions.kaiserBeta );
+	mFilter.resize( ( phases + 1 ) * mTaps );
+	for( size_t phase = 0; phase <= phases; ++phase ) {
+		float * row = &mFilter[phase * mTaps];
+		double sum = 0.0;
+		std::vector<double> taps( mTaps );
+		for( size_t k = 0; k < mTaps; ++k ) {
+			const double x = double( phase ) / double( phases ) + half - 1.0 - double( k );
+			const double r = x / half;
+			const double w = r * r < 1.0 ? besselI0( mOptions.kaiserBeta * std::sqrt( 1.0 - r * r ) ) / window : 0.0;
+			const double t = 2.0 * mOptions.cutoff * x;
+			const double sinc = std::fabs( t ) < 1e-12 ? 1.0 : std::sin( kPi * t ) / ( kPi * t );
+			taps[k] = 2.0 * mOptions.cutoff * sinc * w;
+			sum += taps[k];
+		}
+		for( size_t k = 0; k < mTaps; ++k )
+			row[k] = float( taps[k] / sum );
+	}
+
+	mCoefficients.resize( mTaps );
+	mCapacity = mTaps + kBlockFrames;
+	mInput.resize( mCapacity * mChannels );
+	mOutput.resize( mChannels );
+}
+
+void AudioResampler::reset()
+{
+	mBuffered = 0;
+	mIndex = 0;
+	mFraction = 0;
+}
+
+void AudioResampler::setRatio( double ratio )
+{
+	mRatio = std::min( std::max( ratio, 0.5 ), 2.0 );
+	mStep = uint64_t( std::llround( mRatio * kFractionScale ) );
+}
+
+size_t AudioResampler::getInputFrames( size_t dstFrames ) const
+{
+	if( dstFrames == 0 )
+		return 0;
+
+	// Window of the last output frame.
+	const uint64_t last = mFraction + mStep * uint64_t( dstFrames - 1 );
+	const size_t end = mIndex + size_t( last >> 32 ) + mTaps;
+	return end > mBuffered ? end - mBuffered : 0;
+}
+
+double AudioResampler::getBufferedFrames() const
+{
+	return double( mBuffered ) - double( mIndex ) - ( double( mTaps / 2 ) - 1.0 ) - double( mFraction ) / kFractionScale;
+}
+
+size_t AudioResampler::process( const int32_t * src, size_t * srcFrames, int32_t * dst, size_t dstFrames )
+{
+	return processFrames( src, srcFrames, dst, dstFrames, getSimdLevel() );
+}
+
+size_t AudioResampler::process( const int32_t * src, size_t * srcFrames, int32_t * dst, size_t dstFrames, SimdLevel level )
+{
+	return processFrames( src, srcFrames, dst, dstFrames, level );
+}
+
+size_t AudioResampler::process( const int16_t * src, size_t * srcFrames, int16_t * dst, size_t dstFrames )
+{
+	return processFrames( src, srcFrames, dst, dstFrames, getSimdLevel() );
+}
+
+size_t AudioResampler::process( const int16_t * src, size_t * srcFrames, int16_t * dst, size_t dstFrames, SimdLevel level )
+{
+	return processFrames( src, srcFrames, dst, dstFrames, level );
+}
+
+template<typename T>
+size_t AudioResampler::processFrames( const T * src, size_t * srcFrames, T * dst, size_t dstFrames, SimdLevel level )
+{
+	if( ! isSimdLevelSupported( level ) )
+		level = SimdLevel::SCALAR;
+
+	const FilterKernel filter = getKernel( mChannels, level );
+	const float scale = getAudioSampleScale( src );
+	const unsigned phaseShift = unsigned( 32 - mPhaseBits );
+	const uint64_t phaseMask = ( uint64_t( 1 ) << phaseShift ) - 1;
+	const float phaseScale = 1.0f / float( uint64_t( 1 ) << phaseShift );
+
+	const size_t available = *srcFrames;
+	size_t consumed = 0, produced = 0;
+	while( produced < dstFrames ) {
+		if( mIndex + mTaps > mBuffered ) {
+			// The window runs past the input: move what is left of it to the front and convert more frames behind.
+			if( consumed == available )
+				break;
+			if( mIndex > 0 ) {
+				const size_t kept = mBuffered > mIndex ? mBuffered - mIndex : 0;
+				std::memmove( mInput.data(), mInput.data() + mIndex * mChannels, kept * mChannels * sizeof( float ) );
+				mIndex -= mBuffered - kept;
+				mBuffered = kept;
+			}
+			// A window past the input skips frames, they are converted to be dropped.
+			const size_t count = std::min( available - consumed, mCapacity - mBuffered );
+			const T * samples = src + consumed * mChannels;
+			float * frames = mInput.data() + mBuffered * mChannels;
+			for( size_t i = 0; i < count * mChannels; ++i )
+				frames[i] = float( samples[i] ) * scale;
+			consumed += count;
+			mBuffered += count;
+			if( mIndex >= mBuffered ) {
+				mIndex -= mBuffered;
+				mBuffered = 0;
+			}
+			continue;
+		}
+
+		const uint32_t fraction = uint32_t( mFraction );
+		const float * a = &mFilter[size_t( fraction >> phaseShift ) * mTaps];
+		const float * b = a + mTaps;
+		const float weight = float( fraction & phaseMask ) * phaseScale;
+		for( size_t k = 0; k < mTaps; ++k )
+			mCoefficients[k] = a[k] + weight * ( b[k] - a[k] );
+		filter( mInput.data() + mIndex * mChannels, mCoefficients.data(), mTaps, mChannels, mOutput.data() );
+
+		T * out = dst + produced * mChannels;
+		for( size_t c = 0; c < mChannels; ++c )
+			storeSample( mOutput[c], out + c );
+		++produced;
+
+		mFraction += mStep;
+		mIndex += size_t( mFraction >> 32 );
+		mFraction &= kFractionMask;
+	}
+
+	*srcFrames = consumed;
+	return produced;
+}
@@ -0,0 +1,168 @@
+#include "AudioRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace media;
+
+namespace {
+	// Word by word through relaxed atomics, the bytes in between are copied with memcpy so that dst needs no alignment.
+	void storeWords( std::atomic<uint32_t> * dst, const uint8_t * src, size_t words )
+	{
+		for( size_t i = 0; i < words; ++i ) {
+			uint32_t word = 0;
+			if( src )
+				std::memcpy( &word, src + i * 4, 4 );
+			dst[i].store( word, std::memory_order_relaxed );
+		}
+	}
+
+	void loadWords( const std::atomic<uint32_t> * src, uint8_t * dst, size_t words )
+	{
+		for( size_t i = 0; i < words; ++i ) {
+			const uint32_t word = src[i].load( std::memory_order_relaxed );
+			std::memcpy( dst + i * 4, &word, 4 );
+		}
+	}
+}
+
+AudioRingBuffer::AudioRingBuffer( size_t channels, size_t bytesPerSample, size_t capacityFrames )
+	: mChannels{ channels }
+	, mBytesPerSample{ bytesPerSample }
+	, mFrameBytes{ channels * bytesPerSample }
+	, mCapacity{ std::max<size_t>( capacityFrames, 1 ) }
+	, mData( mCapacity * mFrameBytes / 4 )
+	, mEpoch{ 0 }
+	, mStart{ 0 }
+	, mEnd{ 0 }
+	, mEmpty{ true }
+	, mWrittenFrames{ 0 }
+	, mSilenceFrames{ 0 }
+	, mDiscontinuities{ 0 }
+	, mFailedReads{ 0 }
+{
+	// Not every standard library zeroes a default constructed atomic.
+	for( auto& word : mData )
+		word.store( 0, std::memory_order_relaxed );
+}
+
+void AudioRingBuffer::write( int64_t position, const void * data, size_t frameCount )
+{
+	if( frameCount == 0 )
+		return;
+
+	// Only the newest capacity frames of an oversized packet can be kept.
+	const uint8_t * bytes = (const uint8_t*)data;
+	if( frameCount > mCapacity ) {
+		bytes += ( frameCount - mCapacity ) * mFrameBytes;
+		position += int64_t( frameCount - mCapacity );
+		frameCount = mCapacity;
+	}
+
+	const int64_t end = mEnd.load( std::memory_order_relaxed );
+	if( mEmpty ) {
+		restart( position );
+		mEmpty = false;
+	}
+	else if( position < end || position - end >= int64_t( mCapacity ) ) {
+		// Timeline restarted, or a gap nothing would be left of. Positions from before are meaningless now.
+		restart( position );
+		mDiscontinuities.fetch_add( 1, std::memory_order_relaxed );
+	}
+	else if( position > end ) {
+		const size_t gap = size_t( position - end );
+		store( end, nullptr, gap );
+		mSilenceFrames.fetch_add( gap, std::memory_order_relaxed );
+	}
+
+	store( position, bytes, frameCount );
+	mWrittenFrames.fetch_add( frameCount, std::memory_order_relaxed );
+}
+
+bool AudioRingBuffer::read( int64_t position, size_t frameCount, void * dst ) const
+{
+	uint64_t epoch;
+	if( ! beginRead( position, frameCount, &epoch ) )
+		return false;
+
+	loadFrames( position, frameCount, (uint8_t*)dst );
+	return endRead( position, epoch );
+}
+
+bool AudioRingBuffer::beginRead( int64_t position, size_t frameCount, uint64_t * epoch ) const
+{
+	*epoch = mEpoch.load( std::memory_order_acquire );
+	const int64_t end = mEnd.load( std::memory_order_acquire );
+	if( position < mStart.load( std::memory_order_acquire ) || position + int64_t( frameCount ) > end ) {
+		mFailedReads.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+	return true;
+}
+
+bool AudioRingBuffer::endRead( int64_t position, uint64_t epoch ) const
+{
+	// Pairs with the release fence of store(): if the copy saw any overwritten sample, it also sees the start moving past it.
+	std::atomic_thread_fence( std::memory_order_acquire );
+	if( mStart.load( std::memory_order_relaxed ) > position || mEpoch.load( std::memory_order_relaxed ) != epoch ) {
+		mFailedReads.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+	return true;
+}
+
+void AudioRingBuffer::loadFrames( int64_t position, size_t frameCount, uint8_t * dst ) const
+{
+	const size_t frameWords = mFrameBytes / 4;
+	const size_t offset = getOffset( position );
+	const size_t first = std::min( frameCount, mCapacity - offset );
+	loadWords( mData.data() + offset * frameWords, dst, first * frameWords );
+	loadWords( mData.data(), dst + first * mFrameBytes, ( frameCount - first ) * frameWords );
+}
+
+size_t AudioRingBuffer::getOffset( int64_t position ) const
+{
+	// Packet times are not negative in practice, but the modulo must not be either.
+	const int64_t offset = position % int64_t( mCapacity );
+	return size_t( offset < 0 ? offset + int64_t( mCapacity ) : offset );
+}
+
+AudioBufferStats AudioRingBuffer::getStats() const
+{
+	AudioBufferStats stats;
+	stats.startPosition = mStart.load( std::memory_order_acquire );
+	stats.endPosition = mEnd.load( std::memory_order_acquire );
+	stats.writtenFrames = mWrittenFrames.load( std::memory_order_relaxed );
+	stats.silenceFrames = mSilenceFrames.load( std::memory_order_relaxed );
+	stats.discontinuities = mDiscontinuities.load( std::memory_order_relaxed );
+	stats.failedReads = mFailedReads.load( std::memory_order_relaxed );
+	return stats;
+}
+
+void AudioRingBuffer::store( int64_t position, const uint8_t * data, size_t frameCount )
+{
+	if( frameCount == 0 )
+		return;
+
+	// Readers must see the start move past the frames about to be overwritten before they see any new byte.
+	const int64_t start = std::max( mStart.load( std::memory_order_relaxed ), position + int64_t( frameCount ) - int64_t( mCapacity ) );
+	mStart.store( start, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+
+	// Null data stores zero words, silence for signed integer samples.
+	const size_t frameWords = mFrameBytes / 4;
+	const size_t offset = getOffset( position );
+	const size_t first = std::min( frameCount, mCapacity - offset );
+	storeWords( mData.data() + offset * frameWords, data, first * frameWords );
+	storeWords( mData.data(), data ? data + first * mFrameBytes : nullptr, ( frameCount - first ) * frameWords );
+
+	mEnd.store( position + int64_t( frameCount ), std::memory_order_release );
+}
+
+void AudioRingBuffer::restart( int64_t position )
+{
+	mEpoch.fetch_add( 1, std::memory_order_relaxed );
+	mStart.store( position, std::memory_order_relaxed );
+	mEnd.store( position, std::memory_order_release );
+	std::atomic_thread_fence( std::memory_order_release );
+}
@@ -0,0 +1,116 @@
+#include "CpuFeatures.h"
+
+#include <atomic>
+
+#if defined( MEDIA_ARCH_X86 )
+	#if defined( _MSC_VER )
+		#include <intrin.h>
+		#include <immintrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+namespace media {
+
+namespace {
+
+#if defined( MEDIA_ARCH_X86 )
+	void cpuid( int leaf, int subleaf, int regs[4] )
+	{
+#if defined( _MSC_VER )
+		__cpuidex( regs, leaf, subleaf );
+#else
+		unsigned int a, b, c, d;
+		__cpuid_count( leaf, subleaf, a, b, c, d );
+		regs[0] = a; regs[1] = b; regs[2] = c; regs[3] = d;
+#endif
+	}
+
+	uint64_t xgetbv0()
+	{
+#if defined( _MSC_VER )
+		return _xgetbv( 0 );
+#else
+		unsigned int lo, hi;
+		__asm__ __volatile__( "xgetbv" : "=a"( lo ), "=d"( hi ) : "c"( 0 ) );
+		return ( uint64_t( hi ) << 32 ) | lo;
+#endif
+	}
+#endif
+
+	SimdLevel detectSimdLevel()
+	{
+#if defined( MEDIA_ARCH_X86 )
+		int regs[4];
+		cpuid( 0, 0, regs );
+		const int maxLeaf = regs[0];
+
+		cpuid( 1, 0, regs );
+		const bool sse2 = ( regs[3] & ( 1 << 26 ) ) != 0;
+		const bool osxsave = ( regs[2] & ( 1 << 27 ) ) != 0;
+		const bool avx = ( regs[2] & ( 1 << 28 ) ) != 0;
+		const bool f16c = ( regs[2] & ( 1 << 29 ) ) != 0;
+
+		// AVX2 also needs the OS to save the ymm registers on context switches.
+		if( maxLeaf >= 7 && osxsave && avx && f16c && ( xgetbv0() & 0x6 ) == 0x6 ) {
+			cpuid( 7, 0, regs );
+			if( regs[1] & ( 1 << 5 ) )
+				return SimdLevel::AVX2;
+		}
+		return sse2 ? SimdLevel::SSE2 : SimdLevel::SCALAR;
+#elif defined( MEDIA_ARCH_NEON )
+		return SimdLevel::NEON;
+#else
+		return SimdLevel::SCALAR;
+#endif
+	}
+
+	std::atomic<int> sSimdLevel{ -1 };
+}
+
+SimdLevel getSupportedSimdLevel()
+{
+	static const SimdLevel supported = detectSimdLevel();
+	return supported;
+}
+
+bool isSimdLevelSupported( SimdLevel level )
+{
+	const SimdLevel supported = getSupportedSimdLevel();
+	switch( level ) {
+	case SimdLevel::SCALAR:	return true;
+	case SimdLevel::SSE2:	return supported == SimdLevel::SSE2 || supported == SimdLevel::AVX2;
+	case SimdLevel::AVX2:	return supported == SimdLevel::AVX2;
+	case SimdLevel::NEON:	return supported == SimdLevel::NEON;
+	default:				return false;
+	}
+}
+
+SimdLevel getSimdLevel()
+{
+	int level = sSimdLevel.load( std::memory_order_relaxed );
+	if( level < 0 )
+		return getSupportedSimdLevel();
+	return static_cast<SimdLevel>( level );
+}
+
+void setSimdLevel( SimdLevel level )
+{
+	if( ! isSimdLevelSupported( level ) )
+		level = SimdLevel::SCALAR;
+	sSimdLevel.store( static_cast<int>( level ), std::memory_order_relaxed );
+}
+
+const char* getSimdLevelName( SimdLevel level )
+{
+	switch( level ) {
+	case SimdLevel::SCALAR:	return "Scalar";
+	case SimdLevel::SSE2:	return "SSE2";
+	case SimdLevel::AVX2:	return "AVX2";
+	case SimdLevel::NEON:	return "NEON";
+	default:				return "Unknown";
+	}
+}
+
+} //end namespace media
@@ -2,9 +2,45 @@
 #include "cinder/Log.h"
 
 #include "DeckLinkDevice.h"
+#include "ImageResampler.h"
+#include "VideoConversion.h"
+
+#include <algorithm>
+#include <chrono>
 
 using namespace media;
 
+namespace {
+	// Converted frames in flight: the one being filled plus the ones consumers still hold.
+	const size_t kFramePoolCapacity = 3;
+	// More stripes than cores evens out the load when a core is busy with something else.
+	const size_t kStripesPerThread = 2;
+	const BMDTimeScale kMicrosecondTimeScale = 1000000;
+	// Multiple of 48 kHz and of every SDI frame rate (1001 variants included), so frame boundaries land on exact audio positions.
+	const BMDTimeScale kStreamTimeScale = 240000;
+	const BMDTimeScale kAudioSampleRate = 48000;
+	// Shortest watchdog timer period, for modes whose frame duration is not known.
+	const int64_t kMinWatchdogPeriodUs = 1000;
+	// Frame arrivals waiting for the watchdog thread, which drains them every half frame.
+	const size_t kWatchdogArrivalCapacity = 64;
+
+	int64_t getHostTimeUs()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	bool getPackedRGBFormat( BMDPixelFormat pixelFormat, PackedRGBFormat * format )
+	{
+		switch( pixelFormat ) {
+		case bmdFormat10BitRGB:		*format = PackedRGBFormat::R210; return true;
+		case bmdFormat10BitRGBX:	*format = PackedRGBFormat::R10B; return true;
+		case bmdFormat10BitRGBXLE:	*format = PackedRGBFormat::R10L; return true;
+		case bmdFormat12BitRGB:		*format = PackedRGBFormat::R12B; return true;
+		case bmdFormat12BitRGBLE:	*format = PackedRGBFormat::R12L; return true;
+		default:					return false;
+		}
+	}
+}
 
 glm::ivec2 DeckLinkInput::getDisplayModeResolution( BMDDisplayMode mode )
 {
@@ -17,6 +53,36 @@ glm::ivec2 DeckLinkInput::getDisplayModeResolution( BMDDisplayMode mode )
 	return glm::ivec2( 0 );
 }
 
+int64_t DeckLinkInput::getDisplayModeFrameDurationUs( BMDDisplayMode mode )
+{
+	for( const auto& decklinkMode : mModesList ) {
+		BMDTimeValue frameDuration;
+		BMDTimeScale timeScale;
+		if( decklinkMode->GetDisplayMode() == mode && decklinkMode->GetFrameRate( &frameDuration, &timeScale ) == S_OK && timeScale > 0 )
+			return frameDuration * kMicrosecondTimeScale / timeScale;
+	}
+	return 0;
+}
+
+void DeckLinkInput::resizeFramePool( const glm::ivec2& resolution )
+{
+	const size_t frameBytes = resolution.x * resolution.y * 4;
+	if( ! mFramePool )
+		mFramePool = VideoFramePool::create( frameBytes, kFramePoolCapacity );
+	else
+		mFramePool->resize( frameBytes );
+}
+
+PooledFrameBufferRef DeckLinkInput::acquireFrameBuffer( long width, long height )
+{
+	const size_t frameBytes = width * height * 4;
+	if( mFramePool && mFramePool->getBufferSize() == frameBytes )
+		return mFramePool->acquire();
+
+	// Frame arrived before the pool caught up with a mode change.
+	return PooledFrameBuffer::create( frameBytes );
+}
+
 DeckLinkInput::DeckLinkInput( DeckLinkDevice * device )
 : mDevice{ device }
 , mDecklinkInput( NULL )
@@ -24,6 +90,15 @@ DeckLinkInput::DeckLinkInput( DeckLinkDevice * device )
 , mCurrentlyCapturing{ false }
 , mUseYUVTexture{ false }
 , mResolution{}
+, mPixelFormat{ bmdFormat8BitYUV }
+, mFrameDelivery{ FrameDelivery::SIGNAL }
+, mEnqueueLatencyLastNs{ 0 }
+, mEnqueueLatencyMaxNs{ 0 }
+, mEnqueueLatencySumNs{ 0 }
+, mEnqueueCount{ 0 }
+, mFramesSkipped{ 0 }
+, mFrameAllocator{ DeckLinkMemoryAllocator::create() }
+, mWatchdogActive{ false }
 {
 
 	IDeckLinkAttributes* deckLinkAttributes = NULL;
@@ -61,32 +136,74 @@ DeckLinkInput::~DeckLinkInput()
 	}
 }
 
-bool DeckLinkInput::start( BMDDisplayMode videoMode, bool useYUVTexture )
+bool DeckLinkInput::start( BMDDisplayMode videoMode, bool useYUVTexture, BMDPixelFormat pixelFormat )
 {
 	if( mCurrentlyCapturing ) {
 		CI_LOG_W( "Already capturing, aborting start." );
 		return false;
 	}
 
+	if( pixelFormat != bmdFormat8BitYUV && pixelFormat != bmdFormat10BitYUV ) {
+		CI_LOG_E( "Unsupported capture pixel format." );
+		return false;
+	}
+
 	BMDVideoInputFlags videoInputFlags = bmdVideoInputFlagDefault;
 	if( mDevice->isFormatDetectionSupported() )
 		videoInputFlags |= bmdVideoInputEnableFormatDetection;
 
+	if( mDecklinkInput->SetVideoInputFrameMemoryAllocator( mFrameAllocator.get() ) != S_OK )
+		CI_LOG_W( "Unable to install the capture frame allocator, frames will use driver memory." );
+
 	// Set the video input mode
-	if( mDecklinkInput->EnableVideoInput( videoMode, bmdFormat8BitYUV, videoInputFlags ) != S_OK ) {
+	if( mDecklinkInput->EnableVideoInput( videoMode, pixelFormat, videoInputFlags ) != S_OK ) {
 		CI_LOG_E( "This application was unable to select the chosen video mode. Perhaps, the selected device is currently in-use." );
 		return false;
 	}
 
+	mPixelFormat = pixelFormat;
+	mResolution = getDisplayModeResolution( videoMode );
+	resizeFramePool( mResolution );
+
+	if( mAudioOptions.enabled ) {
+		if( mDecklinkInput->EnableAudioInput( bmdAudioSampleRate48kHz, mAudioOptions.sampleType, mAudioOptions.channels ) != S_OK ) {
+			CI_LOG_E( "This application was unable to enable audio capture with " << mAudioOptions.channels << " channels." );
+			return false;
+		}
+		const size_t bytesPerSample = mAudioOptions.sampleType == bmdAudioSampleType32bitInteger ? 4 : 2;
+		const size_t capacity = size_t( std::max( mAudioOptions.bufferSeconds, 0.1 ) * kAudioSampleRate );
+		AudioRingBufferRef buffer = AudioRingBuffer::create( mAudioOptions.channels, bytesPerSample, capacity );
+		if( ! buffer ) {
+			CI_LOG_E( "Audio capture needs sample frames of whole 32-bit words, " << mAudioOptions.channels << " channels do not make one." );
+			mDecklinkInput->DisableAudioInput();
+			return false;
+		}
+		std::atomic_store( &mAudioBuffer, buffer );
+		AudioMeterRef meter;
+		if( mAudioOptions.metering ) {
+			meter = AudioMeter::create( mAudioOptions.meterOptions );
+			meter->reset( mAudioOptions.channels, double( kAudioSampleRate ) );
+		}
+		std::atomic_store( &mAudioMeter, meter );
+	}
+	else {
+		mDecklinkInput->DisableAudioInput();
+		std::atomic_store( &mAudioBuffer, AudioRingBufferRef() );
+		std::atomic_store( &mAudioMeter, AudioMeterRef() );
+	}
+
+	if( mWatchdogOptions.enabled ) {
+		prepareSubstituteFrames( mResolution, pixelFormat );
+		startWatchdog( getDisplayModeFrameDurationUs( videoMode ) );
+	}
+
 	// Start the capture
 	if( mDecklinkInput->StartStreams() != S_OK ) {
 		CI_LOG_E( "This application was unable to start the capture. Perhaps, the selected device is currently in-use." );
+		stopWatchdog();
 		return false;
 	}
 
-
-	mResolution = getDisplayModeResolution( videoMode );
-
 	// Set capture callback
 	mDecklinkInput->SetCallback( this );
 	mCurrentlyCapturing = true;
@@ -104,6 +221,7 @@ void DeckLinkInput::stop()
 		mDecklinkInput->SetCallback( NULL );
 	}
 
+	stopWatchdog();
 	mCurrentlyCapturing = false;
 }
 
@@ -115,7 +233,7 @@ bool DeckLinkInput::isCapturing()
 HRESULT DeckLinkInput::VideoInputFormatChanged(/* in */ BMDVideoInputFormatChangedEvents notificationEvents, /* in */ IDeckLinkDisplayMode *newMode, /* in */ BMDDetectedVideoInputFormatFlags detectedSignalFlags ) {
 
 	unsigned int	modeIndex = 0;
-	BMDPixelFormat	pixelFormat = bmdFormat8BitYUV;
+	BMDPixelFormat	pixelFormat = mPixelFormat;
 
 	// Restart capture with the new video mode if told to
 	if( mDevice->isFormatDetectionSupported() ) {
@@ -143,32 +261,519 @@ HRESULT DeckLinkInput::VideoInputFormatChanged(/* in */ BMDVideoInputFormatChang
 	}
 	
 	mResolution = glm::ivec2( newMode->GetWidth(), newMode->GetHeight() );
+	resizeFramePool( mResolution );
+
+	if( mWatchdogOptions.enabled ) {
+		BMDTimeValue frameDuration;
+		BMDTimeScale timeScale;
+		if( newMode->GetFrameRate( &frameDuration, &timeScale ) == S_OK && timeScale > 0 ) {
+			std::lock_guard<std::mutex> lock( mWatchdogMutex );
+			mWatchdog.setFrameDuration( frameDuration * kMicrosecondTimeScale / timeScale );
+		}
+		prepareSubstituteFrames( mResolution, pixelFormat );
+	}
 
 	return S_OK;
 }
 
 HRESULT DeckLinkInput::VideoInputFrameArrived( IDeckLinkVideoInputFrame* frame, IDeckLinkAudioInputPacket* audioPacket )
 {
+	if( audioPacket != NULL && mRawAudioCallback )
+		mRawAudioCallback( audioPacket );
+	// Same atomic access as the readers, start() may swap them while a late callback of the previous capture runs.
+	const AudioRingBufferRef audioBuffer = audioPacket != NULL ? std::atomic_load( &mAudioBuffer ) : AudioRingBufferRef();
+	if( audioBuffer ) {
+		void * samples = NULL;
+		BMDTimeValue packetTime;
+		if( audioPacket->GetBytes( &samples ) == S_OK && audioPacket->GetPacketTime( &packetTime, kAudioSampleRate ) == S_OK ) {
+			const size_t sampleFrames = size_t( audioPacket->GetSampleFrameCount() );
+			audioBuffer->write( packetTime, samples, sampleFrames );
+			const AudioMeterRef meter = std::atomic_load( &mAudioMeter );
+			if( meter ) {
+				if( mAudioOptions.sampleType == bmdAudioSampleType32bitInteger )
+					meter->process( (const int32_t*)samples, sampleFrames );
+				else
+					meter->process( (const int16_t*)samples, sampleFrames );
+			}
+		}
+	}
+
 	if( frame == NULL )
 		return S_OK;
 
+	const bool hasSignal = ( frame->GetFlags() & bmdFrameHasNoInputSource ) == 0;
+	if( mWatchdogOptions.enabled ) {
+		// The watchdog thread feeds the arrival to the watchdog on its next tick, the callback takes no lock for it.
+		WatchdogArrival arrival;
+		arrival.hasSignal = hasSignal;
+		arrival.timeUs = getHostTimeUs();
+		mWatchdogArrivals->tryPush( arrival );
+		// Keeps the cadence of the card, it still calls back once per frame.
+		if( ! hasSignal )
+			deliverSubstituteFrame( false );
+	}
+
+	if( ! hasSignal )
+		return S_FALSE;
+
+	if( mRawFrameCallback ) {
+		mRawFrameCallback( frame );
+		// Forwarded without a preview, there is no one to convert for.
+		if( mFrameDelivery == FrameDelivery::SIGNAL && mSignalFrame.getNumSlots() == 0 )
+			return S_OK;
+	}
+
+	if( mFrameDelivery == FrameDelivery::QUEUE ) {
+		const auto arrival = std::chrono::steady_clock::now();
+
+		// Nothing but a reference goes through the queue, the consumer converts when it pops.
+		QueuedFrame queued;
+		queued.frame = RefPtr<IDeckLinkVideoInputFrame>( frame );
+		queued.timeUs = getHostTimeUs();
+		mFrameQueue->tryPush( std::move( queued ) );
+
+		const uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - arrival ).count();
+		mEnqueueLatencyLastNs = latency;
+		mEnqueueLatencySumNs += latency;
+		++mEnqueueCount;
+		uint64_t maxLatency = mEnqueueLatencyMaxNs;
+		while( latency > maxLatency && ! mEnqueueLatencyMaxNs.compare_exchange_weak( maxLatency, latency ) ) { }
+		return S_OK;
+	}
+
 	std::lock_guard<std::mutex> lock( mFrameMutex );
+	FrameEvent frameEvent = createFrameEvent( frame );
+	mSignalFrame.emit( frameEvent );
+	return S_OK;
+}
+
+FrameEvent DeckLinkInput::createFrameEvent( IDeckLinkVideoInputFrame* frame )
+{
+	FrameEvent frameEvent = mUseYUVTexture ? FrameEvent{ frame } : FrameEvent{ frame->GetWidth(), frame->GetHeight(), acquireFrameBuffer( frame->GetWidth(), frame->GetHeight() ) };
+	if( ! mUseYUVTexture )
+		convertFrame( frame, frameEvent.surfaceData );
+	// Also runs on the consumer thread with queue delivery.
+	if( std::atomic_load( &mAudioBuffer ) )
+		setAudioSpan( frame, frameEvent );
+
+	if( mWatchdogOptions.enabled && mWatchdogOptions.substitution == LossSubstitution::FREEZE ) {
+		std::lock_guard<std::mutex> lock( mSubstituteMutex );
+		mLastGoodFrame = frameEvent.frame;
+	}
+	return frameEvent;
+}
 
-	if( (frame->GetFlags() & bmdFrameHasNoInputSource) == 0 ) {
+FrameEvent DeckLinkInput::createQueuedFrameEvent( const QueuedFrame& queued )
+{
+	if( ! queued.frame ) {
+		FrameEvent frameEvent{ queued.substitute };
+		frameEvent.substituted = true;
+		return frameEvent;
+	}
+
+	FrameEvent frameEvent = createFrameEvent( queued.frame.get() );
+	// Converted events are done with the capture frame, it goes back to the driver with the queue entry.
+	if( frameEvent.dataPointer )
+		frameEvent.mFrameRef = queued.frame;
+	return frameEvent;
+}
+
+void DeckLinkInput::convertFrame( IDeckLinkVideoInputFrame* frame, VideoFrameBGRA& dest )
+{
+	void * bytes = NULL;
+	const BMDPixelFormat pixelFormat = frame->GetPixelFormat();
+	PackedRGBFormat packedFormat;
+	const bool packedRGB = getPackedRGBFormat( pixelFormat, &packedFormat );
+	if( ( pixelFormat != bmdFormat8BitYUV && pixelFormat != bmdFormat10BitYUV && ! packedRGB ) || frame->GetBytes( &bytes ) != S_OK ) {
+		// Formats without a kernel still go through the SDK.
+		DeckLinkDeviceDiscovery::sVideoConverter->ConvertFrame( frame, &dest );
+		return;
+	}
+
+	const uint8_t * src = (const uint8_t*)bytes;
+	const size_t srcRowBytes = frame->GetRowBytes();
+	const size_t dstRowBytes = dest.GetRowBytes();
+	const long width = frame->GetWidth();
+	const long height = frame->GetHeight();
+	const YCbCrMatrix matrix = getDefaultYCbCrMatrix( height );
+
+	auto convertRows = [&]( size_t rowBegin, size_t rowEnd ) {
+		const uint8_t * srcRows = src + rowBegin * srcRowBytes;
+		uint8_t * dstRows = dest.data() + rowBegin * dstRowBytes;
+		const long rows = long( rowEnd - rowBegin );
+		if( packedRGB )
+			convertPackedRGBToBGRA( packedFormat, srcRows, srcRowBytes, dstRows, dstRowBytes, width, rows );
+		else if( pixelFormat == bmdFormat10BitYUV )
+			convertV210ToBGRA( srcRows, srcRowBytes, dstRows, dstRowBytes, width, rows, matrix );
+		else
+			convertUYVYToBGRA( srcRows, srcRowBytes, dstRows, dstRowBytes, width, rows, matrix );
+	};
+
+	WorkerPoolRef pool = std::atomic_load( &mConversionPool );
+	if( ! pool ) {
+		convertRows( 0, size_t( height ) );
+		return;
+	}
+
+	pool->parallelForRanges( height, pool->getConcurrency() * kStripesPerThread, convertRows );
+}
+
+void DeckLinkInput::setRawFrameCallback( const RawFrameCallback& callback )
+{
+	if( mCurrentlyCapturing ) {
+		CI_LOG_W( "Cannot change the raw frame callback while capturing." );
+		return;
+	}
+
+	mRawFrameCallback = callback;
+}
+
+void DeckLinkInput::setConversionThreads( size_t numThreads, const std::vector<int>& cpuAffinity )
+{
+	WorkerPoolRef pool;
+	if( numThreads > 1 )
+		pool = WorkerPool::create( numThreads - 1, cpuAffinity );
+
+	// The previous pool joins its threads once the callback thread is done with it.
+	std::atomic_store( &mConversionPool, pool );
+}
+
+size_t DeckLinkInput::getConversionThreads() const
+{
+	WorkerPoolRef pool = std::atomic_load( &mConversionPool );
+	return pool ? pool->getConcurrency() : 1;
+}
+
+void DeckLinkInput::setFrameMemoryOptions( const MemoryAllocatorOptions& options )
+{
+	if( mCurrentlyCapturing ) {
+		CI_LOG_W( "Cannot change the frame memory options while capturing." );
+		return;
+	}
+
+	// The driver keeps its own reference on the previous allocator until the next one is installed.
+	mFrameAllocator = DeckLinkMemoryAllocator::create( options );
+}
+
+void DeckLinkInput::setWatchdogOptions( const InputWatchdogOptions& options )
+{
+	if( mCurrentlyCapturing ) {
+		CI_LOG_W( "Cannot change the watchdog options while capturing." );
+		return;
+	}
+
+	mWatchdogOptions = options;
+	mWatchdog = InputWatchdog( options.timeoutFrames );
+}
+
+InputSignalState DeckLinkInput::getSignalState() const
+{
+	std::lock_guard<std::mutex> lock( mWatchdogMutex );
+	return mWatchdog.getState();
+}
+
+InputWatchdogStats DeckLinkInput::getWatchdogStats() const
+{
+	std::lock_guard<std::mutex> lock( mWatchdogMutex );
+	return mWatchdog.getStats();
+}
+
+void DeckLinkInput::startWatchdog( int64_t frameDurationUs )
+{
+	// Called before the streams start, nothing pushes arrivals yet.
+	mWatchdogArrivals.reset( new SpscQueue<WatchdogArrival>( kWatchdogArrivalCapacity ) );
+	{
+		std::lock_guard<std::mutex> lock( mWatchdogMutex );
+		mWatchdog.reset( frameDurationUs, getHostTimeUs() );
+		mWatchdogActive = true;
+	}
+	mWatchdogThread = std::thread( &DeckLinkInput::watchdogLoop, this );
+}
+
+void DeckLinkInput::stopWatchdog()
+{
+	{
+		std::lock_guard<std::mutex> lock( mWatchdogMutex );
+		mWatchdogActive = false;
+	}
+	mWatchdogCondition.notify_all();
+	if( mWatchdogThread.joinable() )
+		mWatchdogThread.join();
+
+	std::lock_guard<std::mutex> lock( mSubstituteMutex );
+	mLastGoodFrame = InputFrame();
+	mSubstituteBGRA = InputFrame();
+	mSubstituteYUV = InputFrame();
+}
 
-		if( mUseYUVTexture ) {
-			FrameEvent frameEvent{ frame };
-			mSignalFrame.emit( frameEvent );
+void DeckLinkInput::watchdogLoop()
+{
+	std::unique_lock<std::mutex> lock( mWatchdogMutex );
+	bool substitute = false;
+	while( mWatchdogActive ) {
+		// Half a frame between checks. A late timer can leave a second substitute due right away, so no wait then.
+		if( ! substitute )
+			mWatchdogCondition.wait_for( lock, std::chrono::microseconds( std::max( mWatchdog.getFrameDurationUs() / 2, kMinWatchdogPeriodUs ) ) );
+		if( ! mWatchdogActive )
+			break;
+
+		// Arrivals first, in the order the callback pushed them, so that the tick sees the latest one.
+		WatchdogArrival arrival;
+		while( mWatchdogArrivals->tryPop( arrival ) )
+			mWatchdog.onFrame( arrival.hasSignal, arrival.timeUs );
+		substitute = mWatchdog.onTick( getHostTimeUs() );
+		// Several arrivals can change the state back and forth within one tick, every transition is reported.
+		const std::vector<InputSignalEvent> events = mWatchdog.popEvents();
+
+		lock.unlock();
+		emitWatchdogEvents( events );
+		if( substitute )
+			deliverSubstituteFrame( true );
+		lock.lock();
+	}
+}
+
+void DeckLinkInput::emitWatchdogEvents( const std::vector<InputSignalEvent>& events )
+{
+	for( const auto& event : events ) {
+		if( event.state == InputSignalState::NO_SIGNAL )
+			CI_LOG_W( "Input signal lost." );
+		else if( event.state == InputSignalState::STALLED )
+			CI_LOG_W( "Input stalled, no frame for " << event.outageUs / 1000 << " ms." );
+		mSignalWatchdog.emit( event );
+	}
+}
+
+void DeckLinkInput::prepareSubstituteFrames( const glm::ivec2& resolution, BMDPixelFormat pixelFormat )
+{
+	InputFrame bgra, yuv;
+	if( mWatchdogOptions.substitution != LossSubstitution::NONE && resolution.x > 0 && resolution.y > 0 ) {
+		const long width = resolution.x;
+		const long height = resolution.y;
+		const size_t rowBytes = size_t( width ) * 4;
+		PooledFrameBufferRef pixels = PooledFrameBuffer::create( rowBytes * height );
+
+		const ci::Surface8uRef& slate = mWatchdogOptions.slate;
+		if( mWatchdogOptions.substitution == LossSubstitution::SLATE && slate && slate->getWidth() > 0 && slate->getHeight() > 0 ) {
+			// Any channel order goes through a BGRX copy first. SDI carries no alpha, the slate is made opaque.
+			ci::Surface8u source( slate->getWidth(), slate->getHeight(), false, ci::SurfaceChannelOrder::BGRX );
+			source.copyFrom( *slate, slate->getBounds() );
+			ImageResampler resampler;
+			resampler.setup( source.getWidth(), source.getHeight(), PixelLayout::BGRX, width, height );
+			resampler.resample( source.getData(), source.getRowBytes(), pixels->data(), rowBytes, 0, height );
 		}
 		else {
-			FrameEvent frameEvent{ frame->GetWidth(), frame->GetHeight() };
-			DeckLinkDeviceDiscovery::sVideoConverter->ConvertFrame( frame, &frameEvent.surfaceData );
-			mSignalFrame.emit( frameEvent );
+			const uint8_t black[4] = { 0, 0, 0, 255 };
+			for( size_t i = 0; i < rowBytes * height; i += 4 )
+				std::memcpy( pixels->data() + i, black, 4 );
+		}
+		bgra = InputFrame( pixels, width, height, long( rowBytes ), bmdFormat8BitBGRA );
+
+		// Only the YUV capture formats can be encoded, other formats from format detection get no YUV substitute.
+		const YCbCrMatrix matrix = getDefaultYCbCrMatrix( height );
+		if( pixelFormat == bmdFormat8BitYUV ) {
+			const long yuvRowBytes = width * 2;
+			PooledFrameBufferRef encoded = PooledFrameBuffer::create( size_t( yuvRowBytes ) * height );
+			convertBGRAToUYVY( pixels->data(), rowBytes, encoded->data(), yuvRowBytes, width, height, matrix );
+			yuv = InputFrame( PooledVideoInputFrame::create( encoded, width, height, yuvRowBytes, pixelFormat ) );
 		}
+		else if( pixelFormat == bmdFormat10BitYUV ) {
+			const long yuvRowBytes = long( getV210RowBytes( width ) );
+			PooledFrameBufferRef encoded = PooledFrameBuffer::create( size_t( yuvRowBytes ) * height );
+			std::memset( encoded->data(), 0, size_t( yuvRowBytes ) * height );
+			convertBGRAToV210( pixels->data(), rowBytes, encoded->data(), yuvRowBytes, width, height, matrix );
+			yuv = InputFrame( PooledVideoInputFrame::create( encoded, width, height, yuvRowBytes, pixelFormat ) );
+		}
+	}
 
-		return S_OK;
+	std::lock_guard<std::mutex> lock( mSubstituteMutex );
+	mSubstituteBGRA = bgra;
+	mSubstituteYUV = yuv;
+	// A frozen frame from the previous mode would not match the new one.
+	mLastGoodFrame = InputFrame();
+}
+
+void DeckLinkInput::deliverSubstituteFrame( bool watchdogThread )
+{
+	if( mWatchdogOptions.substitution == LossSubstitution::NONE )
+		return;
+
+	InputFrame frame;
+	{
+		std::lock_guard<std::mutex> lock( mSubstituteMutex );
+		const bool freeze = mWatchdogOptions.substitution == LossSubstitution::FREEZE && mLastGoodFrame;
+		frame = freeze ? mLastGoodFrame : ( mUseYUVTexture ? mSubstituteYUV : mSubstituteBGRA );
+		if( ! frame )
+			return;
+	}
+	{
+		// Only during an outage, the callback thread never takes this lock for frames with a signal.
+		std::lock_guard<std::mutex> lock( mWatchdogMutex );
+		mWatchdog.onSubstituted();
+	}
+
+	if( mFrameDelivery == FrameDelivery::QUEUE ) {
+		QueuedFrame queued;
+		queued.substitute = frame;
+		queued.timeUs = getHostTimeUs();
+		( watchdogThread ? mStallQueue : mFrameQueue )->tryPush( std::move( queued ) );
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( mFrameMutex );
+	FrameEvent frameEvent{ frame };
+	frameEvent.substituted = true;
+	mSignalFrame.emit( frameEvent );
+}
+
+void DeckLinkInput::setAudioSpan( IDeckLinkVideoInputFrame* frame, FrameEvent& frameEvent )
+{
+	BMDTimeValue frameTime, frameDuration;
+	if( frame->GetStreamTime( &frameTime, &frameDuration, kStreamTimeScale ) != S_OK )
+		return;
+
+	// Both ends round down, so consecutive frames tile the audio without gap or overlap (1601 and 1602 samples at 29.97).
+	const int64_t begin = frameTime * kAudioSampleRate / kStreamTimeScale;
+	const int64_t end = ( frameTime + frameDuration ) * kAudioSampleRate / kStreamTimeScale;
+	frameEvent.audioPosition = begin;
+	frameEvent.audioSampleFrames = long( end - begin );
+}
+
+void DeckLinkInput::setAudioCaptureOptions( const AudioCaptureOptions& options )
+{
+	if( mCurrentlyCapturing ) {
+		CI_LOG_W( "Cannot change the audio capture options while capturing." );
+		return;
+	}
+
+	mAudioOptions = options;
+}
+
+bool DeckLinkInput::readAudio( const FrameEvent& frameEvent, void * dst ) const
+{
+	return frameEvent.audioSampleFrames > 0 && readAudio( frameEvent.audioPosition, frameEvent.audioSampleFrames, dst );
+}
+
+bool DeckLinkInput::readAudio( int64_t position, long sampleFrames, void * dst ) const
+{
+	AudioRingBufferRef buffer = std::atomic_load( &mAudioBuffer );
+	return buffer && sampleFrames >= 0 && buffer->read( position, size_t( sampleFrames ), dst );
+}
+
+bool DeckLinkInput::readAudioFloat( const FrameEvent& frameEvent, float * const * dst, size_t dstChannels, const int * routing ) const
+{
+	return frameEvent.audioSampleFrames > 0 && readAudioFloat( frameEvent.audioPosition, frameEvent.audioSampleFrames, dst, dstChannels, routing );
+}
+
+bool DeckLinkInput::readAudioFloat( int64_t position, long sampleFrames, float * const * dst, size_t dstChannels, const int * routing ) const
+{
+	AudioRingBufferRef buffer = std::atomic_load( &mAudioBuffer );
+	if( ! buffer || sampleFrames < 0 || dstChannels > kMaxAudioChannels )
+		return false;
+
+	const size_t channels = buffer->getChannels();
+	const bool wide = buffer->getBytesPerSample() == 4;
+	return buffer->visit( position, size_t( sampleFrames ), [&]( const uint8_t * frames, size_t offset, size_t count ) {
+		float * planes[kMaxAudioChannels];
+		for( size_t i = 0; i < dstChannels; ++i )
+			planes[i] = dst[i] + offset;
+		if( wide )
+			convertAudioToFloat( (const int32_t*)frames, channels, count, planes, dstChannels, routing );
+		else
+			convertAudioToFloat( (const int16_t*)frames, channels, count, planes, dstChannels, routing );
+	} );
+}
+
+void DeckLinkInput::setRawAudioCallback( const RawAudioCallback& callback )
+{
+	if( mCurrentlyCapturing ) {
+		CI_LOG_W( "Cannot change the raw audio callback while capturing." );
+		return;
 	}
-	return S_FALSE;
+
+	mRawAudioCallback = callback;
+}
+
+AudioBufferStats DeckLinkInput::getAudioStats() const
+{
+	AudioRingBufferRef buffer = std::atomic_load( &mAudioBuffer );
+	return buffer ? buffer->getStats() : AudioBufferStats();
+}
+
+AudioLevels DeckLinkInput::getAudioLevels() const
+{
+	AudioMeterRef meter = std::atomic_load( &mAudioMeter );
+	return meter ? meter->getLevels() : AudioLevels();
+}
+
+void DeckLinkInput::setFrameDelivery( FrameDelivery delivery, size_t queueCapacity )
+{
+	if( mCurrentlyCapturing ) {
+		CI_LOG_W( "Cannot change the frame delivery while capturing." );
+		return;
+	}
+
+	mFrameDelivery = delivery;
+	if( delivery == FrameDelivery::QUEUE ) {
+		mFrameQueue.reset( new SpscQueue<QueuedFrame>( queueCapacity ) );
+		mStallQueue.reset( new SpscQueue<QueuedFrame>( queueCapacity ) );
+	}
+	else {
+		mFrameQueue.reset();
+		mStallQueue.reset();
+	}
+}
+
+bool DeckLinkInput::popQueuedFrame( QueuedFrame& queued )
+{
+	if( ! mFrameQueue )
+		return false;
+
+	return tryPopOlder( *mFrameQueue, *mStallQueue, queued, []( const QueuedFrame& a, const QueuedFrame& b ) { return a.timeUs < b.timeUs; } );
+}
+
+bool DeckLinkInput::tryPopFrame( FrameEvent& frameEvent )
+{
+	QueuedFrame queued;
+	if( ! popQueuedFrame( queued ) )
+		return false;
+
+	frameEvent = createQueuedFrameEvent( queued );
+	return true;
+}
+
+bool DeckLinkInput::tryPopLatestFrame( FrameEvent& frameEvent )
+{
+	// The skipped frames go straight back to the driver, never converted.
+	QueuedFrame queued;
+	if( ! popQueuedFrame( queued ) )
+		return false;
+
+	while( popQueuedFrame( queued ) )
+		++mFramesSkipped;
+
+	frameEvent = createQueuedFrameEvent( queued );
+	return true;
+}
+
+FrameQueueStats DeckLinkInput::getFrameQueueStats() const
+{
+	FrameQueueStats stats;
+	if( ! mFrameQueue )
+		return stats;
+
+	stats.depth = mFrameQueue->size() + mStallQueue->size();
+	stats.capacity = mFrameQueue->capacity();
+	stats.pushed = mFrameQueue->getPushCount() + mStallQueue->getPushCount();
+	stats.popped = mFrameQueue->getPopCount() + mStallQueue->getPopCount();
+	stats.overflows = mFrameQueue->getOverflowCount() + mStallQueue->getOverflowCount();
+	stats.skipped = mFramesSkipped;
+
+	const uint64_t count = mEnqueueCount;
+	stats.lastEnqueueLatencyUs = mEnqueueLatencyLastNs * 1e-3;
+	stats.maxEnqueueLatencyUs = mEnqueueLatencyMaxNs * 1e-3;
+	stats.meanEnqueueLatencyUs = count ? mEnqueueLatencySumNs * 1e-3 / count : 0.0;
+	return stats;
 }
 
 void DeckLinkInput::getAncillaryDataFromFrame( IDeckLinkVideoInputFrame* videoFrame, BMDTimecodeFormat timecodeFormat, std::string& timecodeString, std::string& userBitsString ) {
@@ -255,3 +860,74 @@ void VideoFrameBGRA::getSurface( ci::SurfaceRef & surface )
 	}
 	std::memcpy( surface->getData(), data(), GetRowBytes() * GetHeight() );
 }
+
+InputFrame::InputFrame( RefPtr<IDeckLinkVideoInputFrame> frame )
+	: mDeckLinkFrame{ std::move( frame ) }
+	, mWidth{ 0 }
+	, mHeight{ 0 }
+	, mRowBytes{ 0 }
+	, mPixelFormat{ bmdFormat8BitYUV }
+	, mData{ nullptr }
+{
+	void * bytes = NULL;
+	if( mDeckLinkFrame && mDeckLinkFrame->GetBytes( &bytes ) == S_OK ) {
+		mWidth = mDeckLinkFrame->GetWidth();
+		mHeight = mDeckLinkFrame->GetHeight();
+		mRowBytes = mDeckLinkFrame->GetRowBytes();
+		mPixelFormat = mDeckLinkFrame->GetPixelFormat();
+		mData = (const uint8_t*)bytes;
+	}
+}
+
+InputFrame::InputFrame( PooledFrameBufferRef buffer, long width, long height, long rowBytes, BMDPixelFormat pixelFormat )
+	: mBuffer{ std::move( buffer ) }
+	, mWidth{ width }
+	, mHeight{ height }
+	, mRowBytes{ rowBytes }
+	, mPixelFormat{ pixelFormat }
+	, mData{ mBuffer ? mBuffer->data() : nullptr }
+{
+}
+
+ci::SurfaceRef InputFrame::createSurface() const
+{
+	if( ! mData )
+		return nullptr;
+
+	long width = mWidth;
+	ci::SurfaceChannelOrder channelOrder = ci::SurfaceChannelOrder::BGRA;
+	if( mPixelFormat == bmdFormat8BitYUV ) {
+		width = mWidth / 2;
+		channelOrder = ci::SurfaceChannelOrder::RGBA;
+	}
+	else if( mPixelFormat != bmdFormat8BitBGRA ) {
+		CI_LOG_E( "No surface layout for this pixel format." );
+		return nullptr;
+	}
+
+	// The deleter owns a copy of this handle, so the pixels outlive the surface.
+	InputFrame self = *this;
+	return ci::SurfaceRef( new ci::Surface8u( const_cast<uint8_t*>( mData ), width, mHeight, mRowBytes, channelOrder ), [self]( ci::Surface8u * surface ) {
+		delete surface;
+	} );
+}
+
+ci::Surface16uRef InputFrame::createSurface16u() const
+{
+	if( ! mData )
+		return nullptr;
+
+	PackedRGBFormat packedFormat;
+	const bool packedRGB = getPackedRGBFormat( mPixelFormat, &packedFormat );
+	if( ! packedRGB && mPixelFormat != bmdFormat10BitYUV ) {
+		CI_LOG_E( "Only 10 and 12-bit frames convert to a 16-bit surface." );
+		return nullptr;
+	}
+
+	auto surface = ci::Surface16u::create( mWidth, mHeight, true, ci::SurfaceChannelOrder::RGBA );
+	if( packedRGB )
+		convertPackedRGBToRGBA16( packedFormat, mData, mRowBytes, surface->getData(), surface->getRowBytes(), mWidth, mHeight );
+	else
+		convertV210ToRGBA16( mData, mRowBytes, surface->getData(), surface->getRowBytes(), mWidth, mHeight, getDefaultYCbCrMatrix( mHeight ) );
+	return surface;
+}
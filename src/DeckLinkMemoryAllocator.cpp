@@ -0,0 +1,77 @@
+#include "DeckLinkMemoryAllocator.h"
+
+using namespace media;
+
+DeckLinkMemoryAllocatorRef DeckLinkMemoryAllocator::create( const MemoryAllocatorOptions& options )
+{
+	return DeckLinkMemoryAllocatorRef::adopt( new DeckLinkMemoryAllocator{ options } );
+}
+
+DeckLinkMemoryAllocator::DeckLinkMemoryAllocator( const MemoryAllocatorOptions& options )
+	: mCache( options )
+	, m_refCount{ 1 }
+{
+}
+
+DeckLinkMemoryAllocator::~DeckLinkMemoryAllocator()
+{
+}
+
+HRESULT DeckLinkMemoryAllocator::AllocateBuffer( unsigned int bufferSize, void **allocatedBuffer )
+{
+	if( allocatedBuffer == NULL )
+		return E_POINTER;
+
+	*allocatedBuffer = mCache.allocate( bufferSize );
+	return *allocatedBuffer ? S_OK : E_OUTOFMEMORY;
+}
+
+HRESULT DeckLinkMemoryAllocator::ReleaseBuffer( void *buffer )
+{
+	return mCache.release( buffer ) ? S_OK : E_INVALIDARG;
+}
+
+HRESULT DeckLinkMemoryAllocator::Commit()
+{
+	mCache.commit();
+	return S_OK;
+}
+
+HRESULT DeckLinkMemoryAllocator::Decommit()
+{
+	mCache.decommit();
+	return S_OK;
+}
+
+HRESULT	STDMETHODCALLTYPE DeckLinkMemoryAllocator::QueryInterface( REFIID iid, LPVOID *ppv )
+{
+	if( ppv == NULL )
+		return E_INVALIDARG;
+
+	*ppv = NULL;
+	if( iid == IID_IUnknown || iid == IID_IDeckLinkMemoryAllocator ) {
+		*ppv = (IDeckLinkMemoryAllocator*)this;
+		AddRef();
+		return S_OK;
+	}
+	return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE DeckLinkMemoryAllocator::AddRef( void )
+{
+	return InterlockedIncrement( (LONG*)&m_refCount );
+}
+
+ULONG STDMETHODCALLTYPE DeckLinkMemoryAllocator::Release( void )
+{
+	int		newRefValue;
+
+	newRefValue = InterlockedDecrement( (LONG*)&m_refCount );
+	if( newRefValue == 0 )
+	{
+		delete this;
+		return 0;
+	}
+
+	return newRefValue;
+}
@@ -1,15 +1,95 @@
 #include "cinder/app/App.h"
 #include "cinder/Log.h"
 
-#include "cinder/ip/Resize.h"
-
 #include "DeckLinkOutput.h"
 #include "DeckLinkDevice.h"
 
+#include <chrono>
+
 using namespace media;
 
+namespace {
+	const size_t kDefaultReadbackDepth = 2;
+	const size_t kStripesPerThread = 2;
+	// Completion timestamps and clock samples are taken in microseconds.
+	const BMDTimeScale kMicrosecondTimeScale = 1000000;
+	// Audio is scheduled with its sample position as stream time.
+	const BMDTimeScale kAudioSampleRate = 48000;
+
+	int64_t getHostTimeUs()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	FrameCompletion getFrameCompletion( BMDOutputFrameCompletionResult result )
+	{
+		switch( result ) {
+		case bmdOutputFrameDisplayedLate:	return FrameCompletion::LATE;
+		case bmdOutputFrameDropped:			return FrameCompletion::DROPPED;
+		case bmdOutputFrameFlushed:			return FrameCompletion::FLUSHED;
+		default:							return FrameCompletion::COMPLETED;
+		}
+	}
+
+	bool getPixelLayout( const ci::SurfaceChannelOrder& channelOrder, PixelLayout * layout )
+	{
+		switch( channelOrder.getCode() ) {
+		case ci::SurfaceChannelOrder::RGB:	*layout = PixelLayout::RGB; return true;
+		case ci::SurfaceChannelOrder::BGR:	*layout = PixelLayout::BGR; return true;
+		case ci::SurfaceChannelOrder::RGBA:	*layout = PixelLayout::RGBA; return true;
+		case ci::SurfaceChannelOrder::BGRA:	*layout = PixelLayout::BGRA; return true;
+		case ci::SurfaceChannelOrder::RGBX:	*layout = PixelLayout::RGBX; return true;
+		case ci::SurfaceChannelOrder::BGRX:	*layout = PixelLayout::BGRX; return true;
+		default:							return false;
+		}
+	}
+
+	long getOutputRowBytes( BMDPixelFormat pixelFormat, long width )
+	{
+		switch( pixelFormat ) {
+		case bmdFormat8BitYUV:		return width * 2;
+		case bmdFormat10BitYUV:		return long( getV210RowBytes( width ) );
+		default:					return width * 4;
+		}
+	}
+}
+
+OutputFrame::OutputFrame( RefPtr<IDeckLinkVideoFrame> frame )
+	: mFrame{ std::move( frame ) }
+	, mWidth{ 0 }
+	, mHeight{ 0 }
+	, mRowBytes{ 0 }
+	, mPixelFormat{ bmdFormat8BitBGRA }
+	, mData{ nullptr }
+{
+	void * bytes = NULL;
+	if( mFrame && mFrame->GetBytes( &bytes ) == S_OK ) {
+		mWidth = mFrame->GetWidth();
+		mHeight = mFrame->GetHeight();
+		mRowBytes = mFrame->GetRowBytes();
+		mPixelFormat = mFrame->GetPixelFormat();
+		mData = (uint8_t*)bytes;
+	}
+}
+
 DeckLinkOutput::DeckLinkOutput( DeckLinkDevice * device )
 	: mDevice{ device }
+	, mPixelFormat{ bmdFormat8BitBGRA }
+	, mMatrix{ YCbCrMatrix::BT709 }
+	, mRange{ YCbCrRange::LEGAL }
+	, mChromaFilter{ ChromaFilter::COSITED }
+	, mMatrixFromMode{ true }
+	, frameDuration{ 0 }
+	, frameTimescale{ 0 }
+	, mFillActive{ false }
+	, mFillPending{ false }
+	, mResampleFilter{ ResampleFilter::BILINEAR }
+	, mPassthroughLead{ 0 }
+	, mFrameAllocator{ DeckLinkMemoryAllocator::create() }
+	, mAudioLowWatermark{ 0 }
+	, mAudioHighWatermark{ 0 }
+	, mAudioPreroll{ false }
+	, mReadbackDepth{ kDefaultReadbackDepth }
 	, m_refCount{ 1 }
 {
 	if( mDevice->mDecklink->QueryInterface( IID_IDeckLinkOutput, (void**)&mDeckLinkOutput ) != S_OK ) {
@@ -23,6 +103,7 @@ DeckLinkOutput::DeckLinkOutput( DeckLinkDevice * device )
 
 DeckLinkOutput::~DeckLinkOutput()
 {
+	stopFillThread();
 	if( mDeckLinkOutput != NULL )
 	{
 		mDeckLinkOutput->Release();
@@ -32,46 +113,200 @@ DeckLinkOutput::~DeckLinkOutput()
 
 void DeckLinkOutput::sendSurface( const ci::Surface & surface )
 {
-	std::lock_guard<std::mutex> lock( mMutex );
-	if( ! mWindowSurface || mWindowSurface->getSize() != mResolution ) {
-		mWindowSurface = ci::Surface8u::create( mResolution.x, mResolution.y, true, ci::SurfaceChannelOrder::BGRA );
+	if( surface.getSize() == mResolution && surface.getChannelOrder() == ci::SurfaceChannelOrder::BGRA ) {
+		writeFrame( surface.getData(), surface.getRowBytes() );
+		return;
 	}
 
-	if( surface.getSize() == mWindowSurface->getSize() && surface.getChannelOrder() == mWindowSurface->getChannelOrder() ) {
-		mWindowSurface->copyFrom( surface, surface.getBounds() );
+	PixelLayout layout;
+	if( ! getPixelLayout( surface.getChannelOrder(), &layout ) ) {
+		CI_LOG_E( "Unsupported surface channel order." );
+		return;
+	}
+	if( mResolution.x <= 0 || mResolution.y <= 0 || surface.getWidth() <= 0 || surface.getHeight() <= 0 )
+		return;
+
+	mResampler.setup( surface.getWidth(), surface.getHeight(), layout, mResolution.x, mResolution.y, mResampleFilter );
+	if( mPixelFormat == bmdFormat8BitBGRA ) {
+		// Scaled straight into the output frame.
+		OutputFrame frame = acquireFrame();
+		if( ! frame )
+			return;
+		resampleSurface( surface, frame.getData(), frame.getRowBytes() );
+		commitFrame( frame );
 	}
 	else {
-		CI_LOG_E( "Incompatible surface." );
+		const size_t rowBytes = size_t( mResolution.x ) * 4;
+		mScaledPixels.resize( rowBytes * mResolution.y );
+		resampleSurface( surface, mScaledPixels.data(), rowBytes );
+		writeFrame( mScaledPixels.data(), rowBytes );
 	}
 }
 
-void DeckLinkOutput::sendTexture( const ci::gl::Texture2dRef & texture )
+void DeckLinkOutput::resampleSurface( const ci::Surface& surface, uint8_t * dst, size_t dstRowBytes )
 {
-	std::lock_guard<std::mutex> lock( mMutex );
-	if( ! mWindowSurface || mWindowSurface->getSize() != mResolution ) {
-		mWindowSurface = ci::Surface8u::create( mResolution.x, mResolution.y, true, ci::SurfaceChannelOrder::BGRA );
+	const uint8_t * src = surface.getData();
+	const size_t srcRowBytes = surface.getRowBytes();
+	if( ! mConversionPool ) {
+		mResampler.resample( src, srcRowBytes, dst, dstRowBytes, 0, mResolution.y );
+		return;
 	}
 
-	ci::gl::ScopedTextureBind tex0{ texture };
-	glGetTexImage( GL_TEXTURE_2D, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, mWindowSurface->getData() );
+	mConversionPool->parallelForRanges( mResolution.y, mConversionPool->getConcurrency() * kStripesPerThread, [&]( size_t rowBegin, size_t rowEnd ) {
+		mResampler.resample( src, srcRowBytes, dst, dstRowBytes, long( rowBegin ), long( rowEnd ) );
+	} );
+}
+
+void DeckLinkOutput::setConversionThreads( size_t numThreads, const std::vector<int>& cpuAffinity )
+{
+	mConversionPool = numThreads > 1 ? WorkerPool::create( numThreads - 1, cpuAffinity ) : nullptr;
+}
+
+void DeckLinkOutput::sendTexture( const ci::gl::Texture2dRef & texture )
+{
+	if( ! prepareReadback() )
+		return;
+
+	mReadback->readTexture( texture, [this]( const uint8_t * pixels, size_t rowBytes ) {
+		writeFrame( pixels, rowBytes );
+	} );
 }
 
 void DeckLinkOutput::sendWindowSurface()
 {
-	std::lock_guard<std::mutex> lock( mMutex );
-	if( ! mWindowSurface || mWindowSurface->getSize() != mResolution ) {
-		mWindowSurface = ci::Surface8u::create( mResolution.x, mResolution.y, true, ci::SurfaceChannelOrder::BGRA );
+	if( ! prepareReadback() )
+		return;
+
+	mReadback->readFramebuffer( [this]( const uint8_t * pixels, size_t rowBytes ) {
+		writeFrame( pixels, rowBytes );
+	} );
+}
+
+bool DeckLinkOutput::prepareReadback()
+{
+	if( mResolution.x <= 0 || mResolution.y <= 0 )
+		return false;
+
+	// Transfers still in flight in a replaced ring are dropped along with it.
+	if( ! mReadback || mReadback->getSize() != mResolution || mReadback->getDepth() != mReadbackDepth )
+		mReadback = OutputReadback::create( mResolution, mReadbackDepth );
+	return true;
+}
+
+ReadbackStats DeckLinkOutput::getReadbackStats() const
+{
+	return mReadback ? mReadback->getStats() : ReadbackStats();
+}
+
+void DeckLinkOutput::writeFrame( const uint8_t * pixels, size_t rowBytes )
+{
+	OutputFrame frame = acquireFrame();
+	if( ! frame )
+		return;
+
+	const size_t frameRowBytes = frame.getRowBytes();
+	if( frame.getPixelFormat() != bmdFormat8BitBGRA ) {
+		// YUV frames are not flipped by the driver, bottom-up rows are encoded in reverse order instead.
+		const long height = frame.getHeight();
+		for( long row = 0; row < height; ++row ) {
+			const uint8_t * src = pixels + ( height - 1 - row ) * rowBytes;
+			uint8_t * dst = frame.getData() + row * frameRowBytes;
+			if( frame.getPixelFormat() == bmdFormat10BitYUV )
+				convertBGRAToV210( src, rowBytes, dst, frameRowBytes, frame.getWidth(), 1, mMatrix, mRange, mChromaFilter );
+			else
+				convertBGRAToUYVY( src, rowBytes, dst, frameRowBytes, frame.getWidth(), 1, mMatrix, mRange, mChromaFilter );
+		}
+	}
+	else if( rowBytes == frameRowBytes ) {
+		std::memcpy( frame.getData(), pixels, rowBytes * frame.getHeight() );
+	}
+	else {
+		const size_t copyBytes = rowBytes < frameRowBytes ? rowBytes : frameRowBytes;
+		for( long row = 0; row < frame.getHeight(); ++row )
+			std::memcpy( frame.getData() + row * frameRowBytes, pixels + row * rowBytes, copyBytes );
+	}
+	commitFrame( frame );
+}
+
+OutputFrame DeckLinkOutput::acquireFrame()
+{
+	RefPtr<IDeckLinkVideoFrame> frame = std::move( mFrames.getWriteSlot() );
+	// The previous frame is still held by the application, the allocator recycles its memory once dropped.
+	if( ! frame )
+		frame = createFrame();
+	return OutputFrame{ std::move( frame ) };
+}
+
+void DeckLinkOutput::commitFrame( OutputFrame& frame )
+{
+	if( ! frame )
+		return;
+
+	mFrames.getWriteSlot() = std::move( frame.mFrame );
+	mFrames.publish();
+	frame = OutputFrame();
+}
+
+OutputFrameStats DeckLinkOutput::getFrameStats() const
+{
+	OutputFrameStats stats;
+	stats.committed = mFrames.getPublishCount();
+	stats.repeated = mFrames.getRepeatedCount();
+	stats.skipped = mFrames.getSkippedCount();
+	return stats;
+}
+
+void DeckLinkOutput::setYCbCrEncoding( YCbCrMatrix matrix, YCbCrRange range, ChromaFilter filter )
+{
+	mMatrix = matrix;
+	mRange = range;
+	mChromaFilter = filter;
+	mMatrixFromMode = false;
+}
+
+void DeckLinkOutput::setFrameMemoryOptions( const MemoryAllocatorOptions& options )
+{
+	mFrameAllocator = DeckLinkMemoryAllocator::create( options );
+}
+
+RefPtr<IDeckLinkVideoFrame> DeckLinkOutput::createFrame()
+{
+	if( mResolution.x <= 0 || mResolution.y <= 0 )
+		return nullptr;
+
+	// Flip frame vertical, because OpenGL rendering starts from left bottom corner. YUV frames are flipped while encoding.
+	const BMDFrameFlags flags = mPixelFormat == bmdFormat8BitBGRA ? bmdFrameFlagFlipVertical : bmdFrameFlagDefault;
+	IDeckLinkMutableVideoFrame * frame = NULL;
+	if( mDeckLinkOutput->CreateVideoFrame( mResolution.x, mResolution.y, getOutputRowBytes( mPixelFormat, mResolution.x ), mPixelFormat, flags, &frame ) != S_OK ) {
+		CI_LOG_E( "Failed to create an output frame." );
+		return nullptr;
 	}
-	GLint oldPackAlignment;
-	glFlush();
-	glGetIntegerv( GL_PACK_ALIGNMENT, &oldPackAlignment );
-	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
-	glReadPixels( 0, 0, mResolution.x, mResolution.y, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, mWindowSurface->getData() );
-	glPixelStorei( GL_PACK_ALIGNMENT, oldPackAlignment );
+	return RefPtr<IDeckLinkVideoFrame>::adopt( frame );
 }
 
-bool DeckLinkOutput::start( BMDDisplayMode videoMode )
+bool DeckLinkOutput::start( BMDDisplayMode videoMode, BMDPixelFormat pixelFormat )
 {
+	mPassthroughLead = 0;
+	return startPlayback( videoMode, pixelFormat );
+}
+
+bool DeckLinkOutput::startPassthrough( BMDDisplayMode videoMode, BMDPixelFormat pixelFormat, unsigned leadFrames )
+{
+	mPassthroughLead = leadFrames > 0 ? leadFrames : 1;
+	if( startPlayback( videoMode, pixelFormat ) )
+		return true;
+
+	mPassthroughLead = 0;
+	return false;
+}
+
+bool DeckLinkOutput::startPlayback( BMDDisplayMode videoMode, BMDPixelFormat pixelFormat )
+{
+	if( pixelFormat != bmdFormat8BitBGRA && pixelFormat != bmdFormat8BitYUV && pixelFormat != bmdFormat10BitYUV ) {
+		CI_LOG_E( "Unsupported output pixel format." );
+		return false;
+	}
+
 	bool								success = false;
 	IDeckLinkDisplayModeIterator*		displayModeIterator;
 	IDeckLinkDisplayMode*				displayMode = NULL;
@@ -92,9 +327,30 @@ bool DeckLinkOutput::start( BMDDisplayMode videoMode )
 		mResolution.y = displayMode->GetHeight();
 		displayMode->GetFrameRate( &frameDuration, &frameTimescale );
 		uiFPS = ( ( frameTimescale + ( frameDuration - 1 ) ) / frameDuration );
+		mPixelFormat = pixelFormat;
+		mTelemetry.reset( frameDuration, frameTimescale );
+		mClock.reset( frameDuration, frameTimescale );
+		if( mMatrixFromMode )
+			mMatrix = getDefaultYCbCrMatrix( mResolution.y );
+		if( mDeckLinkOutput->SetVideoOutputFrameMemoryAllocator( mFrameAllocator.get() ) != S_OK )
+			CI_LOG_W( "Unable to install the output frame allocator, frames will use driver memory." );
 		if( mDeckLinkOutput->EnableVideoOutput( videoMode, bmdVideoOutputFlagDefault ) == S_OK ) {
+			if( mAudioOptions.enabled && mPassthroughLead )
+				CI_LOG_W( "Audio output is not available in passthrough." );
+			const bool audio = mAudioOptions.enabled && ! mPassthroughLead && startAudio();
 			setPreroll();
-			mDeckLinkOutput->StartScheduledPlayback( 0, 100, 1.0 );
+			if( mFillCallback && ! mPassthroughLead )
+				startFillThread();
+			// With audio, playback starts from the first audio preroll callback, once the audio queue is filled as well.
+			mAudioPreroll = audio;
+			if( ! audio || mDeckLinkOutput->BeginAudioPreroll() != S_OK ) {
+				if( audio ) {
+					CI_LOG_E( "Failed to start audio preroll, continuing without audio." );
+					mAudioPreroll = false;
+					stopAudio();
+				}
+				mDeckLinkOutput->StartScheduledPlayback( 0, frameTimescale, 1.0 );
+			}
 			success = true;
 		}
 		else {
@@ -118,61 +374,410 @@ bool DeckLinkOutput::start( BMDDisplayMode videoMode )
 
 void DeckLinkOutput::stop()
 {
+	mAudioPreroll = false;
 	mDeckLinkOutput->StopScheduledPlayback( 0, NULL, 0 );
 	mDeckLinkOutput->DisableVideoOutput();
+	stopAudio();
+	stopFillThread();
+	mPassthroughLead = 0;
+
+	mFrames.reset( nullptr, nullptr, nullptr );
+	mLastFrame.reset();
 }
 
 void DeckLinkOutput::setPreroll()
 {
-	IDeckLinkMutableVideoFrame* pDLVideoFrame;
-
-	// Set 3 frame preroll
-	for( unsigned i = 0; i < 3; i++ )
+	unsigned prerollFrames;
 	{
-		// Flip frame vertical, because OpenGL rendering starts from left bottom corner
-		if( mDeckLinkOutput->CreateVideoFrame( mResolution.x, mResolution.y, mResolution.x * 4, bmdFormat8BitBGRA, bmdFrameFlagFlipVertical, &pDLVideoFrame ) != S_OK )
-			goto bail;
+		std::lock_guard<std::mutex> lock( mPrerollMutex );
+		mPreroll = PrerollController{ mPrerollOptions };
+		prerollFrames = mPreroll.reset( frameDuration, frameTimescale );
+	}
+	// Passthrough frames go to the first slot past the lead, a deeper preroll would only add latency.
+	if( mPassthroughLead )
+		prerollFrames = mPassthroughLead;
 
-		if( mDeckLinkOutput->ScheduleVideoFrame( pDLVideoFrame, (uiTotalFrames * frameDuration), frameDuration, frameTimescale ) != S_OK )
-			goto bail;
+	for( unsigned i = 0; i < prerollFrames; i++ ) {
+		RefPtr<IDeckLinkVideoFrame> frame = createFrame();
+		if( ! frame )
+			return;
 
-		/* The local reference to the IDeckLinkVideoFrame is released here, as the ownership has now been passed to
-		*  the DeckLinkAPI via ScheduleVideoFrame.
-		*
-		* After the API has finished with the frame, it is returned to the application via ScheduledFrameCompleted.
-		* In ScheduledFrameCompleted, this application updates the video frame and passes it to ScheduleVideoFrame,
-		* returning ownership to the DeckLink API.
+		/* The API keeps its own reference on scheduled frames and hands them back through ScheduledFrameCompleted,
+		*  where they are rescheduled with the latest committed content.
 		*/
-		pDLVideoFrame->Release();
-		pDLVideoFrame = NULL;
+		clearFrame( frame.get() );
+		if( ! scheduleFrame( frame.get() ) )
+			return;
+	}
+
+	// One frame for the application to write, one ready and one for the callback to swap with the completed frame.
+	mFrames.reset( createFrame(), createFrame(), createFrame() );
+}
+
+void DeckLinkOutput::clearFrame( IDeckLinkVideoFrame * frame )
+{
+	void * bytes = NULL;
+	if( frame->GetBytes( &bytes ) != S_OK )
+		return;
+
+	const long width = frame->GetWidth();
+	const long height = frame->GetHeight();
+	const long rowBytes = frame->GetRowBytes();
+	if( frame->GetPixelFormat() == bmdFormat8BitBGRA ) {
+		std::memset( bytes, 0, rowBytes * height );
+		return;
+	}
+
+	// Zero is not black in YUV, encode a black row in the output range instead.
+	std::vector<uint8_t> black( width * 4, 0 );
+	for( long row = 0; row < height; ++row ) {
+		uint8_t * dst = (uint8_t*)bytes + row * rowBytes;
+		if( frame->GetPixelFormat() == bmdFormat10BitYUV )
+			convertBGRAToV210( black.data(), black.size(), dst, rowBytes, width, 1, mMatrix, mRange, mChromaFilter );
+		else
+			convertBGRAToUYVY( black.data(), black.size(), dst, rowBytes, width, 1, mMatrix, mRange, mChromaFilter );
+	}
+}
 
-		uiTotalFrames++;
+bool DeckLinkOutput::schedulePassthroughFrame( IDeckLinkVideoFrame * frame, int64_t * displayDelayUs )
+{
+	if( ! mPassthroughLead || ! frame )
+		return false;
+	if( frame->GetWidth() != mResolution.x || frame->GetHeight() != mResolution.y || frame->GetPixelFormat() != mPixelFormat )
+		return false;
+
+	BMDTimeValue streamTime;
+	double playbackSpeed;
+	if( mDeckLinkOutput->GetScheduledStreamTime( frameTimescale, &streamTime, &playbackSpeed ) != S_OK || playbackSpeed <= 0.0 )
+		streamTime = 0;
+
+	// One frame past the first slot absorbs arrival jitter around a slot boundary, further than that the input runs
+	// ahead of the output clock. When it runs behind, slots are skipped and the card shows the last frame again.
+	const uint64_t firstSlot = uint64_t( streamTime / frameDuration ) + mPassthroughLead;
+	if( uiTotalFrames > firstSlot + 1 )
+		return false;
+	if( uiTotalFrames < firstSlot )
+		uiTotalFrames = (unsigned __int32)firstSlot;
+
+	if( displayDelayUs )
+		*displayDelayUs = ( int64_t( uiTotalFrames ) * frameDuration - streamTime ) * kMicrosecondTimeScale / frameTimescale;
+	return scheduleFrame( frame );
+}
+
+bool DeckLinkOutput::scheduleFrame( IDeckLinkVideoFrame * frame )
+{
+	if( mDeckLinkOutput->ScheduleVideoFrame( frame, (uiTotalFrames * frameDuration), frameDuration, frameTimescale ) != S_OK )
+		return false;
+
+	mTelemetry.onFrameScheduled( uiTotalFrames * frameDuration );
+	uiTotalFrames++;
+	return true;
+}
+
+void DeckLinkOutput::startFillThread()
+{
+	stopFillThread();
+	{
+		std::lock_guard<std::mutex> lock( mFillMutex );
+		mFillActive = true;
+		mFillPending = false;
+		mPullStats = PullModeStats();
 	}
-	return;
+	mFillThread = std::thread( &DeckLinkOutput::fillLoop, this );
+	// The preroll covers the first frames, the first fill goes to the slot after it.
+	requestFill( uiTotalFrames );
+}
 
-bail:
-	if( pDLVideoFrame )
+void DeckLinkOutput::stopFillThread()
+{
 	{
-		pDLVideoFrame->Release();
-		pDLVideoFrame = NULL;
+		std::lock_guard<std::mutex> lock( mFillMutex );
+		mFillActive = false;
+	}
+	mFillCondition.notify_one();
+	if( mFillThread.joinable() )
+		mFillThread.join();
+}
+
+void DeckLinkOutput::requestFill( uint64_t frameIndex )
+{
+	{
+		std::lock_guard<std::mutex> lock( mFillMutex );
+		if( ! mFillActive )
+			return;
+	}
+
+	const int64_t hardwareTimeUs = getSlotHardwareTimeUs( frameIndex );
+	// Mostly called from the completion callback, while startAudio() and stopAudio() may swap the buffer.
+	const AudioPlayoutBufferRef audioBuffer = std::atomic_load( &mAudioBuffer );
+	{
+		std::lock_guard<std::mutex> lock( mFillMutex );
+		if( ! mFillActive )
+			return;
+		// Only the newest request matters, a frame for an older slot would already be late.
+		if( mFillPending )
+			++mPullStats.overruns;
+		mFillTime.frameIndex = frameIndex;
+		mFillTime.streamTime = int64_t( frameIndex ) * frameDuration;
+		mFillTime.frameDuration = frameDuration;
+		mFillTime.timeScale = frameTimescale;
+		mFillTime.hardwareTimeUs = hardwareTimeUs;
+		mFillTime.audioPosition = 0;
+		mFillTime.audioSampleFrames = 0;
+		if( audioBuffer ) {
+			mFillTime.audioPosition = getAudioPosition( frameIndex );
+			mFillTime.audioSampleFrames = long( getAudioPosition( frameIndex + 1 ) - mFillTime.audioPosition );
+		}
+		mFillPending = true;
+		++mPullStats.requests;
+	}
+	mFillCondition.notify_one();
+}
+
+int64_t DeckLinkOutput::getSlotHardwareTimeUs( uint64_t slot )
+{
+	BMDTimeValue hardwareTime, timeInFrame, ticksPerFrame;
+	if( mDeckLinkOutput->GetHardwareReferenceClock( kMicrosecondTimeScale, &hardwareTime, &timeInFrame, &ticksPerFrame ) != S_OK )
+		return -1;
+
+	// Before playback starts the stream time stays at 0, which is where it starts from.
+	BMDTimeValue streamTime;
+	double playbackSpeed;
+	if( mDeckLinkOutput->GetScheduledStreamTime( kMicrosecondTimeScale, &streamTime, &playbackSpeed ) != S_OK || playbackSpeed <= 0.0 )
+		streamTime = 0;
+	return hardwareTime + int64_t( slot ) * frameDuration * kMicrosecondTimeScale / frameTimescale - streamTime;
+}
+
+void DeckLinkOutput::fillLoop()
+{
+	std::unique_lock<std::mutex> lock( mFillMutex );
+	while( true ) {
+		mFillCondition.wait( lock, [this] { return mFillPending || ! mFillActive; } );
+		if( ! mFillActive )
+			break;
+
+		const OutputFrameTime time = mFillTime;
+		mFillPending = false;
+		lock.unlock();
+
+		const auto begin = std::chrono::steady_clock::now();
+		OutputFrame frame = acquireFrame();
+		if( frame ) {
+			mFillCallback( frame, time );
+			commitFrame( frame );
+		}
+		const double fillMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - begin ).count();
+
+		lock.lock();
+		++mPullStats.fills;
+		mPullStats.lastFillMs = fillMs;
+		if( fillMs > mPullStats.maxFillMs )
+			mPullStats.maxFillMs = fillMs;
+	}
+}
+
+PullModeStats DeckLinkOutput::getPullModeStats() const
+{
+	std::lock_guard<std::mutex> lock( mFillMutex );
+	return mPullStats;
+}
+
+bool DeckLinkOutput::startAudio()
+{
+	if( mDeckLinkOutput->EnableAudioOutput( bmdAudioSampleRate48kHz, mAudioOptions.sampleType, mAudioOptions.channels, bmdAudioOutputStreamTimestamped ) != S_OK ) {
+		CI_LOG_E( "Failed to enable audio output with " << mAudioOptions.channels << " channels." );
+		return false;
+	}
+	if( mDeckLinkOutput->SetAudioCallback( this ) != S_OK ) {
+		CI_LOG_E( "Failed to install the audio output callback." );
+		mDeckLinkOutput->DisableAudioOutput();
+		return false;
+	}
+
+	const size_t bytesPerSample = mAudioOptions.sampleType == bmdAudioSampleType32bitInteger ? 4 : 2;
+	const size_t capacity = size_t( std::max( mAudioOptions.bufferSeconds, 0.1 ) * kAudioSampleRate );
+	mAudioLowWatermark = std::max<size_t>( size_t( mAudioOptions.lowWatermarkMs * kAudioSampleRate / 1000.0 ), 1 );
+	mAudioHighWatermark = std::max( size_t( mAudioOptions.highWatermarkMs * kAudioSampleRate / 1000.0 ), mAudioLowWatermark );
+	mAudioSilence.assign( mAudioHighWatermark * mAudioOptions.channels * bytesPerSample, 0 );
+	std::atomic_store( &mAudioBuffer, AudioPlayoutBuffer::create( mAudioOptions.channels, bytesPerSample, capacity ) );
+	return true;
+}
+
+void DeckLinkOutput::stopAudio()
+{
+	if( ! mAudioBuffer )
+		return;
+
+	mDeckLinkOutput->DisableAudioOutput();
+	mDeckLinkOutput->SetAudioCallback( NULL );
+	std::atomic_store( &mAudioBuffer, AudioPlayoutBufferRef() );
+}
+
+size_t DeckLinkOutput::writeAudio( int64_t position, const void * samples, size_t sampleFrames )
+{
+	AudioPlayoutBufferRef buffer = std::atomic_load( &mAudioBuffer );
+	return buffer ? buffer->write( position, samples, sampleFrames ) : 0;
+}
+
+size_t DeckLinkOutput::writeAudio( const void * samples, size_t sampleFrames )
+{
+	AudioPlayoutBufferRef buffer = std::atomic_load( &mAudioBuffer );
+	return buffer ? buffer->write( samples, sampleFrames ) : 0;
+}
+
+int64_t DeckLinkOutput::getAudioPosition( uint64_t frameIndex ) const
+{
+	// Rounds down like the capture side, so consecutive frames tile the audio (1601 and 1602 samples at 29.97).
+	return frameTimescale > 0 ? int64_t( frameIndex ) * frameDuration * kAudioSampleRate / frameTimescale : 0;
+}
+
+AudioPlayoutStats DeckLinkOutput::getAudioStats() const
+{
+	AudioPlayoutBufferRef buffer = std::atomic_load( &mAudioBuffer );
+	return buffer ? buffer->getStats() : AudioPlayoutStats();
+}
+
+void DeckLinkOutput::refillAudio( bool preroll )
+{
+	AudioPlayoutBufferRef buffer = std::atomic_load( &mAudioBuffer );
+	if( ! buffer )
+		return;
+
+	// Batched: nothing until the driver queue drops under the low watermark, then it is topped up at once.
+	unsigned int bufferedFrames = 0;
+	if( mDeckLinkOutput->GetBufferedAudioSampleFrameCount( &bufferedFrames ) != S_OK || bufferedFrames >= mAudioLowWatermark )
+		return;
+
+	// A late callback left the schedule behind playback, samples in the past would not play. Skipping to the playback
+	// position keeps every later sample at its place next to the video.
+	BMDTimeValue streamTime;
+	double playbackSpeed;
+	if( ! preroll && mDeckLinkOutput->GetScheduledStreamTime( kAudioSampleRate, &streamTime, &playbackSpeed ) == S_OK && playbackSpeed > 0.0 ) {
+		if( buffer->getReadPosition() < streamTime ) {
+			buffer->seek( streamTime );
+			bufferedFrames = 0;
+		}
+	}
+
+	size_t scheduled = 0;
+	const size_t wanted = mAudioHighWatermark - bufferedFrames;
+	while( scheduled < wanted ) {
+		const uint8_t * frames = nullptr;
+		const size_t count = std::min( buffer->peek( &frames ), wanted - scheduled );
+		if( count == 0 )
+			break;
+		if( ! scheduleAudio( *buffer, frames, count ) )
+			return;
+		scheduled += count;
 	}
+
+	// The application is late: silence keeps the driver queue at the low watermark, and the audio written for these
+	// positions later on is dropped.
+	if( bufferedFrames + scheduled < mAudioLowWatermark )
+		scheduleAudio( *buffer, mAudioSilence.data(), mAudioLowWatermark - bufferedFrames - scheduled );
+}
+
+bool DeckLinkOutput::scheduleAudio( AudioPlayoutBuffer& buffer, const uint8_t * frames, size_t frameCount )
+{
+	// The driver copies the samples.
+	unsigned int written = 0;
+	const HRESULT result = mDeckLinkOutput->ScheduleAudioSamples( (void*)frames, (unsigned int)frameCount, buffer.getReadPosition(), kAudioSampleRate, &written );
+	buffer.consume( written );
+	return result == S_OK && written == frameCount;
+}
+
+HRESULT DeckLinkOutput::RenderAudioSamples( BOOL preroll )
+{
+	refillAudio( preroll != 0 );
+
+	// The video preroll is scheduled already, playback starts once the audio queue is filled too.
+	if( preroll && mAudioPreroll.exchange( false ) )
+		mDeckLinkOutput->StartScheduledPlayback( 0, frameTimescale, 1.0 );
+	return S_OK;
+}
+
+PrerollStats DeckLinkOutput::getPrerollStats() const
+{
+	std::lock_guard<std::mutex> lock( mPrerollMutex );
+	return mPreroll.getStats();
 }
 
 HRESULT DeckLinkOutput::ScheduledFrameCompleted( IDeckLinkVideoFrame * completedFrame, BMDOutputFrameCompletionResult result )
 {
-	std::lock_guard<std::mutex> lock( mMutex );
+	const FrameCompletion completion = getFrameCompletion( result );
+	BMDTimeValue completionTime = -1;
+	if( mDeckLinkOutput->GetFrameCompletionReferenceTimestamp( completedFrame, kMicrosecondTimeScale, &completionTime ) != S_OK )
+		completionTime = -1;
+	mTelemetry.onFrameCompleted( completion, completionTime );
+
+	BMDTimeValue hardwareTime, timeInFrame, ticksPerFrame;
+	if( mDeckLinkOutput->GetHardwareReferenceClock( kMicrosecondTimeScale, &hardwareTime, &timeInFrame, &ticksPerFrame ) == S_OK )
+		mClock.addClockSample( hardwareTime, getHostTimeUs() );
+
+	// Passthrough frames are scheduled as they arrive, the completed one simply goes back to its owner.
+	if( mPassthroughLead )
+		return S_OK;
 
-	if( ! mWindowSurface )
+	uint32_t bufferedFrames = 0;
+	const bool knownDepth = mDeckLinkOutput->GetBufferedVideoFrameCount( &bufferedFrames ) == S_OK;
+	unsigned scheduleCount;
+	{
+		// An unknown depth would pass for an empty queue and grow it on every completion, only replace the completed frame.
+		std::lock_guard<std::mutex> lock( mPrerollMutex );
+		scheduleCount = knownDepth ? mPreroll.onFrameCompleted( completion, bufferedFrames ) : mPreroll.onFrameCompleted( completion );
+	}
+
+	// Playback is stopping, or the queue is shrinking: the frame goes away with the last reference and a committed
+	// frame waits for the next completion.
+	if( scheduleCount == 0 )
 		return S_OK;
 
-	void * data = NULL;
-	completedFrame->GetBytes( (void**)&data );
-	std::memcpy( data, mWindowSurface->getData(), mWindowSurface->getRowBytes() * mWindowSurface->getHeight() );
+	RefPtr<IDeckLinkVideoFrame> completed{ completedFrame };
+	RefPtr<IDeckLinkVideoFrame> next, repeatSource;
+	if( mFrames.fetch() && mFrames.getReadSlot() ) {
+		// The completed frame takes the place of the new one and goes back to the application through the ready slot.
+		next = std::move( mFrames.getReadSlot() );
+		mFrames.getReadSlot() = std::move( completed );
+	}
+	else {
+		// Nothing new: show the last frame again, copying it unless the completed slot already holds it.
+		if( mLastFrame && mLastFrame != completed )
+			repeatSource = mLastFrame;
+		next = std::move( completed );
+	}
+	mLastFrame = next;
+
+	if( repeatSource ) {
+		// The source is scheduled, so the driver only reads from it and it cannot be handed out meanwhile.
+		void * src = NULL;
+		void * dst = NULL;
+		if( repeatSource->GetBytes( &src ) == S_OK && next->GetBytes( &dst ) == S_OK )
+			std::memcpy( dst, src, next->GetRowBytes() * next->GetHeight() );
+	}
+
+	// A stall may have left the schedule behind playback, continue from the first slot that can still be shown.
+	BMDTimeValue streamTime;
+	double playbackSpeed;
+	if( mDeckLinkOutput->GetScheduledStreamTime( frameTimescale, &streamTime, &playbackSpeed ) == S_OK && playbackSpeed > 0.0 )
+		uiTotalFrames = (unsigned __int32)mClock.getScheduleSlot( uiTotalFrames, streamTime );
 
-	if( mDeckLinkOutput->ScheduleVideoFrame( completedFrame, (uiTotalFrames * frameDuration), frameDuration, frameTimescale ) == S_OK )
-	{
-		uiTotalFrames++;
+	if( ! scheduleFrame( next.get() ) )
+		return S_OK;
+
+	// Growing the queue: the added frame repeats the one just scheduled, which pushes the following frames one slot later.
+	for( unsigned i = 1; i < scheduleCount; ++i ) {
+		RefPtr<IDeckLinkVideoFrame> extra = createFrame();
+		void * src = NULL;
+		void * dst = NULL;
+		if( ! extra || next->GetBytes( &src ) != S_OK || extra->GetBytes( &dst ) != S_OK )
+			break;
+		std::memcpy( dst, src, next->GetRowBytes() * next->GetHeight() );
+		if( ! scheduleFrame( extra.get() ) )
+			break;
 	}
+
+	// Pull mode: the frame filled now goes out at the next completion, in the slot after the ones just scheduled.
+	requestFill( uiTotalFrames );
 	return S_OK;
 }
 
@@ -198,6 +803,12 @@ HRESULT	STDMETHODCALLTYPE DeckLinkOutput::QueryInterface( REFIID iid, LPVOID *pp
 		AddRef();
 		result = S_OK;
 	}
+	else if( iid == IID_IDeckLinkAudioOutputCallback )
+	{
+		*ppv = (IDeckLinkAudioOutputCallback*)this;
+		AddRef();
+		result = S_OK;
+	}
 	else if( iid == IID_IDeckLinkInputCallback )
 	{
 		*ppv = (IDeckLinkInputCallback*)this;
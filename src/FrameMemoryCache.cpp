@@ -0,0 +1,197 @@
+#include "FrameMemoryCache.h"
+
+#if defined( _MSC_VER )
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+#endif
+
+using namespace media;
+
+namespace {
+	const size_t kPageSize = 4096;
+#if ! defined( _MSC_VER )
+	const size_t kHugePageSize = 2 * 1024 * 1024;
+#endif
+
+	size_t roundUp( size_t size, size_t multiple )
+	{
+		return ( size + multiple - 1 ) / multiple * multiple;
+	}
+
+	size_t getLargePageSize()
+	{
+#if defined( _MSC_VER )
+		return GetLargePageMinimum();
+#elif defined( MAP_HUGETLB )
+		return kHugePageSize;
+#else
+		return 0;
+#endif
+	}
+}
+
+FrameMemoryCache::FrameMemoryCache( const MemoryAllocatorOptions& options )
+	: mOptions( options )
+	, mCommitted{ true }
+{
+}
+
+FrameMemoryCache::~FrameMemoryCache()
+{
+	releaseCachedBlocks();
+	for( const auto& outstanding : mOutstandingBlocks )
+		unmapBlock( outstanding.first, outstanding.second );
+}
+
+void * FrameMemoryCache::mapBlock( size_t size, Block * block ) const
+{
+	void * data = nullptr;
+	block->size = size;
+	block->mappedSize = size;
+	block->largePages = false;
+
+	const size_t largePageSize = mOptions.largePages ? getLargePageSize() : 0;
+#if defined( _MSC_VER )
+	if( largePageSize ) {
+		const size_t mappedSize = roundUp( size, largePageSize );
+		data = VirtualAlloc( NULL, mappedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+		if( data ) {
+			block->mappedSize = mappedSize;
+			block->largePages = true;
+		}
+	}
+	if( ! data )
+		data = VirtualAlloc( NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+#else
+	#if defined( MAP_HUGETLB )
+	if( largePageSize ) {
+		const size_t mappedSize = roundUp( size, largePageSize );
+		data = mmap( nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+		if( data != MAP_FAILED ) {
+			block->mappedSize = mappedSize;
+			block->largePages = true;
+		}
+		else
+			data = nullptr;
+	}
+	#endif
+	if( ! data ) {
+		data = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if( data == MAP_FAILED )
+			return nullptr;
+	#if defined( MADV_HUGEPAGE )
+		// No reserved huge pages, transparent ones are the next best thing.
+		if( mOptions.largePages )
+			madvise( data, size, MADV_HUGEPAGE );
+	#endif
+	}
+#endif
+
+	if( data && mOptions.prefault ) {
+		volatile uint8_t * bytes = static_cast<uint8_t*>( data );
+		for( size_t offset = 0; offset < block->mappedSize; offset += kPageSize )
+			bytes[offset] = 0;
+	}
+	return data;
+}
+
+void FrameMemoryCache::unmapBlock( void * data, const Block& block )
+{
+#if defined( _MSC_VER )
+	VirtualFree( data, 0, MEM_RELEASE );
+#else
+	munmap( data, block.mappedSize );
+#endif
+	mStats.committedBytes -= block.mappedSize;
+	if( block.largePages )
+		--mStats.largePageBuffers;
+}
+
+void FrameMemoryCache::releaseCachedBlocks()
+{
+	for( const auto& cached : mCachedBlocks )
+		unmapBlock( cached.first, cached.second );
+	mCachedBlocks.clear();
+}
+
+void * FrameMemoryCache::allocate( size_t bufferSize )
+{
+	const size_t size = roundUp( bufferSize ? bufferSize : 1, kPageSize );
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	// Frames of a mode all have the same size, an exact match is the common case.
+	for( auto it = mCachedBlocks.begin(); it != mCachedBlocks.end(); ++it ) {
+		if( it->second.size == size ) {
+			void * data = it->first;
+			mOutstandingBlocks[data] = it->second;
+			mCachedBlocks.erase( it );
+			++mStats.allocations;
+			++mStats.reuses;
+			return data;
+		}
+	}
+
+	if( mOptions.maxCommittedBytes ) {
+		const size_t largePageSize = mOptions.largePages ? getLargePageSize() : 0;
+		const size_t expectedSize = largePageSize ? roundUp( size, largePageSize ) : size;
+		// Cached blocks of another size are dead weight after a mode change, drop them before giving up.
+		if( mStats.committedBytes + expectedSize > mOptions.maxCommittedBytes )
+			releaseCachedBlocks();
+		if( mStats.committedBytes + expectedSize > mOptions.maxCommittedBytes ) {
+			++mStats.rejections;
+			return nullptr;
+		}
+	}
+
+	Block block;
+	void * data = mapBlock( size, &block );
+	if( ! data )
+		return nullptr;
+
+	mOutstandingBlocks[data] = block;
+	mStats.committedBytes += block.mappedSize;
+	if( mStats.committedBytes > mStats.peakCommittedBytes )
+		mStats.peakCommittedBytes = mStats.committedBytes;
+	if( block.largePages )
+		++mStats.largePageBuffers;
+	++mStats.allocations;
+	return data;
+}
+
+bool FrameMemoryCache::release( void * buffer )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	auto it = mOutstandingBlocks.find( buffer );
+	if( it == mOutstandingBlocks.end() )
+		return false;
+
+	if( mCommitted )
+		mCachedBlocks.push_back( *it );
+	else
+		unmapBlock( it->first, it->second );
+	mOutstandingBlocks.erase( it );
+	return true;
+}
+
+void FrameMemoryCache::commit()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mCommitted = true;
+}
+
+void FrameMemoryCache::decommit()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mCommitted = false;
+	releaseCachedBlocks();
+}
+
+MemoryAllocatorStats FrameMemoryCache::getStats() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	MemoryAllocatorStats stats = mStats;
+	stats.outstandingBuffers = mOutstandingBlocks.size();
+	stats.cachedBuffers = mCachedBlocks.size();
+	return stats;
+}
@@ -0,0 +1,481 @@
+#include "ImageResampler.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined( MEDIA_ARCH_X86 )
+	#include <immintrin.h>
+#elif defined( MEDIA_ARCH_NEON )
+	#include <arm_neon.h>
+#endif
+
+using namespace media;
+
+namespace {
+
+	// Weights are scaled by 2^kWeightBits and sum to exactly that. The vertical pass keeps 6 fractional bits in its
+	// 16-bit row buffer, which leaves room for the Lanczos overshoot, and the horizontal pass removes the rest:
+	//   row = ( sum( w * src ) + 2^7 ) >> 8		saturated to int16
+	//   dst = ( sum( w * row ) + 2^19 ) >> 20		saturated to [0, 255]
+	const int kWeightBits = 14;
+	const int kRowShift = 8;
+	const int kOutputShift = 2 * kWeightBits - kRowShift;
+
+	struct LayoutInfo {
+		long	channels;
+		//! Red comes first in memory, the output swaps it with blue.
+		bool	swapRedBlue;
+		bool	opaque;
+	};
+
+	LayoutInfo getLayoutInfo( PixelLayout layout )
+	{
+		switch( layout ) {
+		case PixelLayout::RGB:	return LayoutInfo{ 3, true, true };
+		case PixelLayout::BGR:	return LayoutInfo{ 3, false, true };
+		case PixelLayout::RGBA:	return LayoutInfo{ 4, true, false };
+		case PixelLayout::RGBX:	return LayoutInfo{ 4, true, true };
+		case PixelLayout::BGRX:	return LayoutInfo{ 4, false, true };
+		default:				return LayoutInfo{ 4, false, false };
+		}
+	}
+
+	double sinc( double x )
+	{
+		const double pi = 3.14159265358979323846;
+		return x == 0.0 ? 1.0 : std::sin( pi * x ) / ( pi * x );
+	}
+
+	double evaluateFilter( ResampleFilter filter, double x )
+	{
+		x = std::fabs( x );
+		if( filter == ResampleFilter::LANCZOS3 )
+			return x < 3.0 ? sinc( x ) * sinc( x / 3.0 ) : 0.0;
+		return x < 1.0 ? 1.0 - x : 0.0;
+	}
+
+	uint32_t pairWeights( int16_t first, int16_t second )
+	{
+		return uint32_t( uint16_t( first ) ) | uint32_t( uint16_t( second ) ) << 16;
+	}
+
+	int16_t saturateRow( int32_t value )
+	{
+		return int16_t( value < -32768 ? -32768 : ( value > 32767 ? 32767 : value ) );
+	}
+
+	uint8_t saturateOutput( int32_t value )
+	{
+		return uint8_t( value < 0 ? 0 : ( value > 255 ? 255 : value ) );
+	}
+
+	void storePixel( const int32_t * channels, const LayoutInfo& info, uint8_t * dst )
+	{
+		dst[0] = saturateOutput( channels[info.swapRedBlue ? 2 : 0] );
+		dst[1] = saturateOutput( channels[1] );
+		dst[2] = saturateOutput( channels[info.swapRedBlue ? 0 : 2] );
+		dst[3] = info.opaque ? 255 : saturateOutput( channels[3] );
+	}
+
+	// Filters \a count bytes of \a taps source rows into the 16-bit row buffer.
+	typedef void( *VerticalKernel )( const uint8_t * const * rows, const int16_t * weights, long taps, long count, int16_t * out );
+	// Filters the row buffer into \a width BGRA pixels.
+	typedef void( *HorizontalKernel )( const int16_t * row, const int32_t * starts, const int16_t * weights, long taps, const LayoutInfo& info, uint8_t * dst, long width );
+
+	void verticalScalar( const uint8_t * const * rows, const int16_t * weights, long taps, long begin, long count, int16_t * out )
+	{
+		for( long i = begin; i < count; ++i ) {
+			int32_t sum = 0;
+			for( long j = 0; j < taps; ++j )
+				sum += weights[j] * rows[j][i];
+			out[i] = saturateRow( ( sum + ( 1 << ( kRowShift - 1 ) ) ) >> kRowShift );
+		}
+	}
+
+	void verticalScalar( const uint8_t * const * rows, const int16_t * weights, long taps, long count, int16_t * out )
+	{
+		verticalScalar( rows, weights, taps, 0, count, out );
+	}
+
+	void horizontalScalar( const int16_t * row, const int32_t * starts, const int16_t * weights, long taps, const LayoutInfo& info, uint8_t * dst, long width )
+	{
+		const long channels = info.opaque ? 3 : 4;
+		for( long x = 0; x < width; ++x ) {
+			const int16_t * src = row + starts[x] * info.channels;
+			const int16_t * w = weights + x * taps;
+			int32_t sum[4] = { 0, 0, 0, 0 };
+			for( long j = 0; j < taps; ++j )
+				for( long ch = 0; ch < channels; ++ch )
+					sum[ch] += w[j] * src[j * info.channels + ch];
+			for( long ch = 0; ch < channels; ++ch )
+				sum[ch] = ( sum[ch] + ( 1 << ( kOutputShift - 1 ) ) ) >> kOutputShift;
+			storePixel( sum, info, dst + x * 4 );
+		}
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	void verticalSse2( const uint8_t * const * rows, const int16_t * weights, long taps, long count, int16_t * out )
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi32( 1 << ( kRowShift - 1 ) );
+		long i = 0;
+		for( ; i + 16 <= count; i += 16 ) {
+			__m128i sum0 = zero, sum1 = zero, sum2 = zero, sum3 = zero;
+			for( long j = 0; j < taps; j += 2 ) {
+				const __m128i a = _mm_loadu_si128( (const __m128i*)( rows[j] + i ) );
+				const __m128i b = _mm_loadu_si128( (const __m128i*)( rows[j + 1] + i ) );
+				const __m128i w = _mm_set1_epi32( int( pairWeights( weights[j], weights[j + 1] ) ) );
+				// Interleaving the rows byte by byte then widening gives the ( a, b ) pairs madd expects.
+				const __m128i lo = _mm_unpacklo_epi8( a, b );
+				const __m128i hi = _mm_unpackhi_epi8( a, b );
+				sum0 = _mm_add_epi32( sum0, _mm_madd_epi16( _mm_unpacklo_epi8( lo, zero ), w ) );
+				sum1 = _mm_add_epi32( sum1, _mm_madd_epi16( _mm_unpackhi_epi8( lo, zero ), w ) );
+				sum2 = _mm_add_epi32( sum2, _mm_madd_epi16( _mm_unpacklo_epi8( hi, zero ), w ) );
+				sum3 = _mm_add_epi32( sum3, _mm_madd_epi16( _mm_unpackhi_epi8( hi, zero ), w ) );
+			}
+			sum0 = _mm_srai_epi32( _mm_add_epi32( sum0, round ), kRowShift );
+			sum1 = _mm_srai_epi32( _mm_add_epi32( sum1, round ), kRowShift );
+			sum2 = _mm_srai_epi32( _mm_add_epi32( sum2, round ), kRowShift );
+			sum3 = _mm_srai_epi32( _mm_add_epi32( sum3, round ), kRowShift );
+			_mm_storeu_si128( (__m128i*)( out + i ), _mm_packs_epi32( sum0, sum1 ) );
+			_mm_storeu_si128( (__m128i*)( out + i + 8 ), _mm_packs_epi32( sum2, sum3 ) );
+		}
+		verticalScalar( rows, weights, taps, i, count, out );
+	}
+
+	MEDIA_TARGET_AVX2 void verticalAvx2( const uint8_t * const * rows, const int16_t * weights, long taps, long count, int16_t * out )
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i round = _mm256_set1_epi32( 1 << ( kRowShift - 1 ) );
+		long i = 0;
+		for( ; i + 32 <= count; i += 32 ) {
+			__m256i sum0 = zero, sum1 = zero, sum2 = zero, sum3 = zero;
+			for( long j = 0; j < taps; j += 2 ) {
+				const __m256i a = _mm256_loadu_si256( (const __m256i*)( rows[j] + i ) );
+				const __m256i b = _mm256_loadu_si256( (const __m256i*)( rows[j + 1] + i ) );
+				const __m256i w = _mm256_set1_epi32( int( pairWeights( weights[j], weights[j + 1] ) ) );
+				const __m256i lo = _mm256_unpacklo_epi8( a, b );
+				const __m256i hi = _mm256_unpackhi_epi8( a, b );
+				sum0 = _mm256_add_epi32( sum0, _mm256_madd_epi16( _mm256_unpacklo_epi8( lo, zero ), w ) );
+				sum1 = _mm256_add_epi32( sum1, _mm256_madd_epi16( _mm256_unpackhi_epi8( lo, zero ), w ) );
+				sum2 = _mm256_add_epi32( sum2, _mm256_madd_epi16( _mm256_unpacklo_epi8( hi, zero ), w ) );
+				sum3 = _mm256_add_epi32( sum3, _mm256_madd_epi16( _mm256_unpackhi_epi8( hi, zero ), w ) );
+			}
+			sum0 = _mm256_srai_epi32( _mm256_add_epi32( sum0, round ), kRowShift );
+			sum1 = _mm256_srai_epi32( _mm256_add_epi32( sum1, round ), kRowShift );
+			sum2 = _mm256_srai_epi32( _mm256_add_epi32( sum2, round ), kRowShift );
+			sum3 = _mm256_srai_epi32( _mm256_add_epi32( sum3, round ), kRowShift );
+			// The unpacks work within 128-bit lanes: the first pack holds bytes 0-7 | 16-23, the second 8-15 | 24-31.
+			const __m256i first = _mm256_packs_epi32( sum0, sum1 );
+			const __m256i second = _mm256_packs_epi32( sum2, sum3 );
+			_mm256_storeu_si256( (__m256i*)( out + i ), _mm256_permute2x128_si256( first, second, 0x20 ) );
+			_mm256_storeu_si256( (__m256i*)( out + i + 16 ), _mm256_permute2x128_si256( first, second, 0x31 ) );
+		}
+		verticalScalar( rows, weights, taps, i, count, out );
+	}
+
+	// Rounds, swizzles and stores the 4 channel sums of one pixel.
+	void storePixelSse2( __m128i sum, const LayoutInfo& info, uint8_t * dst )
+	{
+		sum = _mm_srai_epi32( _mm_add_epi32( sum, _mm_set1_epi32( 1 << ( kOutputShift - 1 ) ) ), kOutputShift );
+		if( info.swapRedBlue )
+			sum = _mm_shuffle_epi32( sum, _MM_SHUFFLE( 3, 0, 1, 2 ) );
+		sum = _mm_packs_epi32( sum, sum );
+		uint32_t pixel = uint32_t( _mm_cvtsi128_si32( _mm_packus_epi16( sum, sum ) ) );
+		if( info.opaque )
+			pixel |= 0xFF000000;
+		std::memcpy( dst, &pixel, 4 );
+	}
+
+	// Each load reads 4 samples from the start of a pixel, for 3 channel layouts the last one belongs to the next
+	// pixel and is discarded. The row buffer is padded for it.
+	__m128i sumTapPairSse2( const int16_t * src, long channels, const int16_t * w )
+	{
+		const __m128i a = _mm_loadl_epi64( (const __m128i*)src );
+		const __m128i b = _mm_loadl_epi64( (const __m128i*)( src + channels ) );
+		return _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), _mm_set1_epi32( int( pairWeights( w[0], w[1] ) ) ) );
+	}
+
+	void horizontalSse2( const int16_t * row, const int32_t * starts, const int16_t * weights, long taps, const LayoutInfo& info, uint8_t * dst, long width )
+	{
+		const long channels = info.channels;
+		for( long x = 0; x < width; ++x ) {
+			const int16_t * src = row + starts[x] * channels;
+			const int16_t * w = weights + x * taps;
+			__m128i sum = _mm_setzero_si128();
+			for( long j = 0; j < taps; j += 2 )
+				sum = _mm_add_epi32( sum, sumTapPairSse2( src + j * channels, channels, w + j ) );
+			storePixelSse2( sum, info, dst + x * 4 );
+		}
+	}
+
+	MEDIA_TARGET_AVX2 void horizontalAvx2( const int16_t * row, const int32_t * starts, const int16_t * weights, long taps, const LayoutInfo& info, uint8_t * dst, long width )
+	{
+		const long channels = info.channels;
+		// Pairs sample c of the first and second pixel of each lane, 3 and 4 channel pixels.
+		const __m256i pairs = channels == 3
+			? _mm256_setr_epi8( 0, 1, 6, 7, 2, 3, 8, 9, 4, 5, 10, 11, 4, 5, 10, 11, 0, 1, 6, 7, 2, 3, 8, 9, 4, 5, 10, 11, 4, 5, 10, 11 )
+			: _mm256_setr_epi8( 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15, 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15 );
+		// Broadcasts the weight pair of taps 0 and 1 to the low lane and of taps 2 and 3 to the high lane.
+		const __m256i weightLanes = _mm256_setr_epi32( 0, 0, 0, 0, 1, 1, 1, 1 );
+		for( long x = 0; x < width; ++x ) {
+			const int16_t * src = row + starts[x] * channels;
+			const int16_t * w = weights + x * taps;
+			__m256i sum = _mm256_setzero_si256();
+			long j = 0;
+			// Four taps per step, the low lane holds the first two pixels and the high lane the next two.
+			for( ; j + 4 <= taps; j += 4 ) {
+				const __m256i samples = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( (const __m128i*)( src + j * channels ) ) ),
+																 _mm_loadu_si128( (const __m128i*)( src + ( j + 2 ) * channels ) ), 1 );
+				const __m256i wv = _mm256_permutevar8x32_epi32( _mm256_castsi128_si256( _mm_loadl_epi64( (const __m128i*)( w + j ) ) ), weightLanes );
+				sum = _mm256_add_epi32( sum, _mm256_madd_epi16( _mm256_shuffle_epi8( samples, pairs ), wv ) );
+			}
+			__m128i total = _mm_add_epi32( _mm256_castsi256_si128( sum ), _mm256_extracti128_si256( sum, 1 ) );
+			if( j < taps )
+				total = _mm_add_epi32( total, sumTapPairSse2( src + j * channels, channels, w + j ) );
+			storePixelSse2( total, info, dst + x * 4 );
+		}
+	}
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+	void verticalNeon( const uint8_t * const * rows, const int16_t * weights, long taps, long count, int16_t * out )
+	{
+		long i = 0;
+		for( ; i + 16 <= count; i += 16 ) {
+			int32x4_t sum0 = vdupq_n_s32( 0 ), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+			for( long j = 0; j < taps; ++j ) {
+				const uint8x16_t src = vld1q_u8( rows[j] + i );
+				const int16x8_t lo = vreinterpretq_s16_u16( vmovl_u8( vget_low_u8( src ) ) );
+				const int16x8_t hi = vreinterpretq_s16_u16( vmovl_u8( vget_high_u8( src ) ) );
+				sum0 = vmlal_n_s16( sum0, vget_low_s16( lo ), weights[j] );
+				sum1 = vmlal_n_s16( sum1, vget_high_s16( lo ), weights[j] );
+				sum2 = vmlal_n_s16( sum2, vget_low_s16( hi ), weights[j] );
+				sum3 = vmlal_n_s16( sum3, vget_high_s16( hi ), weights[j] );
+			}
+			const int32x4_t round = vdupq_n_s32( 1 << ( kRowShift - 1 ) );
+			vst1q_s16( out + i, vcombine_s16( vqmovn_s32( vshrq_n_s32( vaddq_s32( sum0, round ), kRowShift ) ), vqmovn_s32( vshrq_n_s32( vaddq_s32( sum1, round ), kRowShift ) ) ) );
+			vst1q_s16( out + i + 8, vcombine_s16( vqmovn_s32( vshrq_n_s32( vaddq_s32( sum2, round ), kRowShift ) ), vqmovn_s32( vshrq_n_s32( vaddq_s32( sum3, round ), kRowShift ) ) ) );
+		}
+		verticalScalar( rows, weights, taps, i, count, out );
+	}
+
+	void horizontalNeon( const int16_t * row, const int32_t * starts, const int16_t * weights, long taps, const LayoutInfo& info, uint8_t * dst, long width )
+	{
+		const long channels = info.channels;
+		for( long x = 0; x < width; ++x ) {
+			const int16_t * src = row + starts[x] * channels;
+			const int16_t * w = weights + x * taps;
+			int32x4_t sum = vdupq_n_s32( 0 );
+			for( long j = 0; j < taps; ++j )
+				sum = vmlal_n_s16( sum, vld1_s16( src + j * channels ), w[j] );
+			sum = vshrq_n_s32( vaddq_s32( sum, vdupq_n_s32( 1 << ( kOutputShift - 1 ) ) ), kOutputShift );
+			const int16x4_t narrow = vqmovn_s32( sum );
+			uint32_t pixel = vget_lane_u32( vreinterpret_u32_u8( vqmovun_s16( vcombine_s16( narrow, narrow ) ) ), 0 );
+			if( info.swapRedBlue )
+				pixel = ( pixel & 0xFF00FF00 ) | ( ( pixel >> 16 ) & 0xFF ) | ( ( pixel & 0xFF ) << 16 );
+			if( info.opaque )
+				pixel |= 0xFF000000;
+			std::memcpy( dst + x * 4, &pixel, 4 );
+		}
+	}
+#endif
+
+	VerticalKernel getVerticalKernel( SimdLevel level )
+	{
+		switch( level ) {
+#if defined( MEDIA_ARCH_X86 )
+		case SimdLevel::SSE2:	return verticalSse2;
+		case SimdLevel::AVX2:	return verticalAvx2;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		case SimdLevel::NEON:	return verticalNeon;
+#endif
+		default:				return verticalScalar;
+		}
+	}
+
+	HorizontalKernel getHorizontalKernel( SimdLevel level )
+	{
+		switch( level ) {
+#if defined( MEDIA_ARCH_X86 )
+		case SimdLevel::SSE2:	return horizontalSse2;
+		// The lane shuffle needs SSSE3, which every AVX2 cpu has.
+		case SimdLevel::AVX2:	return horizontalAvx2;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		case SimdLevel::NEON:	return horizontalNeon;
+#endif
+		default:				return horizontalScalar;
+		}
+	}
+}
+
+ImageResampler::ImageResampler()
+	: mSrcWidth{ 0 }
+	, mSrcHeight{ 0 }
+	, mDstWidth{ 0 }
+	, mDstHeight{ 0 }
+	, mLayout{ PixelLayout::BGRA }
+	, mFilter{ ResampleFilter::BILINEAR }
+{
+}
+
+void ImageResampler::setup( long srcWidth, long srcHeight, PixelLayout layout, long dstWidth, long dstHeight, ResampleFilter filter )
+{
+	if( srcWidth == mSrcWidth && srcHeight == mSrcHeight && layout == mLayout && dstWidth == mDstWidth && dstHeight == mDstHeight && filter == mFilter )
+		return;
+
+	mSrcWidth = srcWidth;
+	mSrcHeight = srcHeight;
+	mLayout = layout;
+	mDstWidth = dstWidth;
+	mDstHeight = dstHeight;
+	mFilter = filter;
+
+	// Same size images are copied and swizzled whatever the filter.
+	const ResampleFilter kernelFilter = isIdentity() ? ResampleFilter::NEAREST : filter;
+	computeKernel( srcWidth, dstWidth, kernelFilter, &mHorizontal );
+	computeKernel( srcHeight, dstHeight, kernelFilter, &mVertical );
+}
+
+bool ImageResampler::isIdentity() const
+{
+	return mSrcWidth == mDstWidth && mSrcHeight == mDstHeight;
+}
+
+void ImageResampler::computeKernel( long srcSize, long dstSize, ResampleFilter filter, Kernel * kernel )
+{
+	kernel->starts.assign( dstSize > 0 ? dstSize : 0, 0 );
+	kernel->weights.clear();
+	kernel->taps = 0;
+	if( srcSize <= 0 || dstSize <= 0 )
+		return;
+
+	const double scale = double( srcSize ) / double( dstSize );
+	if( filter == ResampleFilter::NEAREST ) {
+		kernel->taps = 1;
+		kernel->weights.assign( dstSize, int16_t( 1 << kWeightBits ) );
+		for( long x = 0; x < dstSize; ++x ) {
+			const long src = long( std::floor( ( x + 0.5 ) * scale ) );
+			kernel->starts[x] = int32_t( src < srcSize ? src : srcSize - 1 );
+		}
+		return;
+	}
+
+	// Downscaling stretches the filter over the source so it also acts as the low-pass.
+	const double filterScale = scale > 1.0 ? scale : 1.0;
+	const double support = ( filter == ResampleFilter::LANCZOS3 ? 3.0 : 1.0 ) * filterScale;
+	const long maxTaps = long( std::ceil( support ) ) * 2 + 1;
+
+	std::vector<int16_t> weights( dstSize * maxTaps, 0 );
+	std::vector<double> values( maxTaps );
+	long taps = 0;
+	for( long x = 0; x < dstSize; ++x ) {
+		const double center = ( x + 0.5 ) * scale;
+		long first = long( std::floor( center - support + 0.5 ) );
+		long last = long( std::floor( center + support + 0.5 ) );
+		first = first < 0 ? 0 : first;
+		last = last > srcSize ? srcSize : last;
+		if( last - first > maxTaps )
+			last = first + maxTaps;
+
+		double total = 0.0;
+		for( long i = first; i < last; ++i ) {
+			values[i - first] = evaluateFilter( filter, ( i - center + 0.5 ) / filterScale );
+			total += values[i - first];
+		}
+		if( total == 0.0 ) {
+			// Nothing in reach, fall back to the closest pixel.
+			first = long( std::floor( center ) );
+			first = first < srcSize ? first : srcSize - 1;
+			last = first + 1;
+			values[0] = total = 1.0;
+		}
+
+		// Quantized weights must sum to exactly 1 so flat areas stay flat, the largest one absorbs the error.
+		int16_t * w = &weights[x * maxTaps];
+		int sum = 0;
+		long largest = 0;
+		for( long i = 0; i < last - first; ++i ) {
+			w[i] = int16_t( std::floor( values[i] / total * double( 1 << kWeightBits ) + 0.5 ) );
+			sum += w[i];
+			if( std::abs( w[i] ) > std::abs( w[largest] ) )
+				largest = i;
+		}
+		w[largest] = int16_t( w[largest] + ( 1 << kWeightBits ) - sum );
+
+		// Drop the zero weights at both ends.
+		long begin = 0, end = last - first;
+		while( end - begin > 1 && w[begin] == 0 )
+			++begin;
+		while( end - begin > 1 && w[end - 1] == 0 )
+			--end;
+		if( begin > 0 )
+			std::memmove( w, w + begin, ( end - begin ) * sizeof( int16_t ) );
+		for( long i = end - begin; i < maxTaps; ++i )
+			w[i] = 0;
+
+		kernel->starts[x] = int32_t( first + begin );
+		if( end - begin > taps )
+			taps = end - begin;
+	}
+
+	kernel->taps = ( taps + 1 ) / 2 * 2;
+	kernel->weights.assign( dstSize * kernel->taps, 0 );
+	for( long x = 0; x < dstSize; ++x ) {
+		const long count = kernel->taps < maxTaps ? kernel->taps : maxTaps;
+		std::memcpy( &kernel->weights[x * kernel->taps], &weights[x * maxTaps], count * sizeof( int16_t ) );
+	}
+}
+
+void ImageResampler::resample( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long dstRowBegin, long dstRowEnd ) const
+{
+	resample( src, srcRowBytes, dst, dstRowBytes, dstRowBegin, dstRowEnd, getSimdLevel() );
+}
+
+void ImageResampler::resample( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long dstRowBegin, long dstRowEnd, SimdLevel level ) const
+{
+	if( mHorizontal.taps == 0 || mVertical.taps == 0 )
+		return;
+	if( dstRowBegin < 0 )
+		dstRowBegin = 0;
+	if( dstRowEnd > mDstHeight )
+		dstRowEnd = mDstHeight;
+	if( ! isSimdLevelSupported( level ) )
+		level = SimdLevel::SCALAR;
+
+	const LayoutInfo info = getLayoutInfo( mLayout );
+
+	if( mHorizontal.taps == 1 && mVertical.taps == 1 ) {
+		const size_t copyBytes = size_t( mDstWidth ) * 4;
+		const bool copyRows = isIdentity() && mLayout == PixelLayout::BGRA;
+		for( long y = dstRowBegin; y < dstRowEnd; ++y ) {
+			const uint8_t * srcRow = src + mVertical.starts[y] * srcRowBytes;
+			uint8_t * dstRow = dst + y * dstRowBytes;
+			if( copyRows ) {
+				std::memcpy( dstRow, srcRow, copyBytes );
+				continue;
+			}
+			for( long x = 0; x < mDstWidth; ++x ) {
+				const uint8_t * p = srcRow + mHorizontal.starts[x] * info.channels;
+				uint8_t * out = dstRow + x * 4;
+				out[0] = p[info.swapRedBlue ? 2 : 0];
+				out[1] = p[1];
+				out[2] = p[info.swapRedBlue ? 0 : 2];
+				out[3] = info.opaque ? 255 : p[3];
+			}
+		}
+		return;
+	}
+
+	const VerticalKernel vertical = getVerticalKernel( level );
+	const HorizontalKernel horizontal = getHorizontalKernel( level );
+
+	// Padded past the last pixel for the zero weight taps and the 4 sample loads, both read but ignored.
+	std::vector<int16_t> rowBuffer( size_t( mSrcWidth + mHorizontal.taps + 2 ) * 4, 0 );
+	std::vector<const uint8_t*> rows( mVertical.taps );
+	for( long y = dstRowBegin; y < dstRowEnd; ++y ) {
+		const long start = mVertical.starts[y];
+		for( long j = 0; j < mVertical.taps; ++j )
+			rows[j] = src + ( start + j < mSrcHeight ? start + j : mSrcHeight - 1 ) * srcRowBytes;
+		vertical( rows.data(), &mVertical.weights[y * mVertical.taps], mVertical.taps, mSrcWidth * info.channels, rowBuffer.data() );
+		horizontal( rowBuffer.data(), mHorizontal.starts.data(), mHorizontal.weights.data(), mHorizontal.taps, info, dst + y * dstRowBytes, mDstWidth );
+	}
+}
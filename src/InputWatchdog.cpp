@@ -0,0 +1,111 @@
+#include "InputWatchdog.h"
+
+#include <algorithm>
+
+using namespace media;
+
+namespace {
+	// Transitions kept between two popEvents(), the oldest ones go first. Only a consumer that never pops hits it.
+	const size_t kMaxEvents = 64;
+}
+
+InputWatchdog::InputWatchdog( double timeoutFrames )
+	: mTimeoutFrames{ std::max( timeoutFrames, 1.0 ) }
+	, mFrameDurationUs{ 0 }
+	, mState{ InputSignalState::WAITING }
+	, mLastArrivalUs{ 0 }
+	, mLastGoodUs{ 0 }
+	, mNextSubstituteUs{ 0 }
+{
+}
+
+void InputWatchdog::reset( int64_t frameDurationUs, int64_t timeUs )
+{
+	mFrameDurationUs = frameDurationUs;
+	mState = InputSignalState::WAITING;
+	// Timeouts in the WAITING state run from the start.
+	mLastArrivalUs = mLastGoodUs = mNextSubstituteUs = timeUs;
+	mEvents.clear();
+	mStats = InputWatchdogStats();
+}
+
+void InputWatchdog::setFrameDuration( int64_t frameDurationUs )
+{
+	mFrameDurationUs = frameDurationUs;
+}
+
+bool InputWatchdog::onFrame( bool hasSignal, int64_t timeUs )
+{
+	mLastArrivalUs = timeUs;
+	if( hasSignal ) {
+		++mStats.goodFrames;
+		if( mState != InputSignalState::LOCKED )
+			transition( InputSignalState::LOCKED, timeUs );
+		mLastGoodUs = timeUs;
+		return false;
+	}
+
+	++mStats.noSignalFrames;
+	// A stall that ends on frames without a signal is still a loss, only of another kind.
+	if( mState == InputSignalState::STALLED || ( mState != InputSignalState::NO_SIGNAL && timeUs - mLastGoodUs >= getTimeoutUs() ) )
+		transition( InputSignalState::NO_SIGNAL, timeUs );
+	return true;
+}
+
+bool InputWatchdog::onTick( int64_t timeUs )
+{
+	if( mFrameDurationUs <= 0 )
+		return false;
+
+	if( mState != InputSignalState::STALLED ) {
+		if( timeUs - mLastArrivalUs < getTimeoutUs() )
+			return false;
+		transition( InputSignalState::STALLED, timeUs );
+		mNextSubstituteUs = timeUs;
+	}
+
+	// Ticks come from a timer that may fire anywhere in the frame, a quarter frame of slack keeps them from beating.
+	if( timeUs < mNextSubstituteUs - mFrameDurationUs / 4 )
+		return false;
+	mNextSubstituteUs += mFrameDurationUs;
+	// Resynchronizes after a late timer rather than catching up with a burst.
+	if( mNextSubstituteUs <= timeUs )
+		mNextSubstituteUs = timeUs + mFrameDurationUs;
+	return true;
+}
+
+std::vector<InputSignalEvent> InputWatchdog::popEvents()
+{
+	std::vector<InputSignalEvent> events;
+	events.swap( mEvents );
+	return events;
+}
+
+void InputWatchdog::transition( InputSignalState state, int64_t timeUs )
+{
+	InputSignalEvent event;
+	event.state = state;
+	event.previous = mState;
+	event.timeUs = timeUs;
+	event.outageUs = timeUs - mLastGoodUs;
+
+	if( mState == InputSignalState::LOCKED )
+		++mStats.losses;
+	if( state == InputSignalState::STALLED )
+		++mStats.stalls;
+	if( state == InputSignalState::LOCKED && mState != InputSignalState::WAITING ) {
+		mStats.lastOutageUs = double( event.outageUs );
+		mStats.longestOutageUs = std::max( mStats.longestOutageUs, mStats.lastOutageUs );
+	}
+
+	mState = state;
+	mStats.state = state;
+	if( mEvents.size() >= kMaxEvents )
+		mEvents.erase( mEvents.begin() );
+	mEvents.push_back( event );
+}
+
+int64_t InputWatchdog::getTimeoutUs() const
+{
+	return int64_t( mTimeoutFrames * double( mFrameDurationUs ) );
+}
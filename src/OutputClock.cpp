@@ -0,0 +1,92 @@
+#include "OutputClock.h"
+
+#include <algorithm>
+
+using namespace media;
+
+OutputClock::OutputClock( const OutputClockOptions& options )
+	: mOptions( options )
+{
+	mOptions.driftWindow = std::max<size_t>( mOptions.driftWindow, 2 );
+	reset( 0, 0 );
+}
+
+void OutputClock::reset( int64_t frameDuration, int64_t timeScale )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mFrameDuration = frameDuration;
+	mTimeScale = timeScale;
+	mSamples.clear();
+	mSamples.reserve( mOptions.driftWindow );
+	mNextSample = 0;
+	mLastSampleUs = 0;
+	mStats = OutputClockStats();
+}
+
+uint64_t OutputClock::getScheduleSlot( uint64_t nextSlot, int64_t streamTime )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( mFrameDuration <= 0 || mTimeScale <= 0 || streamTime < 0 )
+		return nextSlot;
+
+	// The frame on air is streamTime / duration, the first slot that can still make it is the one after.
+	const uint64_t firstSlot = uint64_t( streamTime / mFrameDuration ) + mOptions.minLeadFrames;
+	uint64_t slot = nextSlot;
+	if( slot < firstSlot ) {
+		++mStats.resyncs;
+		mStats.skippedSlots += firstSlot - slot;
+		slot = firstSlot;
+	}
+	mStats.leadMs = 1000.0 * double( int64_t( slot ) * mFrameDuration - streamTime ) / double( mTimeScale );
+	return slot;
+}
+
+void OutputClock::addClockSample( int64_t hardwareUs, int64_t hostUs )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( ! mSamples.empty() && double( hostUs - mLastSampleUs ) < mOptions.driftSampleIntervalMs * 1000.0 )
+		return;
+
+	mLastSampleUs = hostUs;
+	const Sample sample = { hardwareUs, hostUs };
+	if( mSamples.size() < mOptions.driftWindow )
+		mSamples.push_back( sample );
+	else
+		mSamples[mNextSample] = sample;
+	mNextSample = ( mNextSample + 1 ) % mOptions.driftWindow;
+	updateDrift();
+}
+
+void OutputClock::updateDrift()
+{
+	// Relative to the first sample so that the sums keep their precision over long runs.
+	const Sample& origin = mSamples[mNextSample < mSamples.size() ? mNextSample : 0];
+	double meanHost = 0.0, meanHardware = 0.0;
+	for( const auto& sample : mSamples ) {
+		meanHost += double( sample.hostUs - origin.hostUs );
+		meanHardware += double( sample.hardwareUs - origin.hardwareUs );
+	}
+	meanHost /= double( mSamples.size() );
+	meanHardware /= double( mSamples.size() );
+
+	double covariance = 0.0, variance = 0.0, minHost = 0.0, maxHost = 0.0;
+	for( const auto& sample : mSamples ) {
+		const double host = double( sample.hostUs - origin.hostUs );
+		const double hardware = double( sample.hardwareUs - origin.hardwareUs );
+		covariance += ( host - meanHost ) * ( hardware - meanHardware );
+		variance += ( host - meanHost ) * ( host - meanHost );
+		minHost = std::min( minHost, host );
+		maxHost = std::max( maxHost, host );
+	}
+
+	mStats.driftSamples = mSamples.size();
+	mStats.driftSpanMs = ( maxHost - minHost ) / 1000.0;
+	mStats.driftValid = mSamples.size() >= 2 && variance > 0.0;
+	mStats.driftPpm = mStats.driftValid ? ( covariance / variance - 1.0 ) * 1e6 : 0.0;
+}
+
+OutputClockStats OutputClock::getStats() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mStats;
+}
@@ -0,0 +1,127 @@
+#include "OutputReadback.h"
+
+#include "cinder/Log.h"
+
+using namespace media;
+
+namespace {
+	// Upper bound on a blocking fence wait, a lost context should not hang the render thread.
+	const GLuint64 kFenceTimeoutNs = 100 * 1000 * 1000;
+}
+
+OutputReadbackRef OutputReadback::create( const glm::ivec2& size, size_t depth )
+{
+	return OutputReadbackRef( new OutputReadback{ size, depth } );
+}
+
+OutputReadback::OutputReadback( const glm::ivec2& size, size_t depth )
+	: mSize{ size }
+	, mRowBytes{ size_t( size.x ) * 4 }
+	, mTransfers( depth > 0 ? depth : 1 )
+	, mOldest{ 0 }
+	, mPending{ 0 }
+	, mLatencySumMs{ 0.0 }
+{
+	for( auto& transfer : mTransfers ) {
+		transfer.pbo = ci::gl::Pbo::create( GL_PIXEL_PACK_BUFFER, mRowBytes * size.y, nullptr, GL_STREAM_READ );
+		transfer.index = 0;
+	}
+	mStats.depth = mTransfers.size();
+}
+
+OutputReadback::Transfer& OutputReadback::beginTransfer()
+{
+	// collect() leaves at most depth - 1 transfers in flight, so the slot after the newest one is free.
+	Transfer& transfer = mTransfers[( mOldest + mPending ) % mTransfers.size()];
+	transfer.index = mStats.reads;
+	transfer.issued = std::chrono::steady_clock::now();
+	return transfer;
+}
+
+void OutputReadback::endTransfer( Transfer& transfer )
+{
+	transfer.fence = ci::gl::Sync::create();
+	// Submit now so the fence can signal while the next frame is rendered.
+	glFlush();
+	++mPending;
+	++mStats.reads;
+}
+
+void OutputReadback::readFramebuffer( const ConsumeFn& consume )
+{
+	Transfer& transfer = beginTransfer();
+	{
+		ci::gl::ScopedBuffer scopedPbo{ transfer.pbo };
+		GLint oldPackAlignment;
+		glGetIntegerv( GL_PACK_ALIGNMENT, &oldPackAlignment );
+		glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+		glReadPixels( 0, 0, mSize.x, mSize.y, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr );
+		glPixelStorei( GL_PACK_ALIGNMENT, oldPackAlignment );
+	}
+	endTransfer( transfer );
+	collect( consume );
+}
+
+void OutputReadback::readTexture( const ci::gl::Texture2dRef& texture, const ConsumeFn& consume )
+{
+	if( texture->getSize() != mSize ) {
+		CI_LOG_E( "Texture size does not match the readback size." );
+		return;
+	}
+
+	Transfer& transfer = beginTransfer();
+	{
+		ci::gl::ScopedBuffer scopedPbo{ transfer.pbo };
+		ci::gl::ScopedTextureBind tex0{ texture };
+		glGetTexImage( GL_TEXTURE_2D, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr );
+	}
+	endTransfer( transfer );
+	collect( consume );
+}
+
+void OutputReadback::collect( const ConsumeFn& consume )
+{
+	// Wait for transfers beyond the allowed depth, then take whatever else already finished. Only the newest finished
+	// frame is worth mapping, the consumer would drop the older ones anyway.
+	Transfer * newest = nullptr;
+	while( mPending > 0 ) {
+		Transfer& oldest = mTransfers[mOldest];
+		const bool mustWait = mPending >= mTransfers.size();
+		const GLenum status = oldest.fence->clientWaitSync( GL_SYNC_FLUSH_COMMANDS_BIT, mustWait ? kFenceTimeoutNs : 0 );
+		if( status == GL_TIMEOUT_EXPIRED && ! mustWait )
+			break;
+		if( status == GL_WAIT_FAILED || status == GL_TIMEOUT_EXPIRED )
+			CI_LOG_W( "Readback fence wait failed, the frame may be incomplete." );
+
+		oldest.fence.reset();
+		if( newest )
+			++mStats.discarded;
+		newest = &oldest;
+		mOldest = ( mOldest + 1 ) % mTransfers.size();
+		--mPending;
+	}
+
+	if( ! newest )
+		return;
+
+	const void * pixels = newest->pbo->mapBufferRange( 0, mRowBytes * mSize.y, GL_MAP_READ_BIT );
+	if( pixels ) {
+		consume( (const uint8_t*)pixels, mRowBytes );
+		newest->pbo->unmap();
+	}
+	else {
+		CI_LOG_E( "Unable to map the readback buffer." );
+	}
+
+	const double latencyMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - newest->issued ).count();
+	++mStats.completed;
+	mStats.lastLatencyFrames = mStats.reads - 1 - newest->index;
+	mStats.lastLatencyMs = latencyMs;
+	mLatencySumMs += latencyMs;
+	mStats.meanLatencyMs = mLatencySumMs / mStats.completed;
+}
+
+ReadbackStats OutputReadback::getStats() const
+{
+	return mStats;
+}
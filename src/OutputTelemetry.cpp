@@ -0,0 +1,191 @@
+#include "OutputTelemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace media;
+
+namespace {
+	// Late share bins of the late-rate histogram: clean windows, then tenths.
+	const size_t kLateRateBins = 11;
+
+	const char * getCompletionName( FrameCompletion result )
+	{
+		switch( result ) {
+		case FrameCompletion::LATE:		return "late";
+		case FrameCompletion::DROPPED:	return "dropped";
+		case FrameCompletion::FLUSHED:	return "flushed";
+		default:						return "completed";
+		}
+	}
+}
+
+OutputTelemetry::OutputTelemetry( const OutputTelemetryOptions& options )
+	: mOptions( options )
+{
+	mOptions.timelineFrames = std::max<size_t>( mOptions.timelineFrames, 1 );
+	mOptions.jitterBins = std::max<size_t>( mOptions.jitterBins, 1 );
+	if( mOptions.jitterBinMs <= 0.0 )
+		mOptions.jitterBinMs = OutputTelemetryOptions().jitterBinMs;
+	reset( 0, 0 );
+}
+
+void OutputTelemetry::reset( int64_t frameDuration, int64_t timeScale )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mFrameMs = timeScale > 0 ? 1000.0 * double( frameDuration ) / double( timeScale ) : 0.0;
+	mTimeScale = timeScale;
+	mLateWindowFrames = mOptions.lateWindowFrames;
+	if( mLateWindowFrames == 0 )
+		mLateWindowFrames = mFrameMs > 0.0 ? size_t( std::ceil( 1000.0 / mFrameMs ) ) : 60;
+
+	mPending.clear();
+	mNextIndex = 0;
+	mTimeline.clear();
+	mTimeline.reserve( mOptions.timelineFrames );
+	mTimelineNext = 0;
+	mLastCompletionUs = -1;
+
+	mStats = OutputTelemetryStats();
+	mJitterSumMs = 0.0;
+	mJitterSquareSumMs = 0.0;
+	mJitterCount = 0;
+	mJitterCounts.assign( mOptions.jitterBins, 0 );
+	mLateRateCounts.assign( kLateRateBins, 0 );
+	mWindowFrames = 0;
+	mWindowLate = 0;
+}
+
+void OutputTelemetry::onFrameScheduled( int64_t scheduledTime )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	Scheduled scheduled = { mNextIndex++, scheduledTime };
+	mPending.push_back( scheduled );
+	++mStats.scheduled;
+}
+
+void OutputTelemetry::onFrameCompleted( FrameCompletion result, int64_t completionTimeUs )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	FrameTiming timing;
+	timing.result = result;
+	timing.completionTimeUs = completionTimeUs >= 0 ? completionTimeUs : -1;
+	if( ! mPending.empty() ) {
+		timing.index = mPending.front().index;
+		timing.scheduledTime = mPending.front().time;
+		mPending.pop_front();
+	}
+	else {
+		timing.index = mNextIndex++;
+	}
+
+	switch( result ) {
+	case FrameCompletion::LATE:		++mStats.late; break;
+	case FrameCompletion::DROPPED:	++mStats.dropped; break;
+	case FrameCompletion::FLUSHED:	++mStats.flushed; break;
+	default:						++mStats.completed; break;
+	}
+
+	// Flushed frames never reached the output and say nothing about pacing.
+	if( result != FrameCompletion::FLUSHED ) {
+		if( timing.completionTimeUs >= 0 && mLastCompletionUs >= 0 ) {
+			timing.jitterMs = double( timing.completionTimeUs - mLastCompletionUs ) / 1000.0 - mFrameMs;
+			mJitterSumMs += timing.jitterMs;
+			mJitterSquareSumMs += timing.jitterMs * timing.jitterMs;
+			++mJitterCount;
+			mStats.maxJitterMs = std::max( mStats.maxJitterMs, std::abs( timing.jitterMs ) );
+
+			const double bin = std::floor( timing.jitterMs / mOptions.jitterBinMs + 0.5 ) + double( mOptions.jitterBins / 2 );
+			mJitterCounts[size_t( std::min( std::max( bin, 0.0 ), double( mOptions.jitterBins - 1 ) ) )]++;
+		}
+		if( timing.completionTimeUs >= 0 )
+			mLastCompletionUs = timing.completionTimeUs;
+
+		++mWindowFrames;
+		if( result == FrameCompletion::LATE || result == FrameCompletion::DROPPED )
+			++mWindowLate;
+		if( mWindowFrames >= mLateWindowFrames ) {
+			const size_t bin = mWindowLate == 0 ? 0 : ( mWindowLate * ( kLateRateBins - 1 ) + mWindowFrames - 1 ) / mWindowFrames;
+			mLateRateCounts[std::min( bin, kLateRateBins - 1 )]++;
+			mWindowFrames = 0;
+			mWindowLate = 0;
+		}
+	}
+
+	if( mTimeline.size() < mOptions.timelineFrames )
+		mTimeline.push_back( timing );
+	else
+		mTimeline[mTimelineNext] = timing;
+	mTimelineNext = ( mTimelineNext + 1 ) % mOptions.timelineFrames;
+}
+
+OutputTelemetryStats OutputTelemetry::getStats() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	OutputTelemetryStats stats = mStats;
+	const uint64_t shown = stats.completed + stats.late + stats.dropped;
+	stats.lateRate = shown ? double( stats.late + stats.dropped ) / double( shown ) : 0.0;
+	if( mJitterCount ) {
+		stats.meanJitterMs = mJitterSumMs / double( mJitterCount );
+		stats.rmsJitterMs = std::sqrt( mJitterSquareSumMs / double( mJitterCount ) );
+	}
+	return stats;
+}
+
+std::vector<FrameTiming> OutputTelemetry::getTimeline() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	if( mTimeline.size() < mOptions.timelineFrames )
+		return mTimeline;
+
+	std::vector<FrameTiming> timeline;
+	timeline.reserve( mTimeline.size() );
+	timeline.insert( timeline.end(), mTimeline.begin() + mTimelineNext, mTimeline.end() );
+	timeline.insert( timeline.end(), mTimeline.begin(), mTimeline.begin() + mTimelineNext );
+	return timeline;
+}
+
+TelemetryHistogram OutputTelemetry::getJitterHistogram() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	TelemetryHistogram histogram;
+	histogram.counts = mJitterCounts;
+	for( size_t i = 0; i < mOptions.jitterBins; ++i )
+		histogram.lowerEdges.push_back( ( double( i ) - double( mOptions.jitterBins / 2 ) - 0.5 ) * mOptions.jitterBinMs );
+	return histogram;
+}
+
+TelemetryHistogram OutputTelemetry::getLateRateHistogram() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	TelemetryHistogram histogram;
+	histogram.counts = mLateRateCounts;
+	histogram.lowerEdges.push_back( 0.0 );
+	for( size_t i = 1; i < kLateRateBins; ++i )
+		histogram.lowerEdges.push_back( double( i - 1 ) / double( kLateRateBins - 1 ) );
+	return histogram;
+}
+
+bool OutputTelemetry::writeTimeline( const ci::fs::path& path ) const
+{
+	const std::vector<FrameTiming> timeline = getTimeline();
+	int64_t timeScale;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		timeScale = mTimeScale;
+	}
+
+	std::ofstream file( path.string().c_str() );
+	if( ! file )
+		return false;
+
+	file << "index,scheduled_time,scheduled_ms,result,completion_us,jitter_ms\n";
+	for( const auto& timing : timeline ) {
+		const double scheduledMs = timeScale > 0 && timing.scheduledTime >= 0 ? 1000.0 * double( timing.scheduledTime ) / double( timeScale ) : -1.0;
+		file << timing.index << ',' << timing.scheduledTime << ',' << scheduledMs << ','
+			<< getCompletionName( timing.result ) << ',' << timing.completionTimeUs << ',' << timing.jitterMs << '\n';
+	}
+	return bool( file );
+}
@@ -0,0 +1,93 @@
+#include "PrerollController.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace media;
+
+namespace {
+	// Keeps a target of exactly N frames from rounding up to N + 1.
+	const double kFrameEpsilon = 1e-6;
+	// Frames scheduled per completion when growing, one replaces the completed frame and one is added.
+	const unsigned kMaxScheduledFrames = 2;
+}
+
+PrerollController::PrerollController( const PrerollOptions& options )
+	: mOptions( options )
+	, mFrameMs{ 0.0 }
+	, mFloorFrames{ 0 }
+	, mTargetFrames{ 0 }
+	, mCleanFrames{ 0 }
+	, mShrinkFrames{ 0 }
+	, mHoldoffFrames{ 0 }
+{
+	mOptions.minFrames = std::max( mOptions.minFrames, 1u );
+	mOptions.maxFrames = std::max( mOptions.maxFrames, mOptions.minFrames );
+}
+
+unsigned PrerollController::reset( int64_t frameDuration, int64_t timeScale )
+{
+	mFrameMs = timeScale > 0 ? 1000.0 * double( frameDuration ) / double( timeScale ) : 0.0;
+
+	const double frames = mFrameMs > 0.0 ? std::ceil( mOptions.targetLatencyMs / mFrameMs - kFrameEpsilon ) : 0.0;
+	mFloorFrames = unsigned( std::min( std::max( frames, double( mOptions.minFrames ) ), double( mOptions.maxFrames ) ) );
+	mTargetFrames = mFloorFrames;
+	mCleanFrames = 0;
+	mShrinkFrames = mFrameMs > 0.0 ? std::max<uint64_t>( uint64_t( std::ceil( mOptions.shrinkAfterMs / mFrameMs ) ), 1 ) : 1;
+	mHoldoffFrames = 0;
+	mStats = PrerollStats();
+	return mTargetFrames;
+}
+
+unsigned PrerollController::onFrameCompleted( FrameCompletion completion, unsigned bufferedFrames )
+{
+	mStats.bufferedFrames = bufferedFrames;
+	switch( completion ) {
+	case FrameCompletion::LATE:		++mStats.late; break;
+	case FrameCompletion::DROPPED:	++mStats.dropped; break;
+	case FrameCompletion::FLUSHED:	++mStats.flushed; return 0;
+	default:						++mStats.completed; break;
+	}
+
+	if( mHoldoffFrames > 0 )
+		--mHoldoffFrames;
+
+	if( completion == FrameCompletion::LATE || completion == FrameCompletion::DROPPED ) {
+		mCleanFrames = 0;
+		// Frames queued before the last growth were scheduled too close to air already, wait for them to drain.
+		if( mHoldoffFrames == 0 && mTargetFrames < mOptions.maxFrames ) {
+			++mTargetFrames;
+			++mStats.grows;
+			mHoldoffFrames = mTargetFrames;
+		}
+	}
+	else if( ++mCleanFrames >= mShrinkFrames ) {
+		mCleanFrames = 0;
+		if( mTargetFrames > mFloorFrames ) {
+			--mTargetFrames;
+			++mStats.shrinks;
+		}
+	}
+
+	if( bufferedFrames >= mTargetFrames )
+		return 0;
+	return std::min( mTargetFrames - bufferedFrames, kMaxScheduledFrames );
+}
+
+unsigned PrerollController::onFrameCompleted( FrameCompletion completion )
+{
+	switch( completion ) {
+	case FrameCompletion::LATE:		++mStats.late; return 1;
+	case FrameCompletion::DROPPED:	++mStats.dropped; return 1;
+	case FrameCompletion::FLUSHED:	++mStats.flushed; return 0;
+	default:						++mStats.completed; return 1;
+	}
+}
+
+PrerollStats PrerollController::getStats() const
+{
+	PrerollStats stats = mStats;
+	stats.targetFrames = mTargetFrames;
+	stats.latencyMs = mTargetFrames * mFrameMs;
+	return stats;
+}
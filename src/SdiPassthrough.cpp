@@ -0,0 +1,340 @@
+#include "SdiPassthrough.h"
+
+#include "cinder/Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace media;
+
+namespace {
+	const BMDTimeScale kMicrosecondTimeScale = 1000000;
+	const BMDTimeScale kAudioSampleRate = 48000;
+	// Time constant of the audio latency following the frame sync latency. A repeat or a drop moves the video by a whole
+	// frame at once, the audio slews over to it at a pitch change too small to hear.
+	const double kAudioLatencySmoothingUs = 30e6;
+
+	int64_t getHostTimeUs()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	void clearFrame( OutputFrame& frame )
+	{
+		// Zero is not black in YUV, encode one black row and repeat it.
+		const std::vector<uint8_t> black( size_t( frame.getWidth() ) * 4, 0 );
+		const size_t rowBytes = frame.getRowBytes();
+		if( frame.getPixelFormat() == bmdFormat10BitYUV )
+			convertBGRAToV210( black.data(), black.size(), frame.getData(), rowBytes, frame.getWidth(), 1 );
+		else if( frame.getPixelFormat() == bmdFormat8BitYUV )
+			convertBGRAToUYVY( black.data(), black.size(), frame.getData(), rowBytes, frame.getWidth(), 1 );
+		else
+			std::memset( frame.getData(), 0, rowBytes );
+		for( long row = 1; row < frame.getHeight(); ++row )
+			std::memcpy( frame.getData() + row * rowBytes, frame.getData(), rowBytes );
+	}
+}
+
+SdiPassthroughRef SdiPassthrough::create( DeckLinkInput * input, DeckLinkOutput * output, const PassthroughOptions& options )
+{
+	return SdiPassthroughRef( new SdiPassthrough{ input, output, options } );
+}
+
+SdiPassthrough::SdiPassthrough( DeckLinkInput * input, DeckLinkOutput * output, const PassthroughOptions& options )
+	: mInput{ input }
+	, mOutput{ output }
+	, mOptions( options )
+	, mSync( options.frameSyncOptions )
+	, mRunning{ false }
+	, mLatencySumUs{ 0.0 }
+	, mDrift( options.audioDriftOptions )
+	, mAudioReadPosition{ 0 }
+	, mAudioLocked{ false }
+	, mAudioLatencyUs{ 0.0 }
+	, mAudioLatencyTimeUs{ -1 }
+{
+}
+
+SdiPassthrough::~SdiPassthrough()
+{
+	stop();
+}
+
+void SdiPassthrough::addHook( const PassthroughHook& hook )
+{
+	if( mRunning ) {
+		CI_LOG_W( "Cannot change the passthrough hooks while running." );
+		return;
+	}
+
+	mHooks.push_back( hook );
+}
+
+void SdiPassthrough::clearHooks()
+{
+	if( mRunning ) {
+		CI_LOG_W( "Cannot change the passthrough hooks while running." );
+		return;
+	}
+
+	mHooks.clear();
+}
+
+bool SdiPassthrough::start( BMDDisplayMode videoMode, BMDPixelFormat pixelFormat )
+{
+	if( mRunning || ! mInput || ! mOutput )
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mStats = PassthroughStats();
+		mLatencySumUs = 0.0;
+	}
+
+	// Set before the output starts, the first fill requests come in from its preroll.
+	const bool audio = mOptions.audio && mOptions.frameSync;
+	if( mOptions.audio && ! mOptions.frameSync )
+		CI_LOG_W( "Audio passthrough needs frame sync, forwarding the video only." );
+	mResampler.reset();
+	if( audio ) {
+		AudioCaptureOptions captureOptions = mInput->getAudioCaptureOptions();
+		captureOptions.enabled = true;
+		captureOptions.channels = mOptions.audioChannels;
+		captureOptions.sampleType = mOptions.audioSampleType;
+		mInput->setAudioCaptureOptions( captureOptions );
+		AudioOutputOptions outputOptions = mOutput->getAudioOutputOptions();
+		outputOptions.enabled = true;
+		outputOptions.channels = mOptions.audioChannels;
+		outputOptions.sampleType = mOptions.audioSampleType;
+		mOutput->setAudioOutputOptions( outputOptions );
+
+		mDrift.reset();
+		mResampler = AudioResampler::create( mOptions.audioChannels, mOptions.audioResamplerOptions );
+		mAudioLocked = false;
+		mAudioLatencyUs = 0.0;
+		mAudioLatencyTimeUs = -1;
+	}
+
+	// The output runs first so that the first captured frame already has a slot to go to.
+	bool outputStarted;
+	if( mOptions.frameSync ) {
+		mOutput->setFillCallback( [this]( OutputFrame& frame, const OutputFrameTime& time ) { fillFrame( frame, time ); } );
+		outputStarted = mOutput->start( videoMode, pixelFormat );
+		mSync.reset( mOutput->getFrameDurationUs() );
+	}
+	else
+		outputStarted = mOutput->startPassthrough( videoMode, pixelFormat, mOptions.leadFrames );
+	if( ! outputStarted ) {
+		mOutput->setFillCallback( nullptr );
+		return false;
+	}
+
+	mInput->setRawFrameCallback( [this]( IDeckLinkVideoInputFrame * frame ) { forwardFrame( frame ); } );
+	if( ! mInput->start( videoMode, true, pixelFormat ) ) {
+		mInput->setRawFrameCallback( nullptr );
+		mOutput->stop();
+		mOutput->setFillCallback( nullptr );
+		return false;
+	}
+
+	mRunning = true;
+	return true;
+}
+
+void SdiPassthrough::stop()
+{
+	if( ! mRunning )
+		return;
+
+	// Capture stops first, no frame gets scheduled on a stopped output.
+	mInput->stop();
+	mInput->setRawFrameCallback( nullptr );
+	mOutput->stop();
+	mOutput->setFillCallback( nullptr );
+	// Gives the buffered capture frames back to the input.
+	mSync.reset( 0 );
+	mRunning = false;
+}
+
+void SdiPassthrough::forwardFrame( IDeckLinkVideoInputFrame * frame )
+{
+	const int64_t arrivalUs = getHostTimeUs();
+
+	PassthroughFrame passthroughFrame;
+	void * bytes = NULL;
+	if( frame->GetBytes( &bytes ) == S_OK )
+		passthroughFrame.data = (uint8_t*)bytes;
+	passthroughFrame.width = frame->GetWidth();
+	passthroughFrame.height = frame->GetHeight();
+	passthroughFrame.rowBytes = frame->GetRowBytes();
+	passthroughFrame.pixelFormat = frame->GetPixelFormat();
+	passthroughFrame.deckLinkFrame = frame;
+	BMDTimeValue streamTime, frameDuration;
+	if( frame->GetStreamTime( &streamTime, &frameDuration, kMicrosecondTimeScale ) == S_OK ) {
+		passthroughFrame.streamTimeUs = streamTime;
+		passthroughFrame.frameDurationUs = frameDuration;
+	}
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		passthroughFrame.frameIndex = mStats.received++;
+	}
+
+	if( passthroughFrame.data ) {
+		for( const auto& hook : mHooks )
+			hook( passthroughFrame );
+	}
+	const int64_t hookEndUs = getHostTimeUs();
+
+	if( mOptions.frameSync ) {
+		// The card timestamps captures on the same hardware clock the output slots are estimated on.
+		BMDTimeValue hardwareTime, hardwareDuration;
+		const bool timestamped = frame->GetHardwareReferenceTimestamp( kMicrosecondTimeScale, &hardwareTime, &hardwareDuration ) == S_OK;
+		if( timestamped )
+			mSync.push( RefPtr<IDeckLinkVideoInputFrame>( frame ), hardwareTime );
+		// The audio of a frame starts at its stream time, so frames timestamp the input audio on the same clock.
+		BMDTimeValue audioPosition, audioDuration;
+		if( timestamped && mResampler && frame->GetStreamTime( &audioPosition, &audioDuration, kAudioSampleRate ) == S_OK )
+			mDrift.addInputTimestamp( audioPosition, hardwareTime );
+
+		std::lock_guard<std::mutex> lock( mMutex );
+		mStats.hookUs = double( hookEndUs - arrivalUs );
+		if( mStats.hookUs > mStats.maxHookUs )
+			mStats.maxHookUs = mStats.hookUs;
+		if( ! timestamped )
+			++mStats.dropped;
+		return;
+	}
+
+	int64_t displayDelayUs = 0;
+	const bool forwarded = mOutput->schedulePassthroughFrame( frame, &displayDelayUs );
+	const int64_t scheduledUs = getHostTimeUs();
+
+	std::lock_guard<std::mutex> lock( mMutex );
+	mStats.hookUs = double( hookEndUs - arrivalUs );
+	if( mStats.hookUs > mStats.maxHookUs )
+		mStats.maxHookUs = mStats.hookUs;
+	if( ! forwarded ) {
+		++mStats.dropped;
+		return;
+	}
+
+	++mStats.forwarded;
+	mStats.latencyUs = double( passthroughFrame.frameDurationUs + ( scheduledUs - arrivalUs ) + displayDelayUs );
+	mStats.latencyFrames = passthroughFrame.frameDurationUs > 0 ? mStats.latencyUs / double( passthroughFrame.frameDurationUs ) : 0.0;
+	mLatencySumUs += mStats.latencyUs;
+	mStats.meanLatencyUs = mLatencySumUs / double( mStats.forwarded );
+	if( mStats.latencyUs > mStats.maxLatencyUs )
+		mStats.maxLatencyUs = mStats.latencyUs;
+}
+
+void SdiPassthrough::fillFrame( OutputFrame& frame, const OutputFrameTime& time )
+{
+	RefPtr<IDeckLinkVideoInputFrame> input;
+	const bool selected = time.hardwareTimeUs >= 0 && mSync.select( time.hardwareTimeUs, &input );
+	fillAudio( time );
+	if( ! selected ) {
+		clearFrame( frame );
+		return;
+	}
+
+	void * bytes = NULL;
+	if( input->GetBytes( &bytes ) != S_OK || input->GetWidth() != frame.getWidth() || input->GetHeight() != frame.getHeight() || input->GetPixelFormat() != frame.getPixelFormat() ) {
+		clearFrame( frame );
+		std::lock_guard<std::mutex> lock( mMutex );
+		++mStats.dropped;
+		return;
+	}
+
+	const size_t srcRowBytes = input->GetRowBytes();
+	const size_t dstRowBytes = frame.getRowBytes();
+	if( srcRowBytes == dstRowBytes )
+		std::memcpy( frame.getData(), bytes, dstRowBytes * frame.getHeight() );
+	else {
+		const size_t copyBytes = srcRowBytes < dstRowBytes ? srcRowBytes : dstRowBytes;
+		for( long row = 0; row < frame.getHeight(); ++row )
+			std::memcpy( frame.getData() + row * dstRowBytes, (const uint8_t*)bytes + row * srcRowBytes, copyBytes );
+	}
+
+	const double frameDurationUs = time.timeScale > 0 ? 1e6 * double( time.frameDuration ) / double( time.timeScale ) : 0.0;
+	const double syncLatencyUs = mSync.getStats().latencyUs;
+	std::lock_guard<std::mutex> lock( mMutex );
+	++mStats.forwarded;
+	mStats.latencyUs = frameDurationUs + syncLatencyUs;
+	mStats.latencyFrames = frameDurationUs > 0.0 ? mStats.latencyUs / frameDurationUs : 0.0;
+	mLatencySumUs += mStats.latencyUs;
+	mStats.meanLatencyUs = mLatencySumUs / double( mStats.forwarded );
+	if( mStats.latencyUs > mStats.maxLatencyUs )
+		mStats.maxLatencyUs = mStats.latencyUs;
+}
+
+void SdiPassthrough::fillAudio( const OutputFrameTime& time )
+{
+	if( ! mResampler || time.hardwareTimeUs < 0 || time.audioSampleFrames <= 0 )
+		return;
+
+	mDrift.addOutputTimestamp( time.audioPosition, time.hardwareTimeUs );
+
+	// Audio goes out with the video it came with, until the frame sync has picked a frame the output pads it with silence.
+	const FrameSyncStats syncStats = mSync.getStats();
+	if( syncStats.selected == 0 )
+		return;
+	const double videoLatencyUs = syncStats.latencyUs + 1000.0 * mOptions.audioDelayMs;
+	if( mAudioLatencyTimeUs < 0 )
+		mAudioLatencyUs = videoLatencyUs;
+	else {
+		const double elapsedUs = double( std::max<int64_t>( time.hardwareTimeUs - mAudioLatencyTimeUs, 0 ) );
+		mAudioLatencyUs += ( videoLatencyUs - mAudioLatencyUs ) * std::min( elapsedUs / kAudioLatencySmoothingUs, 1.0 );
+	}
+	mAudioLatencyTimeUs = time.hardwareTimeUs;
+
+	// The position the resampler is centered on lags the read position by the frames it still holds.
+	const double readPosition = double( mAudioReadPosition ) - mResampler->getBufferedFrames();
+	AudioDriftControl control;
+	if( ! mDrift.update( readPosition, time.audioPosition, mAudioLatencyUs, &control ) )
+		return;
+	if( control.resync || ! mAudioLocked ) {
+		// Half the filter ahead of the target, so that the first frame out is centered on it.
+		mResampler->reset();
+		mAudioReadPosition = std::llround( control.targetPosition ) - int64_t( mResampler->getOptions().taps / 2 - 1 );
+		mAudioLocked = true;
+	}
+	mResampler->setRatio( control.ratio );
+
+	const size_t frameBytes = size_t( mOptions.audioChannels ) * ( mOptions.audioSampleType == bmdAudioSampleType32bitInteger ? 4 : 2 );
+	const size_t outputFrames = size_t( time.audioSampleFrames );
+	size_t inputFrames = mResampler->getInputFrames( outputFrames );
+	// Sized by the first blocks, the ratio stays within a few parts per thousand of 1.
+	if( mAudioInput.size() < inputFrames * frameBytes )
+		mAudioInput.resize( inputFrames * frameBytes );
+	if( mAudioOutput.size() < outputFrames * frameBytes )
+		mAudioOutput.resize( outputFrames * frameBytes );
+
+	if( ! mInput->readAudio( mAudioReadPosition, long( inputFrames ), mAudioInput.data() ) ) {
+		// Not captured yet or already overwritten. The output plays silence and the next block starts over at the latency
+		// the video is at, whose audio has been captured along with it.
+		mAudioLocked = false;
+		mAudioLatencyUs = videoLatencyUs;
+		std::lock_guard<std::mutex> lock( mMutex );
+		++mStats.audioGaps;
+		return;
+	}
+
+	size_t produced;
+	if( mOptions.audioSampleType == bmdAudioSampleType32bitInteger )
+		produced = mResampler->process( (const int32_t*)mAudioInput.data(), &inputFrames, (int32_t*)mAudioOutput.data(), outputFrames );
+	else
+		produced = mResampler->process( (const int16_t*)mAudioInput.data(), &inputFrames, (int16_t*)mAudioOutput.data(), outputFrames );
+	mAudioReadPosition += int64_t( inputFrames );
+	mOutput->writeAudio( time.audioPosition, mAudioOutput.data(), produced );
+
+	std::lock_guard<std::mutex> lock( mMutex );
+	mStats.audioLatencyUs = mAudioLatencyUs;
+}
+
+PassthroughStats SdiPassthrough::getStats() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mStats;
+}
@@ -0,0 +1,315 @@
+#include "VideoConversion.h"
+
+#include <cstring>
+
+#if defined( MEDIA_ARCH_X86 )
+	#include <emmintrin.h>
+	#include <immintrin.h>
+#elif defined( MEDIA_ARCH_NEON )
+	#include <arm_neon.h>
+#endif
+
+namespace media {
+
+namespace {
+
+	// Fixed point YCbCr to RGB coefficients, scaled by 2^kShift. Every kernel evaluates the exact
+	// same integer expression, which is what keeps them bit-exact against the scalar reference:
+	//   R = ( y * Y' + rv * V' + round ) >> kShift
+	//   G = ( y * Y' - gu * U' - gv * V' + round ) >> kShift
+	//   B = ( y * Y' + bu * U' + round ) >> kShift
+	// with Y' = Y - 16 and U', V' = U - 128, V - 128 (video range).
+	const int kShift = 13;
+	const int kRound = 1 << ( kShift - 1 );
+
+	struct YuvCoefficients {
+		int16_t y, rv, gu, gv, bu;
+	};
+
+	YuvCoefficients computeCoefficients( YCbCrMatrix matrix )
+	{
+		double kr, kb;
+		getYCbCrWeights( matrix, &kr, &kb );
+		const double kg = 1.0 - kr - kb;
+		const double scale = double( 1 << kShift );
+		const double ys = 255.0 / 219.0;
+		const double cs = 255.0 / 224.0;
+
+		YuvCoefficients c;
+		c.y = int16_t( ys * scale + 0.5 );
+		c.rv = int16_t( 2.0 * ( 1.0 - kr ) * cs * scale + 0.5 );
+		c.gu = int16_t( 2.0 * kb * ( 1.0 - kb ) / kg * cs * scale + 0.5 );
+		c.gv = int16_t( 2.0 * kr * ( 1.0 - kr ) / kg * cs * scale + 0.5 );
+		c.bu = int16_t( 2.0 * ( 1.0 - kb ) * cs * scale + 0.5 );
+		return c;
+	}
+
+	const YuvCoefficients& getCoefficients( YCbCrMatrix matrix )
+	{
+		static const YuvCoefficients bt601 = computeCoefficients( YCbCrMatrix::BT601 );
+		static const YuvCoefficients bt709 = computeCoefficients( YCbCrMatrix::BT709 );
+		static const YuvCoefficients bt2020 = computeCoefficients( YCbCrMatrix::BT2020 );
+		switch( matrix ) {
+		case YCbCrMatrix::BT601:	return bt601;
+		case YCbCrMatrix::BT2020:	return bt2020;
+		default:					return bt709;
+		}
+	}
+
+	inline uint8_t clampToByte( int value )
+	{
+		return uint8_t( value < 0 ? 0 : ( value > 255 ? 255 : value ) );
+	}
+
+	typedef void( *UYVYRowKernel )( const uint8_t * src, uint8_t * dst, long width, const YuvCoefficients& c );
+
+	void uyvyToBgraRowScalar( const uint8_t * src, uint8_t * dst, long width, const YuvCoefficients& c )
+	{
+		for( long x = 0; x < width; x += 2, src += 4 ) {
+			const int u = src[0] - 128;
+			const int v = src[2] - 128;
+			const int r = c.rv * v + kRound;
+			const int g = -c.gu * u - c.gv * v + kRound;
+			const int b = c.bu * u + kRound;
+
+			for( long i = 0; i < 2 && x + i < width; ++i, dst += 4 ) {
+				const int y = c.y * ( src[1 + 2 * i] - 16 );
+				dst[0] = clampToByte( ( y + b ) >> kShift );
+				dst[1] = clampToByte( ( y + g ) >> kShift );
+				dst[2] = clampToByte( ( y + r ) >> kShift );
+				dst[3] = 255;
+			}
+		}
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	inline int32_t packCoefficients( int lo, int hi )
+	{
+		return int32_t( uint32_t( uint16_t( lo ) ) | ( uint32_t( uint16_t( hi ) ) << 16 ) );
+	}
+
+	// 8 pixels (4 macropixels) per iteration. Chroma is duplicated to every pixel and interleaved
+	// with luma so that a single madd evaluates two terms of the fixed point expression.
+	void uyvyToBgraRowSse2( const uint8_t * src, uint8_t * dst, long width, const YuvCoefficients& c )
+	{
+		const __m128i byteMask = _mm_set1_epi16( 0x00FF );
+		const __m128i wordMask = _mm_set1_epi32( 0x0000FFFF );
+		const __m128i lumaOffset = _mm_set1_epi16( 16 );
+		const __m128i chromaOffset = _mm_set1_epi16( 128 );
+		const __m128i ones = _mm_set1_epi16( 1 );
+		const __m128i alpha = _mm_set1_epi16( 255 );
+		const __m128i round = _mm_set1_epi32( kRound );
+		const __m128i coefR = _mm_set1_epi32( packCoefficients( c.y, c.rv ) );
+		const __m128i coefB = _mm_set1_epi32( packCoefficients( c.y, c.bu ) );
+		const __m128i coefGyu = _mm_set1_epi32( packCoefficients( c.y, -c.gu ) );
+		const __m128i coefGv = _mm_set1_epi32( packCoefficients( -c.gv, kRound ) );
+
+		long x = 0;
+		for( ; x + 8 <= width; x += 8 ) {
+			const __m128i uyvy = _mm_loadu_si128( (const __m128i*)( src + x * 2 ) );
+			const __m128i y = _mm_sub_epi16( _mm_srli_epi16( uyvy, 8 ), lumaOffset );
+			const __m128i uv = _mm_sub_epi16( _mm_and_si128( uyvy, byteMask ), chromaOffset );
+			__m128i u = _mm_and_si128( uv, wordMask );
+			u = _mm_or_si128( u, _mm_slli_epi32( u, 16 ) );
+			__m128i v = _mm_srli_epi32( uv, 16 );
+			v = _mm_or_si128( v, _mm_slli_epi32( v, 16 ) );
+
+			const __m128i yuLo = _mm_unpacklo_epi16( y, u ), yuHi = _mm_unpackhi_epi16( y, u );
+			const __m128i yvLo = _mm_unpacklo_epi16( y, v ), yvHi = _mm_unpackhi_epi16( y, v );
+			const __m128i v1Lo = _mm_unpacklo_epi16( v, ones ), v1Hi = _mm_unpackhi_epi16( v, ones );
+
+			const __m128i r = _mm_packs_epi32(
+				_mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yvLo, coefR ), round ), kShift ),
+				_mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yvHi, coefR ), round ), kShift ) );
+			const __m128i g = _mm_packs_epi32(
+				_mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yuLo, coefGyu ), _mm_madd_epi16( v1Lo, coefGv ) ), kShift ),
+				_mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yuHi, coefGyu ), _mm_madd_epi16( v1Hi, coefGv ) ), kShift ) );
+			const __m128i b = _mm_packs_epi32(
+				_mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yuLo, coefB ), round ), kShift ),
+				_mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yuHi, coefB ), round ), kShift ) );
+
+			// packus clamps to [0, 255] exactly like clampToByte.
+			__m128i bg = _mm_packus_epi16( b, g );
+			__m128i ra = _mm_packus_epi16( r, alpha );
+			bg = _mm_unpacklo_epi8( bg, _mm_srli_si128( bg, 8 ) );
+			ra = _mm_unpacklo_epi8( ra, _mm_srli_si128( ra, 8 ) );
+			_mm_storeu_si128( (__m128i*)( dst + x * 4 ), _mm_unpacklo_epi16( bg, ra ) );
+			_mm_storeu_si128( (__m128i*)( dst + x * 4 + 16 ), _mm_unpackhi_epi16( bg, ra ) );
+		}
+
+		if( x < width )
+			uyvyToBgraRowScalar( src + x * 2, dst + x * 4, width - x, c );
+	}
+
+	// Same data flow as the SSE2 kernel on both 128-bit lanes, 16 pixels per iteration. The
+	// in-lane unpacks leave the pixels in [0-3 8-11] [4-7 12-15] order, fixed up on store.
+	MEDIA_TARGET_AVX2 void uyvyToBgraRowAvx2( const uint8_t * src, uint8_t * dst, long width, const YuvCoefficients& c )
+	{
+		const __m256i byteMask = _mm256_set1_epi16( 0x00FF );
+		const __m256i wordMask = _mm256_set1_epi32( 0x0000FFFF );
+		const __m256i lumaOffset = _mm256_set1_epi16( 16 );
+		const __m256i chromaOffset = _mm256_set1_epi16( 128 );
+		const __m256i ones = _mm256_set1_epi16( 1 );
+		const __m256i alpha = _mm256_set1_epi16( 255 );
+		const __m256i round = _mm256_set1_epi32( kRound );
+		const __m256i coefR = _mm256_set1_epi32( packCoefficients( c.y, c.rv ) );
+		const __m256i coefB = _mm256_set1_epi32( packCoefficients( c.y, c.bu ) );
+		const __m256i coefGyu = _mm256_set1_epi32( packCoefficients( c.y, -c.gu ) );
+		const __m256i coefGv = _mm256_set1_epi32( packCoefficients( -c.gv, kRound ) );
+
+		long x = 0;
+		for( ; x + 16 <= width; x += 16 ) {
+			const __m256i uyvy = _mm256_loadu_si256( (const __m256i*)( src + x * 2 ) );
+			const __m256i y = _mm256_sub_epi16( _mm256_srli_epi16( uyvy, 8 ), lumaOffset );
+			const __m256i uv = _mm256_sub_epi16( _mm256_and_si256( uyvy, byteMask ), chromaOffset );
+			__m256i u = _mm256_and_si256( uv, wordMask );
+			u = _mm256_or_si256( u, _mm256_slli_epi32( u, 16 ) );
+			__m256i v = _mm256_srli_epi32( uv, 16 );
+			v = _mm256_or_si256( v, _mm256_slli_epi32( v, 16 ) );
+
+			const __m256i yuLo = _mm256_unpacklo_epi16( y, u ), yuHi = _mm256_unpackhi_epi16( y, u );
+			const __m256i yvLo = _mm256_unpacklo_epi16( y, v ), yvHi = _mm256_unpackhi_epi16( y, v );
+			const __m256i v1Lo = _mm256_unpacklo_epi16( v, ones ), v1Hi = _mm256_unpackhi_epi16( v, ones );
+
+			const __m256i r = _mm256_packs_epi32(
+				_mm256_srai_epi32( _mm256_add_epi32( _mm256_madd_epi16( yvLo, coefR ), round ), kShift ),
+				_mm256_srai_epi32( _mm256_add_epi32( _mm256_madd_epi16( yvHi, coefR ), round ), kShift ) );
+			const __m256i g = _mm256_packs_epi32(
+				_mm256_srai_epi32( _mm256_add_epi32( _mm256_madd_epi16( yuLo, coefGyu ), _mm256_madd_epi16( v1Lo, coefGv ) ), kShift ),
+				_mm256_srai_epi32( _mm256_add_epi32( _mm256_madd_epi16( yuHi, coefGyu ), _mm256_madd_epi16( v1Hi, coefGv ) ), kShift ) );
+			const __m256i b = _mm256_packs_epi32(
+				_mm256_srai_epi32( _mm256_add_epi32( _mm256_madd_epi16( yuLo, coefB ), round ), kShift ),
+				_mm256_srai_epi32( _mm256_add_epi32( _mm256_madd_epi16( yuHi, coefB ), round ), kShift ) );
+
+			__m256i bg = _mm256_packus_epi16( b, g );
+			__m256i ra = _mm256_packus_epi16( r, alpha );
+			bg = _mm256_unpacklo_epi8( bg, _mm256_srli_si256( bg, 8 ) );
+			ra = _mm256_unpacklo_epi8( ra, _mm256_srli_si256( ra, 8 ) );
+			const __m256i lo = _mm256_unpacklo_epi16( bg, ra );
+			const __m256i hi = _mm256_unpackhi_epi16( bg, ra );
+			_mm256_storeu_si256( (__m256i*)( dst + x * 4 ), _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+			_mm256_storeu_si256( (__m256i*)( dst + x * 4 + 32 ), _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+		}
+
+		if( x < width )
+			uyvyToBgraRowScalar( src + x * 2, dst + x * 4, width - x, c );
+	}
+#endif
+
+#if defined( MEDIA_ARCH_NEON )
+	// ( cy * y + ca * a + cb * b + round ) >> kShift, saturated to 8 bits.
+	inline uint8x8_t neonChannel( int16x8_t y, int16_t cy, int16x8_t a, int16_t ca, int16x8_t b, int16_t cb )
+	{
+		const int32x4_t round = vdupq_n_s32( kRound );
+		int32x4_t lo = vmlal_n_s16( round, vget_low_s16( y ), cy );
+		lo = vmlal_n_s16( lo, vget_low_s16( a ), ca );
+		lo = vmlal_n_s16( lo, vget_low_s16( b ), cb );
+		int32x4_t hi = vmlal_n_s16( round, vget_high_s16( y ), cy );
+		hi = vmlal_n_s16( hi, vget_high_s16( a ), ca );
+		hi = vmlal_n_s16( hi, vget_high_s16( b ), cb );
+		return vqmovun_s16( vcombine_s16( vmovn_s32( vshrq_n_s32( lo, kShift ) ), vmovn_s32( vshrq_n_s32( hi, kShift ) ) ) );
+	}
+
+	// 16 pixels (8 macropixels) per iteration, even and odd pixels are converted separately and zipped on store.
+	void uyvyToBgraRowNeon( const uint8_t * src, uint8_t * dst, long width, const YuvCoefficients& c )
+	{
+		const int16x8_t lumaOffset = vdupq_n_s16( 16 );
+		const int16x8_t chromaOffset = vdupq_n_s16( 128 );
+		const uint8x8_t alpha = vdup_n_u8( 255 );
+
+		long x = 0;
+		for( ; x + 16 <= width; x += 16 ) {
+			const uint8x8x4_t uyvy = vld4_u8( src + x * 2 );
+			const int16x8_t u = vsubq_s16( vreinterpretq_s16_u16( vmovl_u8( uyvy.val[0] ) ), chromaOffset );
+			const int16x8_t y0 = vsubq_s16( vreinterpretq_s16_u16( vmovl_u8( uyvy.val[1] ) ), lumaOffset );
+			const int16x8_t v = vsubq_s16( vreinterpretq_s16_u16( vmovl_u8( uyvy.val[2] ) ), chromaOffset );
+			const int16x8_t y1 = vsubq_s16( vreinterpretq_s16_u16( vmovl_u8( uyvy.val[3] ) ), lumaOffset );
+
+			const uint8x8x2_t b = vzip_u8( neonChannel( y0, c.y, u, c.bu, v, 0 ), neonChannel( y1, c.y, u, c.bu, v, 0 ) );
+			const uint8x8x2_t g = vzip_u8( neonChannel( y0, c.y, u, -c.gu, v, -c.gv ), neonChannel( y1, c.y, u, -c.gu, v, -c.gv ) );
+			const uint8x8x2_t r = vzip_u8( neonChannel( y0, c.y, v, c.rv, u, 0 ), neonChannel( y1, c.y, v, c.rv, u, 0 ) );
+
+			uint8x8x4_t bgra;
+			bgra.val[3] = alpha;
+			for( int i = 0; i < 2; ++i ) {
+				bgra.val[0] = b.val[i];
+				bgra.val[1] = g.val[i];
+				bgra.val[2] = r.val[i];
+				vst4_u8( dst + x * 4 + i * 32, bgra );
+			}
+		}
+
+		if( x < width )
+			uyvyToBgraRowScalar( src + x * 2, dst + x * 4, width - x, c );
+	}
+#endif
+
+	UYVYRowKernel getUYVYRowKernel( SimdLevel level )
+	{
+		switch( level ) {
+#if defined( MEDIA_ARCH_X86 )
+		case SimdLevel::SSE2:	return uyvyToBgraRowSse2;
+		case SimdLevel::AVX2:	return uyvyToBgraRowAvx2;
+#elif defined( MEDIA_ARCH_NEON )
+		case SimdLevel::NEON:	return uyvyToBgraRowNeon;
+#endif
+		default:				return uyvyToBgraRowScalar;
+		}
+	}
+}
+
+uint16_t floatToHalf( float value )
+{
+	uint32_t bits;
+	std::memcpy( &bits, &value, sizeof( bits ) );
+	const uint16_t sign = uint16_t( ( bits >> 16 ) & 0x8000 );
+	const uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	// Inf and NaN, keeping NaNs quiet.
+	if( magnitude >= 0x7F800000 )
+		return sign | 0x7C00 | ( magnitude > 0x7F800000 ? 0x200 | ( ( magnitude >> 13 ) & 0x3FF ) : 0 );
+	// 65520 and above round to infinity.
+	if( magnitude >= 0x477FF000 )
+		return sign | 0x7C00;
+
+	uint32_t half, remainder, halfway;
+	if( magnitude < 0x38800000 ) {
+		// Below the smallest normal half, the result is subnormal: mantissa * 2^-24.
+		const uint32_t shift = 126 - ( magnitude >> 23 );
+		if( shift > 24 )
+			return sign;
+		const uint32_t mantissa = ( magnitude & 0x7FFFFF ) | 0x800000;
+		half = mantissa >> shift;
+		remainder = mantissa & ( ( 1u << shift ) - 1 );
+		halfway = 1u << ( shift - 1 );
+	}
+	else {
+		half = ( magnitude - 0x38000000 ) >> 13;
+		remainder = magnitude & 0x1FFF;
+		halfway = 0x1000;
+	}
+
+	// Round to nearest even, a mantissa carry correctly bumps the exponent.
+	if( remainder > halfway || ( remainder == halfway && ( half & 1 ) ) )
+		++half;
+	return sign | uint16_t( half );
+}
+
+void convertUYVYToBGRA( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix )
+{
+	convertUYVYToBGRA( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, getSimdLevel() );
+}
+
+void convertUYVYToBGRA( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level )
+{
+	if( ! isSimdLevelSupported( level ) )
+		level = SimdLevel::SCALAR;
+
+	const UYVYRowKernel kernel = getUYVYRowKernel( level );
+	const YuvCoefficients& coefficients = getCoefficients( matrix );
+	for( long row = 0; row < height; ++row ) {
+		kernel( src + row * srcRowBytes, dst + row * dstRowBytes, width, coefficients );
+	}
+}
+
+} //end namespace media
@@ -0,0 +1,496 @@
+#include "VideoConversion.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined( MEDIA_ARCH_X86 )
+	#include <immintrin.h>
+#elif defined( MEDIA_ARCH_NEON )
+	#include <arm_neon.h>
+#endif
+
+// Encoding runs in two passes over L1 sized chunks of a row: BGRA is converted to 16-bit planar 4:2:2 with
+// the chroma filter applied, then the planes are packed to UYVY or v210. Same split as the v210 decoder.
+
+namespace media {
+
+namespace {
+
+	// Fixed point RGB to YCbCr coefficients, scaled by 2^kShift. Every kernel evaluates:
+	//   Y  = ( yb * B + yg * G + yr * R + round ) >> kShift + yOffset
+	//   Cb = ( ub * B' + ug * G' + ur * R' + round ) >> kShift + cOffset
+	//   Cr = ( vb * B' + vg * G' + vr * R' + round ) >> kShift + cOffset
+	// where B', G', R' are the chroma filter taps summed with a total weight of 4, the chroma coefficients
+	// carry the matching 1/4. Results are clamped to the codes SDI allows in the active picture.
+	const int kShift = 13;
+	const int kRound = 1 << ( kShift - 1 );
+	const long kChunkPixels = 192;
+	// The SIMD packers read up to 8 luma and 4 chroma samples from the start of the last 6 pixel block.
+	const long kChunkPadding = 8;
+
+	struct EncodeCoefficients {
+		int16_t yb, yg, yr;
+		int16_t ub, ug, ur;
+		int16_t vb, vg, vr;
+		int16_t yOffset, cOffset;
+		int16_t minCode, maxCode;
+	};
+
+	int16_t roundCoefficient( double value )
+	{
+		return int16_t( std::floor( value + 0.5 ) );
+	}
+
+	EncodeCoefficients computeCoefficients( YCbCrMatrix matrix, YCbCrRange range, int bits )
+	{
+		double kr, kb;
+		getYCbCrWeights( matrix, &kr, &kb );
+		const int maxCode = ( 1 << bits ) - 1;
+		const double ys = ( range == YCbCrRange::LEGAL ? 219 << ( bits - 8 ) : maxCode ) / 255.0 * double( 1 << kShift );
+		const double cs = ( range == YCbCrRange::LEGAL ? 224 << ( bits - 8 ) : maxCode ) / 255.0 * double( 1 << kShift ) / 4.0;
+
+		// Green takes the rounding slack so that white lands exactly on the nominal peak and greys have
+		// exactly zero chroma.
+		EncodeCoefficients c;
+		c.yr = roundCoefficient( kr * ys );
+		c.yb = roundCoefficient( kb * ys );
+		c.yg = int16_t( roundCoefficient( ys ) - c.yr - c.yb );
+		c.ub = roundCoefficient( 0.5 * cs );
+		c.ur = roundCoefficient( -kr / ( 2.0 * ( 1.0 - kb ) ) * cs );
+		c.ug = int16_t( -c.ub - c.ur );
+		c.vr = roundCoefficient( 0.5 * cs );
+		c.vb = roundCoefficient( -kb / ( 2.0 * ( 1.0 - kr ) ) * cs );
+		c.vg = int16_t( -c.vr - c.vb );
+		c.yOffset = int16_t( range == YCbCrRange::LEGAL ? 16 << ( bits - 8 ) : 0 );
+		c.cOffset = int16_t( 1 << ( bits - 1 ) );
+		c.minCode = int16_t( 1 << ( bits - 8 ) );
+		c.maxCode = int16_t( maxCode - ( 1 << ( bits - 8 ) ) );
+		return c;
+	}
+
+	inline uint16_t clampCode( int value, const EncodeCoefficients& c )
+	{
+		return uint16_t( value < c.minCode ? c.minCode : ( value > c.maxCode ? c.maxCode : value ) );
+	}
+
+	inline void writeLE32( uint8_t * p, uint32_t value )
+	{
+		p[0] = uint8_t( value );
+		p[1] = uint8_t( value >> 8 );
+		p[2] = uint8_t( value >> 16 );
+		p[3] = uint8_t( value >> 24 );
+	}
+
+	inline uint32_t readPixel( const uint8_t * row, long x )
+	{
+		uint32_t pixel;
+		std::memcpy( &pixel, row + x * 4, sizeof( pixel ) );
+		return pixel;
+	}
+
+	// Left neighbour of an even pixel, mirrored at the start of the row.
+	inline long getPreviousPixel( long x, long width )
+	{
+		if( x > 0 )
+			return x - 1;
+		return width > 1 ? 1 : 0;
+	}
+
+	// Encodes pixels [x, x + count) of a row to planar Y, Cb, Cr. x is even, width is the full row so that
+	// the chroma filter can read across chunks.
+	typedef void( *EncodeRowKernel )( const uint8_t * row, long x, long count, long width, uint16_t * y, uint16_t * cb, uint16_t * cr, const EncodeCoefficients& c );
+	typedef void( *PackRowKernel )( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint8_t * dst, long count );
+
+	template<ChromaFilter Filter>
+	void encodeRowScalar( const uint8_t * row, long x, long count, long width, uint16_t * y, uint16_t * cb, uint16_t * cr, const EncodeCoefficients& c )
+	{
+		for( long i = 0; i < count; ++i ) {
+			const uint8_t * p = row + ( x + i ) * 4;
+			y[i] = clampCode( ( ( c.yb * p[0] + c.yg * p[1] + c.yr * p[2] + kRound ) >> kShift ) + c.yOffset, c );
+		}
+
+		for( long i = 0; i < count; i += 2 ) {
+			const uint8_t * even = row + ( x + i ) * 4;
+			const uint8_t * odd = row + ( x + i + 1 < width ? x + i + 1 : x + i ) * 4;
+			const uint8_t * prev = row + getPreviousPixel( x + i, width ) * 4;
+			int s[3];
+			for( int ch = 0; ch < 3; ++ch ) {
+				if( Filter == ChromaFilter::COSITED )
+					s[ch] = prev[ch] + 2 * even[ch] + odd[ch];
+				else if( Filter == ChromaFilter::AVERAGE )
+					s[ch] = 2 * ( even[ch] + odd[ch] );
+				else
+					s[ch] = 4 * even[ch];
+			}
+			cb[i / 2] = clampCode( ( ( c.ub * s[0] + c.ug * s[1] + c.ur * s[2] + kRound ) >> kShift ) + c.cOffset, c );
+			cr[i / 2] = clampCode( ( ( c.vb * s[0] + c.vg * s[1] + c.vr * s[2] + kRound ) >> kShift ) + c.cOffset, c );
+		}
+	}
+
+	void packUYVYRowScalar( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint8_t * dst, long count )
+	{
+		for( long i = 0; i < count; i += 2, dst += 4 ) {
+			dst[0] = uint8_t( cb[i / 2] );
+			dst[1] = uint8_t( y[i] );
+			dst[2] = uint8_t( cr[i / 2] );
+			dst[3] = uint8_t( y[i + 1 < count ? i + 1 : i] );
+		}
+	}
+
+	// Expects count rounded up to whole 6 pixel blocks, see padChunk().
+	void packV210RowScalar( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint8_t * dst, long count )
+	{
+		for( long i = 0; i < count; i += 6, dst += 16 ) {
+			const uint16_t * luma = y + i;
+			const uint16_t * u = cb + i / 2;
+			const uint16_t * v = cr + i / 2;
+			writeLE32( dst, u[0] | uint32_t( luma[0] ) << 10 | uint32_t( v[0] ) << 20 );
+			writeLE32( dst + 4, luma[1] | uint32_t( u[1] ) << 10 | uint32_t( luma[2] ) << 20 );
+			writeLE32( dst + 8, v[1] | uint32_t( luma[3] ) << 10 | uint32_t( u[2] ) << 20 );
+			writeLE32( dst + 12, luma[4] | uint32_t( v[2] ) << 10 | uint32_t( luma[5] ) << 20 );
+		}
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	inline int64_t packTaps( int b, int g, int r )
+	{
+		return int64_t( uint64_t( uint16_t( b ) ) | uint64_t( uint16_t( g ) ) << 16 | uint64_t( uint16_t( r ) ) << 32 );
+	}
+
+	// 4 BGRA pixels widened to 16-bit.
+	MEDIA_TARGET_AVX2 inline __m256i loadPixelsAvx2( const uint8_t * p )
+	{
+		return _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)p ) );
+	}
+
+	// Filter taps of the 4 even pixels held in two widened registers, summed with a total weight of 4.
+	// Sample order is [0 2 | 1 3] across the 128-bit lanes. carry holds the previous odd pixel in the top
+	// half of its low lane.
+	template<ChromaFilter Filter>
+	MEDIA_TARGET_AVX2 inline __m256i chromaTapsAvx2( __m256i a, __m256i b, __m256i * carry )
+	{
+		const __m256i even = _mm256_unpacklo_epi64( a, b );
+		const __m256i odd = _mm256_unpackhi_epi64( a, b );
+		if( Filter == ChromaFilter::COSITED ) {
+			const __m256i swapped = _mm256_permute2x128_si256( odd, odd, 0x01 );
+			const __m256i prev = _mm256_blend_epi32( _mm256_alignr_epi8( swapped, *carry, 8 ), swapped, 0xF0 );
+			*carry = swapped;
+			return _mm256_add_epi16( _mm256_add_epi16( prev, odd ), _mm256_slli_epi16( even, 1 ) );
+		}
+		else if( Filter == ChromaFilter::AVERAGE )
+			return _mm256_slli_epi16( _mm256_add_epi16( even, odd ), 1 );
+		return _mm256_slli_epi16( even, 2 );
+	}
+
+	// 16 pixels per iteration. madd and hadd evaluate the three products of every pixel, which leaves luma
+	// in [0 1 4 5 8 9 12 13 | 2 3 6 7 10 11 14 15] order and chroma in [0 2 4 6 | 1 3 5 7], both fixed before storing.
+	template<ChromaFilter Filter>
+	MEDIA_TARGET_AVX2 void encodeRowAvx2( const uint8_t * row, long x, long count, long width, uint16_t * y, uint16_t * cb, uint16_t * cr, const EncodeCoefficients& c )
+	{
+		const __m256i coefY = _mm256_set1_epi64x( packTaps( c.yb, c.yg, c.yr ) );
+		const __m256i coefU = _mm256_set1_epi64x( packTaps( c.ub, c.ug, c.ur ) );
+		const __m256i coefV = _mm256_set1_epi64x( packTaps( c.vb, c.vg, c.vr ) );
+		const __m256i round = _mm256_set1_epi32( kRound );
+		const __m256i yOffset = _mm256_set1_epi16( c.yOffset );
+		const __m256i cOffset = _mm256_set1_epi16( c.cOffset );
+		const __m256i minCode = _mm256_set1_epi16( c.minCode );
+		const __m256i maxCode = _mm256_set1_epi16( c.maxCode );
+		const __m256i lumaOrder = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+
+		const __m128i prevPixel = _mm_cvtepu8_epi16( _mm_cvtsi32_si128( int( readPixel( row, getPreviousPixel( x, width ) ) ) ) );
+		__m256i carry = _mm256_castsi128_si256( _mm_slli_si128( prevPixel, 8 ) );
+
+		long i = 0;
+		for( ; i + 16 <= count; i += 16 ) {
+			const uint8_t * src = row + ( x + i ) * 4;
+			const __m256i p0 = loadPixelsAvx2( src );
+			const __m256i p1 = loadPixelsAvx2( src + 16 );
+			const __m256i p2 = loadPixelsAvx2( src + 32 );
+			const __m256i p3 = loadPixelsAvx2( src + 48 );
+
+			const __m256i lumaLo = _mm256_hadd_epi32( _mm256_madd_epi16( p0, coefY ), _mm256_madd_epi16( p1, coefY ) );
+			const __m256i lumaHi = _mm256_hadd_epi32( _mm256_madd_epi16( p2, coefY ), _mm256_madd_epi16( p3, coefY ) );
+			__m256i luma = _mm256_packs_epi32(
+				_mm256_srai_epi32( _mm256_add_epi32( lumaLo, round ), kShift ),
+				_mm256_srai_epi32( _mm256_add_epi32( lumaHi, round ), kShift ) );
+			luma = _mm256_permutevar8x32_epi32( luma, lumaOrder );
+			luma = _mm256_min_epi16( _mm256_max_epi16( _mm256_add_epi16( luma, yOffset ), minCode ), maxCode );
+			_mm256_storeu_si256( (__m256i*)( y + i ), luma );
+
+			const __m256i tapsLo = chromaTapsAvx2<Filter>( p0, p1, &carry );
+			const __m256i tapsHi = chromaTapsAvx2<Filter>( p2, p3, &carry );
+			const __m256i u = _mm256_hadd_epi32( _mm256_madd_epi16( tapsLo, coefU ), _mm256_madd_epi16( tapsHi, coefU ) );
+			const __m256i v = _mm256_hadd_epi32( _mm256_madd_epi16( tapsLo, coefV ), _mm256_madd_epi16( tapsHi, coefV ) );
+			__m256i uv = _mm256_packs_epi32(
+				_mm256_srai_epi32( _mm256_add_epi32( u, round ), kShift ),
+				_mm256_srai_epi32( _mm256_add_epi32( v, round ), kShift ) );
+			uv = _mm256_min_epi16( _mm256_max_epi16( _mm256_add_epi16( uv, cOffset ), minCode ), maxCode );
+			// Even samples are in the low lane and odd ones in the high lane, zipping the two lanes restores the order.
+			const __m256i swapped = _mm256_permute2x128_si256( uv, uv, 0x01 );
+			_mm_storeu_si128( (__m128i*)( cb + i / 2 ), _mm256_castsi256_si128( _mm256_unpacklo_epi16( uv, swapped ) ) );
+			_mm_storeu_si128( (__m128i*)( cr + i / 2 ), _mm256_castsi256_si128( _mm256_unpackhi_epi16( uv, swapped ) ) );
+		}
+
+		if( i < count )
+			encodeRowScalar<Filter>( row, x + i, count - i, width, y + i, cb + i / 2, cr + i / 2, c );
+	}
+
+	// 16 pixels per iteration, plain SSE2 so that it also serves the SSE2 level.
+	void packUYVYRowSse2( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint8_t * dst, long count )
+	{
+		long i = 0;
+		for( ; i + 16 <= count; i += 16 ) {
+			const __m128i lumaLo = _mm_loadu_si128( (const __m128i*)( y + i ) );
+			const __m128i lumaHi = _mm_loadu_si128( (const __m128i*)( y + i + 8 ) );
+			const __m128i u = _mm_loadu_si128( (const __m128i*)( cb + i / 2 ) );
+			const __m128i v = _mm_loadu_si128( (const __m128i*)( cr + i / 2 ) );
+			const __m128i uvLo = _mm_unpacklo_epi16( u, v );
+			const __m128i uvHi = _mm_unpackhi_epi16( u, v );
+			_mm_storeu_si128( (__m128i*)( dst + i * 2 ), _mm_packus_epi16( _mm_unpacklo_epi16( uvLo, lumaLo ), _mm_unpackhi_epi16( uvLo, lumaLo ) ) );
+			_mm_storeu_si128( (__m128i*)( dst + i * 2 + 16 ), _mm_packus_epi16( _mm_unpacklo_epi16( uvHi, lumaHi ), _mm_unpackhi_epi16( uvHi, lumaHi ) ) );
+		}
+
+		if( i < count )
+			packUYVYRowScalar( y + i, cb + i / 2, cr + i / 2, dst + i * 2, count - i );
+	}
+
+	// One 6 pixel block per iteration. Samples are zipped to stream order, then shuffled so every 32-bit lane
+	// holds its first two samples as a 16-bit pair (merged by a madd) and its third sample zero extended.
+	MEDIA_TARGET_AVX2 void packV210RowAvx2( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint8_t * dst, long count )
+	{
+		const __m128i pairsLo = _mm_setr_epi8( 0, 1, 2, 3, 6, 7, 8, 9, 12, 13, 14, 15, -1, -1, -1, -1 );
+		const __m128i pairsHi = _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, 4, 5 );
+		const __m128i thirdLo = _mm_setr_epi8( 4, 5, -1, -1, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+		const __m128i thirdHi = _mm_setr_epi8( -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, -1, -1, 6, 7, -1, -1 );
+		const __m128i pairWeights = _mm_set1_epi32( 1 | 1024 << 16 );
+
+		for( long i = 0; i < count; i += 6, dst += 16 ) {
+			const __m128i luma = _mm_loadu_si128( (const __m128i*)( y + i ) );
+			const __m128i uv = _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i*)( cb + i / 2 ) ), _mm_loadl_epi64( (const __m128i*)( cr + i / 2 ) ) );
+			const __m128i streamLo = _mm_unpacklo_epi16( uv, luma );
+			const __m128i streamHi = _mm_unpackhi_epi16( uv, luma );
+			const __m128i pairs = _mm_or_si128( _mm_shuffle_epi8( streamLo, pairsLo ), _mm_shuffle_epi8( streamHi, pairsHi ) );
+			const __m128i third = _mm_or_si128( _mm_shuffle_epi8( streamLo, thirdLo ), _mm_shuffle_epi8( streamHi, thirdHi ) );
+			const __m128i words = _mm_or_si128( _mm_madd_epi16( pairs, pairWeights ), _mm_slli_epi32( third, 20 ) );
+			_mm_storeu_si128( (__m128i*)dst, words );
+		}
+	}
+#endif
+
+#if defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+	// ( cb * b + cg * g + cr * r + round ) >> kShift + offset, clamped to the legal codes.
+	inline uint16x8_t neonEncode( int16x8_t b, int16x8_t g, int16x8_t r, int16_t cb, int16_t cg, int16_t cr, int16_t offset, const EncodeCoefficients& c )
+	{
+		const int32x4_t round = vdupq_n_s32( kRound );
+		int32x4_t lo = vmlal_n_s16( round, vget_low_s16( b ), cb );
+		lo = vmlal_n_s16( lo, vget_low_s16( g ), cg );
+		lo = vmlal_n_s16( lo, vget_low_s16( r ), cr );
+		int32x4_t hi = vmlal_n_s16( round, vget_high_s16( b ), cb );
+		hi = vmlal_n_s16( hi, vget_high_s16( g ), cg );
+		hi = vmlal_n_s16( hi, vget_high_s16( r ), cr );
+		int16x8_t value = vcombine_s16( vmovn_s32( vshrq_n_s32( lo, kShift ) ), vmovn_s32( vshrq_n_s32( hi, kShift ) ) );
+		value = vaddq_s16( value, vdupq_n_s16( offset ) );
+		value = vminq_s16( vmaxq_s16( value, vdupq_n_s16( c.minCode ) ), vdupq_n_s16( c.maxCode ) );
+		return vreinterpretq_u16_s16( value );
+	}
+
+	inline int16x8_t neonWiden( uint8x8_t value )
+	{
+		return vreinterpretq_s16_u16( vmovl_u8( value ) );
+	}
+
+	// Filter taps of one channel for 8 even pixels, carry holds the previous odd pixel in its last lane.
+	template<ChromaFilter Filter>
+	inline int16x8_t neonChromaTaps( uint8x16_t channel, uint8x8_t * carry )
+	{
+		const uint8x8_t even = vget_low_u8( vuzp1q_u8( channel, channel ) );
+		const uint8x8_t odd = vget_low_u8( vuzp2q_u8( channel, channel ) );
+		if( Filter == ChromaFilter::COSITED ) {
+			const uint8x8_t prev = vext_u8( *carry, odd, 7 );
+			*carry = odd;
+			return vreinterpretq_s16_u16( vaddq_u16( vaddl_u8( prev, odd ), vshll_n_u8( even, 1 ) ) );
+		}
+		else if( Filter == ChromaFilter::AVERAGE )
+			return vreinterpretq_s16_u16( vshlq_n_u16( vaddl_u8( even, odd ), 1 ) );
+		return vreinterpretq_s16_u16( vshll_n_u8( even, 2 ) );
+	}
+
+	// 16 pixels per iteration, vld4 deinterleaves the channels and vuzp splits even and odd pixels.
+	template<ChromaFilter Filter>
+	void encodeRowNeon( const uint8_t * row, long x, long count, long width, uint16_t * y, uint16_t * cb, uint16_t * cr, const EncodeCoefficients& c )
+	{
+		const uint8_t * prevPixel = row + getPreviousPixel( x, width ) * 4;
+		uint8x8_t carry[3] = { vdup_n_u8( prevPixel[0] ), vdup_n_u8( prevPixel[1] ), vdup_n_u8( prevPixel[2] ) };
+
+		long i = 0;
+		for( ; i + 16 <= count; i += 16 ) {
+			const uint8x16x4_t bgra = vld4q_u8( row + ( x + i ) * 4 );
+			for( int half = 0; half < 2; ++half ) {
+				const int16x8_t b = neonWiden( half ? vget_high_u8( bgra.val[0] ) : vget_low_u8( bgra.val[0] ) );
+				const int16x8_t g = neonWiden( half ? vget_high_u8( bgra.val[1] ) : vget_low_u8( bgra.val[1] ) );
+				const int16x8_t r = neonWiden( half ? vget_high_u8( bgra.val[2] ) : vget_low_u8( bgra.val[2] ) );
+				vst1q_u16( y + i + half * 8, neonEncode( b, g, r, c.yb, c.yg, c.yr, c.yOffset, c ) );
+			}
+
+			const int16x8_t b = neonChromaTaps<Filter>( bgra.val[0], &carry[0] );
+			const int16x8_t g = neonChromaTaps<Filter>( bgra.val[1], &carry[1] );
+			const int16x8_t r = neonChromaTaps<Filter>( bgra.val[2], &carry[2] );
+			vst1q_u16( cb + i / 2, neonEncode( b, g, r, c.ub, c.ug, c.ur, c.cOffset, c ) );
+			vst1q_u16( cr + i / 2, neonEncode( b, g, r, c.vb, c.vg, c.vr, c.cOffset, c ) );
+		}
+
+		if( i < count )
+			encodeRowScalar<Filter>( row, x + i, count - i, width, y + i, cb + i / 2, cr + i / 2, c );
+	}
+
+	void packUYVYRowNeon( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint8_t * dst, long count )
+	{
+		long i = 0;
+		for( ; i + 16 <= count; i += 16 ) {
+			const uint16x8x2_t luma = vld2q_u16( y + i );
+			uint8x8x4_t uyvy;
+			uyvy.val[0] = vmovn_u16( vld1q_u16( cb + i / 2 ) );
+			uyvy.val[1] = vmovn_u16( luma.val[0] );
+			uyvy.val[2] = vmovn_u16( vld1q_u16( cr + i / 2 ) );
+			uyvy.val[3] = vmovn_u16( luma.val[1] );
+			vst4_u8( dst + i * 2, uyvy );
+		}
+
+		if( i < count )
+			packUYVYRowScalar( y + i, cb + i / 2, cr + i / 2, dst + i * 2, count - i );
+	}
+
+	// Same lane layout as the x86 packer, the two table lookup gathers from both halves of the stream at once.
+	void packV210RowNeon( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint8_t * dst, long count )
+	{
+		static const uint8_t kPairs[16] = { 0, 1, 2, 3, 6, 7, 8, 9, 12, 13, 14, 15, 18, 19, 20, 21 };
+		static const uint8_t kThird[16] = { 4, 5, 255, 255, 10, 11, 255, 255, 16, 17, 255, 255, 22, 23, 255, 255 };
+		const uint8x16_t pairsIndex = vld1q_u8( kPairs );
+		const uint8x16_t thirdIndex = vld1q_u8( kThird );
+
+		for( long i = 0; i < count; i += 6, dst += 16 ) {
+			const uint16x8_t luma = vld1q_u16( y + i );
+			const uint16x4x2_t uv = vzip_u16( vld1_u16( cb + i / 2 ), vld1_u16( cr + i / 2 ) );
+			const uint16x8x2_t stream = vzipq_u16( vcombine_u16( uv.val[0], uv.val[1] ), luma );
+			uint8x16x2_t bytes;
+			bytes.val[0] = vreinterpretq_u8_u16( stream.val[0] );
+			bytes.val[1] = vreinterpretq_u8_u16( stream.val[1] );
+			const uint32x4_t pairs = vreinterpretq_u32_u8( vqtbl2q_u8( bytes, pairsIndex ) );
+			const uint32x4_t third = vreinterpretq_u32_u8( vqtbl2q_u8( bytes, thirdIndex ) );
+			uint32x4_t words = vandq_u32( pairs, vdupq_n_u32( 0xFFFF ) );
+			words = vorrq_u32( words, vshlq_n_u32( vshrq_n_u32( pairs, 16 ), 10 ) );
+			words = vorrq_u32( words, vshlq_n_u32( third, 20 ) );
+			vst1q_u8( dst, vreinterpretq_u8_u32( words ) );
+		}
+	}
+#endif
+
+	template<ChromaFilter Filter>
+	EncodeRowKernel getEncodeKernel( SimdLevel level )
+	{
+		switch( level ) {
+#if defined( MEDIA_ARCH_X86 )
+		case SimdLevel::AVX2:	return encodeRowAvx2<Filter>;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		case SimdLevel::NEON:	return encodeRowNeon<Filter>;
+#endif
+		// hadd and alignr need SSSE3, SSE2 only cpus use the scalar encoder.
+		default:				return encodeRowScalar<Filter>;
+		}
+	}
+
+	EncodeRowKernel getEncodeKernel( SimdLevel level, ChromaFilter filter )
+	{
+		switch( filter ) {
+		case ChromaFilter::AVERAGE:	return getEncodeKernel<ChromaFilter::AVERAGE>( level );
+		case ChromaFilter::DROP:	return getEncodeKernel<ChromaFilter::DROP>( level );
+		default:					return getEncodeKernel<ChromaFilter::COSITED>( level );
+		}
+	}
+
+	PackRowKernel getUYVYPackKernel( SimdLevel level )
+	{
+		switch( level ) {
+#if defined( MEDIA_ARCH_X86 )
+		case SimdLevel::SSE2:
+		case SimdLevel::AVX2:	return packUYVYRowSse2;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		case SimdLevel::NEON:	return packUYVYRowNeon;
+#endif
+		default:				return packUYVYRowScalar;
+		}
+	}
+
+	PackRowKernel getV210PackKernel( SimdLevel level )
+	{
+		switch( level ) {
+#if defined( MEDIA_ARCH_X86 )
+		case SimdLevel::AVX2:	return packV210RowAvx2;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		case SimdLevel::NEON:	return packV210RowNeon;
+#endif
+		// The shuffle needs SSSE3, SSE2 only cpus use the scalar packer.
+		default:				return packV210RowScalar;
+		}
+	}
+
+	// Repeats the last pixel up to the end of its 6 pixel block and returns the padded count.
+	long padChunk( uint16_t * y, uint16_t * cb, uint16_t * cr, long count )
+	{
+		const long padded = ( count + 5 ) / 6 * 6;
+		for( long i = count; i < padded; ++i )
+			y[i] = y[count - 1];
+		for( long i = ( count + 1 ) / 2; i < padded / 2; ++i ) {
+			cb[i] = cb[( count + 1 ) / 2 - 1];
+			cr[i] = cr[( count + 1 ) / 2 - 1];
+		}
+		return padded;
+	}
+
+	template<bool V210>
+	void convertBGRAToYUV( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, YCbCrRange range, ChromaFilter filter, SimdLevel level )
+	{
+		if( ! isSimdLevelSupported( level ) )
+			level = SimdLevel::SCALAR;
+
+		const EncodeRowKernel encode = getEncodeKernel( level, filter );
+		const PackRowKernel pack = V210 ? getV210PackKernel( level ) : getUYVYPackKernel( level );
+		const EncodeCoefficients coefficients = computeCoefficients( matrix, range, V210 ? 10 : 8 );
+
+		uint16_t luma[kChunkPixels + kChunkPadding], blue[( kChunkPixels + kChunkPadding ) / 2], red[( kChunkPixels + kChunkPadding ) / 2];
+		for( long row = 0; row < height; ++row ) {
+			const uint8_t * srcRow = src + row * srcRowBytes;
+			uint8_t * dstRow = dst + row * dstRowBytes;
+			for( long x = 0; x < width; x += kChunkPixels ) {
+				const long count = width - x < kChunkPixels ? width - x : kChunkPixels;
+				encode( srcRow, x, count, width, luma, blue, red, coefficients );
+				if( V210 )
+					pack( luma, blue, red, dstRow + x / 6 * 16, padChunk( luma, blue, red, count ) );
+				else
+					pack( luma, blue, red, dstRow + x * 2, count );
+			}
+		}
+	}
+}
+
+void convertBGRAToUYVY( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, YCbCrRange range, ChromaFilter filter )
+{
+	convertBGRAToYUV<false>( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, range, filter, getSimdLevel() );
+}
+
+void convertBGRAToUYVY( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, YCbCrRange range, ChromaFilter filter, SimdLevel level )
+{
+	convertBGRAToYUV<false>( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, range, filter, level );
+}
+
+void convertBGRAToV210( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, YCbCrRange range, ChromaFilter filter )
+{
+	convertBGRAToYUV<true>( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, range, filter, getSimdLevel() );
+}
+
+void convertBGRAToV210( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, YCbCrRange range, ChromaFilter filter, SimdLevel level )
+{
+	convertBGRAToYUV<true>( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, range, filter, level );
+}
+
+} //end namespace media
@@ -0,0 +1,522 @@
+#include "VideoConversion.h"
+
+#include <vector>
+
+#if defined( MEDIA_ARCH_X86 )
+	#include <immintrin.h>
+#elif defined( MEDIA_ARCH_NEON )
+	#include <arm_neon.h>
+#endif
+
+// r210 words hold R G B from bit 29 down to bit 0, R10b/R10l words from bit 31 down to bit 2.
+// R12L is a little endian bit stream of 12-bit R G B components, 8 pixels per 9 words; R12B stores the same
+// words big endian, so byte i of the stream sits at byte ( i & ~3 ) | ( 3 - ( i & 3 ) ) of the frame.
+
+namespace media {
+
+namespace {
+
+	// 10-bit video levels to 16-bit: 65535 / 876 in 8.8 fixed point, white (940) lands exactly on the clamp.
+	const int kVideoShift = 8;
+	const int kVideoScale = 19152;
+	const int kVideoRound = 1 << ( kVideoShift - 1 );
+	const int kVideoBlack = 64;
+	const int kVideoWhite = 940;
+	const int kFullWhite = 4095;
+	const float kVideoFloatScale = 1.0f / 876.0f;
+	const float kFullFloatScale = 1.0f / 4095.0f;
+
+	template<typename T>
+	using PackedRGBRowKernel = void( *)( const uint8_t * src, T * dst, long width );
+
+	inline bool isTwelveBit( PackedRGBFormat format )
+	{
+		return format == PackedRGBFormat::R12B || format == PackedRGBFormat::R12L;
+	}
+
+	inline uint32_t readLE32( const uint8_t * p )
+	{
+		return uint32_t( p[0] ) | ( uint32_t( p[1] ) << 8 ) | ( uint32_t( p[2] ) << 16 ) | ( uint32_t( p[3] ) << 24 );
+	}
+
+	inline uint32_t readBE32( const uint8_t * p )
+	{
+		return uint32_t( p[3] ) | ( uint32_t( p[2] ) << 8 ) | ( uint32_t( p[1] ) << 16 ) | ( uint32_t( p[0] ) << 24 );
+	}
+
+	inline void writeLE32( uint8_t * p, uint32_t value )
+	{
+		p[0] = uint8_t( value ); p[1] = uint8_t( value >> 8 ); p[2] = uint8_t( value >> 16 ); p[3] = uint8_t( value >> 24 );
+	}
+
+	inline void writeBE32( uint8_t * p, uint32_t value )
+	{
+		p[3] = uint8_t( value ); p[2] = uint8_t( value >> 8 ); p[1] = uint8_t( value >> 16 ); p[0] = uint8_t( value >> 24 );
+	}
+
+	inline size_t streamByte( size_t index, bool bigEndian )
+	{
+		return bigEndian ? ( index & ~size_t( 3 ) ) | ( 3 - ( index & 3 ) ) : index;
+	}
+
+	inline uint16_t clampToWord( int value )
+	{
+		return uint16_t( value < 0 ? 0 : ( value > 65535 ? 65535 : value ) );
+	}
+
+	//! Component \a k of a 12-bit group: even components start on a byte, odd ones on the high nibble of a byte.
+	inline int readComponent12( const uint8_t * group, int k, bool bigEndian )
+	{
+		const size_t o = size_t( k ) * 3 / 2;
+		const int pair = group[streamByte( o, bigEndian )] | ( group[streamByte( o + 1, bigEndian )] << 8 );
+		return k & 1 ? pair >> 4 : pair & 0xFFF;
+	}
+
+	template<PackedRGBFormat Format>
+	inline void readPixel( const uint8_t * src, long x, int * rgb )
+	{
+		if( Format == PackedRGBFormat::R12B || Format == PackedRGBFormat::R12L ) {
+			const uint8_t * group = src + x / 8 * 36;
+			const int k = int( x % 8 ) * 3;
+			for( int i = 0; i < 3; ++i )
+				rgb[i] = readComponent12( group, k + i, Format == PackedRGBFormat::R12B );
+		}
+		else {
+			const int shift = Format == PackedRGBFormat::R210 ? 0 : 2;
+			const uint32_t word = Format == PackedRGBFormat::R10L ? readLE32( src + x * 4 ) : readBE32( src + x * 4 );
+			rgb[0] = int( word >> ( 20 + shift ) ) & 0x3FF;
+			rgb[1] = int( word >> ( 10 + shift ) ) & 0x3FF;
+			rgb[2] = int( word >> shift ) & 0x3FF;
+		}
+	}
+
+	inline void storePixel( uint16_t * dst, const int * rgb, bool twelveBit )
+	{
+		for( int i = 0; i < 3; ++i )
+			dst[i] = twelveBit ? uint16_t( ( rgb[i] << 4 ) | ( rgb[i] >> 8 ) ) : clampToWord( ( ( rgb[i] - kVideoBlack ) * kVideoScale + kVideoRound ) >> kVideoShift );
+		dst[3] = 65535;
+	}
+
+	inline void storePixel( float * dst, const int * rgb, bool twelveBit )
+	{
+		for( int i = 0; i < 3; ++i )
+			dst[i] = twelveBit ? float( rgb[i] ) * kFullFloatScale : float( rgb[i] - kVideoBlack ) * kVideoFloatScale;
+		dst[3] = 1.0f;
+	}
+
+	template<PackedRGBFormat Format, typename T>
+	void unpackRowScalar( const uint8_t * src, T * dst, long width )
+	{
+		const bool twelveBit = Format == PackedRGBFormat::R12B || Format == PackedRGBFormat::R12L;
+		int rgb[3];
+		for( long x = 0; x < width; ++x, dst += 4 ) {
+			readPixel<Format>( src, x, rgb );
+			storePixel( dst, rgb, twelveBit );
+		}
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	inline int32_t packCoefficients( int lo, int hi )
+	{
+		return int32_t( uint32_t( uint16_t( lo ) ) | ( uint32_t( uint16_t( hi ) ) << 16 ) );
+	}
+
+	// Both bit depths are first brought to interleaved RGBA codes, 4 pixels per register, alpha holding the white code.
+	template<bool TwelveBit>
+	MEDIA_TARGET_AVX2 inline void storeCodesAvx2( __m256i codes, uint16_t * dst )
+	{
+		__m256i words;
+		if( TwelveBit ) {
+			words = _mm256_or_si256( _mm256_slli_epi16( codes, 4 ), _mm256_srli_epi16( codes, 8 ) );
+		}
+		else {
+			// ( code - 64 ) * scale + round as one madd per pair, packus clamping like clampToWord.
+			const __m256i coef = _mm256_set1_epi32( packCoefficients( kVideoScale, kVideoRound ) );
+			const __m256i ones = _mm256_set1_epi16( 1 );
+			const __m256i centered = _mm256_sub_epi16( codes, _mm256_set1_epi16( kVideoBlack ) );
+			const __m256i lo = _mm256_srai_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( centered, ones ), coef ), kVideoShift );
+			const __m256i hi = _mm256_srai_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( centered, ones ), coef ), kVideoShift );
+			words = _mm256_packus_epi32( lo, hi );
+		}
+		_mm256_storeu_si256( (__m256i*)dst, words );
+	}
+
+	template<bool TwelveBit>
+	MEDIA_TARGET_AVX2 inline void storeCodesAvx2( __m256i codes, float * dst )
+	{
+		const __m256i offset = _mm256_set1_epi32( TwelveBit ? 0 : kVideoBlack );
+		const __m256 scale = _mm256_set1_ps( TwelveBit ? kFullFloatScale : kVideoFloatScale );
+		const __m256 one = _mm256_set1_ps( 1.0f );
+		const __m256i lo = _mm256_sub_epi32( _mm256_cvtepu16_epi32( _mm256_castsi256_si128( codes ) ), offset );
+		const __m256i hi = _mm256_sub_epi32( _mm256_cvtepu16_epi32( _mm256_extracti128_si256( codes, 1 ) ), offset );
+		_mm256_storeu_ps( dst, _mm256_blend_ps( _mm256_mul_ps( _mm256_cvtepi32_ps( lo ), scale ), one, 0x88 ) );
+		_mm256_storeu_ps( dst + 8, _mm256_blend_ps( _mm256_mul_ps( _mm256_cvtepi32_ps( hi ), scale ), one, 0x88 ) );
+	}
+
+	// 8 pixels per iteration: byte swap the big endian words, extract the fields on 32-bit lanes and interleave
+	// R | G << 16 with B | A << 16. The unpacks work per 128-bit lane, hence the final lane permutes.
+	template<PackedRGBFormat Format, typename T>
+	MEDIA_TARGET_AVX2 void unpackRGB10RowAvx2( const uint8_t * src, T * dst, long width )
+	{
+		const int shift = Format == PackedRGBFormat::R210 ? 0 : 2;
+		const __m256i swap = _mm256_setr_epi8(
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 );
+		const __m256i mask = _mm256_set1_epi32( 0x3FF );
+		const __m256i alpha = _mm256_set1_epi32( kVideoWhite << 16 );
+
+		long x = 0;
+		for( ; x + 8 <= width; x += 8 ) {
+			__m256i words = _mm256_loadu_si256( (const __m256i*)( src + x * 4 ) );
+			if( Format != PackedRGBFormat::R10L )
+				words = _mm256_shuffle_epi8( words, swap );
+			const __m256i r = _mm256_and_si256( _mm256_srli_epi32( words, 20 + shift ), mask );
+			const __m256i g = _mm256_and_si256( _mm256_srli_epi32( words, 10 + shift ), mask );
+			const __m256i b = _mm256_and_si256( _mm256_srli_epi32( words, shift ), mask );
+			const __m256i rg = _mm256_or_si256( r, _mm256_slli_epi32( g, 16 ) );
+			const __m256i ba = _mm256_or_si256( b, alpha );
+			const __m256i lo = _mm256_unpacklo_epi32( rg, ba );
+			const __m256i hi = _mm256_unpackhi_epi32( rg, ba );
+			storeCodesAvx2<false>( _mm256_permute2x128_si256( lo, hi, 0x20 ), dst + x * 4 );
+			storeCodesAvx2<false>( _mm256_permute2x128_si256( lo, hi, 0x31 ), dst + x * 4 + 16 );
+		}
+
+		if( x < width )
+			unpackRowScalar<Format>( src + x * 4, dst + x * 4, width - x );
+	}
+
+	// 8 pixels per 36 byte group, read as three 12 byte chunks of 8 components. Like the v210 unpacker, pshufb
+	// gathers the byte pair covering each component (folding in the R12B byte swap, chunks start on a word) and the
+	// multiply and shift drop the neighbouring nibble. alignr then regroups the RGB stream into RGBA pixel pairs.
+	// The last chunk load reads 4 bytes past the group, so the final group of a row is left to the scalar code.
+	template<PackedRGBFormat Format, typename T>
+	MEDIA_TARGET_AVX2 void unpackRGB12RowAvx2( const uint8_t * src, T * dst, long width )
+	{
+		const __m128i gather = Format == PackedRGBFormat::R12B
+			? _mm_setr_epi8( 3, 2, 2, 1, 0, 7, 7, 6, 5, 4, 4, 11, 10, 9, 9, 8 )
+			: _mm_setr_epi8( 0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11 );
+		const __m128i scale = _mm_setr_epi16( 16, 1, 16, 1, 16, 1, 16, 1 );
+		const __m128i expand = _mm_setr_epi8( 0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1 );
+		const __m128i alpha = _mm_setr_epi16( 0, 0, 0, kFullWhite, 0, 0, 0, kFullWhite );
+
+		long x = 0;
+		for( ; x + 8 < width; x += 8, src += 36 ) {
+			const __m128i c0 = _mm_srli_epi16( _mm_mullo_epi16( _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)src ), gather ), scale ), 4 );
+			const __m128i c1 = _mm_srli_epi16( _mm_mullo_epi16( _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)( src + 12 ) ), gather ), scale ), 4 );
+			const __m128i c2 = _mm_srli_epi16( _mm_mullo_epi16( _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)( src + 24 ) ), gather ), scale ), 4 );
+
+			const __m128i p01 = _mm_or_si128( _mm_shuffle_epi8( c0, expand ), alpha );
+			const __m128i p23 = _mm_or_si128( _mm_shuffle_epi8( _mm_alignr_epi8( c1, c0, 12 ), expand ), alpha );
+			const __m128i p45 = _mm_or_si128( _mm_shuffle_epi8( _mm_alignr_epi8( c2, c1, 8 ), expand ), alpha );
+			const __m128i p67 = _mm_or_si128( _mm_shuffle_epi8( _mm_srli_si128( c2, 4 ), expand ), alpha );
+			storeCodesAvx2<true>( _mm256_inserti128_si256( _mm256_castsi128_si256( p01 ), p23, 1 ), dst + x * 4 );
+			storeCodesAvx2<true>( _mm256_inserti128_si256( _mm256_castsi128_si256( p45 ), p67, 1 ), dst + x * 4 + 16 );
+		}
+
+		if( x < width )
+			unpackRowScalar<Format>( src, dst + x * 4, width - x );
+	}
+#endif
+
+#if defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+	template<bool TwelveBit>
+	inline uint16x4_t neonChannel( uint16x4_t codes, uint16_t * )
+	{
+		if( TwelveBit )
+			return vorr_u16( vshl_n_u16( codes, 4 ), vshr_n_u16( codes, 8 ) );
+		const int32x4_t centered = vsubq_s32( vreinterpretq_s32_u32( vmovl_u16( codes ) ), vdupq_n_s32( kVideoBlack ) );
+		return vqmovun_s32( vshrq_n_s32( vmlaq_n_s32( vdupq_n_s32( kVideoRound ), centered, kVideoScale ), kVideoShift ) );
+	}
+
+	template<bool TwelveBit>
+	inline float32x4_t neonChannel( uint16x4_t codes, float * )
+	{
+		const int32x4_t centered = vsubq_s32( vreinterpretq_s32_u32( vmovl_u16( codes ) ), vdupq_n_s32( TwelveBit ? 0 : kVideoBlack ) );
+		return vmulq_n_f32( vcvtq_f32_s32( centered ), TwelveBit ? kFullFloatScale : kVideoFloatScale );
+	}
+
+	inline void neonStore( uint16_t * dst, uint16x4_t r, uint16x4_t g, uint16x4_t b ) { uint16x4x4_t rgba = { { r, g, b, vdup_n_u16( 65535 ) } }; vst4_u16( dst, rgba ); }
+	inline void neonStore( float * dst, float32x4_t r, float32x4_t g, float32x4_t b ) { float32x4x4_t rgba = { { r, g, b, vdupq_n_f32( 1.0f ) } }; vst4q_f32( dst, rgba ); }
+
+	//! Stores 4 pixels given as planar codes.
+	template<bool TwelveBit, typename T>
+	inline void neonStoreCodes( uint16x4_t r, uint16x4_t g, uint16x4_t b, T * dst )
+	{
+		neonStore( dst, neonChannel<TwelveBit>( r, dst ), neonChannel<TwelveBit>( g, dst ), neonChannel<TwelveBit>( b, dst ) );
+	}
+
+	template<PackedRGBFormat Format, typename T>
+	void unpackRGB10RowNeon( const uint8_t * src, T * dst, long width )
+	{
+		const int shift = Format == PackedRGBFormat::R210 ? 0 : 2;
+		const uint32x4_t mask = vdupq_n_u32( 0x3FF );
+
+		long x = 0;
+		for( ; x + 4 <= width; x += 4 ) {
+			uint8x16_t bytes = vld1q_u8( src + x * 4 );
+			if( Format != PackedRGBFormat::R10L )
+				bytes = vrev32q_u8( bytes );
+			const uint32x4_t words = vreinterpretq_u32_u8( bytes );
+			neonStoreCodes<false>(
+				vmovn_u32( vandq_u32( vshrq_n_u32( words, 20 + shift ), mask ) ),
+				vmovn_u32( vandq_u32( vshrq_n_u32( words, 10 + shift ), mask ) ),
+				vmovn_u32( vandq_u32( vshrq_n_u32( words, shift ), mask ) ),
+				dst + x * 4 );
+		}
+
+		if( x < width )
+			unpackRowScalar<Format>( src + x * 4, dst + x * 4, width - x );
+	}
+
+	// Same chunk gathering as the x86 kernel with a per lane variable shift, vld3 deinterleaving the components.
+	template<PackedRGBFormat Format, typename T>
+	void unpackRGB12RowNeon( const uint8_t * src, T * dst, long width )
+	{
+		static const uint8_t littleTable[16] = { 0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11 };
+		static const uint8_t bigTable[16] = { 3, 2, 2, 1, 0, 7, 7, 6, 5, 4, 4, 11, 10, 9, 9, 8 };
+		static const int16_t shifts[8] = { 0, -4, 0, -4, 0, -4, 0, -4 };
+		const uint8x16_t gather = vld1q_u8( Format == PackedRGBFormat::R12B ? bigTable : littleTable );
+		const int16x8_t shift = vld1q_s16( shifts );
+		const uint16x8_t mask = vdupq_n_u16( 0xFFF );
+
+		uint16_t components[24];
+		long x = 0;
+		for( ; x + 8 < width; x += 8, src += 36 ) {
+			for( int chunk = 0; chunk < 3; ++chunk ) {
+				const uint16x8_t pairs = vreinterpretq_u16_u8( vqtbl1q_u8( vld1q_u8( src + chunk * 12 ), gather ) );
+				vst1q_u16( components + chunk * 8, vandq_u16( vshlq_u16( pairs, shift ), mask ) );
+			}
+			const uint16x8x3_t rgb = vld3q_u16( components );
+			neonStoreCodes<true>( vget_low_u16( rgb.val[0] ), vget_low_u16( rgb.val[1] ), vget_low_u16( rgb.val[2] ), dst + x * 4 );
+			neonStoreCodes<true>( vget_high_u16( rgb.val[0] ), vget_high_u16( rgb.val[1] ), vget_high_u16( rgb.val[2] ), dst + x * 4 + 16 );
+		}
+
+		if( x < width )
+			unpackRowScalar<Format>( src, dst + x * 4, width - x );
+	}
+#endif
+
+	template<typename T>
+	PackedRGBRowKernel<T> getRowKernel( PackedRGBFormat format, SimdLevel level )
+	{
+		// The byte swaps and gathers need SSSE3, SSE2 only cpus use the scalar unpackers.
+#if defined( MEDIA_ARCH_X86 )
+		if( level == SimdLevel::AVX2 ) {
+			switch( format ) {
+			case PackedRGBFormat::R210:	return unpackRGB10RowAvx2<PackedRGBFormat::R210, T>;
+			case PackedRGBFormat::R10B:	return unpackRGB10RowAvx2<PackedRGBFormat::R10B, T>;
+			case PackedRGBFormat::R10L:	return unpackRGB10RowAvx2<PackedRGBFormat::R10L, T>;
+			case PackedRGBFormat::R12B:	return unpackRGB12RowAvx2<PackedRGBFormat::R12B, T>;
+			case PackedRGBFormat::R12L:	return unpackRGB12RowAvx2<PackedRGBFormat::R12L, T>;
+			}
+		}
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		if( level == SimdLevel::NEON ) {
+			switch( format ) {
+			case PackedRGBFormat::R210:	return unpackRGB10RowNeon<PackedRGBFormat::R210, T>;
+			case PackedRGBFormat::R10B:	return unpackRGB10RowNeon<PackedRGBFormat::R10B, T>;
+			case PackedRGBFormat::R10L:	return unpackRGB10RowNeon<PackedRGBFormat::R10L, T>;
+			case PackedRGBFormat::R12B:	return unpackRGB12RowNeon<PackedRGBFormat::R12B, T>;
+			case PackedRGBFormat::R12L:	return unpackRGB12RowNeon<PackedRGBFormat::R12L, T>;
+			}
+		}
+#endif
+		switch( format ) {
+		case PackedRGBFormat::R210:	return unpackRowScalar<PackedRGBFormat::R210, T>;
+		case PackedRGBFormat::R10B:	return unpackRowScalar<PackedRGBFormat::R10B, T>;
+		case PackedRGBFormat::R10L:	return unpackRowScalar<PackedRGBFormat::R10L, T>;
+		case PackedRGBFormat::R12B:	return unpackRowScalar<PackedRGBFormat::R12B, T>;
+		default:					return unpackRowScalar<PackedRGBFormat::R12L, T>;
+		}
+	}
+
+	typedef void( *NarrowRowKernel )( const uint16_t * src, uint8_t * dst, long width );
+
+	// Rounds to nearest, ( value * 255 + 32767 ) / 65535 without the division.
+	inline uint8_t narrowComponent( uint16_t value )
+	{
+		return uint8_t( ( int( value ) * 255 + 32895 ) >> 16 );
+	}
+
+	void narrowRowScalar( const uint16_t * src, uint8_t * dst, long width )
+	{
+		for( long x = 0; x < width; ++x, src += 4, dst += 4 ) {
+			dst[0] = narrowComponent( src[2] );
+			dst[1] = narrowComponent( src[1] );
+			dst[2] = narrowComponent( src[0] );
+			dst[3] = narrowComponent( src[3] );
+		}
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	// Same rounding on 16-bit lanes: t = value + 128 saturated, ( t - ( t >> 8 ) ) >> 8 is exact for every value.
+	inline __m128i narrowSse2( __m128i rgba )
+	{
+		const __m128i bgra = _mm_shufflehi_epi16( _mm_shufflelo_epi16( rgba, _MM_SHUFFLE( 3, 0, 1, 2 ) ), _MM_SHUFFLE( 3, 0, 1, 2 ) );
+		const __m128i rounded = _mm_adds_epu16( bgra, _mm_set1_epi16( 128 ) );
+		return _mm_srli_epi16( _mm_sub_epi16( rounded, _mm_srli_epi16( rounded, 8 ) ), 8 );
+	}
+
+	// 4 pixels per iteration. Bandwidth bound, AVX2 uses it too.
+	void narrowRowSse2( const uint16_t * src, uint8_t * dst, long width )
+	{
+		long x = 0;
+		for( ; x + 4 <= width; x += 4 ) {
+			const __m128i lo = narrowSse2( _mm_loadu_si128( (const __m128i*)( src + x * 4 ) ) );
+			const __m128i hi = narrowSse2( _mm_loadu_si128( (const __m128i*)( src + x * 4 + 8 ) ) );
+			_mm_storeu_si128( (__m128i*)( dst + x * 4 ), _mm_packus_epi16( lo, hi ) );
+		}
+
+		if( x < width )
+			narrowRowScalar( src + x * 4, dst + x * 4, width - x );
+	}
+#endif
+
+#if defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+	inline uint8x8_t narrowNeon( uint16x8_t value )
+	{
+		const uint16x8_t rounded = vqaddq_u16( value, vdupq_n_u16( 128 ) );
+		return vmovn_u16( vshrq_n_u16( vsubq_u16( rounded, vshrq_n_u16( rounded, 8 ) ), 8 ) );
+	}
+
+	// 8 pixels per iteration, vld4 deinterleaving the channels so that the swap is free.
+	void narrowRowNeon( const uint16_t * src, uint8_t * dst, long width )
+	{
+		long x = 0;
+		for( ; x + 8 <= width; x += 8 ) {
+			const uint16x8x4_t rgba = vld4q_u16( src + x * 4 );
+			const uint8x8x4_t bgra = { { narrowNeon( rgba.val[2] ), narrowNeon( rgba.val[1] ), narrowNeon( rgba.val[0] ), narrowNeon( rgba.val[3] ) } };
+			vst4_u8( dst + x * 4, bgra );
+		}
+
+		if( x < width )
+			narrowRowScalar( src + x * 4, dst + x * 4, width - x );
+	}
+#endif
+
+	NarrowRowKernel getNarrowRowKernel( SimdLevel level )
+	{
+#if defined( MEDIA_ARCH_X86 )
+		if( level == SimdLevel::SSE2 || level == SimdLevel::AVX2 )
+			return narrowRowSse2;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		if( level == SimdLevel::NEON )
+			return narrowRowNeon;
+#endif
+		return narrowRowScalar;
+	}
+
+	template<typename T>
+	void convertPackedRGBToRGBA( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, T * dst, size_t dstRowBytes, long width, long height, SimdLevel level )
+	{
+		if( ! isSimdLevelSupported( level ) )
+			level = SimdLevel::SCALAR;
+
+		const PackedRGBRowKernel<T> unpack = getRowKernel<T>( format, level );
+		for( long row = 0; row < height; ++row )
+			unpack( src + row * srcRowBytes, (T*)( (uint8_t*)dst + row * dstRowBytes ), width );
+	}
+
+	inline int toVideoCode( uint16_t value )
+	{
+		return kVideoBlack + ( value * ( kVideoWhite - kVideoBlack ) + 32767 ) / 65535;
+	}
+
+	void packRowScalar( PackedRGBFormat format, const uint16_t * src, uint8_t * dst, long width )
+	{
+		if( isTwelveBit( format ) ) {
+			const bool bigEndian = format == PackedRGBFormat::R12B;
+			for( long x = 0; x < width; x += 8, dst += 36 ) {
+				uint8_t stream[36] = {};
+				const long count = width - x < 8 ? width - x : 8;
+				for( int k = 0; k < count * 3; ++k ) {
+					const int code = src[( x + k / 3 ) * 4 + k % 3] >> 4;
+					const size_t o = size_t( k ) * 3 / 2;
+					if( k & 1 ) {
+						stream[o] |= uint8_t( code << 4 );
+						stream[o + 1] = uint8_t( code >> 4 );
+					}
+					else {
+						stream[o] = uint8_t( code );
+						stream[o + 1] |= uint8_t( code >> 8 );
+					}
+				}
+				for( size_t i = 0; i < 36; ++i )
+					dst[streamByte( i, bigEndian )] = stream[i];
+			}
+		}
+		else {
+			const int shift = format == PackedRGBFormat::R210 ? 0 : 2;
+			for( long x = 0; x < width; ++x, src += 4, dst += 4 ) {
+				const uint32_t word = ( uint32_t( toVideoCode( src[0] ) ) << ( 20 + shift ) ) | ( uint32_t( toVideoCode( src[1] ) ) << ( 10 + shift ) ) | ( uint32_t( toVideoCode( src[2] ) ) << shift );
+				if( format == PackedRGBFormat::R10L )
+					writeLE32( dst, word );
+				else
+					writeBE32( dst, word );
+			}
+		}
+	}
+}
+
+void convertPackedRGBToRGBA16( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height )
+{
+	convertPackedRGBToRGBA( format, src, srcRowBytes, dst, dstRowBytes, width, height, getSimdLevel() );
+}
+
+void convertPackedRGBToRGBA16( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, SimdLevel level )
+{
+	convertPackedRGBToRGBA( format, src, srcRowBytes, dst, dstRowBytes, width, height, level );
+}
+
+void convertPackedRGBToRGBAFloat( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, float * dst, size_t dstRowBytes, long width, long height )
+{
+	convertPackedRGBToRGBA( format, src, srcRowBytes, dst, dstRowBytes, width, height, getSimdLevel() );
+}
+
+void convertPackedRGBToRGBAFloat( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, float * dst, size_t dstRowBytes, long width, long height, SimdLevel level )
+{
+	convertPackedRGBToRGBA( format, src, srcRowBytes, dst, dstRowBytes, width, height, level );
+}
+
+void convertRGBA16ToBGRA( const uint16_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height )
+{
+	convertRGBA16ToBGRA( src, srcRowBytes, dst, dstRowBytes, width, height, getSimdLevel() );
+}
+
+void convertRGBA16ToBGRA( const uint16_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, SimdLevel level )
+{
+	if( ! isSimdLevelSupported( level ) )
+		level = SimdLevel::SCALAR;
+
+	const NarrowRowKernel narrow = getNarrowRowKernel( level );
+	for( long row = 0; row < height; ++row )
+		narrow( (const uint16_t*)( (const uint8_t*)src + row * srcRowBytes ), dst + row * dstRowBytes, width );
+}
+
+void convertPackedRGBToBGRA( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height )
+{
+	convertPackedRGBToBGRA( format, src, srcRowBytes, dst, dstRowBytes, width, height, getSimdLevel() );
+}
+
+void convertPackedRGBToBGRA( PackedRGBFormat format, const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, SimdLevel level )
+{
+	if( ! isSimdLevelSupported( level ) )
+		level = SimdLevel::SCALAR;
+
+	// One row at a time through 16-bit RGBA, which stays in cache between the two passes.
+	const PackedRGBRowKernel<uint16_t> unpack = getRowKernel<uint16_t>( format, level );
+	const NarrowRowKernel narrow = getNarrowRowKernel( level );
+	std::vector<uint16_t> rgba( size_t( width ) * 4 );
+	for( long row = 0; row < height; ++row ) {
+		unpack( src + row * srcRowBytes, rgba.data(), width );
+		narrow( rgba.data(), dst + row * dstRowBytes, width );
+	}
+}
+
+void convertRGBA16ToPackedRGB( PackedRGBFormat format, const uint16_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height )
+{
+	for( long row = 0; row < height; ++row )
+		packRowScalar( format, (const uint16_t*)( (const uint8_t*)src + row * srcRowBytes ), dst + row * dstRowBytes, width );
+}
+
+} //end namespace media
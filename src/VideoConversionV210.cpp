@@ -0,0 +1,396 @@
+#include "VideoConversion.h"
+
+#include <vector>
+
+#if defined( MEDIA_ARCH_X86 )
+	#include <immintrin.h>
+#elif defined( MEDIA_ARCH_NEON )
+	#include <arm_neon.h>
+#endif
+
+// v210 packs three 10-bit samples in each little endian 32-bit word, 6 pixels per 16 bytes:
+//   word 0: Cb0 Y0 Cr0   word 1: Y1 Cb2 Y2   word 2: Cr2 Y3 Cb4   word 3: Y4 Cr4 Y5
+// Rows are padded to 48 pixel / 128 byte groups, so a 16 byte block can always be read whole.
+
+namespace media {
+
+namespace {
+
+	// Fixed point 10-bit YCbCr to 16-bit RGB, same expression layout as the 8-bit UYVY kernels.
+	const int kShift = 7;
+	const int kRound = 1 << ( kShift - 1 );
+	const float kHalfScale = 1.0f / 65535.0f;
+	const uint16_t kHalfOne = 0x3C00;
+
+	// Unpacking is done in chunks through stack buffers, large enough to amortize the loop and small enough for L1.
+	const long kChunkPixels = 192;
+
+	struct Yuv10Coefficients {
+		int16_t y, rv, gu, gv, bu;
+	};
+
+	Yuv10Coefficients computeCoefficients( YCbCrMatrix matrix )
+	{
+		double kr, kb;
+		getYCbCrWeights( matrix, &kr, &kb );
+		const double kg = 1.0 - kr - kb;
+		const double scale = double( 1 << kShift );
+		const double ys = 65535.0 / 876.0;
+		const double cs = 65535.0 / 896.0;
+
+		Yuv10Coefficients c;
+		c.y = int16_t( ys * scale + 0.5 );
+		c.rv = int16_t( 2.0 * ( 1.0 - kr ) * cs * scale + 0.5 );
+		c.gu = int16_t( 2.0 * kb * ( 1.0 - kb ) / kg * cs * scale + 0.5 );
+		c.gv = int16_t( 2.0 * kr * ( 1.0 - kr ) / kg * cs * scale + 0.5 );
+		c.bu = int16_t( 2.0 * ( 1.0 - kb ) * cs * scale + 0.5 );
+		return c;
+	}
+
+	const Yuv10Coefficients& getCoefficients( YCbCrMatrix matrix )
+	{
+		static const Yuv10Coefficients bt601 = computeCoefficients( YCbCrMatrix::BT601 );
+		static const Yuv10Coefficients bt709 = computeCoefficients( YCbCrMatrix::BT709 );
+		static const Yuv10Coefficients bt2020 = computeCoefficients( YCbCrMatrix::BT2020 );
+		switch( matrix ) {
+		case YCbCrMatrix::BT601:	return bt601;
+		case YCbCrMatrix::BT2020:	return bt2020;
+		default:					return bt709;
+		}
+	}
+
+	inline uint32_t readLE32( const uint8_t * p )
+	{
+		return uint32_t( p[0] ) | ( uint32_t( p[1] ) << 8 ) | ( uint32_t( p[2] ) << 16 ) | ( uint32_t( p[3] ) << 24 );
+	}
+
+	inline uint16_t clampToWord( int value )
+	{
+		return uint16_t( value < 0 ? 0 : ( value > 65535 ? 65535 : value ) );
+	}
+
+	typedef void( *V210UnpackKernel )( const uint8_t * src, uint16_t * y, uint16_t * cb, uint16_t * cr, long width );
+	typedef void( *Planar422ToRGBAKernel )( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint16_t * dst, long width, const Yuv10Coefficients& c );
+
+	void unpackV210RowScalar( const uint8_t * src, uint16_t * y, uint16_t * cb, uint16_t * cr, long width )
+	{
+		for( long x = 0; x < width; x += 6, src += 16 ) {
+			const uint32_t w0 = readLE32( src ), w1 = readLE32( src + 4 ), w2 = readLE32( src + 8 ), w3 = readLE32( src + 12 );
+			const uint16_t luma[6] = {
+				uint16_t( ( w0 >> 10 ) & 0x3FF ), uint16_t( w1 & 0x3FF ), uint16_t( ( w1 >> 20 ) & 0x3FF ),
+				uint16_t( ( w2 >> 10 ) & 0x3FF ), uint16_t( w3 & 0x3FF ), uint16_t( ( w3 >> 20 ) & 0x3FF ) };
+			const uint16_t blue[3] = { uint16_t( w0 & 0x3FF ), uint16_t( ( w1 >> 10 ) & 0x3FF ), uint16_t( ( w2 >> 20 ) & 0x3FF ) };
+			const uint16_t red[3] = { uint16_t( ( w0 >> 20 ) & 0x3FF ), uint16_t( w2 & 0x3FF ), uint16_t( ( w3 >> 10 ) & 0x3FF ) };
+
+			const long count = width - x < 6 ? width - x : 6;
+			for( long i = 0; i < count; ++i )
+				y[x + i] = luma[i];
+			for( long i = 0; i < ( count + 1 ) / 2; ++i ) {
+				cb[x / 2 + i] = blue[i];
+				cr[x / 2 + i] = red[i];
+			}
+		}
+	}
+
+	template<bool Half>
+	void planarToRGBARowScalar( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint16_t * dst, long width, const Yuv10Coefficients& c )
+	{
+		for( long x = 0; x < width; ++x, dst += 4 ) {
+			const int u = cb[x / 2] - 512;
+			const int v = cr[x / 2] - 512;
+			const int luma = c.y * ( y[x] - 64 );
+			const int r = ( luma + c.rv * v + kRound ) >> kShift;
+			const int g = ( luma - c.gu * u - c.gv * v + kRound ) >> kShift;
+			const int b = ( luma + c.bu * u + kRound ) >> kShift;
+			if( Half ) {
+				dst[0] = floatToHalf( float( r ) * kHalfScale );
+				dst[1] = floatToHalf( float( g ) * kHalfScale );
+				dst[2] = floatToHalf( float( b ) * kHalfScale );
+				dst[3] = kHalfOne;
+			}
+			else {
+				dst[0] = clampToWord( r );
+				dst[1] = clampToWord( g );
+				dst[2] = clampToWord( b );
+				dst[3] = 65535;
+			}
+		}
+	}
+
+#if defined( MEDIA_ARCH_X86 )
+	inline int32_t packCoefficients( int lo, int hi )
+	{
+		return int32_t( uint32_t( uint16_t( lo ) ) | ( uint32_t( uint16_t( hi ) ) << 16 ) );
+	}
+
+	// Each 128-bit lane holds one 16 byte block. pshufb gathers the two bytes covering every sample into a 16-bit
+	// lane, the multiply moves the sample to bits 4-13 (samples sit at bit 0, 2 or 4 of their byte pair) and the
+	// shift and mask extract it. 6 luma and 3 + 3 chroma samples come out per block; the stores write 8 and 4
+	// lanes, the extra ones being overwritten by the next block or left alone by stopping 16 pixels short of the end.
+	MEDIA_TARGET_AVX2 void unpackV210RowAvx2( const uint8_t * src, uint16_t * y, uint16_t * cb, uint16_t * cr, long width )
+	{
+		const __m256i lumaShuffle = _mm256_setr_epi8(
+			1, 2, 4, 5, 6, 7, 9, 10, 12, 13, 14, 15, -1, -1, -1, -1,
+			1, 2, 4, 5, 6, 7, 9, 10, 12, 13, 14, 15, -1, -1, -1, -1 );
+		const __m256i lumaScale = _mm256_setr_epi16( 4, 16, 1, 4, 16, 1, 0, 0, 4, 16, 1, 4, 16, 1, 0, 0 );
+		const __m256i chromaShuffle = _mm256_setr_epi8(
+			0, 1, 5, 6, 10, 11, -1, -1, 2, 3, 8, 9, 13, 14, -1, -1,
+			0, 1, 5, 6, 10, 11, -1, -1, 2, 3, 8, 9, 13, 14, -1, -1 );
+		const __m256i chromaScale = _mm256_setr_epi16( 16, 4, 1, 0, 1, 16, 4, 0, 16, 4, 1, 0, 1, 16, 4, 0 );
+		const __m256i mask = _mm256_set1_epi16( 0x3FF );
+
+		long x = 0;
+		for( ; x + 16 <= width; x += 12, src += 32 ) {
+			const __m256i block = _mm256_loadu_si256( (const __m256i*)src );
+			const __m256i luma = _mm256_and_si256( _mm256_srli_epi16( _mm256_mullo_epi16( _mm256_shuffle_epi8( block, lumaShuffle ), lumaScale ), 4 ), mask );
+			const __m256i chroma = _mm256_and_si256( _mm256_srli_epi16( _mm256_mullo_epi16( _mm256_shuffle_epi8( block, chromaShuffle ), chromaScale ), 4 ), mask );
+
+			const __m128i luma0 = _mm256_castsi256_si128( luma ), luma1 = _mm256_extracti128_si256( luma, 1 );
+			const __m128i chroma0 = _mm256_castsi256_si128( chroma ), chroma1 = _mm256_extracti128_si256( chroma, 1 );
+			_mm_storeu_si128( (__m128i*)( y + x ), luma0 );
+			_mm_storeu_si128( (__m128i*)( y + x + 6 ), luma1 );
+			_mm_storel_epi64( (__m128i*)( cb + x / 2 ), chroma0 );
+			_mm_storel_epi64( (__m128i*)( cb + x / 2 + 3 ), chroma1 );
+			_mm_storel_epi64( (__m128i*)( cr + x / 2 ), _mm_unpackhi_epi64( chroma0, chroma0 ) );
+			_mm_storel_epi64( (__m128i*)( cr + x / 2 + 3 ), _mm_unpackhi_epi64( chroma1, chroma1 ) );
+		}
+
+		if( x < width )
+			unpackV210RowScalar( src, y + x, cb + x / 2, cr + x / 2, width - x );
+	}
+
+	// 8 pixels per iteration with the madd pairing of the 8-bit kernels, kept on 128-bit lanes since the planar
+	// chroma would need lane crossing shuffles otherwise.
+	template<bool Half>
+	MEDIA_TARGET_AVX2 void planarToRGBARowAvx2( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint16_t * dst, long width, const Yuv10Coefficients& c )
+	{
+		const __m128i lumaOffset = _mm_set1_epi16( 64 );
+		const __m128i chromaOffset = _mm_set1_epi16( 512 );
+		const __m128i ones = _mm_set1_epi16( 1 );
+		const __m128i alpha = _mm_set1_epi16( Half ? int16_t( kHalfOne ) : int16_t( -1 ) );
+		const __m128i round = _mm_set1_epi32( kRound );
+		const __m128 halfScale = _mm_set1_ps( kHalfScale );
+		const __m128i coefR = _mm_set1_epi32( packCoefficients( c.y, c.rv ) );
+		const __m128i coefB = _mm_set1_epi32( packCoefficients( c.y, c.bu ) );
+		const __m128i coefGyu = _mm_set1_epi32( packCoefficients( c.y, -c.gu ) );
+		const __m128i coefGv = _mm_set1_epi32( packCoefficients( -c.gv, kRound ) );
+
+		long x = 0;
+		for( ; x + 8 <= width; x += 8 ) {
+			const __m128i luma = _mm_sub_epi16( _mm_loadu_si128( (const __m128i*)( y + x ) ), lumaOffset );
+			__m128i u = _mm_sub_epi16( _mm_loadl_epi64( (const __m128i*)( cb + x / 2 ) ), chromaOffset );
+			__m128i v = _mm_sub_epi16( _mm_loadl_epi64( (const __m128i*)( cr + x / 2 ) ), chromaOffset );
+			u = _mm_unpacklo_epi16( u, u );
+			v = _mm_unpacklo_epi16( v, v );
+
+			const __m128i yuLo = _mm_unpacklo_epi16( luma, u ), yuHi = _mm_unpackhi_epi16( luma, u );
+			const __m128i yvLo = _mm_unpacklo_epi16( luma, v ), yvHi = _mm_unpackhi_epi16( luma, v );
+			const __m128i v1Lo = _mm_unpacklo_epi16( v, ones ), v1Hi = _mm_unpackhi_epi16( v, ones );
+
+			const __m128i rLo = _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yvLo, coefR ), round ), kShift );
+			const __m128i rHi = _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yvHi, coefR ), round ), kShift );
+			const __m128i gLo = _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yuLo, coefGyu ), _mm_madd_epi16( v1Lo, coefGv ) ), kShift );
+			const __m128i gHi = _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yuHi, coefGyu ), _mm_madd_epi16( v1Hi, coefGv ) ), kShift );
+			const __m128i bLo = _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yuLo, coefB ), round ), kShift );
+			const __m128i bHi = _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( yuHi, coefB ), round ), kShift );
+
+			__m128i r, g, b;
+			if( Half ) {
+				r = _mm_unpacklo_epi64( _mm_cvtps_ph( _mm_mul_ps( _mm_cvtepi32_ps( rLo ), halfScale ), _MM_FROUND_TO_NEAREST_INT ),
+										_mm_cvtps_ph( _mm_mul_ps( _mm_cvtepi32_ps( rHi ), halfScale ), _MM_FROUND_TO_NEAREST_INT ) );
+				g = _mm_unpacklo_epi64( _mm_cvtps_ph( _mm_mul_ps( _mm_cvtepi32_ps( gLo ), halfScale ), _MM_FROUND_TO_NEAREST_INT ),
+										_mm_cvtps_ph( _mm_mul_ps( _mm_cvtepi32_ps( gHi ), halfScale ), _MM_FROUND_TO_NEAREST_INT ) );
+				b = _mm_unpacklo_epi64( _mm_cvtps_ph( _mm_mul_ps( _mm_cvtepi32_ps( bLo ), halfScale ), _MM_FROUND_TO_NEAREST_INT ),
+										_mm_cvtps_ph( _mm_mul_ps( _mm_cvtepi32_ps( bHi ), halfScale ), _MM_FROUND_TO_NEAREST_INT ) );
+			}
+			else {
+				// packus clamps to [0, 65535] exactly like clampToWord.
+				r = _mm_packus_epi32( rLo, rHi );
+				g = _mm_packus_epi32( gLo, gHi );
+				b = _mm_packus_epi32( bLo, bHi );
+			}
+
+			const __m128i rgLo = _mm_unpacklo_epi16( r, g ), rgHi = _mm_unpackhi_epi16( r, g );
+			const __m128i baLo = _mm_unpacklo_epi16( b, alpha ), baHi = _mm_unpackhi_epi16( b, alpha );
+			__m128i * out = (__m128i*)( dst + x * 4 );
+			_mm_storeu_si128( out + 0, _mm_unpacklo_epi32( rgLo, baLo ) );
+			_mm_storeu_si128( out + 1, _mm_unpackhi_epi32( rgLo, baLo ) );
+			_mm_storeu_si128( out + 2, _mm_unpacklo_epi32( rgHi, baHi ) );
+			_mm_storeu_si128( out + 3, _mm_unpackhi_epi32( rgHi, baHi ) );
+		}
+
+		if( x < width )
+			planarToRGBARowScalar<Half>( y + x, cb + x / 2, cr + x / 2, dst + x * 4, width - x, c );
+	}
+#endif
+
+#if defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+	// Same byte gathering as the x86 kernel through a table lookup, with a per lane variable shift instead of the multiply.
+	void unpackV210RowNeon( const uint8_t * src, uint16_t * y, uint16_t * cb, uint16_t * cr, long width )
+	{
+		static const uint8_t lumaTable[16] = { 1, 2, 4, 5, 6, 7, 9, 10, 12, 13, 14, 15, 255, 255, 255, 255 };
+		static const int16_t lumaShifts[8] = { -2, 0, -4, -2, 0, -4, 0, 0 };
+		static const uint8_t chromaTable[16] = { 0, 1, 5, 6, 10, 11, 255, 255, 2, 3, 8, 9, 13, 14, 255, 255 };
+		static const int16_t chromaShifts[8] = { 0, -2, -4, 0, -4, 0, -2, 0 };
+		const uint8x16_t lumaIndex = vld1q_u8( lumaTable ), chromaIndex = vld1q_u8( chromaTable );
+		const int16x8_t lumaShift = vld1q_s16( lumaShifts ), chromaShift = vld1q_s16( chromaShifts );
+		const uint16x8_t mask = vdupq_n_u16( 0x3FF );
+
+		long x = 0;
+		for( ; x + 8 <= width; x += 6, src += 16 ) {
+			const uint8x16_t block = vld1q_u8( src );
+			const uint16x8_t luma = vandq_u16( vshlq_u16( vreinterpretq_u16_u8( vqtbl1q_u8( block, lumaIndex ) ), lumaShift ), mask );
+			const uint16x8_t chroma = vandq_u16( vshlq_u16( vreinterpretq_u16_u8( vqtbl1q_u8( block, chromaIndex ) ), chromaShift ), mask );
+			vst1q_u16( y + x, luma );
+			vst1_u16( cb + x / 2, vget_low_u16( chroma ) );
+			vst1_u16( cr + x / 2, vget_high_u16( chroma ) );
+		}
+
+		if( x < width )
+			unpackV210RowScalar( src, y + x, cb + x / 2, cr + x / 2, width - x );
+	}
+
+	inline int32x4_t neonChannel( int16x4_t y, int16_t cy, int16x4_t a, int16_t ca, int16x4_t b, int16_t cb )
+	{
+		int32x4_t sum = vmlal_n_s16( vdupq_n_s32( kRound ), y, cy );
+		sum = vmlal_n_s16( sum, a, ca );
+		sum = vmlal_n_s16( sum, b, cb );
+		return vshrq_n_s32( sum, kShift );
+	}
+
+	template<bool Half>
+	inline uint16x4_t neonStore( int32x4_t value )
+	{
+		if( Half )
+			return vreinterpret_u16_f16( vcvt_f16_f32( vmulq_n_f32( vcvtq_f32_s32( value ), kHalfScale ) ) );
+		return vqmovun_s32( value );
+	}
+
+	template<bool Half>
+	void planarToRGBARowNeon( const uint16_t * y, const uint16_t * cb, const uint16_t * cr, uint16_t * dst, long width, const Yuv10Coefficients& c )
+	{
+		const int16x4_t lumaOffset = vdup_n_s16( 64 );
+		const int16x4_t chromaOffset = vdup_n_s16( 512 );
+
+		long x = 0;
+		for( ; x + 4 <= width; x += 4 ) {
+			const int16x4_t luma = vsub_s16( vreinterpret_s16_u16( vld1_u16( y + x ) ), lumaOffset );
+			const uint16_t us[4] = { cb[x / 2], cb[x / 2], cb[x / 2 + 1], cb[x / 2 + 1] };
+			const uint16_t vs[4] = { cr[x / 2], cr[x / 2], cr[x / 2 + 1], cr[x / 2 + 1] };
+			const int16x4_t u = vsub_s16( vreinterpret_s16_u16( vld1_u16( us ) ), chromaOffset );
+			const int16x4_t v = vsub_s16( vreinterpret_s16_u16( vld1_u16( vs ) ), chromaOffset );
+
+			uint16x4x4_t rgba;
+			rgba.val[0] = neonStore<Half>( neonChannel( luma, c.y, v, c.rv, u, 0 ) );
+			rgba.val[1] = neonStore<Half>( neonChannel( luma, c.y, u, -c.gu, v, -c.gv ) );
+			rgba.val[2] = neonStore<Half>( neonChannel( luma, c.y, u, c.bu, v, 0 ) );
+			rgba.val[3] = vdup_n_u16( Half ? kHalfOne : 65535 );
+			vst4_u16( dst + x * 4, rgba );
+		}
+
+		if( x < width )
+			planarToRGBARowScalar<Half>( y + x, cb + x / 2, cr + x / 2, dst + x * 4, width - x, c );
+	}
+#endif
+
+	V210UnpackKernel getUnpackKernel( SimdLevel level )
+	{
+		switch( level ) {
+#if defined( MEDIA_ARCH_X86 )
+		case SimdLevel::AVX2:	return unpackV210RowAvx2;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		case SimdLevel::NEON:	return unpackV210RowNeon;
+#endif
+		// The shuffle needs SSSE3, SSE2 only cpus use the scalar unpacker.
+		default:				return unpackV210RowScalar;
+		}
+	}
+
+	template<bool Half>
+	Planar422ToRGBAKernel getRGBAKernel( SimdLevel level )
+	{
+		switch( level ) {
+#if defined( MEDIA_ARCH_X86 )
+		case SimdLevel::AVX2:	return planarToRGBARowAvx2<Half>;
+#elif defined( MEDIA_ARCH_NEON ) && ( defined( __aarch64__ ) || defined( _M_ARM64 ) )
+		case SimdLevel::NEON:	return planarToRGBARowNeon<Half>;
+#endif
+		default:				return planarToRGBARowScalar<Half>;
+		}
+	}
+
+	template<bool Half>
+	void convertV210ToRGBA( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level )
+	{
+		if( ! isSimdLevelSupported( level ) )
+			level = SimdLevel::SCALAR;
+
+		const V210UnpackKernel unpack = getUnpackKernel( level );
+		const Planar422ToRGBAKernel toRGBA = getRGBAKernel<Half>( level );
+		const Yuv10Coefficients& coefficients = getCoefficients( matrix );
+
+		uint16_t luma[kChunkPixels], blue[kChunkPixels / 2], red[kChunkPixels / 2];
+		for( long row = 0; row < height; ++row ) {
+			const uint8_t * srcRow = src + row * srcRowBytes;
+			uint16_t * dstRow = (uint16_t*)( (uint8_t*)dst + row * dstRowBytes );
+			for( long x = 0; x < width; x += kChunkPixels ) {
+				const long count = width - x < kChunkPixels ? width - x : kChunkPixels;
+				unpack( srcRow + x / 6 * 16, luma, blue, red, count );
+				toRGBA( luma, blue, red, dstRow + x * 4, count, coefficients );
+			}
+		}
+	}
+}
+
+void convertV210ToYUV422P16( const uint8_t * src, size_t srcRowBytes, uint16_t * y, size_t yRowBytes, uint16_t * cb, size_t cbRowBytes, uint16_t * cr, size_t crRowBytes, long width, long height )
+{
+	convertV210ToYUV422P16( src, srcRowBytes, y, yRowBytes, cb, cbRowBytes, cr, crRowBytes, width, height, getSimdLevel() );
+}
+
+void convertV210ToYUV422P16( const uint8_t * src, size_t srcRowBytes, uint16_t * y, size_t yRowBytes, uint16_t * cb, size_t cbRowBytes, uint16_t * cr, size_t crRowBytes, long width, long height, SimdLevel level )
+{
+	if( ! isSimdLevelSupported( level ) )
+		level = SimdLevel::SCALAR;
+
+	const V210UnpackKernel unpack = getUnpackKernel( level );
+	for( long row = 0; row < height; ++row ) {
+		unpack( src + row * srcRowBytes, (uint16_t*)( (uint8_t*)y + row * yRowBytes ), (uint16_t*)( (uint8_t*)cb + row * cbRowBytes ), (uint16_t*)( (uint8_t*)cr + row * crRowBytes ), width );
+	}
+}
+
+void convertV210ToRGBA16( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix )
+{
+	convertV210ToRGBA<false>( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, getSimdLevel() );
+}
+
+void convertV210ToRGBA16( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level )
+{
+	convertV210ToRGBA<false>( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, level );
+}
+
+void convertV210ToRGBAHalf( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix )
+{
+	convertV210ToRGBA<true>( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, getSimdLevel() );
+}
+
+void convertV210ToRGBAHalf( const uint8_t * src, size_t srcRowBytes, uint16_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level )
+{
+	convertV210ToRGBA<true>( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, level );
+}
+
+void convertV210ToBGRA( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix )
+{
+	convertV210ToBGRA( src, srcRowBytes, dst, dstRowBytes, width, height, matrix, getSimdLevel() );
+}
+
+void convertV210ToBGRA( const uint8_t * src, size_t srcRowBytes, uint8_t * dst, size_t dstRowBytes, long width, long height, YCbCrMatrix matrix, SimdLevel level )
+{
+	// One row at a time through 16-bit RGBA, which stays in cache between the two passes.
+	std::vector<uint16_t> rgba( size_t( width ) * 4 );
+	for( long row = 0; row < height; ++row ) {
+		convertV210ToRGBA<false>( src + row * srcRowBytes, srcRowBytes, rgba.data(), rgba.size() * 2, width, 1, matrix, level );
+		convertRGBA16ToBGRA( rgba.data(), rgba.size() * 2, dst + row * dstRowBytes, dstRowBytes, width, 1, level );
+	}
+}
+
+} //end namespace media
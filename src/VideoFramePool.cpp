@@ -0,0 +1,180 @@
+#include "VideoFramePool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined( _MSC_VER )
+	#include <malloc.h>
+#endif
+
+using namespace media;
+
+namespace {
+	const size_t kBufferAlignment = 64;
+
+	uint8_t * allocateAligned( size_t size )
+	{
+#if defined( _MSC_VER )
+		void * ptr = _aligned_malloc( size, kBufferAlignment );
+#else
+		void * ptr = nullptr;
+		if( posix_memalign( &ptr, kBufferAlignment, size ) != 0 )
+			ptr = nullptr;
+#endif
+		if( ! ptr )
+			throw std::bad_alloc();
+
+		// Touch every page up front so the capture thread never takes the page faults.
+		std::memset( ptr, 0, size );
+		return static_cast<uint8_t*>( ptr );
+	}
+
+	void freeAligned( uint8_t * ptr )
+	{
+#if defined( _MSC_VER )
+		_aligned_free( ptr );
+#else
+		std::free( ptr );
+#endif
+	}
+}
+
+PooledFrameBufferRef PooledFrameBuffer::create( size_t size )
+{
+	return PooledFrameBufferRef::adopt( new PooledFrameBuffer{ size } );
+}
+
+PooledFrameBuffer::PooledFrameBuffer( size_t size )
+	: mData{ size ? allocateAligned( size ) : nullptr }
+	, mSize{ size }
+	, mRefCount{ 1 }
+{
+}
+
+PooledFrameBuffer::~PooledFrameBuffer()
+{
+	if( mData )
+		freeAligned( mData );
+}
+
+unsigned long PooledFrameBuffer::AddRef()
+{
+	return ++mRefCount;
+}
+
+unsigned long PooledFrameBuffer::Release()
+{
+	unsigned long newRefValue = --mRefCount;
+	if( newRefValue == 0 ) {
+		// The pool may be destroyed along with this last reference, don't touch this buffer after recycling it.
+		VideoFramePoolRef pool = std::move( mPool );
+		if( pool )
+			pool->recycle( this );
+		else
+			delete this;
+	}
+	return newRefValue;
+}
+
+VideoFramePoolRef VideoFramePool::create( size_t bufferSize, size_t capacity )
+{
+	return VideoFramePoolRef( new VideoFramePool{ bufferSize, capacity } );
+}
+
+VideoFramePool::VideoFramePool( size_t bufferSize, size_t capacity )
+	: mBufferSize{ 0 }
+	, mCapacity{ capacity }
+	, mHits{ 0 }
+	, mMisses{ 0 }
+{
+	mFreeBuffers.reserve( mCapacity );
+	resize( bufferSize );
+}
+
+VideoFramePool::~VideoFramePool()
+{
+	for( auto buffer : mFreeBuffers ) {
+		delete buffer;
+	}
+}
+
+PooledFrameBufferRef VideoFramePool::acquire()
+{
+	PooledFrameBuffer * buffer = nullptr;
+	size_t bufferSize;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		bufferSize = mBufferSize;
+		if( ! mFreeBuffers.empty() ) {
+			buffer = mFreeBuffers.back();
+			mFreeBuffers.pop_back();
+		}
+	}
+
+	if( buffer ) {
+		++mHits;
+		buffer->mRefCount = 1;
+	}
+	else {
+		++mMisses;
+		buffer = new PooledFrameBuffer{ bufferSize };
+	}
+
+	buffer->mPool = shared_from_this();
+	return PooledFrameBufferRef::adopt( buffer );
+}
+
+void VideoFramePool::resize( size_t bufferSize )
+{
+	std::vector<PooledFrameBuffer*> released;
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		if( bufferSize == mBufferSize && mFreeBuffers.size() == mCapacity )
+			return;
+		mBufferSize = bufferSize;
+		released.swap( mFreeBuffers );
+	}
+
+	for( auto buffer : released ) {
+		delete buffer;
+	}
+
+	std::vector<PooledFrameBuffer*> warmed;
+	warmed.reserve( mCapacity );
+	for( size_t i = 0; i < mCapacity; ++i ) {
+		warmed.push_back( new PooledFrameBuffer{ bufferSize } );
+	}
+
+	std::lock_guard<std::mutex> lock( mMutex );
+	for( auto buffer : warmed ) {
+		if( buffer->mSize == mBufferSize && mFreeBuffers.size() < mCapacity )
+			mFreeBuffers.push_back( buffer );
+		else
+			delete buffer;
+	}
+}
+
+size_t VideoFramePool::getBufferSize() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mBufferSize;
+}
+
+size_t VideoFramePool::getFreeCount() const
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mFreeBuffers.size();
+}
+
+void VideoFramePool::recycle( PooledFrameBuffer * buffer )
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		if( buffer->mSize == mBufferSize && mFreeBuffers.size() < mCapacity ) {
+			mFreeBuffers.push_back( buffer );
+			return;
+		}
+	}
+	delete buffer;
+}
@@ -0,0 +1,122 @@
+#include "WorkerPool.h"
+
+#if defined( _WIN32 )
+	#include <windows.h>
+#elif defined( __linux__ )
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+using namespace media;
+
+namespace {
+	void setThreadAffinity( std::thread& thread, int cpu )
+	{
+#if defined( _WIN32 )
+		SetThreadAffinityMask( thread.native_handle(), DWORD_PTR( 1 ) << cpu );
+#elif defined( __linux__ )
+		cpu_set_t set;
+		CPU_ZERO( &set );
+		CPU_SET( cpu, &set );
+		pthread_setaffinity_np( thread.native_handle(), sizeof( set ), &set );
+#endif
+	}
+}
+
+WorkerPoolRef WorkerPool::create( size_t numWorkers, const std::vector<int>& cpuAffinity )
+{
+	return WorkerPoolRef( new WorkerPool{ numWorkers, cpuAffinity } );
+}
+
+WorkerPool::WorkerPool( size_t numWorkers, const std::vector<int>& cpuAffinity )
+	: mGeneration{ 0 }
+	, mBusyWorkers{ 0 }
+	, mQuit{ false }
+	, mTask{ nullptr }
+	, mContext{ nullptr }
+	, mCount{ 0 }
+	, mNextIndex{ 0 }
+{
+	for( size_t i = 0; i < numWorkers; ++i ) {
+		mThreads.emplace_back( &WorkerPool::workerLoop, this );
+		if( ! cpuAffinity.empty() )
+			setThreadAffinity( mThreads.back(), cpuAffinity[i % cpuAffinity.size()] );
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mQuit = true;
+	}
+	mWorkCondition.notify_all();
+
+	for( auto& thread : mThreads ) {
+		thread.join();
+	}
+}
+
+void WorkerPool::run( size_t count, Task task, void * context )
+{
+	if( count == 0 )
+		return;
+
+	if( mThreads.empty() || count == 1 ) {
+		for( size_t i = 0; i < count; ++i )
+			task( context, i );
+		return;
+	}
+
+	std::lock_guard<std::mutex> runLock( mRunMutex );
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		mTask = task;
+		mContext = context;
+		mCount = count;
+		mNextIndex = 0;
+		mBusyWorkers = mThreads.size();
+		++mGeneration;
+	}
+	mWorkCondition.notify_all();
+
+	execute();
+
+	std::unique_lock<std::mutex> lock( mMutex );
+	mDoneCondition.wait( lock, [this] { return mBusyWorkers == 0; } );
+	mTask = nullptr;
+	mContext = nullptr;
+}
+
+void WorkerPool::workerLoop()
+{
+	uint64_t generation = 0;
+	while( true ) {
+		{
+			std::unique_lock<std::mutex> lock( mMutex );
+			mWorkCondition.wait( lock, [&] { return mQuit || mGeneration != generation; } );
+			if( mQuit )
+				return;
+			generation = mGeneration;
+		}
+
+		execute();
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			last = --mBusyWorkers == 0;
+		}
+		if( last )
+			mDoneCondition.notify_one();
+	}
+}
+
+void WorkerPool::execute()
+{
+	// Indices are handed out dynamically, so faster cores simply take more stripes.
+	size_t index;
+	while( ( index = mNextIndex.fetch_add( 1 ) ) < mCount ) {
+		mTask( mContext, index );
+	}
+}
@@ -0,0 +1,143 @@
+// Locks a simulated output, 40 ppm slow, to a simulated input, 80 ppm fast, with AudioDriftEstimator: both streams are
+// timestamped once per 1920 frame block with up to 50 us of jitter, and the read position advances by the ratio each
+// update returns, as the resampler's would. Checks the measured rates and drift, the convergence of the ratio, the slew
+// of an injected offset below resyncThresholdMs and the resync on one above it.
+
+#include "AudioDriftEstimator.h"
+#include "TestHarness.h"
+
+#include <cmath>
+#include <cstdint>
+
+using namespace media;
+
+namespace {
+	const double kSampleRate = 48000.0;
+	const int64_t kBlockFrames = 1920;
+	const double kInputPpm = 80.0;
+	const double kOutputPpm = -40.0;
+
+	class SimulatedStreams {
+	public:
+		SimulatedStreams()
+			: mInputRate( kSampleRate * ( 1.0 + kInputPpm * 1e-6 ) ), mOutputRate( kSampleRate * ( 1.0 + kOutputPpm * 1e-6 ) ),
+			mSeed( 1 ), mInputBlock( 0 ), mOutputBlock( 0 ), mReadPosition( 0.0 ), mLatencyUs( 80000.0 ), mResyncs( 0 )
+		{
+		}
+
+		//! Runs the output for \a seconds, one update per output block.
+		void run( AudioDriftEstimator& estimator, double seconds )
+		{
+			const int64_t blocks = int64_t( seconds * kSampleRate / double( kBlockFrames ) );
+			for( int64_t block = 0; block < blocks; ++block, ++mOutputBlock ) {
+				const double outputUs = 1e6 + 1e6 * double( mOutputBlock * kBlockFrames ) / mOutputRate;
+				// Every input block captured by then.
+				for( ;; ++mInputBlock ) {
+					const double inputUs = 1e6 * double( mInputBlock * kBlockFrames ) / mInputRate;
+					if( inputUs >= outputUs )
+						break;
+					estimator.addInputTimestamp( mInputBlock * kBlockFrames, int64_t( inputUs ) + getJitterUs() );
+				}
+				estimator.addOutputTimestamp( mOutputBlock * kBlockFrames, int64_t( outputUs ) + getJitterUs() );
+
+				AudioDriftControl control;
+				if( ! estimator.update( mReadPosition, mOutputBlock * kBlockFrames, mLatencyUs, &control ) )
+					continue;
+				// Where the input really was latencyUs before this block plays, for checking only.
+				mError = mReadPosition - mInputRate * ( outputUs - mLatencyUs ) * 1e-6;
+				if( control.resync ) {
+					++mResyncs;
+					mReadPosition = control.targetPosition;
+				}
+				mRatio = control.ratio;
+				mReadPosition += control.ratio * double( kBlockFrames );
+			}
+		}
+
+		//! Plays the input \a offsetUs later from now on.
+		void addLatency( double offsetUs ) { mLatencyUs += offsetUs; }
+
+		//! Read position minus where it should be, in input frames, before the last update.
+		double		getError() const { return mError; }
+		double		getRatio() const { return mRatio; }
+		//! Input frames per output frame the clocks call for.
+		double		getTrueRatio() const { return mInputRate / mOutputRate; }
+		int			getResyncs() const { return mResyncs; }
+	private:
+		int64_t getJitterUs()
+		{
+			mSeed = mSeed * 1664525u + 1013904223u;
+			return int64_t( mSeed >> 16 ) % 101 - 50;
+		}
+
+		double		mInputRate, mOutputRate;
+		uint32_t	mSeed;
+		int64_t		mInputBlock, mOutputBlock;
+		double		mReadPosition, mLatencyUs, mError = 0.0, mRatio = 1.0;
+		int			mResyncs;
+	};
+
+	void testStartup()
+	{
+		AudioDriftEstimator estimator;
+		AudioDriftControl control;
+		MEDIA_CHECK( ! estimator.update( 0.0, 0, 0.0, &control ) );
+		estimator.addInputTimestamp( 0, 1000000 );
+		MEDIA_CHECK( ! estimator.update( 0.0, 0, 0.0, &control ) );
+
+		// With a timestamp each, positions are extrapolated at the nominal rate and the ratio stays nominal.
+		estimator.addOutputTimestamp( 0, 1000000 );
+		MEDIA_CHECK( estimator.update( 2400.0, 4800, 50000.0, &control ) );
+		MEDIA_CHECK( control.ratio == 1.0 && std::fabs( control.targetPosition - 2400.0 ) < 1e-6 && ! control.resync );
+		MEDIA_CHECK( ! estimator.getStats().driftValid );
+	}
+
+	void testLock()
+	{
+		AudioDriftEstimator estimator;
+		SimulatedStreams streams;
+
+		// The read position starts at 0, far from the input captured 80 ms earlier: the first update resyncs it.
+		streams.run( estimator, 20.0 );
+		AudioDriftStats stats = estimator.getStats();
+		const double expectedDrift = ( streams.getTrueRatio() - 1.0 ) * 1e6;
+		MEDIA_CHECK( stats.driftValid );
+		MEDIA_CHECK( std::fabs( stats.inputPpm - kInputPpm ) < 3.0 && std::fabs( stats.outputPpm - kOutputPpm ) < 3.0 );
+		MEDIA_CHECK( std::fabs( stats.driftPpm - expectedDrift ) < 3.0 );
+		MEDIA_CHECK( streams.getResyncs() == 1 && stats.resyncs == 1 );
+
+		// Locked: the ratio follows the drift and the read position stays within a couple of frames of the truth.
+		for( int second = 0; second < 20; ++second ) {
+			streams.run( estimator, 1.0 );
+			MEDIA_CHECK( std::fabs( streams.getRatio() / streams.getTrueRatio() - 1.0 ) < 10e-6 );
+			MEDIA_CHECK( std::fabs( streams.getError() ) < 2.0 );
+		}
+		stats = estimator.getStats();
+		MEDIA_CHECK( std::fabs( stats.driftPpm - expectedDrift ) < 2.0 && stats.ratio == streams.getRatio() );
+
+		// 3 ms is under the 10 ms threshold: slewed at up to maxCorrectionPpm rather than jumped over.
+		streams.addLatency( 3000.0 );
+		streams.run( estimator, 0.1 );
+		stats = estimator.getStats();
+		MEDIA_CHECK( stats.resyncs == 1 && std::fabs( stats.offsetFrames + 144.0 ) < 3.0 );
+		MEDIA_CHECK( stats.correctionPpm < -500.0 && stats.correctionPpm >= -estimator.getOptions().maxCorrectionPpm );
+		streams.run( estimator, 20.0 );
+		MEDIA_CHECK( estimator.getStats().resyncs == 1 && std::fabs( streams.getError() ) < 3.0 );
+
+		// 40 ms is over it: one resync, locked again right after.
+		streams.addLatency( 40000.0 );
+		streams.run( estimator, 0.1 );
+		MEDIA_CHECK( streams.getResyncs() == 2 && estimator.getStats().resyncs == 2 );
+		MEDIA_CHECK( std::fabs( streams.getError() ) < 2.0 );
+		streams.run( estimator, 10.0 );
+		MEDIA_CHECK( estimator.getStats().resyncs == 2 && std::fabs( streams.getError() ) < 2.0 );
+		MEDIA_CHECK( std::fabs( streams.getRatio() / streams.getTrueRatio() - 1.0 ) < 10e-6 );
+	}
+}
+
+int main()
+{
+	testStartup();
+	testLock();
+	return test::report( "AudioDriftEstimatorTest" );
+}
@@ -0,0 +1,147 @@
+// Checks AudioResampler: the signal to noise ratio of sines resampled at drift correction ratios, against the ideal sine
+// at the output times, the filter delay getBufferedFrames() reports, and every SIMD level matching the scalar kernel bit
+// for bit with the ratio changing between blocks of random sizes.
+
+#include "AudioResampler.h"
+#include "CpuFeatures.h"
+#include "TestHarness.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	const double kPi = 3.14159265358979323846;
+	const double kSampleRate = 48000.0;
+
+	uint32_t nextRandom( uint32_t& seed )
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	//! Resamples two seconds of a half scale sine at \a ratio and compares output frame j with the sine at input time
+	//! j * ratio + \a delayFrames, in dB.
+	double measureSnr( double frequency, double ratio, double delayFrames )
+	{
+		AudioResamplerRef resampler = AudioResampler::create( 1 );
+		resampler->setRatio( ratio );
+		const size_t frames = size_t( 2 * kSampleRate );
+		const double amplitude = 0.5 * 2147483648.0;
+		std::vector<int32_t> src( frames ), dst( frames );
+		for( size_t i = 0; i < frames; ++i )
+			src[i] = int32_t( std::floor( amplitude * std::sin( 2.0 * kPi * frequency * double( i ) / kSampleRate ) + 0.5 ) );
+
+		size_t consumed = frames;
+		const size_t produced = resampler->process( src.data(), &consumed, dst.data(), size_t( double( frames ) / ratio ) - 200 );
+		double signal = 0.0, noise = 0.0;
+		// The edges are filtered against the zeros before the first frame.
+		for( size_t j = 2000; j + 2000 < produced; ++j ) {
+			const double ideal = amplitude * std::sin( 2.0 * kPi * frequency * ( double( j ) * ratio + delayFrames ) / kSampleRate );
+			signal += ideal * ideal;
+			noise += ( double( dst[j] ) - ideal ) * ( double( dst[j] ) - ideal );
+		}
+		return 10.0 * std::log10( signal / noise );
+	}
+
+	void testSnr()
+	{
+		// 48 taps, the default: output frame j is centered on input frame j * ratio + taps / 2 - 1.
+		const double delay = 48 / 2 - 1;
+		for( double ratio : { 1.0001, 0.9995 } ) {
+			MEDIA_CHECK( measureSnr( 100.0, ratio, delay ) > 95.0 );
+			MEDIA_CHECK( measureSnr( 1000.0, ratio, delay ) > 90.0 );
+			MEDIA_CHECK( measureSnr( 10000.0, ratio, delay ) > 90.0 );
+			// The top of the passband, where the transition band starts.
+			MEDIA_CHECK( measureSnr( 18000.0, ratio, delay ) > 80.0 );
+			MEDIA_CHECK( measureSnr( 20000.0, ratio, delay ) > 75.0 );
+			// A frame of delay off is a 1 kHz phase error of 7.5 degrees, far under any of these.
+			MEDIA_CHECK( measureSnr( 1000.0, ratio, delay + 1.0 ) < 20.0 );
+		}
+	}
+
+	void testDelay()
+	{
+		AudioResamplerOptions options;
+		options.taps = 32;
+		AudioResamplerRef resampler = AudioResampler::create( 2, options );
+		MEDIA_CHECK( resampler->getBufferedFrames() == 1.0 - 32 / 2 );
+
+		// An impulse at input frame 100 peaks at output frame 100 - ( taps / 2 - 1 ) at a ratio of 1.
+		std::vector<int32_t> src( 2 * 400, 0 ), dst( 2 * 300 );
+		src[2 * 100] = src[2 * 100 + 1] = 1 << 30;
+		size_t consumed = 400;
+		const size_t produced = resampler->process( src.data(), &consumed, dst.data(), 300 );
+		MEDIA_CHECK( produced == 300 );
+		size_t peak = 0;
+		for( size_t j = 0; j < produced; ++j ) {
+			if( dst[2 * j] > dst[2 * peak] )
+				peak = j;
+		}
+		MEDIA_CHECK( peak == 100 - ( 32 / 2 - 1 ) && dst[2 * peak] == dst[2 * peak + 1] );
+
+		// Buffered frames follow what is fed minus what is played, at any ratio.
+		resampler->reset();
+		uint32_t seed = 3;
+		size_t position = 0;
+		for( int block = 0; block < 50; ++block ) {
+			resampler->setRatio( 0.99 + 0.02 * double( nextRandom( seed ) % 1000 ) / 1000.0 );
+			const size_t dstFrames = 1 + nextRandom( seed ) % 100;
+			size_t srcFrames = resampler->getInputFrames( dstFrames );
+			const double before = resampler->getBufferedFrames();
+			if( position + srcFrames > 400 )
+				position = 0;
+			MEDIA_CHECK( resampler->process( src.data() + 2 * position, &srcFrames, dst.data(), dstFrames ) == dstFrames );
+			position += srcFrames;
+			const double expected = before + double( srcFrames ) - double( dstFrames ) * resampler->getRatio();
+			MEDIA_CHECK( std::fabs( resampler->getBufferedFrames() - expected ) < 1e-3 );
+		}
+	}
+
+	template<typename T>
+	std::vector<T> resampleBlocks( const std::vector<T>& src, size_t channels, SimdLevel level, uint32_t seed )
+	{
+		AudioResamplerRef resampler = AudioResampler::create( channels );
+		std::vector<T> out, block;
+		size_t position = 0;
+		for( ;; ) {
+			resampler->setRatio( 0.99 + 0.02 * double( nextRandom( seed ) % 1000 ) / 1000.0 );
+			const size_t dstFrames = 1 + nextRandom( seed ) % 700;
+			size_t srcFrames = resampler->getInputFrames( dstFrames );
+			if( ( position + srcFrames ) * channels > src.size() )
+				return out;
+			block.resize( dstFrames * channels );
+			const size_t produced = resampler->process( src.data() + position * channels, &srcFrames, block.data(), dstFrames, level );
+			out.insert( out.end(), block.begin(), block.begin() + produced * channels );
+			position += srcFrames;
+		}
+	}
+
+	template<typename T>
+	void testLevels()
+	{
+		uint32_t seed = 7;
+		// Stereo, the vectorized multiples of 4 and 8, and odd counts taking the scalar path for the remainder.
+		for( size_t channels : { 1, 2, 3, 4, 6, 8, 12, 16, 18 } ) {
+			std::vector<T> src( channels * 6000 );
+			for( auto& sample : src )
+				sample = T( nextRandom( seed ) << 8 >> ( 32 - 8 * sizeof( T ) ) );
+			const std::vector<T> reference = resampleBlocks( src, channels, SimdLevel::SCALAR, channels );
+			MEDIA_CHECK( reference.size() > channels * 5000 );
+			for( SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON } ) {
+				if( isSimdLevelSupported( level ) )
+					MEDIA_CHECK( resampleBlocks( src, channels, level, channels ) == reference );
+			}
+		}
+	}
+}
+
+int main()
+{
+	testSnr();
+	testDelay();
+	testLevels<int16_t>();
+	testLevels<int32_t>();
+	return test::report( "AudioResamplerTest" );
+}
@@ -0,0 +1,135 @@
+// Checks AudioRingBuffer: the frame layouts create() accepts, reads across the wrap, silence for gaps in the packet times,
+// reads of overwritten or restarted audio failing, and readers racing the producer never returning torn samples.
+
+#include "AudioRingBuffer.h"
+#include "TestHarness.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	void testLayouts()
+	{
+		// Frames are stored as 32-bit words, anything else would lose samples.
+		MEDIA_CHECK( AudioRingBuffer::create( 2, 2, 100 ) );
+		MEDIA_CHECK( AudioRingBuffer::create( 16, 4, 100 ) );
+		MEDIA_CHECK( AudioRingBuffer::create( 1, 4, 100 ) );
+		MEDIA_CHECK( ! AudioRingBuffer::create( 1, 2, 100 ) );
+		MEDIA_CHECK( ! AudioRingBuffer::create( 3, 2, 100 ) );
+		MEDIA_CHECK( ! AudioRingBuffer::create( 2, 3, 100 ) );
+		MEDIA_CHECK( ! AudioRingBuffer::create( 0, 4, 100 ) );
+
+		AudioRingBufferRef buffer = AudioRingBuffer::create( 6, 2, 0 );
+		MEDIA_CHECK( buffer && buffer->getFrameBytes() == 12 && buffer->getCapacity() == 1 );
+	}
+
+	void testWrapAndGaps()
+	{
+		AudioRingBufferRef buffer = AudioRingBuffer::create( 2, 2, 100 );
+		std::vector<int16_t> packet( 2 * 30 );
+		for( size_t i = 0; i < packet.size(); ++i )
+			packet[i] = int16_t( i + 1 );
+
+		// 30 frames, a gap of 10, then 30 more.
+		buffer->write( 0, packet.data(), 30 );
+		buffer->write( 40, packet.data(), 30 );
+		std::vector<int16_t> out( 2 * 100 );
+		MEDIA_CHECK( buffer->read( 0, 70, out.data() ) );
+		MEDIA_CHECK( out[0] == 1 && out[59] == 60 && out[60] == 0 && out[79] == 0 && out[80] == 1 && out[139] == 60 );
+		AudioBufferStats stats = buffer->getStats();
+		MEDIA_CHECK( stats.silenceFrames == 10 && stats.writtenFrames == 60 && stats.endPosition == 70 );
+
+		// Past the capacity: the oldest frames are gone, the rest reads across the wrap.
+		buffer->write( 70, packet.data(), 30 );
+		buffer->write( 100, packet.data(), 30 );
+		MEDIA_CHECK( buffer->getStartPosition() == 30 && buffer->getEndPosition() == 130 );
+		MEDIA_CHECK( ! buffer->read( 25, 10, out.data() ) );
+		MEDIA_CHECK( ! buffer->read( 120, 11, out.data() ) );
+		MEDIA_CHECK( buffer->read( 90, 20, out.data() ) );
+		MEDIA_CHECK( out[0] == 41 && out[19] == 60 && out[20] == 1 && out[39] == 20 );
+
+		// Visiting hands out the same frames with their offsets.
+		std::vector<int16_t> visited( 2 * 100 );
+		MEDIA_CHECK( buffer->visit( 30, 100, [&]( const uint8_t * frames, size_t offset, size_t count ) {
+			const int16_t * samples = (const int16_t*)frames;
+			for( size_t i = 0; i < count * 2; ++i )
+				visited[offset * 2 + i] = samples[i];
+		} ) );
+		MEDIA_CHECK( buffer->read( 30, 100, out.data() ) && visited == out );
+
+		// A packet time going back starts the timeline over.
+		buffer->write( 10, packet.data(), 30 );
+		stats = buffer->getStats();
+		MEDIA_CHECK( stats.discontinuities == 1 && stats.startPosition == 10 && stats.endPosition == 40 );
+		MEDIA_CHECK( ! buffer->read( 100, 10, out.data() ) && buffer->read( 10, 30, out.data() ) );
+		MEDIA_CHECK( buffer->getStats().failedReads == 3 );
+	}
+
+	// Every sample holds its own position in the stream, a torn read shows up as a wrong value.
+	void testConcurrentReaders()
+	{
+		const size_t channels = 8;
+		const size_t packetFrames = 1600;
+		AudioRingBufferRef buffer = AudioRingBuffer::create( channels, 4, 4800 );
+		std::atomic<bool> done{ false };
+		std::atomic<int> torn{ 0 }, reads{ 0 };
+
+		std::thread producer( [&] {
+			std::vector<int32_t> packet( packetFrames * channels );
+			for( int64_t position = 0; position < int64_t( packetFrames ) * 2000; position += packetFrames ) {
+				for( size_t i = 0; i < packet.size(); ++i )
+					packet[i] = int32_t( position * channels + int64_t( i ) );
+				buffer->write( position, packet.data(), packetFrames );
+				std::this_thread::yield();
+			}
+			done = true;
+		} );
+
+		auto reader = [&]( bool visit ) {
+			std::vector<int32_t> out( packetFrames * channels );
+			while( ! done ) {
+				// Close to the start, where the producer overwrites.
+				const int64_t position = buffer->getEndPosition() - 4000;
+				std::this_thread::yield();
+				if( position < 0 )
+					continue;
+				bool read;
+				if( visit ) {
+					read = buffer->visit( position, packetFrames, [&]( const uint8_t * frames, size_t offset, size_t count ) {
+						const int32_t * samples = (const int32_t*)frames;
+						for( size_t i = 0; i < count * channels; ++i )
+							out[offset * channels + i] = samples[i];
+					} );
+				}
+				else
+					read = buffer->read( position, packetFrames, out.data() );
+				if( ! read )
+					continue;
+				++reads;
+				for( size_t i = 0; i < out.size(); ++i ) {
+					if( out[i] != int32_t( position * channels + int64_t( i ) ) ) {
+						++torn;
+						break;
+					}
+				}
+			}
+		};
+		std::thread first( reader, false ), second( reader, true );
+		producer.join();
+		first.join();
+		second.join();
+		MEDIA_CHECK( torn == 0 );
+		MEDIA_CHECK( reads > 0 );
+	}
+}
+
+int main()
+{
+	testLayouts();
+	testWrapAndGaps();
+	testConcurrentReaders();
+	return test::report( "AudioRingBufferTest" );
+}
@@ -0,0 +1,137 @@
+// Exercises the block cache behind DeckLinkMemoryAllocator through the same allocate, release, commit and decommit
+// sequence the driver follows: reuse of released blocks, Decommit() flushing the cache, eviction of cached blocks of
+// another size before an allocation is refused by the cap, and the committed and peak byte accounting.
+
+#include "FrameMemoryCache.h"
+#include "TestHarness.h"
+
+#include <cstring>
+
+using namespace media;
+
+namespace {
+	const size_t kPage = 4096;
+
+	MemoryAllocatorOptions makeOptions( size_t maxCommittedBytes )
+	{
+		MemoryAllocatorOptions options;
+		options.largePages = false;
+		options.prefault = true;
+		options.maxCommittedBytes = maxCommittedBytes;
+		return options;
+	}
+
+	void testReuse()
+	{
+		FrameMemoryCache cache( makeOptions( 0 ) );
+		void * first = cache.allocate( 5000 );
+		MEDIA_CHECK( first != nullptr );
+		MEDIA_CHECK( reinterpret_cast<uintptr_t>( first ) % kPage == 0 );
+		std::memset( first, 0x5A, 5000 );
+
+		MEDIA_CHECK( cache.release( first ) );
+		MEDIA_CHECK( ! cache.release( first ) );
+		MEDIA_CHECK( ! cache.release( &first ) );
+		MEDIA_CHECK( cache.getStats().cachedBuffers == 1 && cache.getStats().outstandingBuffers == 0 );
+
+		// Same size once rounded to pages: the cached block comes back.
+		void * second = cache.allocate( 8192 );
+		MEDIA_CHECK( second == first );
+		// Another size maps fresh memory and leaves nothing cached to take.
+		void * third = cache.allocate( 3 * kPage );
+		MEDIA_CHECK( third != nullptr && third != first );
+
+		const MemoryAllocatorStats stats = cache.getStats();
+		MEDIA_CHECK( stats.allocations == 3 && stats.reuses == 1 && stats.rejections == 0 );
+		MEDIA_CHECK( stats.outstandingBuffers == 2 && stats.cachedBuffers == 0 );
+		MEDIA_CHECK( stats.committedBytes == 5 * kPage );
+		cache.release( second );
+		cache.release( third );
+	}
+
+	void testDecommit()
+	{
+		FrameMemoryCache cache( makeOptions( 0 ) );
+		void * blocks[4];
+		for( auto& block : blocks )
+			block = cache.allocate( 2 * kPage );
+		cache.release( blocks[0] );
+		cache.release( blocks[1] );
+		MEDIA_CHECK( cache.getStats().cachedBuffers == 2 && cache.getStats().committedBytes == 8 * kPage );
+
+		// Decommit frees the cache, outstanding blocks stay valid.
+		cache.decommit();
+		MEDIA_CHECK( cache.getStats().cachedBuffers == 0 && cache.getStats().committedBytes == 4 * kPage );
+		std::memset( blocks[2], 1, 2 * kPage );
+
+		// Released while decommitted goes straight back to the system.
+		cache.release( blocks[2] );
+		MEDIA_CHECK( cache.getStats().cachedBuffers == 0 && cache.getStats().committedBytes == 2 * kPage );
+
+		// Commit caches again.
+		cache.commit();
+		cache.release( blocks[3] );
+		MEDIA_CHECK( cache.getStats().cachedBuffers == 1 && cache.getStats().committedBytes == 2 * kPage );
+		MEDIA_CHECK( cache.allocate( 2 * kPage ) == blocks[3] && cache.getStats().reuses == 1 );
+	}
+
+	void testCap()
+	{
+		// Room for three pages: two single page frames, then a mode change to two page frames.
+		FrameMemoryCache cache( makeOptions( 3 * kPage ) );
+		void * small[2] = { cache.allocate( kPage ), cache.allocate( kPage ) };
+		MEDIA_CHECK( small[0] && small[1] );
+		cache.release( small[0] );
+		cache.release( small[1] );
+		MEDIA_CHECK( cache.getStats().cachedBuffers == 2 && cache.getStats().committedBytes == 2 * kPage );
+
+		// 2 cached + 2 new pages would pass the cap: the stale small blocks go first and the allocation succeeds.
+		void * large = cache.allocate( 2 * kPage );
+		MEDIA_CHECK( large != nullptr );
+		MemoryAllocatorStats stats = cache.getStats();
+		MEDIA_CHECK( stats.cachedBuffers == 0 && stats.rejections == 0 && stats.committedBytes == 2 * kPage );
+
+		// Nothing left to evict, the next one is refused and counted.
+		MEDIA_CHECK( cache.allocate( 2 * kPage ) == nullptr );
+		stats = cache.getStats();
+		MEDIA_CHECK( stats.rejections == 1 && stats.allocations == 3 && stats.committedBytes == 2 * kPage );
+
+		// A single page still fits.
+		void * fits = cache.allocate( kPage );
+		MEDIA_CHECK( fits != nullptr && cache.getStats().committedBytes == 3 * kPage );
+		cache.release( fits );
+		cache.release( large );
+	}
+
+	void testPeak()
+	{
+		FrameMemoryCache cache( makeOptions( 0 ) );
+		void * a = cache.allocate( kPage );
+		void * b = cache.allocate( 4 * kPage );
+		MEDIA_CHECK( cache.getStats().peakCommittedBytes == 5 * kPage );
+
+		// Cached blocks still count as committed, freed ones no longer do. The peak stays.
+		cache.release( b );
+		MEDIA_CHECK( cache.getStats().committedBytes == 5 * kPage );
+		cache.decommit();
+		MEDIA_CHECK( cache.getStats().committedBytes == kPage && cache.getStats().peakCommittedBytes == 5 * kPage );
+
+		cache.commit();
+		void * c = cache.allocate( 2 * kPage );
+		MEDIA_CHECK( cache.getStats().committedBytes == 3 * kPage && cache.getStats().peakCommittedBytes == 5 * kPage );
+		void * d = cache.allocate( 8 * kPage );
+		MEDIA_CHECK( cache.getStats().peakCommittedBytes == 11 * kPage );
+		cache.release( a );
+		cache.release( c );
+		cache.release( d );
+	}
+}
+
+int main()
+{
+	testReuse();
+	testDecommit();
+	testCap();
+	testPeak();
+	return test::report( "FrameMemoryCacheTest" );
+}
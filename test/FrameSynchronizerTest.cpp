@@ -0,0 +1,115 @@
+// Runs FrameSynchronizer between two simulated clocks, an input 100 ppm fast or slow against a 50 Hz output, with and
+// without jitter on the arrival times. Checks that the input frames shown only ever advance by one, or repeat or skip a
+// single frame about every 10000 outputs, that a slip never flaps into the opposite event, and the measured drift.
+
+#include "FrameSynchronizer.h"
+#include "TestHarness.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	const int64_t kOutputPeriodUs = 20000;
+	// A slip every 10000 frames at 100 ppm, enough outputs for several of them.
+	const int kOutputs = 60000;
+
+	struct RunResult {
+		FrameSyncStats				stats;
+		std::vector<FrameSyncEvent>	events;
+		// Input frames shown by each output frame, from the first one selected.
+		std::vector<uint64_t>		shown;
+	};
+
+	//! Input frame i arrives at i * period plus up to +/- jitterUs, the output asks for a frame every kOutputPeriodUs. Both
+	//! sides run in time order on one thread, as they would interleave on the card clock.
+	RunResult run( double driftPpm, int64_t jitterUs )
+	{
+		FrameSynchronizer<uint64_t> sync;
+		sync.reset( kOutputPeriodUs );
+
+		const double inputPeriodUs = double( kOutputPeriodUs ) / ( 1.0 + driftPpm * 1e-6 );
+		uint32_t seed = 1;
+		uint64_t input = 0;
+		int64_t nextInputUs = 0;
+		RunResult result;
+		for( int output = 0; output < kOutputs; ++output ) {
+			const int64_t outputUs = int64_t( output ) * kOutputPeriodUs + kOutputPeriodUs / 2;
+			while( nextInputUs <= outputUs ) {
+				sync.push( input, nextInputUs );
+				++input;
+				seed = seed * 1664525u + 1013904223u;
+				const int64_t jitter = jitterUs > 0 ? int64_t( seed >> 8 ) % ( 2 * jitterUs + 1 ) - jitterUs : 0;
+				nextInputUs = int64_t( std::floor( double( input ) * inputPeriodUs + 0.5 ) ) + jitter;
+			}
+
+			uint64_t frame = 0;
+			if( sync.select( outputUs, &frame ) )
+				result.shown.push_back( frame );
+		}
+		result.stats = sync.getStats();
+		result.events = sync.popEvents();
+		return result;
+	}
+
+	//! \a spacingSlack is how far apart slips may be from the drift period, in output frames.
+	void checkRun( const RunResult& result, double driftPpm, double spacingSlack )
+	{
+		const FrameSyncEventType expected = driftPpm > 0.0 ? FrameSyncEventType::DROP : FrameSyncEventType::REPEAT;
+
+		// Every shown frame is the next one, or the same one again for a slow input, or one further for a fast input.
+		uint64_t repeats = 0, drops = 0;
+		for( size_t i = 1; i < result.shown.size(); ++i ) {
+			const uint64_t step = result.shown[i] - result.shown[i - 1];
+			MEDIA_CHECK( result.shown[i] >= result.shown[i - 1] && step <= 2 );
+			repeats += step == 0 ? 1 : 0;
+			drops += step == 2 ? 1 : 0;
+		}
+		MEDIA_CHECK( result.stats.repeats == repeats && result.stats.drops == drops );
+		MEDIA_CHECK( result.stats.selected == result.shown.size() && result.stats.outputs == uint64_t( kOutputs ) );
+		MEDIA_CHECK( result.stats.overflows == 0 && result.stats.lostEvents == 0 );
+
+		// One slip per 1 / 100 ppm frames, all the same way, single frames, evenly spaced.
+		const double expectedSlips = std::fabs( driftPpm ) * 1e-6 * kOutputs;
+		MEDIA_CHECK( std::fabs( double( repeats + drops ) - expectedSlips ) <= 1.0 );
+		MEDIA_CHECK( result.events.size() == repeats + drops );
+		for( size_t i = 0; i < result.events.size(); ++i ) {
+			MEDIA_CHECK( result.events[i].type == expected && result.events[i].count == 1 );
+			if( i > 0 ) {
+				const uint64_t spacing = result.events[i].outputIndex - result.events[i - 1].outputIndex;
+				MEDIA_CHECK( std::fabs( double( spacing ) - 1e6 / std::fabs( driftPpm ) ) <= spacingSlack );
+			}
+		}
+
+		MEDIA_CHECK( std::fabs( result.stats.driftPpm - driftPpm ) < 2.0 );
+		MEDIA_CHECK( std::fabs( result.stats.outputPeriodUs - double( kOutputPeriodUs ) ) < 1e-6 );
+	}
+
+	void testDrift()
+	{
+		checkRun( run( 100.0, 0 ), 100.0, 1.0 );
+		checkRun( run( -100.0, 0 ), -100.0, 1.0 );
+	}
+
+	void testJitter()
+	{
+		// Arrivals jittered by up to 1.5 ms, as far as the clocks drift apart in 15 s: the slips stay single events of the same
+		// kind, with no repeat followed by a drop or the other way around. The tracking loop keeps their timing within a few
+		// percent of the drift period, raw timestamps would move them by up to 750 frames.
+		checkRun( run( 100.0, 1500 ), 100.0, 300.0 );
+		checkRun( run( -100.0, 1500 ), -100.0, 300.0 );
+
+		// No drift, nothing to correct however noisy the arrivals.
+		RunResult locked = run( 0.0, 1500 );
+		MEDIA_CHECK( locked.stats.repeats == 0 && locked.stats.drops == 0 && locked.events.empty() );
+		MEDIA_CHECK( std::fabs( locked.stats.driftPpm ) < 2.0 );
+	}
+}
+
+int main()
+{
+	testDrift();
+	testJitter();
+	return test::report( "FrameSynchronizerTest" );
+}
@@ -0,0 +1,87 @@
+// Packs random 16-bit RGBA to each packed RGB format, unpacks it with every SIMD level the machine supports and packs it
+// again: the unpack kernels must agree with the scalar reference and the second pack must give back the first one byte
+// for byte. Widths cover partial 8 and 64 pixel groups, odd widths and rows padded past the SDK row bytes.
+
+#include "TestHarness.h"
+#include "VideoConversion.h"
+
+#include <vector>
+
+using namespace media;
+
+namespace {
+	const char * getFormatName( PackedRGBFormat format )
+	{
+		switch( format ) {
+		case PackedRGBFormat::R210:	return "r210";
+		case PackedRGBFormat::R10B:	return "R10b";
+		case PackedRGBFormat::R10L:	return "R10l";
+		case PackedRGBFormat::R12B:	return "R12B";
+		default:					return "R12L";
+		}
+	}
+
+	void testRoundTrip( PackedRGBFormat format, long width, long height, size_t rowPadding, uint32_t seed )
+	{
+		const size_t rgbaRowBytes = size_t( width ) * 8 + rowPadding;
+		const size_t packedRowBytes = getPackedRGBRowBytes( format, width ) + rowPadding;
+		std::vector<uint16_t> rgba( rgbaRowBytes / 2 * height );
+		for( auto& value : rgba ) {
+			seed = seed * 1664525u + 1013904223u;
+			value = uint16_t( seed >> 16 );
+		}
+
+		std::vector<uint8_t> packed( packedRowBytes * height, 0 );
+		convertRGBA16ToPackedRGB( format, rgba.data(), rgbaRowBytes, packed.data(), packedRowBytes, width, height );
+
+		std::vector<uint16_t> reference( rgbaRowBytes / 2 * height, 0 );
+		convertPackedRGBToRGBA16( format, packed.data(), packedRowBytes, reference.data(), rgbaRowBytes, width, height, SimdLevel::SCALAR );
+
+		for( SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON } ) {
+			if( ! isSimdLevelSupported( level ) )
+				continue;
+
+			std::vector<uint16_t> unpacked( rgbaRowBytes / 2 * height, 0 );
+			convertPackedRGBToRGBA16( format, packed.data(), packedRowBytes, unpacked.data(), rgbaRowBytes, width, height, level );
+			std::vector<uint8_t> repacked( packedRowBytes * height, 0 );
+			convertRGBA16ToPackedRGB( format, unpacked.data(), rgbaRowBytes, repacked.data(), packedRowBytes, width, height );
+
+			const bool sameUnpack = unpacked == reference;
+			const bool sameBytes = repacked == packed;
+			if( ! sameUnpack || ! sameBytes )
+				std::fprintf( stderr, "%s %s width %ld padding %u: unpack %s, repack %s\n", getFormatName( format ), getSimdLevelName( level ),
+					width, unsigned( rowPadding ), sameUnpack ? "same" : "differs", sameBytes ? "same" : "differs" );
+			MEDIA_CHECK( sameUnpack );
+			MEDIA_CHECK( sameBytes );
+		}
+	}
+}
+
+int main()
+{
+	const PackedRGBFormat formats[] = { PackedRGBFormat::R210, PackedRGBFormat::R10B, PackedRGBFormat::R10L, PackedRGBFormat::R12B, PackedRGBFormat::R12L };
+	const long widths[] = { 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 63, 64, 65, 127, 129, 719, 720, 1919, 1920 };
+	const size_t paddings[] = { 0, 8, 72 };
+
+	uint32_t seed = 1;
+	for( PackedRGBFormat format : formats ) {
+		for( long width : widths ) {
+			for( size_t padding : paddings )
+				testRoundTrip( format, width, 4, padding, seed++ );
+		}
+	}
+
+	// Video levels of the 10-bit formats: code 64 is black and 940 white, full range 12-bit is bit replicated.
+	uint8_t pixel[4];
+	uint16_t rgba[4];
+	const uint32_t whiteR210 = ( 940u << 20 ) | ( 940u << 10 ) | 940u;
+	pixel[0] = uint8_t( whiteR210 >> 24 ); pixel[1] = uint8_t( whiteR210 >> 16 ); pixel[2] = uint8_t( whiteR210 >> 8 ); pixel[3] = uint8_t( whiteR210 );
+	convertPackedRGBToRGBA16( PackedRGBFormat::R210, pixel, 4, rgba, 8, 1, 1, SimdLevel::SCALAR );
+	MEDIA_CHECK( rgba[0] == 65535 && rgba[1] == 65535 && rgba[2] == 65535 && rgba[3] == 65535 );
+	const uint32_t blackR210 = ( 64u << 20 ) | ( 64u << 10 ) | 64u;
+	pixel[0] = uint8_t( blackR210 >> 24 ); pixel[1] = uint8_t( blackR210 >> 16 ); pixel[2] = uint8_t( blackR210 >> 8 ); pixel[3] = uint8_t( blackR210 );
+	convertPackedRGBToRGBA16( PackedRGBFormat::R210, pixel, 4, rgba, 8, 1, 1, SimdLevel::SCALAR );
+	MEDIA_CHECK( rgba[0] == 0 && rgba[1] == 0 && rgba[2] == 0 && rgba[3] == 65535 );
+
+	return test::report( "PackedRGBRoundTripTest" );
+}
@@ -0,0 +1,224 @@
+// Drives PrerollController with the completion results of a simulated output: a card that airs one queued frame per tick
+// and a host callback that can stall. Checks growth on late and dropped frames with its holdoff, shrinking after
+// shrinkAfterMs of clean output, the min and max clamps, flushing, and the fallback when the queue depth is unknown.
+
+#include "PrerollController.h"
+#include "TestHarness.h"
+
+#include <deque>
+
+using namespace media;
+
+namespace {
+	// 59.94 Hz, 16.683 ms frames.
+	const int64_t kFrameDuration = 1001;
+	const int64_t kTimeScale = 60000;
+
+	PrerollOptions makeOptions( double targetLatencyMs, double shrinkAfterMs )
+	{
+		PrerollOptions options;
+		options.targetLatencyMs = targetLatencyMs;
+		options.minFrames = 2;
+		options.maxFrames = 6;
+		options.shrinkAfterMs = shrinkAfterMs;
+		return options;
+	}
+
+	//! The card airs the oldest queued frame on each tick. With nothing queued the previous frame repeats and the next one
+	//! to air is late. Completions reach the host callback right away, or all at once when a stall ends.
+	class SimulatedOutput {
+	public:
+		explicit SimulatedOutput( PrerollController& controller )
+			: mController( controller ), mQueued( controller.reset( kFrameDuration, kTimeScale ) ), mLateNext( false ), mMaxQueued( mQueued )
+		{
+		}
+
+		void run( int ticks, bool stalled = false )
+		{
+			for( int tick = 0; tick < ticks; ++tick ) {
+				if( mQueued > 0 ) {
+					--mQueued;
+					mPending.push_back( mLateNext ? FrameCompletion::LATE : FrameCompletion::COMPLETED );
+					mLateNext = false;
+				}
+				else
+					mLateNext = true;
+
+				if( ! stalled )
+					deliver();
+			}
+		}
+
+		void deliver()
+		{
+			while( ! mPending.empty() ) {
+				mQueued += mController.onFrameCompleted( mPending.front(), mQueued );
+				mPending.pop_front();
+				mMaxQueued = mQueued > mMaxQueued ? mQueued : mMaxQueued;
+			}
+		}
+
+		unsigned	getQueued() const { return mQueued; }
+		unsigned	getMaxQueued() const { return mMaxQueued; }
+	private:
+		PrerollController&				mController;
+		unsigned						mQueued;
+		bool							mLateNext;
+		unsigned						mMaxQueued;
+		std::deque<FrameCompletion>		mPending;
+	};
+
+	void testClamps()
+	{
+		// 50 ms at 59.94 Hz is 2.997 frames, rounded up to 3. Exactly 3 frames must not become 4.
+		PrerollController controller( makeOptions( 50.0, 1000.0 ) );
+		MEDIA_CHECK( controller.reset( kFrameDuration, kTimeScale ) == 3 );
+		PrerollController exact( makeOptions( 3 * 1000.0 * 1001.0 / 60000.0, 1000.0 ) );
+		MEDIA_CHECK( exact.reset( kFrameDuration, kTimeScale ) == 3 );
+
+		PrerollController tiny( makeOptions( 1.0, 1000.0 ) );
+		MEDIA_CHECK( tiny.reset( kFrameDuration, kTimeScale ) == 2 );
+		PrerollController huge( makeOptions( 1000.0, 1000.0 ) );
+		MEDIA_CHECK( huge.reset( kFrameDuration, kTimeScale ) == 6 );
+
+		// A max below the min is raised to it.
+		PrerollOptions inverted = makeOptions( 50.0, 1000.0 );
+		inverted.minFrames = 4;
+		inverted.maxFrames = 1;
+		PrerollController clamped( inverted );
+		MEDIA_CHECK( clamped.reset( kFrameDuration, kTimeScale ) == 4 );
+		MEDIA_CHECK( clamped.getOptions().maxFrames == 4 );
+	}
+
+	void testGrowthAndHoldoff()
+	{
+		PrerollController controller( makeOptions( 50.0, 1000.0 ) );
+		controller.reset( kFrameDuration, kTimeScale );
+
+		// Steady state replaces the completed frame.
+		MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::COMPLETED, 2 ) == 1 );
+
+		// A late frame grows the target by one, two frames scheduled to get there.
+		MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::LATE, 2 ) == 2 );
+		MEDIA_CHECK( controller.getTargetFrames() == 4 );
+
+		// The frames queued before the growth drain late too, they must not grow it again within the holdoff.
+		MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::DROPPED, 3 ) == 1 );
+		MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::LATE, 3 ) == 1 );
+		MEDIA_CHECK( controller.getTargetFrames() == 4 );
+		controller.onFrameCompleted( FrameCompletion::COMPLETED, 3 );
+		controller.onFrameCompleted( FrameCompletion::COMPLETED, 3 );
+
+		// Holdoff of 4 completions spent: the next underrun grows again, and so on up to maxFrames.
+		controller.onFrameCompleted( FrameCompletion::DROPPED, 3 );
+		MEDIA_CHECK( controller.getTargetFrames() == 5 );
+		for( int i = 0; i < 100; ++i )
+			controller.onFrameCompleted( FrameCompletion::LATE, 0 );
+		MEDIA_CHECK( controller.getTargetFrames() == 6 );
+
+		const PrerollStats stats = controller.getStats();
+		MEDIA_CHECK( stats.grows == 3 && stats.late == 102 && stats.dropped == 2 && stats.completed == 3 );
+		MEDIA_CHECK( stats.targetFrames == 6 && stats.bufferedFrames == 0 );
+		// Never more than two frames per completion, even far below the target.
+		MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::COMPLETED, 0 ) == 2 );
+	}
+
+	void testShrink()
+	{
+		// 1 s of clean output at 59.94 Hz is 60 completions.
+		PrerollController controller( makeOptions( 50.0, 1000.0 ) );
+		controller.reset( kFrameDuration, kTimeScale );
+		controller.onFrameCompleted( FrameCompletion::LATE, 2 );
+		MEDIA_CHECK( controller.getTargetFrames() == 4 );
+
+		for( int i = 0; i < 59; ++i )
+			controller.onFrameCompleted( FrameCompletion::COMPLETED, 3 );
+		MEDIA_CHECK( controller.getTargetFrames() == 4 );
+		// The 60th clean completion gives back a frame: nothing is scheduled in place of this one.
+		MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::COMPLETED, 3 ) == 0 );
+		MEDIA_CHECK( controller.getTargetFrames() == 3 && controller.getStats().shrinks == 1 );
+
+		// Never below the floor set by the latency target.
+		for( int i = 0; i < 600; ++i )
+			controller.onFrameCompleted( FrameCompletion::COMPLETED, 2 );
+		MEDIA_CHECK( controller.getTargetFrames() == 3 && controller.getStats().shrinks == 1 );
+
+		// An underrun within the holdoff does not grow the target but still restarts the clean count.
+		controller.onFrameCompleted( FrameCompletion::LATE, 2 );
+		for( int i = 0; i < 30; ++i )
+			controller.onFrameCompleted( FrameCompletion::COMPLETED, 3 );
+		MEDIA_CHECK( controller.getTargetFrames() == 4 );
+		controller.onFrameCompleted( FrameCompletion::DROPPED, 3 );
+		MEDIA_CHECK( controller.getTargetFrames() == 5 );
+		for( int i = 0; i < 2; ++i )
+			controller.onFrameCompleted( FrameCompletion::COMPLETED, 4 );
+		controller.onFrameCompleted( FrameCompletion::DROPPED, 4 );
+		for( int i = 0; i < 59; ++i )
+			controller.onFrameCompleted( FrameCompletion::COMPLETED, 4 );
+		MEDIA_CHECK( controller.getTargetFrames() == 5 );
+		controller.onFrameCompleted( FrameCompletion::COMPLETED, 4 );
+		MEDIA_CHECK( controller.getTargetFrames() == 4 && controller.getStats().grows == 3 );
+	}
+
+	void testFlushAndUnknownDepth()
+	{
+		PrerollController controller( makeOptions( 50.0, 1000.0 ) );
+		controller.reset( kFrameDuration, kTimeScale );
+		MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::FLUSHED, 0 ) == 0 );
+		MEDIA_CHECK( controller.getStats().flushed == 1 && controller.getTargetFrames() == 3 );
+
+		// Without a depth every result schedules exactly one frame, none when flushed, and the target never moves.
+		for( int i = 0; i < 50; ++i ) {
+			MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::LATE ) == 1 );
+			MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::DROPPED ) == 1 );
+			MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::COMPLETED ) == 1 );
+		}
+		MEDIA_CHECK( controller.onFrameCompleted( FrameCompletion::FLUSHED ) == 0 );
+		const PrerollStats stats = controller.getStats();
+		MEDIA_CHECK( stats.targetFrames == 3 && stats.grows == 0 && stats.shrinks == 0 );
+		MEDIA_CHECK( stats.late == 50 && stats.dropped == 50 && stats.completed == 50 && stats.flushed == 2 );
+	}
+
+	void testSimulatedOutput()
+	{
+		PrerollController controller( makeOptions( 50.0, 1000.0 ) );
+		SimulatedOutput output( controller );
+		output.run( 120 );
+		MEDIA_CHECK( controller.getStats().late == 0 && output.getQueued() == 3 );
+
+		// A stall longer than the queue underruns once: one growth, the holdoff absorbs the rest of the backlog.
+		output.run( 5, true );
+		output.deliver();
+		output.run( 30 );
+		PrerollStats stats = controller.getStats();
+		MEDIA_CHECK( stats.late == 1 && stats.grows == 1 && stats.targetFrames == 4 );
+		MEDIA_CHECK( output.getQueued() == 4 );
+
+		// A second of clean output gives the frame back.
+		output.run( 60 );
+		stats = controller.getStats();
+		MEDIA_CHECK( stats.shrinks == 1 && stats.targetFrames == 3 && output.getQueued() == 3 );
+
+		// Ever longer stalls push the queue to maxFrames and no further.
+		for( int stall = 4; stall < 20; ++stall ) {
+			output.run( stall, true );
+			output.deliver();
+			output.run( 10 );
+		}
+		MEDIA_CHECK( controller.getTargetFrames() == 6 && output.getMaxQueued() <= 6 );
+
+		// Then clean output brings it back down to the target, one frame per shrinkAfterMs.
+		output.run( 60 * 3 + 10 );
+		MEDIA_CHECK( controller.getTargetFrames() == 3 && output.getQueued() == 3 );
+	}
+}
+
+int main()
+{
+	testClamps();
+	testGrowthAndHoldoff();
+	testShrink();
+	testFlushAndUnknownDepth();
+	testSimulatedOutput();
+	return test::report( "PrerollControllerTest" );
+}
@@ -0,0 +1,181 @@
+// Drives SpscQueue the way queued frame delivery does: a synthetic capture thread pushes numbered frames while the main
+// thread pops them, checking order, overflow and skip counts, then merges two producers as DeckLinkInput merges the
+// capture and stall substitute queues.
+
+#include "SpscQueue.h"
+#include "TestHarness.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace media;
+
+namespace {
+	struct Frame {
+		int64_t		timeUs = 0;
+		int			source = 0;
+		uint64_t	sequence = 0;
+	};
+
+	bool isOlder( const Frame& a, const Frame& b ) { return a.timeUs < b.timeUs; }
+
+	void testFullQueue()
+	{
+		SpscQueue<int> queue( 4 );
+		MEDIA_CHECK( queue.empty() && queue.capacity() == 4 );
+		for( int i = 0; i < 4; ++i )
+			MEDIA_CHECK( queue.tryPush( i ) );
+		MEDIA_CHECK( ! queue.tryPush( 4 ) );
+		MEDIA_CHECK( ! queue.tryPush( 5 ) );
+		MEDIA_CHECK( queue.getOverflowCount() == 2 && queue.getPushCount() == 4 && queue.size() == 4 );
+
+		int value = -1;
+		MEDIA_CHECK( queue.front() && *queue.front() == 0 );
+		MEDIA_CHECK( queue.tryPop( value ) && value == 0 );
+		MEDIA_CHECK( queue.tryPush( 6 ) );
+		MEDIA_CHECK( queue.tryPopLatest( value ) && value == 6 );
+		MEDIA_CHECK( queue.getSkippedCount() == 3 && queue.getPopCount() == 5 && queue.empty() );
+		MEDIA_CHECK( ! queue.tryPop( value ) && ! queue.tryPopLatest( value ) && queue.front() == nullptr );
+	}
+
+	void testMoveOnly()
+	{
+		// Popping moves the item out, the slot no longer keeps it alive.
+		SpscQueue<std::shared_ptr<int>> queue( 2 );
+		std::shared_ptr<int> item = std::make_shared<int>( 7 );
+		MEDIA_CHECK( queue.tryPush( item ) );
+		std::shared_ptr<int> popped;
+		MEDIA_CHECK( queue.tryPop( popped ) && *popped == 7 );
+		popped.reset();
+		MEDIA_CHECK( item.use_count() == 1 );
+	}
+
+	// The producer never waits: what does not fit is an overflow, exactly as in the capture callback.
+	void testProducerThread( bool popLatest )
+	{
+		const uint64_t kFrames = 200000;
+		SpscQueue<Frame> queue( 8 );
+		std::atomic<uint64_t> rejected{ 0 };
+		std::thread producer( [&] {
+			for( uint64_t i = 0; i < kFrames; ++i ) {
+				Frame frame;
+				frame.sequence = i;
+				if( ! queue.tryPush( std::move( frame ) ) )
+					++rejected;
+				if( i % 64 == 0 )
+					std::this_thread::yield();
+			}
+		} );
+
+		uint64_t received = 0, previous = 0;
+		bool ordered = true, done = false;
+		while( ! done ) {
+			done = queue.getPushCount() + rejected == kFrames;
+			Frame frame;
+			while( popLatest ? queue.tryPopLatest( frame ) : queue.tryPop( frame ) ) {
+				ordered = ordered && ( received == 0 || frame.sequence > previous );
+				previous = frame.sequence;
+				++received;
+			}
+			std::this_thread::yield();
+		}
+		producer.join();
+
+		MEDIA_CHECK( ordered );
+		MEDIA_CHECK( queue.getOverflowCount() == rejected );
+		MEDIA_CHECK( queue.getPushCount() + queue.getOverflowCount() == kFrames );
+		MEDIA_CHECK( queue.getPopCount() == queue.getPushCount() );
+		MEDIA_CHECK( received + queue.getSkippedCount() == queue.getPushCount() );
+		if( ! popLatest )
+			MEDIA_CHECK( queue.getSkippedCount() == 0 );
+	}
+
+	void testMergeOrder()
+	{
+		// Capture frames until a stall, watchdog substitutes during it, capture again after: one global order.
+		SpscQueue<Frame> capture( 16 ), stall( 16 );
+		const int64_t captureTimes[] = { 0, 16, 33, 150, 166 };
+		const int64_t stallTimes[] = { 66, 83, 100, 116, 133 };
+		for( int64_t time : captureTimes ) {
+			Frame frame;
+			frame.timeUs = time;
+			capture.tryPush( std::move( frame ) );
+		}
+		for( int64_t time : stallTimes ) {
+			Frame frame;
+			frame.timeUs = time;
+			frame.source = 1;
+			stall.tryPush( std::move( frame ) );
+		}
+
+		std::vector<int64_t> times;
+		Frame frame;
+		while( tryPopOlder( capture, stall, frame, isOlder ) )
+			times.push_back( frame.timeUs );
+		const std::vector<int64_t> expected = { 0, 16, 33, 66, 83, 100, 116, 133, 150, 166 };
+		MEDIA_CHECK( times == expected );
+
+		// Equal times go to the first queue.
+		Frame a, b;
+		b.source = 1;
+		capture.tryPush( a );
+		stall.tryPush( b );
+		MEDIA_CHECK( tryPopOlder( capture, stall, frame, isOlder ) && frame.source == 0 );
+		MEDIA_CHECK( tryPopOlder( capture, stall, frame, isOlder ) && frame.source == 1 );
+		MEDIA_CHECK( ! tryPopOlder( capture, stall, frame, isOlder ) );
+	}
+
+	void testMergeThreads()
+	{
+		// A capture thread and a watchdog thread, one producer each. A shared clock stamps every frame, so each
+		// source must come out in order and the merge must never hand out a frame older than one it already did
+		// from the same queue.
+		const uint64_t kFrames = 100000;
+		SpscQueue<Frame> capture( 8 ), stall( 8 );
+		std::atomic<int64_t> clock{ 0 };
+		auto produce = [&]( SpscQueue<Frame>& queue, int source ) {
+			for( uint64_t i = 0; i < kFrames; ++i ) {
+				Frame frame;
+				frame.timeUs = clock++;
+				frame.source = source;
+				frame.sequence = i;
+				while( ! queue.tryPush( std::move( frame ) ) )
+					std::this_thread::yield();
+			}
+		};
+		std::thread captureThread( produce, std::ref( capture ), 0 );
+		std::thread stallThread( produce, std::ref( stall ), 1 );
+
+		uint64_t received[2] = { 0, 0 };
+		bool ordered = true;
+		Frame frame;
+		while( received[0] + received[1] < 2 * kFrames ) {
+			if( tryPopOlder( capture, stall, frame, isOlder ) ) {
+				ordered = ordered && frame.sequence == received[frame.source];
+				++received[frame.source];
+			}
+			else
+				std::this_thread::yield();
+		}
+		captureThread.join();
+		stallThread.join();
+
+		MEDIA_CHECK( ordered );
+		MEDIA_CHECK( received[0] == kFrames && received[1] == kFrames );
+		MEDIA_CHECK( capture.getPopCount() == kFrames && stall.getPopCount() == kFrames );
+		MEDIA_CHECK( capture.empty() && stall.empty() );
+	}
+}
+
+int main()
+{
+	testFullQueue();
+	testMoveOnly();
+	testProducerThread( false );
+	testProducerThread( true );
+	testMergeOrder();
+	testMergeThreads();
+	return test::report( "SpscQueueTest" );
+}
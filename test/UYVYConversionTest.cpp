@@ -0,0 +1,92 @@
+// Checks every UYVY to BGRA kernel the machine supports against the scalar reference on random 2vuy buffers: widths
+// around the 8 and 16 pixel vector steps, odd widths, and row strides padded past the pixels.
+
+#include "TestHarness.h"
+#include "VideoConversion.h"
+
+#include <vector>
+
+using namespace media;
+
+namespace {
+	const uint8_t kGuard = 0xA5;
+
+	struct Frame {
+		long			width, height;
+		size_t			srcRowBytes, dstRowBytes;
+		std::vector<uint8_t>	src;
+	};
+
+	Frame makeFrame( long width, long height, size_t srcPadding, size_t dstPadding, uint32_t seed )
+	{
+		Frame frame;
+		frame.width = width;
+		frame.height = height;
+		// Odd widths still end on a whole macropixel.
+		frame.srcRowBytes = size_t( ( width + 1 ) / 2 ) * 4 + srcPadding;
+		frame.dstRowBytes = size_t( width ) * 4 + dstPadding;
+		frame.src.resize( frame.srcRowBytes * height );
+		for( auto& byte : frame.src ) {
+			seed = seed * 1664525u + 1013904223u;
+			byte = uint8_t( seed >> 24 );
+		}
+		return frame;
+	}
+
+	std::vector<uint8_t> convert( const Frame& frame, YCbCrMatrix matrix, SimdLevel level )
+	{
+		std::vector<uint8_t> dst( frame.dstRowBytes * frame.height, kGuard );
+		convertUYVYToBGRA( frame.src.data(), frame.srcRowBytes, dst.data(), frame.dstRowBytes, frame.width, frame.height, matrix, level );
+		return dst;
+	}
+
+	void checkPadding( const Frame& frame, const std::vector<uint8_t>& dst )
+	{
+		bool untouched = true;
+		for( long row = 0; row < frame.height; ++row ) {
+			for( size_t i = size_t( frame.width ) * 4; i < frame.dstRowBytes; ++i )
+				untouched = untouched && dst[row * frame.dstRowBytes + i] == kGuard;
+		}
+		MEDIA_CHECK( untouched );
+	}
+}
+
+int main()
+{
+	const long widths[] = { 1, 2, 3, 6, 7, 8, 9, 14, 15, 16, 17, 18, 23, 31, 32, 33, 47, 63, 64, 65, 720, 1919, 1920 };
+	const size_t paddings[][2] = { { 0, 0 }, { 4, 12 }, { 64, 64 }, { 140, 4 } };
+	const YCbCrMatrix matrices[] = { YCbCrMatrix::BT601, YCbCrMatrix::BT709, YCbCrMatrix::BT2020 };
+	const SimdLevel levels[] = { SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON };
+
+	int compared = 0;
+	uint32_t seed = 1;
+	for( long width : widths ) {
+		for( const auto& padding : paddings ) {
+			const Frame frame = makeFrame( width, 5, padding[0], padding[1], seed++ );
+			for( YCbCrMatrix matrix : matrices ) {
+				const std::vector<uint8_t> reference = convert( frame, matrix, SimdLevel::SCALAR );
+				checkPadding( frame, reference );
+				for( SimdLevel level : levels ) {
+					if( ! isSimdLevelSupported( level ) )
+						continue;
+					const std::vector<uint8_t> result = convert( frame, matrix, level );
+					if( result != reference )
+						std::fprintf( stderr, "%s differs at width %ld, padding %u/%u\n", getSimdLevelName( level ), width, unsigned( padding[0] ), unsigned( padding[1] ) );
+					MEDIA_CHECK( result == reference );
+					++compared;
+				}
+			}
+		}
+	}
+
+	// Black, white and the extremes of chroma pin the reference itself.
+	const uint8_t black[4] = { 128, 16, 128, 16 }, white[4] = { 128, 235, 128, 235 };
+	uint8_t bgra[8];
+	convertUYVYToBGRA( black, 4, bgra, 8, 2, 1, YCbCrMatrix::BT709, SimdLevel::SCALAR );
+	MEDIA_CHECK( bgra[0] == 0 && bgra[1] == 0 && bgra[2] == 0 && bgra[3] == 255 );
+	convertUYVYToBGRA( white, 4, bgra, 8, 2, 1, YCbCrMatrix::BT709, SimdLevel::SCALAR );
+	MEDIA_CHECK( bgra[0] == 255 && bgra[1] == 255 && bgra[2] == 255 && bgra[7] == 255 );
+
+	std::printf( "%d kernel comparisons\n", compared );
+	return test::report( "UYVYConversionTest" );
+}